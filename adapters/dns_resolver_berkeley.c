@@ -0,0 +1,622 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+typedef struct DNS_RESOLVER_INSTANCE_TAG
+{
+    /* the instance is shared by its owners and the lookup thread, the last one to let go frees it */
+    pthread_mutex_t mutex;
+    int reference_count;
+    bool is_complete;
+    char* hostname;
+    int port;
+    DNS_RESOLVER_GETADDRINFO getaddrinfo_function;
+    DNS_RESOLVER_FREEADDRINFO freeaddrinfo_function;
+    /* a copy made by copy_addrinfo, NULL when the lookup failed */
+    struct addrinfo* addr_info;
+} DNS_RESOLVER_INSTANCE;
+
+typedef struct DNS_CACHE_ENTRY_TAG
+{
+    /* the entries are ordered from the most to the least recently used */
+    DLIST_ENTRY entry;
+    char* hostname;
+    int port;
+    bool has_result;
+    /* a copy made by copy_addrinfo, NULL for a failed lookup */
+    struct addrinfo* addr_info;
+    uint64_t expiry_time;
+    /* the lookup running for this host, shared by all the resolvers created meanwhile */
+    DNS_RESOLVER_INSTANCE* lookup;
+} DNS_CACHE_ENTRY;
+
+static pthread_mutex_t g_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DLIST_ENTRY g_cache_entries;
+static bool g_is_cache_initialized = false;
+static size_t g_cache_entry_count = 0;
+static TICK_COUNTER_HANDLE g_tick_counter = NULL;
+static DNS_RESOLVER_CACHE_OPTIONS g_cache_options =
+{
+    DNS_RESOLVER_DEFAULT_TTL_MS,
+    DNS_RESOLVER_DEFAULT_NEGATIVE_TTL_MS,
+    DNS_RESOLVER_DEFAULT_STALE_TTL_MS,
+    DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT
+};
+static DNS_RESOLVER_GETADDRINFO g_getaddrinfo_function = getaddrinfo;
+static DNS_RESOLVER_FREEADDRINFO g_freeaddrinfo_function = freeaddrinfo;
+
+static void free_addrinfo_copy(struct addrinfo* addr_info)
+{
+    while (addr_info != NULL)
+    {
+        struct addrinfo* next = addr_info->ai_next;
+        free(addr_info);
+        addr_info = next;
+    }
+}
+
+/* copies the address list, each node and its address in a single allocation; the canonical names are not kept */
+static int copy_addrinfo(const struct addrinfo* source, struct addrinfo** destination)
+{
+    int result = 0;
+    struct addrinfo** last = destination;
+
+    *destination = NULL;
+    for (; source != NULL; source = source->ai_next)
+    {
+        struct addrinfo* copy = (struct addrinfo*)malloc(sizeof(struct addrinfo) + source->ai_addrlen);
+        if (copy == NULL)
+        {
+            LogError("Allocation Failure: addrinfo copy");
+            free_addrinfo_copy(*destination);
+            *destination = NULL;
+            result = __LINE__;
+            break;
+        }
+
+        (void)memcpy(copy, source, sizeof(struct addrinfo));
+        copy->ai_addr = (struct sockaddr*)(copy + 1);
+        (void)memcpy(copy->ai_addr, source->ai_addr, source->ai_addrlen);
+        copy->ai_canonname = NULL;
+        copy->ai_next = NULL;
+        *last = copy;
+        last = &copy->ai_next;
+    }
+
+    return result;
+}
+
+/* must be called with g_cache_mutex held */
+static int get_current_time(uint64_t* now)
+{
+    int result;
+
+    if ((g_tick_counter == NULL) &&
+        ((g_tick_counter = tickcounter_create()) == NULL))
+    {
+        LogError("Failure: tickcounter_create failed.");
+        result = __LINE__;
+    }
+    else if (tickcounter_get_current_ms(g_tick_counter, now) != 0)
+    {
+        LogError("Failure: tickcounter_get_current_ms failed.");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+/* must be called with g_cache_mutex held */
+static DNS_CACHE_ENTRY* find_cache_entry(const char* hostname, int port)
+{
+    DNS_CACHE_ENTRY* result = NULL;
+
+    if (g_is_cache_initialized)
+    {
+        PDLIST_ENTRY list_entry;
+        for (list_entry = g_cache_entries.Flink; list_entry != &g_cache_entries; list_entry = list_entry->Flink)
+        {
+            DNS_CACHE_ENTRY* cache_entry = containingRecord(list_entry, DNS_CACHE_ENTRY, entry);
+            if ((cache_entry->port == port) &&
+                (strcmp(cache_entry->hostname, hostname) == 0))
+            {
+                result = cache_entry;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/* must be called with g_cache_mutex held */
+static void remove_cache_entry(DNS_CACHE_ENTRY* cache_entry)
+{
+    (void)DList_RemoveEntryList(&cache_entry->entry);
+    g_cache_entry_count--;
+    free_addrinfo_copy(cache_entry->addr_info);
+    free(cache_entry->hostname);
+    free(cache_entry);
+}
+
+/* must be called with g_cache_mutex held */
+static void trim_cache(size_t max_entry_count)
+{
+    while (g_cache_entry_count > max_entry_count)
+    {
+        remove_cache_entry(containingRecord(g_cache_entries.Blink, DNS_CACHE_ENTRY, entry));
+    }
+}
+
+/* must be called with g_cache_mutex held */
+static DNS_CACHE_ENTRY* add_cache_entry(const char* hostname, int port)
+{
+    DNS_CACHE_ENTRY* result;
+
+    if (!g_is_cache_initialized)
+    {
+        DList_InitializeListHead(&g_cache_entries);
+        g_is_cache_initialized = true;
+    }
+
+    if ((result = (DNS_CACHE_ENTRY*)malloc(sizeof(DNS_CACHE_ENTRY))) == NULL)
+    {
+        LogError("Allocation Failure: DNS_CACHE_ENTRY");
+    }
+    else if ((result->hostname = (char*)malloc(strlen(hostname) + 1)) == NULL)
+    {
+        LogError("Allocation Failure: hostname");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        (void)strcpy(result->hostname, hostname);
+        result->port = port;
+        result->has_result = false;
+        result->addr_info = NULL;
+        result->expiry_time = 0;
+        result->lookup = NULL;
+
+        trim_cache(g_cache_options.max_entry_count - 1);
+        DList_InsertHeadList(&g_cache_entries, &result->entry);
+        g_cache_entry_count++;
+    }
+
+    return result;
+}
+
+/* must be called with g_cache_mutex held */
+static void store_lookup_result(DNS_RESOLVER_INSTANCE* lookup, const struct addrinfo* addr_info)
+{
+    DNS_CACHE_ENTRY* cache_entry = find_cache_entry(lookup->hostname, lookup->port);
+    uint64_t now;
+
+    if ((cache_entry != NULL) &&
+        (cache_entry->lookup == lookup))
+    {
+        cache_entry->lookup = NULL;
+    }
+
+    if (g_cache_options.max_entry_count == 0)
+    {
+        /* the cache is disabled */
+    }
+    else if (get_current_time(&now) != 0)
+    {
+        LogError("Failure: cannot cache the addresses of %s.", lookup->hostname);
+    }
+    else if ((cache_entry == NULL) &&
+        ((cache_entry = add_cache_entry(lookup->hostname, lookup->port)) == NULL))
+    {
+        LogError("Failure: cannot cache the addresses of %s.", lookup->hostname);
+    }
+    else if (addr_info != NULL)
+    {
+        struct addrinfo* addr_info_copy;
+
+        /* Codes_SRS_DNS_RESOLVER_01_014: [ When a lookup succeeds, its addresses shall be cached for ttl_ms. ]*/
+        if (copy_addrinfo(addr_info, &addr_info_copy) != 0)
+        {
+            LogError("Failure: cannot cache the addresses of %s.", lookup->hostname);
+        }
+        else
+        {
+            free_addrinfo_copy(cache_entry->addr_info);
+            cache_entry->addr_info = addr_info_copy;
+            cache_entry->has_result = true;
+            cache_entry->expiry_time = now + g_cache_options.ttl_ms;
+        }
+    }
+    else if ((cache_entry->addr_info != NULL) &&
+        (now < cache_entry->expiry_time + g_cache_options.stale_ttl_ms))
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_018: [ If the background lookup fails, the stale addresses shall be kept until stale_ttl_ms elapses. ]*/
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_015: [ When a lookup fails, the failure shall be cached for negative_ttl_ms. ]*/
+        free_addrinfo_copy(cache_entry->addr_info);
+        cache_entry->addr_info = NULL;
+        cache_entry->has_result = true;
+        cache_entry->expiry_time = now + g_cache_options.negative_ttl_ms;
+    }
+}
+
+static void free_dns_resolver(DNS_RESOLVER_INSTANCE* dns_resolver_instance)
+{
+    free_addrinfo_copy(dns_resolver_instance->addr_info);
+    (void)pthread_mutex_destroy(&dns_resolver_instance->mutex);
+    free(dns_resolver_instance->hostname);
+    free(dns_resolver_instance);
+}
+
+static void release_dns_resolver(DNS_RESOLVER_INSTANCE* dns_resolver_instance)
+{
+    int reference_count;
+
+    (void)pthread_mutex_lock(&dns_resolver_instance->mutex);
+    reference_count = --dns_resolver_instance->reference_count;
+    (void)pthread_mutex_unlock(&dns_resolver_instance->mutex);
+
+    if (reference_count == 0)
+    {
+        free_dns_resolver(dns_resolver_instance);
+    }
+}
+
+static DNS_RESOLVER_INSTANCE* allocate_dns_resolver(int reference_count)
+{
+    DNS_RESOLVER_INSTANCE* result = (DNS_RESOLVER_INSTANCE*)malloc(sizeof(DNS_RESOLVER_INSTANCE));
+    if (result == NULL)
+    {
+        LogError("Allocation Failure: DNS_RESOLVER_INSTANCE");
+    }
+    else if (pthread_mutex_init(&result->mutex, NULL) != 0)
+    {
+        LogError("Failure: pthread_mutex_init failed");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->reference_count = reference_count;
+        result->is_complete = false;
+        result->hostname = NULL;
+        result->port = 0;
+        result->getaddrinfo_function = g_getaddrinfo_function;
+        result->freeaddrinfo_function = g_freeaddrinfo_function;
+        result->addr_info = NULL;
+    }
+
+    return result;
+}
+
+/* the lookup thread stores its result in the cache, then in the resolver */
+static void* lookup_thread(void* context)
+{
+    DNS_RESOLVER_INSTANCE* dns_resolver_instance = (DNS_RESOLVER_INSTANCE*)context;
+    char port_string[16];
+    struct addrinfo addr_hint;
+    struct addrinfo* lookup_result;
+    struct addrinfo* addr_info = NULL;
+    int error;
+
+    (void)memset(&addr_hint, 0, sizeof(addr_hint));
+    addr_hint.ai_family = AF_UNSPEC;
+    addr_hint.ai_socktype = SOCK_STREAM;
+    addr_hint.ai_protocol = 0;
+    (void)sprintf(port_string, "%u", (unsigned int)dns_resolver_instance->port);
+
+    /* Codes_SRS_DNS_RESOLVER_01_005: [ The lookup thread shall call getaddrinfo, or the function set with dns_resolver_set_lookup_functions, for the host name and port. ]*/
+    error = dns_resolver_instance->getaddrinfo_function(dns_resolver_instance->hostname, port_string, &addr_hint, &lookup_result);
+    if (error != 0)
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_006: [ If getaddrinfo fails, the lookup shall complete without addresses. ]*/
+        LogError("Failure: getaddrinfo failed for %s: %d (%s).", dns_resolver_instance->hostname, error, gai_strerror(error));
+    }
+    else
+    {
+        if (copy_addrinfo(lookup_result, &addr_info) != 0)
+        {
+            LogError("Failure: cannot copy the addresses of %s.", dns_resolver_instance->hostname);
+        }
+
+        dns_resolver_instance->freeaddrinfo_function(lookup_result);
+    }
+
+    (void)pthread_mutex_lock(&g_cache_mutex);
+    store_lookup_result(dns_resolver_instance, addr_info);
+    (void)pthread_mutex_unlock(&g_cache_mutex);
+
+    (void)pthread_mutex_lock(&dns_resolver_instance->mutex);
+    dns_resolver_instance->addr_info = addr_info;
+    dns_resolver_instance->is_complete = true;
+    (void)pthread_mutex_unlock(&dns_resolver_instance->mutex);
+
+    release_dns_resolver(dns_resolver_instance);
+    return NULL;
+}
+
+/* must be called with g_cache_mutex held, reference_count counts the lookup thread */
+static DNS_RESOLVER_INSTANCE* start_lookup(const char* hostname, int port, int reference_count)
+{
+    DNS_RESOLVER_INSTANCE* result = allocate_dns_resolver(reference_count);
+    if (result == NULL)
+    {
+        /* already logged */
+    }
+    else if ((result->hostname = (char*)malloc(strlen(hostname) + 1)) == NULL)
+    {
+        LogError("Allocation Failure: hostname");
+        free_dns_resolver(result);
+        result = NULL;
+    }
+    else
+    {
+        pthread_attr_t thread_attributes;
+        pthread_t thread;
+
+        (void)strcpy(result->hostname, hostname);
+        result->port = port;
+
+        /* Codes_SRS_DNS_RESOLVER_01_003: [ dns_resolver_create shall start a detached thread that performs the lookup. ]*/
+        if (pthread_attr_init(&thread_attributes) != 0)
+        {
+            LogError("Failure: pthread_attr_init failed");
+            free_dns_resolver(result);
+            result = NULL;
+        }
+        else
+        {
+            if ((pthread_attr_setdetachstate(&thread_attributes, PTHREAD_CREATE_DETACHED) != 0) ||
+                (pthread_create(&thread, &thread_attributes, lookup_thread, result) != 0))
+            {
+                LogError("Failure: cannot start the lookup thread");
+                free_dns_resolver(result);
+                result = NULL;
+            }
+
+            (void)pthread_attr_destroy(&thread_attributes);
+        }
+    }
+
+    return result;
+}
+
+/* creates a resolver that is already complete, with a copy of cached addresses */
+static DNS_RESOLVER_INSTANCE* create_complete_dns_resolver(const struct addrinfo* addr_info)
+{
+    DNS_RESOLVER_INSTANCE* result = allocate_dns_resolver(1);
+    if (result == NULL)
+    {
+        /* already logged */
+    }
+    else if (copy_addrinfo(addr_info, &result->addr_info) != 0)
+    {
+        free_dns_resolver(result);
+        result = NULL;
+    }
+    else
+    {
+        result->is_complete = true;
+    }
+
+    return result;
+}
+
+DNS_RESOLVER_HANDLE dns_resolver_create(const char* hostname, int port)
+{
+    DNS_RESOLVER_INSTANCE* result;
+
+    /* Codes_SRS_DNS_RESOLVER_01_001: [ If hostname is NULL, dns_resolver_create shall fail and return NULL. ]*/
+    if (hostname == NULL)
+    {
+        LogError("Invalid argument: hostname is NULL");
+        result = NULL;
+    }
+    else
+    {
+        DNS_CACHE_ENTRY* cache_entry = NULL;
+        uint64_t now = 0;
+
+        (void)pthread_mutex_lock(&g_cache_mutex);
+
+        if ((g_cache_options.max_entry_count > 0) &&
+            (get_current_time(&now) == 0))
+        {
+            cache_entry = find_cache_entry(hostname, port);
+            if (cache_entry == NULL)
+            {
+                cache_entry = add_cache_entry(hostname, port);
+            }
+            else
+            {
+                (void)DList_RemoveEntryList(&cache_entry->entry);
+                DList_InsertHeadList(&g_cache_entries, &cache_entry->entry);
+            }
+        }
+
+        if ((cache_entry != NULL) &&
+            cache_entry->has_result &&
+            (now < cache_entry->expiry_time))
+        {
+            /* Codes_SRS_DNS_RESOLVER_01_013: [ If the cache holds an unexpired result for hostname and port, dns_resolver_create shall return a resolver that is already complete with a copy of it. ]*/
+            result = create_complete_dns_resolver(cache_entry->addr_info);
+        }
+        else if ((cache_entry != NULL) &&
+            (cache_entry->addr_info != NULL) &&
+            (now < cache_entry->expiry_time + g_cache_options.stale_ttl_ms))
+        {
+            /* Codes_SRS_DNS_RESOLVER_01_017: [ If the cached addresses expired less than stale_ttl_ms ago, dns_resolver_create shall return them and start a background lookup that refreshes them, unless one is running. ]*/
+            result = create_complete_dns_resolver(cache_entry->addr_info);
+            if (cache_entry->lookup == NULL)
+            {
+                cache_entry->lookup = start_lookup(hostname, port, 1);
+            }
+        }
+        else if ((cache_entry != NULL) &&
+            (cache_entry->lookup != NULL))
+        {
+            /* Codes_SRS_DNS_RESOLVER_01_016: [ If a lookup of the same hostname and port is running, dns_resolver_create shall return a handle to it instead of starting another one. ]*/
+            result = cache_entry->lookup;
+            (void)pthread_mutex_lock(&result->mutex);
+            result->reference_count++;
+            (void)pthread_mutex_unlock(&result->mutex);
+        }
+        else
+        {
+            /* Codes_SRS_DNS_RESOLVER_01_002: [ dns_resolver_create shall allocate a new resolver and copy the host name. ]*/
+            result = start_lookup(hostname, port, 2);
+            if (cache_entry != NULL)
+            {
+                cache_entry->lookup = result;
+            }
+        }
+
+        (void)pthread_mutex_unlock(&g_cache_mutex);
+
+        /* Codes_SRS_DNS_RESOLVER_01_004: [ If any error occurs, dns_resolver_create shall fail and return NULL. ]*/
+    }
+
+    return result;
+}
+
+void dns_resolver_destroy(DNS_RESOLVER_HANDLE dns_resolver)
+{
+    /* Codes_SRS_DNS_RESOLVER_01_007: [ If dns_resolver is NULL, dns_resolver_destroy shall do nothing. ]*/
+    if (dns_resolver != NULL)
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_008: [ If the lookup is still running, dns_resolver_destroy shall return immediately and the resolver shall be freed when the lookup completes. ]*/
+        release_dns_resolver(dns_resolver);
+    }
+}
+
+bool dns_resolver_is_complete(DNS_RESOLVER_HANDLE dns_resolver)
+{
+    bool result;
+
+    /* Codes_SRS_DNS_RESOLVER_01_009: [ If dns_resolver is NULL, dns_resolver_is_complete shall return false. ]*/
+    if (dns_resolver == NULL)
+    {
+        LogError("Invalid argument: dns_resolver is NULL");
+        result = false;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_010: [ dns_resolver_is_complete shall return true once the lookup completed, whether it succeeded or not. ]*/
+        (void)pthread_mutex_lock(&dns_resolver->mutex);
+        result = dns_resolver->is_complete;
+        (void)pthread_mutex_unlock(&dns_resolver->mutex);
+    }
+
+    return result;
+}
+
+const struct addrinfo* dns_resolver_get_addrinfo(DNS_RESOLVER_HANDLE dns_resolver)
+{
+    const struct addrinfo* result;
+
+    /* Codes_SRS_DNS_RESOLVER_01_011: [ If dns_resolver is NULL, dns_resolver_get_addrinfo shall return NULL. ]*/
+    if (dns_resolver == NULL)
+    {
+        LogError("Invalid argument: dns_resolver is NULL");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_012: [ dns_resolver_get_addrinfo shall return the resolved addresses, or NULL if the lookup failed or is still running. ]*/
+        (void)pthread_mutex_lock(&dns_resolver->mutex);
+        result = dns_resolver->is_complete ? dns_resolver->addr_info : NULL;
+        (void)pthread_mutex_unlock(&dns_resolver->mutex);
+    }
+
+    return result;
+}
+
+int dns_resolver_set_cache_options(const DNS_RESOLVER_CACHE_OPTIONS* options)
+{
+    int result;
+
+    /* Codes_SRS_DNS_RESOLVER_01_019: [ If options is NULL, dns_resolver_set_cache_options shall fail and return a non-zero value. ]*/
+    if (options == NULL)
+    {
+        LogError("Invalid argument: options is NULL");
+        result = __LINE__;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_020: [ dns_resolver_set_cache_options shall store the options and drop the least recently used entries that exceed max_entry_count. ]*/
+        (void)pthread_mutex_lock(&g_cache_mutex);
+        g_cache_options = *options;
+        if (g_is_cache_initialized)
+        {
+            trim_cache(g_cache_options.max_entry_count);
+        }
+        (void)pthread_mutex_unlock(&g_cache_mutex);
+        result = 0;
+    }
+
+    return result;
+}
+
+void dns_resolver_clear_cache(void)
+{
+    /* Codes_SRS_DNS_RESOLVER_01_021: [ dns_resolver_clear_cache shall drop all the cache entries. Running lookups shall complete normally. ]*/
+    (void)pthread_mutex_lock(&g_cache_mutex);
+    if (g_is_cache_initialized)
+    {
+        trim_cache(0);
+    }
+
+    if (g_tick_counter != NULL)
+    {
+        tickcounter_destroy(g_tick_counter);
+        g_tick_counter = NULL;
+    }
+    (void)pthread_mutex_unlock(&g_cache_mutex);
+}
+
+int dns_resolver_set_lookup_functions(DNS_RESOLVER_GETADDRINFO getaddrinfo_function, DNS_RESOLVER_FREEADDRINFO freeaddrinfo_function)
+{
+    int result;
+
+    /* Codes_SRS_DNS_RESOLVER_01_022: [ If only one of getaddrinfo_function and freeaddrinfo_function is NULL, dns_resolver_set_lookup_functions shall fail and return a non-zero value. ]*/
+    if ((getaddrinfo_function == NULL) != (freeaddrinfo_function == NULL))
+    {
+        LogError("Invalid arguments: getaddrinfo_function=%p, freeaddrinfo_function=%p", getaddrinfo_function, freeaddrinfo_function);
+        result = __LINE__;
+    }
+    else
+    {
+        /* Codes_SRS_DNS_RESOLVER_01_023: [ dns_resolver_set_lookup_functions shall make the lookups started afterwards call getaddrinfo_function and freeaddrinfo_function, or getaddrinfo and freeaddrinfo when both are NULL. ]*/
+        (void)pthread_mutex_lock(&g_cache_mutex);
+        g_getaddrinfo_function = (getaddrinfo_function == NULL) ? getaddrinfo : getaddrinfo_function;
+        g_freeaddrinfo_function = (freeaddrinfo_function == NULL) ? freeaddrinfo : freeaddrinfo_function;
+        (void)pthread_mutex_unlock(&g_cache_mutex);
+        result = 0;
+    }
+
+    return result;
+}
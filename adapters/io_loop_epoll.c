@@ -0,0 +1,367 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "azure_c_shared_utility/io_loop.h"
+#include "azure_c_shared_utility/timer_wheel.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+/*number of events collected by one epoll_wait call*/
+#define IO_LOOP_MAX_EVENTS      64
+
+typedef struct IO_LOOP_REGISTRATION_INSTANCE_TAG
+{
+    DLIST_ENTRY entry;
+    struct IO_LOOP_INSTANCE_TAG* io_loop;
+    int fd;
+    ON_IO_LOOP_EVENT on_io_loop_event;
+    void* context;
+    bool is_unregistered;
+} IO_LOOP_REGISTRATION_INSTANCE;
+
+typedef struct IO_LOOP_INSTANCE_TAG
+{
+    int epoll_fd;
+    TIMER_WHEEL_HANDLE timer_wheel;
+    size_t registration_count;
+    /*registrations removed while events are being dispatched; freed once the dispatch completes*/
+    bool is_dispatching;
+    DLIST_ENTRY unregistered_list;
+} IO_LOOP_INSTANCE;
+
+static uint32_t to_epoll_events(unsigned int events)
+{
+    uint32_t result = 0;
+
+    if ((events & IO_LOOP_EVENT_READ) != 0)
+    {
+        result |= EPOLLIN | EPOLLRDHUP;
+    }
+    if ((events & IO_LOOP_EVENT_WRITE) != 0)
+    {
+        result |= EPOLLOUT;
+    }
+
+    return result;
+}
+
+static unsigned int from_epoll_events(uint32_t epoll_events)
+{
+    unsigned int result = 0;
+
+    if ((epoll_events & (EPOLLIN | EPOLLRDHUP)) != 0)
+    {
+        result |= IO_LOOP_EVENT_READ;
+    }
+    if ((epoll_events & EPOLLOUT) != 0)
+    {
+        result |= IO_LOOP_EVENT_WRITE;
+    }
+    if ((epoll_events & (EPOLLERR | EPOLLHUP)) != 0)
+    {
+        result |= IO_LOOP_EVENT_ERROR;
+    }
+
+    return result;
+}
+
+static void free_unregistered(IO_LOOP_INSTANCE* io_loop)
+{
+    while (!DList_IsListEmpty(&io_loop->unregistered_list))
+    {
+        IO_LOOP_REGISTRATION_INSTANCE* registration = containingRecord(DList_RemoveHeadList(&io_loop->unregistered_list), IO_LOOP_REGISTRATION_INSTANCE, entry);
+        free(registration);
+    }
+}
+
+IO_LOOP_HANDLE io_loop_create(void)
+{
+    IO_LOOP_INSTANCE* result;
+
+    /*Codes_SRS_IO_LOOP_01_001: [ io_loop_create shall allocate a new io loop, create an epoll instance and a timer wheel. ]*/
+    result = (IO_LOOP_INSTANCE*)malloc(sizeof(IO_LOOP_INSTANCE));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IO_LOOP_01_002: [ If any error occurs, io_loop_create shall fail and return NULL. ]*/
+        LogError("Cannot allocate io loop");
+    }
+    else
+    {
+        result->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (result->epoll_fd == -1)
+        {
+            /*Codes_SRS_IO_LOOP_01_002: [ If any error occurs, io_loop_create shall fail and return NULL. ]*/
+            LogError("epoll_create1 failed, errno=%d (%s)", errno, strerror(errno));
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            result->timer_wheel = timer_wheel_create();
+            if (result->timer_wheel == NULL)
+            {
+                /*Codes_SRS_IO_LOOP_01_002: [ If any error occurs, io_loop_create shall fail and return NULL. ]*/
+                LogError("Cannot create the timer wheel");
+                (void)close(result->epoll_fd);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                result->registration_count = 0;
+                result->is_dispatching = false;
+                DList_InitializeListHead(&result->unregistered_list);
+            }
+        }
+    }
+
+    return result;
+}
+
+void io_loop_destroy(IO_LOOP_HANDLE io_loop)
+{
+    /*Codes_SRS_IO_LOOP_01_003: [ If io_loop is NULL, io_loop_destroy shall do nothing. ]*/
+    if (io_loop == NULL)
+    {
+        LogError("NULL io_loop");
+    }
+    else
+    {
+        if (io_loop->registration_count != 0)
+        {
+            LogError("io loop destroyed with %zu descriptors still registered", io_loop->registration_count);
+        }
+
+        /*Codes_SRS_IO_LOOP_01_004: [ io_loop_destroy shall close the epoll instance, destroy the timer wheel and free the io loop. ]*/
+        free_unregistered(io_loop);
+        timer_wheel_destroy(io_loop->timer_wheel);
+        (void)close(io_loop->epoll_fd);
+        free(io_loop);
+    }
+}
+
+IO_LOOP_REGISTRATION_HANDLE io_loop_register(IO_LOOP_HANDLE io_loop, int fd, unsigned int events, ON_IO_LOOP_EVENT on_io_loop_event, void* context)
+{
+    IO_LOOP_REGISTRATION_INSTANCE* result;
+
+    if ((io_loop == NULL) ||
+        (fd < 0) ||
+        (on_io_loop_event == NULL))
+    {
+        /*Codes_SRS_IO_LOOP_01_005: [ If io_loop or on_io_loop_event is NULL or fd is negative, io_loop_register shall fail and return NULL. ]*/
+        LogError("Bad arguments: io_loop = %p, fd = %d, on_io_loop_event = %p",
+            io_loop, fd, on_io_loop_event);
+        result = NULL;
+    }
+    else
+    {
+        result = (IO_LOOP_REGISTRATION_INSTANCE*)malloc(sizeof(IO_LOOP_REGISTRATION_INSTANCE));
+        if (result == NULL)
+        {
+            /*Codes_SRS_IO_LOOP_01_007: [ If any error occurs, io_loop_register shall fail and return NULL. ]*/
+            LogError("Cannot allocate registration");
+        }
+        else
+        {
+            struct epoll_event epoll_event;
+
+            result->io_loop = io_loop;
+            result->fd = fd;
+            result->on_io_loop_event = on_io_loop_event;
+            result->context = context;
+            result->is_unregistered = false;
+
+            /*Codes_SRS_IO_LOOP_01_006: [ io_loop_register shall add fd to the epoll instance, watching for the requested events. ]*/
+            (void)memset(&epoll_event, 0, sizeof(epoll_event));
+            epoll_event.events = to_epoll_events(events);
+            epoll_event.data.ptr = result;
+            if (epoll_ctl(io_loop->epoll_fd, EPOLL_CTL_ADD, fd, &epoll_event) != 0)
+            {
+                /*Codes_SRS_IO_LOOP_01_007: [ If any error occurs, io_loop_register shall fail and return NULL. ]*/
+                LogError("epoll_ctl(EPOLL_CTL_ADD) failed, errno=%d (%s)", errno, strerror(errno));
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                io_loop->registration_count++;
+            }
+        }
+    }
+
+    return result;
+}
+
+int io_loop_modify(IO_LOOP_REGISTRATION_HANDLE registration, unsigned int events)
+{
+    int result;
+
+    if (registration == NULL)
+    {
+        /*Codes_SRS_IO_LOOP_01_008: [ If registration is NULL, io_loop_modify shall fail and return a non-zero value. ]*/
+        LogError("NULL registration");
+        result = __LINE__;
+    }
+    else
+    {
+        struct epoll_event epoll_event;
+
+        /*Codes_SRS_IO_LOOP_01_009: [ io_loop_modify shall change the events watched for the descriptor. ]*/
+        (void)memset(&epoll_event, 0, sizeof(epoll_event));
+        epoll_event.events = to_epoll_events(events);
+        epoll_event.data.ptr = registration;
+        if (epoll_ctl(registration->io_loop->epoll_fd, EPOLL_CTL_MOD, registration->fd, &epoll_event) != 0)
+        {
+            /*Codes_SRS_IO_LOOP_01_010: [ If epoll_ctl fails, io_loop_modify shall fail and return a non-zero value. ]*/
+            LogError("epoll_ctl(EPOLL_CTL_MOD) failed, errno=%d (%s)", errno, strerror(errno));
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+void io_loop_unregister(IO_LOOP_REGISTRATION_HANDLE registration)
+{
+    if (registration == NULL)
+    {
+        /*Codes_SRS_IO_LOOP_01_011: [ If registration is NULL, io_loop_unregister shall do nothing. ]*/
+        LogError("NULL registration");
+    }
+    else
+    {
+        IO_LOOP_INSTANCE* io_loop = registration->io_loop;
+
+        /*Codes_SRS_IO_LOOP_01_012: [ io_loop_unregister shall remove the descriptor from the epoll instance and free the registration. ]*/
+        if (epoll_ctl(io_loop->epoll_fd, EPOLL_CTL_DEL, registration->fd, NULL) != 0)
+        {
+            LogError("epoll_ctl(EPOLL_CTL_DEL) failed, errno=%d (%s)", errno, strerror(errno));
+        }
+
+        io_loop->registration_count--;
+
+        if (io_loop->is_dispatching)
+        {
+            /*Codes_SRS_IO_LOOP_01_013: [ If events are being dispatched, io_loop_unregister shall defer freeing the registration until the dispatch completes, and no further events shall be reported for it. ]*/
+            registration->is_unregistered = true;
+            DList_InsertTailList(&io_loop->unregistered_list, &registration->entry);
+        }
+        else
+        {
+            free(registration);
+        }
+    }
+}
+
+int io_loop_wait(IO_LOOP_HANDLE io_loop, uint32_t timeout_ms)
+{
+    int result;
+
+    if (io_loop == NULL)
+    {
+        /*Codes_SRS_IO_LOOP_01_014: [ If io_loop is NULL, io_loop_wait shall fail and return a non-zero value. ]*/
+        LogError("NULL io_loop");
+        result = __LINE__;
+    }
+    else if (io_loop->is_dispatching)
+    {
+        /*Codes_SRS_IO_LOOP_01_019: [ If io_loop_wait is called from an event or timer callback, it shall fail and return a non-zero value. ]*/
+        LogError("io_loop_wait cannot be called from a callback");
+        result = __LINE__;
+    }
+    else
+    {
+        uint32_t timer_timeout_ms;
+        int epoll_timeout;
+        int event_count;
+        struct epoll_event events[IO_LOOP_MAX_EVENTS];
+
+        /*Codes_SRS_IO_LOOP_01_015: [ io_loop_wait shall block in epoll_wait for at most timeout_ms, or less if a timer of the timer wheel expires earlier. ]*/
+        if (timer_wheel_get_next_timeout(io_loop->timer_wheel, &timer_timeout_ms) != 0)
+        {
+            timer_timeout_ms = 0;
+        }
+        if (timer_timeout_ms < timeout_ms)
+        {
+            timeout_ms = timer_timeout_ms;
+        }
+
+        if ((timeout_ms == IO_LOOP_WAIT_INFINITE) ||
+            (timeout_ms > INT32_MAX))
+        {
+            epoll_timeout = -1;
+        }
+        else
+        {
+            epoll_timeout = (int)timeout_ms;
+        }
+
+        event_count = epoll_wait(io_loop->epoll_fd, events, IO_LOOP_MAX_EVENTS, epoll_timeout);
+        if ((event_count < 0) &&
+            (errno != EINTR))
+        {
+            /*Codes_SRS_IO_LOOP_01_016: [ If epoll_wait fails for any other reason than EINTR, io_loop_wait shall fail and return a non-zero value. ]*/
+            LogError("epoll_wait failed, errno=%d (%s)", errno, strerror(errno));
+            result = __LINE__;
+        }
+        else
+        {
+            int i;
+
+            /*Codes_SRS_IO_LOOP_01_017: [ io_loop_wait shall call on_io_loop_event for every ready descriptor that was not unregistered by a previous callback. ]*/
+            io_loop->is_dispatching = true;
+            for (i = 0; i < event_count; i++)
+            {
+                IO_LOOP_REGISTRATION_INSTANCE* registration = (IO_LOOP_REGISTRATION_INSTANCE*)events[i].data.ptr;
+                if (!registration->is_unregistered)
+                {
+                    registration->on_io_loop_event(registration->context, from_epoll_events(events[i].events));
+                }
+            }
+
+            /*Codes_SRS_IO_LOOP_01_018: [ io_loop_wait shall then call timer_wheel_dowork to process the expired timers. ]*/
+            timer_wheel_dowork(io_loop->timer_wheel);
+            io_loop->is_dispatching = false;
+
+            free_unregistered(io_loop);
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+TIMER_WHEEL_HANDLE io_loop_get_timer_wheel(IO_LOOP_HANDLE io_loop)
+{
+    TIMER_WHEEL_HANDLE result;
+
+    if (io_loop == NULL)
+    {
+        /*Codes_SRS_IO_LOOP_01_020: [ If io_loop is NULL, io_loop_get_timer_wheel shall return NULL. ]*/
+        LogError("NULL io_loop");
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IO_LOOP_01_021: [ io_loop_get_timer_wheel shall return the timer wheel owned by the io loop. ]*/
+        result = io_loop->timer_wheel;
+    }
+
+    return result;
+}
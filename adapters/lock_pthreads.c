@@ -2,12 +2,291 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <pthread.h>
+#ifdef LOCK_COLLECT_STATISTICS
+#include <time.h>
+#endif
 #include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/xlogging.h"
 
 DEFINE_ENUM_STRINGS(LOCK_RESULT, LOCK_RESULT_VALUES);
 
+#ifdef LOCK_COLLECT_STATISTICS
+
+/*when LOCK_COLLECT_STATISTICS is defined the handle points to an instrumented lock instead of a bare pthread_mutex_t*/
+/*the mutex must stay the first member: condition_pthreads.c casts the LOCK_HANDLE to pthread_mutex_t* */
+typedef struct LOCK_INSTANCE_TAG
+{
+	pthread_mutex_t mutex;
+	/*guards the counters only, so that they can be read by a thread that holds (or waits for) mutex*/
+	pthread_mutex_t statistics_mutex;
+	char* name;
+	uint64_t acquire_count;
+	uint64_t contended_count;
+	uint64_t total_wait_ns;
+	struct LOCK_INSTANCE_TAG* next;
+} LOCK_INSTANCE;
+
+/*all live instrumented locks, so that Lock_DumpStatistics can walk them*/
+static pthread_mutex_t lock_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LOCK_INSTANCE* lock_registry_head = NULL;
+
+static uint64_t get_monotonic_ns(void)
+{
+	struct timespec now;
+	uint64_t result;
+	if (clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+	{
+		result = 0;
+	}
+	else
+	{
+		result = ((uint64_t)now.tv_sec * 1000000000) + (uint64_t)now.tv_nsec;
+	}
+	return result;
+}
+
+static void register_lock(LOCK_INSTANCE* lock_instance)
+{
+	(void)pthread_mutex_lock(&lock_registry_mutex);
+	lock_instance->next = lock_registry_head;
+	lock_registry_head = lock_instance;
+	(void)pthread_mutex_unlock(&lock_registry_mutex);
+}
+
+static void unregister_lock(LOCK_INSTANCE* lock_instance)
+{
+	LOCK_INSTANCE** current;
+	(void)pthread_mutex_lock(&lock_registry_mutex);
+	for (current = &lock_registry_head; *current != NULL; current = &(*current)->next)
+	{
+		if (*current == lock_instance)
+		{
+			*current = lock_instance->next;
+			break;
+		}
+	}
+	(void)pthread_mutex_unlock(&lock_registry_mutex);
+}
+
+static void copy_statistics(LOCK_INSTANCE* lock_instance, LOCK_STATISTICS* statistics)
+{
+	/*SRS_LOCK_01_007:[ Lock_GetStatistics shall not acquire the measured lock, so that it can be called by the thread that holds it]*/
+	(void)pthread_mutex_lock(&lock_instance->statistics_mutex);
+	statistics->name = lock_instance->name;
+	statistics->acquire_count = lock_instance->acquire_count;
+	statistics->contended_count = lock_instance->contended_count;
+	statistics->total_wait_ns = lock_instance->total_wait_ns;
+	(void)pthread_mutex_unlock(&lock_instance->statistics_mutex);
+}
+
+static void count_acquisition(LOCK_INSTANCE* lock_instance, int is_contended, uint64_t wait_ns)
+{
+	(void)pthread_mutex_lock(&lock_instance->statistics_mutex);
+	lock_instance->acquire_count++;
+	if (is_contended)
+	{
+		lock_instance->contended_count++;
+		lock_instance->total_wait_ns += wait_ns;
+	}
+	(void)pthread_mutex_unlock(&lock_instance->statistics_mutex);
+}
+
+LOCK_HANDLE Lock_Init_Named(const char* name)
+{
+	LOCK_INSTANCE* lock_instance = (LOCK_INSTANCE*)malloc(sizeof(LOCK_INSTANCE));
+	if (NULL != lock_instance)
+	{
+		lock_instance->name = NULL;
+		lock_instance->acquire_count = 0;
+		lock_instance->contended_count = 0;
+		lock_instance->total_wait_ns = 0;
+		lock_instance->next = NULL;
+
+		if ((name != NULL) &&
+			((lock_instance->name = (char*)malloc(strlen(name) + 1)) == NULL))
+		{
+			/*SRS_LOCK_99_003:[ On Error Should return NULL]*/
+			free(lock_instance);
+			lock_instance = NULL;
+			LogError("Failed to allocate lock name");
+		}
+		else if (pthread_mutex_init(&lock_instance->mutex, NULL) != 0)
+		{
+			/*SRS_LOCK_99_003:[ On Error Should return NULL]*/
+			free(lock_instance->name);
+			free(lock_instance);
+			lock_instance = NULL;
+			LogError("Failed to initialize mutex");
+		}
+		else if (pthread_mutex_init(&lock_instance->statistics_mutex, NULL) != 0)
+		{
+			/*SRS_LOCK_99_003:[ On Error Should return NULL]*/
+			(void)pthread_mutex_destroy(&lock_instance->mutex);
+			free(lock_instance->name);
+			free(lock_instance);
+			lock_instance = NULL;
+			LogError("Failed to initialize statistics mutex");
+		}
+		else
+		{
+			if (name != NULL)
+			{
+				(void)strcpy(lock_instance->name, name);
+			}
+			register_lock(lock_instance);
+		}
+	}
+
+	return (LOCK_HANDLE)lock_instance;
+}
+
+/*SRS_LOCK_99_002:[ This API on success will return a valid lock handle which should be a non NULL value]*/
+LOCK_HANDLE Lock_Init(void)
+{
+	return Lock_Init_Named(NULL);
+}
+
+LOCK_RESULT Lock(LOCK_HANDLE handle)
+{
+	LOCK_RESULT result;
+	if (handle == NULL)
+	{
+		/*SRS_LOCK_99_007:[ This API on NULL handle passed returns LOCK_ERROR]*/
+		result = LOCK_ERROR;
+		LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+	}
+	else
+	{
+		LOCK_INSTANCE* lock_instance = (LOCK_INSTANCE*)handle;
+		int trylock_result = pthread_mutex_trylock(&lock_instance->mutex);
+		if (trylock_result == 0)
+		{
+			/*SRS_LOCK_99_005:[ This API on success should return LOCK_OK]*/
+			count_acquisition(lock_instance, 0, 0);
+			result = LOCK_OK;
+		}
+		else if (trylock_result == EBUSY)
+		{
+			uint64_t wait_start = get_monotonic_ns();
+			if (pthread_mutex_lock(&lock_instance->mutex) == 0)
+			{
+				/*SRS_LOCK_99_005:[ This API on success should return LOCK_OK]*/
+				count_acquisition(lock_instance, 1, get_monotonic_ns() - wait_start);
+				result = LOCK_OK;
+			}
+			else
+			{
+				/*SRS_LOCK_99_006:[ This API on error should return LOCK_ERROR]*/
+				result = LOCK_ERROR;
+				LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+			}
+		}
+		else
+		{
+			/*SRS_LOCK_99_006:[ This API on error should return LOCK_ERROR]*/
+			result = LOCK_ERROR;
+			LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+		}
+	}
+	return result;
+}
+
+LOCK_RESULT Unlock(LOCK_HANDLE handle)
+{
+	LOCK_RESULT result;
+	if (handle == NULL)
+	{
+		/*SRS_LOCK_99_011:[ This API on NULL handle passed returns LOCK_ERROR]*/
+		result = LOCK_ERROR;
+		LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+	}
+	else
+	{
+		if (pthread_mutex_unlock(&((LOCK_INSTANCE*)handle)->mutex) == 0)
+		{
+			/*SRS_LOCK_99_009:[ This API on success should return LOCK_OK]*/
+			result = LOCK_OK;
+		}
+		else
+		{
+			/*SRS_LOCK_99_010:[ This API on error should return LOCK_ERROR]*/
+			result = LOCK_ERROR;
+			LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+		}
+	}
+	return result;
+}
+
+LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
+{
+	LOCK_RESULT result = LOCK_OK;
+	if (NULL == handle)
+	{
+		/*SRS_LOCK_99_013:[ This API on NULL handle passed returns LOCK_ERROR]*/
+		result = LOCK_ERROR;
+		LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+	}
+	else
+	{
+		LOCK_INSTANCE* lock_instance = (LOCK_INSTANCE*)handle;
+		unregister_lock(lock_instance);
+
+		/*SRS_LOCK_99_012:[ This API frees the memory pointed by handle]*/
+		if (pthread_mutex_destroy(&lock_instance->mutex) == 0)
+		{
+			(void)pthread_mutex_destroy(&lock_instance->statistics_mutex);
+			free(lock_instance->name);
+			free(lock_instance);
+		}
+		else
+		{
+			register_lock(lock_instance);
+			result = LOCK_ERROR;
+			LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
+		}
+	}
+
+	return result;
+}
+
+LOCK_RESULT Lock_GetStatistics(LOCK_HANDLE handle, LOCK_STATISTICS* statistics)
+{
+	LOCK_RESULT result;
+	if ((handle == NULL) || (statistics == NULL))
+	{
+		result = LOCK_ERROR;
+		LogError("invalid arguments: LOCK_HANDLE handle=%p, LOCK_STATISTICS* statistics=%p", handle, statistics);
+	}
+	else
+	{
+		copy_statistics((LOCK_INSTANCE*)handle, statistics);
+		result = LOCK_OK;
+	}
+	return result;
+}
+
+void Lock_DumpStatistics(void)
+{
+	LOCK_INSTANCE* current;
+	(void)pthread_mutex_lock(&lock_registry_mutex);
+	for (current = lock_registry_head; current != NULL; current = current->next)
+	{
+		LOCK_STATISTICS statistics;
+		copy_statistics(current, &statistics);
+		LogInfo("lock %s (%p): acquired=%llu contended=%llu total_wait_us=%llu",
+			(statistics.name == NULL) ? "<unnamed>" : statistics.name, current,
+			(unsigned long long)statistics.acquire_count,
+			(unsigned long long)statistics.contended_count,
+			(unsigned long long)(statistics.total_wait_ns / 1000));
+	}
+	(void)pthread_mutex_unlock(&lock_registry_mutex);
+}
+
+#else
+
 /*SRS_LOCK_99_002:[ This API on success will return a valid lock handle which should be a non NULL value]*/
 LOCK_HANDLE Lock_Init(void)
 {
@@ -22,10 +301,16 @@ LOCK_HANDLE Lock_Init(void)
 			LogError("Failed to initialize mutex");
 		}
 	}
-	
+
 	return (LOCK_HANDLE)lock_mtx;
 }
 
+/*without LOCK_COLLECT_STATISTICS the name is not kept anywhere*/
+LOCK_HANDLE Lock_Init_Named(const char* name)
+{
+	(void)name;
+	return Lock_Init();
+}
 
 LOCK_RESULT Lock(LOCK_HANDLE handle)
 {
@@ -101,8 +386,21 @@ LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
 			LogError("(result = %s)", ENUM_TO_STRING(LOCK_RESULT, result));
 		}
 	}
-	
+
 	return result;
 }
 
+LOCK_RESULT Lock_GetStatistics(LOCK_HANDLE handle, LOCK_STATISTICS* statistics)
+{
+	(void)handle;
+	(void)statistics;
+	LogError("lock statistics are not available, build with LOCK_COLLECT_STATISTICS defined");
+	return LOCK_ERROR;
+}
+
+void Lock_DumpStatistics(void)
+{
+	LogInfo("lock statistics are not available, build with LOCK_COLLECT_STATISTICS defined");
+}
 
+#endif
@@ -75,4 +75,23 @@ LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
         free( (LPCRITICAL_SECTION) handle );
     }
     return result;
-}
\ No newline at end of file
+}
+/*this adapter does not collect contention counters, the name is only accepted for API compatibility*/
+LOCK_HANDLE Lock_Init_Named(const char* name)
+{
+    (void)name;
+    return Lock_Init();
+}
+
+LOCK_RESULT Lock_GetStatistics(LOCK_HANDLE handle, LOCK_STATISTICS* statistics)
+{
+    (void)handle;
+    (void)statistics;
+    LogError("lock statistics are not supported by this adapter");
+    return LOCK_ERROR;
+}
+
+void Lock_DumpStatistics(void)
+{
+    LogInfo("lock statistics are not supported by this adapter");
+}
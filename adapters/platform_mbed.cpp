@@ -52,6 +52,10 @@ int platform_init(void)
     {
         result = __LINE__;
     }
+    else if (tlsio_wolfssl_init() != 0)
+    {
+        result = __LINE__;
+    }
     else
     {
         result = 0;
@@ -67,5 +71,6 @@ const IO_INTERFACE_DESCRIPTION* platform_get_default_tlsio(void)
 
 void platform_deinit(void)
 {
+    tlsio_wolfssl_deinit();
     EthernetInterface::disconnect();
 }
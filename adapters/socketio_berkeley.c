@@ -13,145 +13,1297 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include "azure_c_shared_utility/list.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#ifdef __linux__
+#include "azure_c_shared_utility/io_loop.h"
+#endif
+
+#define SOCKET_SUCCESS          0
+#define INVALID_SOCKET          -1
+
+// connect timeout in seconds
+#define CONNECT_TIMEOUT         10
+
+// how often the io loop checks the progress of an open
+#define OPEN_POLL_INTERVAL_MS   10
+
+// delay before the next address is tried while a connection is in progress (RFC 8305)
+#define CONNECTION_ATTEMPT_DELAY_MS 250
+
+// maximum number of buffers gathered in one sendmsg call
+#if defined(IOV_MAX)
+#define MAX_SEND_IOVEC_COUNT    IOV_MAX
+#elif defined(__linux__)
+#define MAX_SEND_IOVEC_COUNT    1024
+#else
+#define MAX_SEND_IOVEC_COUNT    16
+#endif
+
+typedef enum IO_STATE_TAG
+{
+    IO_STATE_CLOSED,
+    IO_STATE_OPENING,
+    IO_STATE_OPEN,
+    IO_STATE_CLOSING,
+    IO_STATE_ERROR
+} IO_STATE;
+
+typedef struct PENDING_SOCKET_IO_TAG
+{
+    unsigned char* bytes;
+    size_t size;
+    /* number of bytes at the beginning of bytes that were already sent */
+    size_t sent;
+    /* when the send was queued, in microseconds */
+    uint64_t send_time;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+    LIST_HANDLE pending_io_list;
+} PENDING_SOCKET_IO;
+
+typedef struct SOCKET_OPTION_TAG
+{
+    const char* name;
+    int level;
+    int option_name;
+} SOCKET_OPTION;
+
+/*the options that map to an int setsockopt, they are remembered and applied to every socket this instance creates*/
+static const SOCKET_OPTION socket_options[] =
+{
+    { "tcp_keepalive", SOL_SOCKET, SO_KEEPALIVE },
+#ifdef __APPLE__
+    { "tcp_keepalive_time", IPPROTO_TCP, TCP_KEEPALIVE },
+#else
+    { "tcp_keepalive_time", IPPROTO_TCP, TCP_KEEPIDLE },
+#endif
+    { "tcp_keepalive_interval", IPPROTO_TCP, TCP_KEEPINTVL },
+    { "tcp_nodelay", IPPROTO_TCP, TCP_NODELAY },
+    { "tcp_send_buffer_size", SOL_SOCKET, SO_SNDBUF },
+    { "tcp_receive_buffer_size", SOL_SOCKET, SO_RCVBUF },
+#ifdef TCP_QUICKACK
+    { "tcp_quickack", IPPROTO_TCP, TCP_QUICKACK },
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+    { "tcp_notsent_lowat", IPPROTO_TCP, TCP_NOTSENT_LOWAT },
+#endif
+#ifdef TCP_USER_TIMEOUT
+    { "tcp_user_timeout", IPPROTO_TCP, TCP_USER_TIMEOUT },
+#endif
+#ifdef SO_BUSY_POLL
+    { "socket_busy_poll", SOL_SOCKET, SO_BUSY_POLL },
+#endif
+};
+
+#define SOCKET_OPTION_COUNT     (sizeof(socket_options) / sizeof(socket_options[0]))
+
+typedef struct CONNECT_ATTEMPT_TAG
+{
+    int socket;
+#ifdef __linux__
+    IO_LOOP_REGISTRATION_HANDLE io_loop_registration;
+#endif
+} CONNECT_ATTEMPT;
+
+typedef struct SOCKET_IO_INSTANCE_TAG
+{
+    int socket;
+    ON_BYTES_RECEIVED on_bytes_received;
+    ON_IO_ERROR on_io_error;
+    void* on_bytes_received_context;
+    void* on_io_error_context;
+    char* hostname;
+    int port;
+    IO_STATE io_state;
+    LIST_HANDLE pending_io_list;
+    /*allocated on the first receive and reused by every recv call*/
+    unsigned char* receive_buffer;
+    size_t receive_buffer_size;
+    SOCKETIO_RECEIVE_STATISTICS receive_statistics;
+    /*bytes_received is taken from receive_statistics*/
+    XIO_STATISTICS statistics;
+    /*0 for no limit, compared with statistics.pending_send_bytes*/
+    size_t send_high_watermark;
+    size_t send_low_watermark;
+    XIO_WRITABLE_CALLBACK on_writable;
+    /*set when the queue reached the high watermark, cleared once it drained to the low watermark*/
+    bool is_send_blocked;
+    /*the values of the socket_options set so far*/
+    int socket_option_values[SOCKET_OPTION_COUNT];
+    bool socket_option_is_set[SOCKET_OPTION_COUNT];
+    /*while opening, the host name lookup and then the connection are advanced by socketio_dowork*/
+    ON_IO_OPEN_COMPLETE on_io_open_complete;
+    void* on_io_open_complete_context;
+    DNS_RESOLVER_HANDLE dns_resolver;
+    TICK_COUNTER_HANDLE tick_counter;
+    uint64_t connect_start_time;
+    /*the resolved addresses, in the order they are tried, and one attempt per address tried so far*/
+    const struct addrinfo** connect_addresses;
+    size_t connect_address_count;
+    CONNECT_ATTEMPT* connect_attempts;
+    size_t connect_attempt_count;
+    uint64_t last_connect_attempt_time;
+#ifdef __linux__
+    /*when an io loop is set, the socket is serviced by io_loop_wait instead of socketio_dowork*/
+    IO_LOOP_HANDLE io_loop;
+    IO_LOOP_REGISTRATION_HANDLE io_loop_registration;
+    unsigned int io_loop_events;
+    TIMER_HANDLE open_timer;
+#endif
+} SOCKET_IO_INSTANCE;
+
+static size_t find_socket_option(const char* name)
+{
+    size_t i;
+
+    for (i = 0; i < SOCKET_OPTION_COUNT; i++)
+    {
+        if (strcmp(socket_options[i].name, name) == 0)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*this function will clone an option given by name and value*/
+static void* socketio_CloneOption(const char* name, const void* value)
+{
+    void* result;
+
+    if ((name == NULL) || (value == NULL))
+    {
+        LogError("invalid parameter detected: const char* name=%p, const void* value=%p", name, value);
+        result = NULL;
+    }
+    else if ((strcmp(name, OPTION_RECEIVE_BUFFER_SIZE) == 0) ||
+        (strcmp(name, OPTION_SEND_HIGH_WATERMARK) == 0) ||
+        (strcmp(name, OPTION_SEND_LOW_WATERMARK) == 0))
+    {
+        result = malloc(sizeof(size_t));
+        if (result == NULL)
+        {
+            LogError("unable to clone the %s option", name);
+        }
+        else
+        {
+            *(size_t*)result = *(const size_t*)value;
+        }
+    }
+    else if (find_socket_option(name) < SOCKET_OPTION_COUNT)
+    {
+        result = malloc(sizeof(int));
+        if (result == NULL)
+        {
+            LogError("unable to clone the %s option", name);
+        }
+        else
+        {
+            *(int*)result = *(const int*)value;
+        }
+    }
+    else
+    {
+        LogError("not handled option : %s", name);
+        result = NULL;
+    }
+
+    return result;
+}
+
+/*this function destroys an option previously created*/
+static void socketio_DestroyOption(const char* name, const void* value)
+{
+    if ((name == NULL) || (value == NULL))
+    {
+        LogError("invalid parameter detected: const char* name=%p, const void* value=%p", name, value);
+    }
+    else if ((strcmp(name, OPTION_RECEIVE_BUFFER_SIZE) == 0) ||
+        (strcmp(name, OPTION_SEND_HIGH_WATERMARK) == 0) ||
+        (strcmp(name, OPTION_SEND_LOW_WATERMARK) == 0) ||
+        (find_socket_option(name) < SOCKET_OPTION_COUNT))
+    {
+        free((void*)value);
+    }
+    else
+    {
+        LogError("not handled option : %s", name);
+    }
+}
+
+static OPTIONHANDLER_HANDLE socketio_retrieveoptions(CONCRETE_IO_HANDLE handle)
+{
+    OPTIONHANDLER_HANDLE result;
+    if (handle == NULL)
+    {
+        LogError("invalid parameter detected: CONCRETE_IO_HANDLE handle=%p", handle);
+        result = NULL;
+    }
+    else
+    {
+        result = OptionHandler_Create(socketio_CloneOption, socketio_DestroyOption, socketio_setoption);
+        if (result == NULL)
+        {
+            LogError("unable to OptionHandler_Create");
+            /*return as is*/
+        }
+        else
+        {
+            SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)handle;
+            size_t i;
+
+            for (i = 0; i < SOCKET_OPTION_COUNT; i++)
+            {
+                if (socket_io_instance->socket_option_is_set[i] &&
+                    (OptionHandler_AddOption(result, socket_options[i].name, &socket_io_instance->socket_option_values[i]) != 0))
+                {
+                    break;
+                }
+            }
+
+            if (i < SOCKET_OPTION_COUNT)
+            {
+                LogError("unable to save the %s option", socket_options[i].name);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (socket_io_instance->receive_buffer_size != SOCKETIO_DEFAULT_RECEIVE_BUFFER_SIZE) &&
+                (OptionHandler_AddOption(result, OPTION_RECEIVE_BUFFER_SIZE, &socket_io_instance->receive_buffer_size) != 0)
+                )
+            {
+                LogError("unable to save the receive buffer size option");
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                ((socket_io_instance->send_high_watermark != 0) &&
+                (OptionHandler_AddOption(result, OPTION_SEND_HIGH_WATERMARK, &socket_io_instance->send_high_watermark) != 0)) ||
+                ((socket_io_instance->send_low_watermark != 0) &&
+                (OptionHandler_AddOption(result, OPTION_SEND_LOW_WATERMARK, &socket_io_instance->send_low_watermark) != 0))
+                )
+            {
+                LogError("unable to save the send watermark options");
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else
+            {
+                /*all is fine, all interesting options have been saved*/
+                /*return as is*/
+            }
+        }
+    }
+    return result;
+}
+
+static const IO_INTERFACE_DESCRIPTION socket_io_interface_description = 
+{
+    socketio_retrieveoptions,
+    socketio_create,
+    socketio_destroy,
+    socketio_open,
+    socketio_close,
+    socketio_send,
+    socketio_dowork,
+    socketio_setoption,
+    socketio_send_vectored,
+    socketio_get_statistics,
+    socketio_get_socket
+};
+
+static void indicate_error(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    socket_io_instance->statistics.io_error_count++;
+    if (socket_io_instance->on_io_error != NULL)
+    {
+        socket_io_instance->on_io_error(socket_io_instance->on_io_error_context);
+    }
+}
+
+/* applies the socket options set so far to a socket this instance created */
+static int apply_socket_options(SOCKET_IO_INSTANCE* socket_io_instance, int socket)
+{
+    int result = 0;
+    size_t i;
+
+    for (i = 0; i < SOCKET_OPTION_COUNT; i++)
+    {
+        if (socket_io_instance->socket_option_is_set[i] &&
+            (setsockopt(socket, socket_options[i].level, socket_options[i].option_name, &socket_io_instance->socket_option_values[i], sizeof(int)) != 0))
+        {
+            LogError("Failure: cannot set the %s option, errno %d.", socket_options[i].name, errno);
+            result = __LINE__;
+            break;
+        }
+    }
+
+    return result;
+}
+
+#ifdef TCP_QUICKACK
+/* the kernel leaves quick ack mode on its own, so a requested quick ack mode is requested again after every read */
+static void rearm_quickack(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    size_t i;
+
+    for (i = 0; i < SOCKET_OPTION_COUNT; i++)
+    {
+        if ((socket_options[i].level == IPPROTO_TCP) &&
+            (socket_options[i].option_name == TCP_QUICKACK))
+        {
+            if (socket_io_instance->socket_option_is_set[i] &&
+                (socket_io_instance->socket_option_values[i] != 0))
+            {
+                (void)setsockopt(socket_io_instance->socket, IPPROTO_TCP, TCP_QUICKACK, &socket_io_instance->socket_option_values[i], sizeof(int));
+            }
+            break;
+        }
+    }
+}
+#endif
+
+static uint64_t get_time_us(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    uint64_t result;
+
+    if ((socket_io_instance->tick_counter == NULL) ||
+        (tickcounter_get_current_us(socket_io_instance->tick_counter, &result) != 0))
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+/* counts a send accepted by socketio_send or socketio_send_vectored */
+static void record_send(SOCKET_IO_INSTANCE* socket_io_instance, int send_result, size_t size)
+{
+    if (send_result == 0)
+    {
+        socket_io_instance->statistics.messages_sent++;
+        socket_io_instance->statistics.bytes_sent += size;
+    }
+    else
+    {
+        socket_io_instance->statistics.send_error_count++;
+    }
+}
+
+/* removes the pending io at the head of the list from the statistics once it completed or failed */
+static void record_pending_io_done(SOCKET_IO_INSTANCE* socket_io_instance, PENDING_SOCKET_IO* pending_socket_io, bool succeeded)
+{
+    socket_io_instance->statistics.pending_send_count--;
+    socket_io_instance->statistics.pending_send_bytes -= pending_socket_io->size - pending_socket_io->sent;
+    if (succeeded)
+    {
+        uint64_t now = get_time_us(socket_io_instance);
+        xio_statistics_add_send_latency(&socket_io_instance->statistics, (now > pending_socket_io->send_time) ? (now - pending_socket_io->send_time) : 0);
+    }
+    else
+    {
+        socket_io_instance->statistics.send_error_count++;
+    }
+}
+
+/* new sends are refused while the queued bytes are at or above the high watermark; the layers above check the
+   same condition with xio_get_statistics before they commit to a send */
+static bool is_send_queue_full(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    bool result;
+
+    if ((socket_io_instance->send_high_watermark != 0) &&
+        (socket_io_instance->statistics.pending_send_bytes >= socket_io_instance->send_high_watermark))
+    {
+        socket_io_instance->is_send_blocked = true;
+        result = true;
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+/* tells the producer it can send again once the queue that reached the high watermark drained to the low watermark */
+static void indicate_writable(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if ((socket_io_instance->is_send_blocked) &&
+        (socket_io_instance->io_state == IO_STATE_OPEN) &&
+        (socket_io_instance->statistics.pending_send_bytes <= socket_io_instance->send_low_watermark))
+    {
+        socket_io_instance->is_send_blocked = false;
+        if (socket_io_instance->on_writable.on_writable != NULL)
+        {
+            socket_io_instance->on_writable.on_writable(socket_io_instance->on_writable.context);
+        }
+    }
+}
+
+/* queues the segments as one pending io, skipping the first skip_size bytes that were already sent */
+static int add_pending_io_vectored(SOCKET_IO_INSTANCE* socket_io_instance, const XIO_BUFFER* buffers, size_t buffer_count, size_t skip_size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+    size_t size = 0;
+    size_t i;
+    PENDING_SOCKET_IO* pending_socket_io;
+
+    for (i = 0; i < buffer_count; i++)
+    {
+        size += buffers[i].size;
+    }
+    size -= skip_size;
+
+    pending_socket_io = (PENDING_SOCKET_IO*)malloc(sizeof(PENDING_SOCKET_IO));
+    if (pending_socket_io == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        pending_socket_io->bytes = (unsigned char*)malloc(size);
+        if (pending_socket_io->bytes == NULL)
+        {
+            LogError("Allocation Failure: Unable to allocate pending list.");
+            free(pending_socket_io);
+            result = __LINE__;
+        }
+        else
+        {
+            size_t position = 0;
+
+            pending_socket_io->size = size;
+            pending_socket_io->sent = 0;
+            pending_socket_io->send_time = get_time_us(socket_io_instance);
+            pending_socket_io->on_send_complete = on_send_complete;
+            pending_socket_io->callback_context = callback_context;
+            pending_socket_io->pending_io_list = socket_io_instance->pending_io_list;
+            for (i = 0; i < buffer_count; i++)
+            {
+                if (skip_size >= buffers[i].size)
+                {
+                    skip_size -= buffers[i].size;
+                }
+                else
+                {
+                    (void)memcpy(pending_socket_io->bytes + position, (const unsigned char*)buffers[i].buffer + skip_size, buffers[i].size - skip_size);
+                    position += buffers[i].size - skip_size;
+                    skip_size = 0;
+                }
+            }
+
+            if (list_add(socket_io_instance->pending_io_list, pending_socket_io) == NULL)
+            {
+                LogError("Failure: Unable to add socket to pending list.");
+                free(pending_socket_io->bytes);
+                free(pending_socket_io);
+                result = __LINE__;
+            }
+            else
+            {
+                socket_io_instance->statistics.pending_send_count++;
+                socket_io_instance->statistics.pending_send_bytes += size;
+                (void)is_send_queue_full(socket_io_instance);
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int add_pending_io(SOCKET_IO_INSTANCE* socket_io_instance, const unsigned char* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    XIO_BUFFER segment;
+    segment.buffer = buffer;
+    segment.size = size;
+    return add_pending_io_vectored(socket_io_instance, &segment, 1, 0, on_send_complete, callback_context);
+}
+
+/* sends as much of the pending ios as the socket accepts, gathering up to MAX_SEND_IOVEC_COUNT of them in each sendmsg call */
+static void send_pending_io(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    struct iovec iov[MAX_SEND_IOVEC_COUNT];
+    LIST_ITEM_HANDLE first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
+
+    while (first_pending_io != NULL)
+    {
+        LIST_ITEM_HANDLE pending_io = first_pending_io;
+        struct msghdr message;
+        size_t iov_count = 0;
+        size_t gathered_size = 0;
+        ssize_t send_result;
+
+        while ((pending_io != NULL) && (iov_count < MAX_SEND_IOVEC_COUNT))
+        {
+            PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)list_item_get_value(pending_io);
+            if (pending_socket_io == NULL)
+            {
+                break;
+            }
+
+            iov[iov_count].iov_base = pending_socket_io->bytes + pending_socket_io->sent;
+            iov[iov_count].iov_len = pending_socket_io->size - pending_socket_io->sent;
+            gathered_size += iov[iov_count].iov_len;
+            iov_count++;
+            pending_io = list_get_next_item(pending_io);
+        }
+
+        if (iov_count == 0)
+        {
+            socket_io_instance->io_state = IO_STATE_ERROR;
+            indicate_error(socket_io_instance);
+            LogError("Failure: retrieving socket from list");
+            break;
+        }
+
+        (void)memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        send_result = sendmsg(socket_io_instance->socket, &message, 0);
+        if (send_result < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
+            {
+                /*do nothing until next dowork */
+            }
+            else
+            {
+                PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)list_item_get_value(first_pending_io);
+                (void)list_remove(socket_io_instance->pending_io_list, first_pending_io);
+                record_pending_io_done(socket_io_instance, pending_socket_io, false);
+                free(pending_socket_io->bytes);
+                free(pending_socket_io);
+
+                LogError("Failure: sending Socket information. errno=%d (%s).", errno, strerror(errno));
+                socket_io_instance->io_state = IO_STATE_ERROR;
+                indicate_error(socket_io_instance);
+            }
+            break;
+        }
+        else
+        {
+            size_t remaining = (size_t)send_result;
+
+            /* complete the pending ios that were sent entirely, the last one may have been sent partially */
+            while (remaining > 0)
+            {
+                PENDING_SOCKET_IO* pending_socket_io;
+                first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
+                if (first_pending_io == NULL)
+                {
+                    /* the list was cleared by a callback */
+                    break;
+                }
+
+                pending_socket_io = (PENDING_SOCKET_IO*)list_item_get_value(first_pending_io);
+                if (remaining < pending_socket_io->size - pending_socket_io->sent)
+                {
+                    pending_socket_io->sent += remaining;
+                    socket_io_instance->statistics.pending_send_bytes -= remaining;
+                    remaining = 0;
+                }
+                else
+                {
+                    remaining -= pending_socket_io->size - pending_socket_io->sent;
+                    if (list_remove(socket_io_instance->pending_io_list, first_pending_io) != 0)
+                    {
+                        record_pending_io_done(socket_io_instance, pending_socket_io, false);
+                        socket_io_instance->io_state = IO_STATE_ERROR;
+                        indicate_error(socket_io_instance);
+                        LogError("Failure: unable to remove socket from list");
+                        free(pending_socket_io->bytes);
+                        free(pending_socket_io);
+                        break;
+                    }
+
+                    record_pending_io_done(socket_io_instance, pending_socket_io, true);
+                    if (pending_socket_io->on_send_complete != NULL)
+                    {
+                        pending_socket_io->on_send_complete(pending_socket_io->callback_context, IO_SEND_OK);
+                    }
+
+                    free(pending_socket_io->bytes);
+                    free(pending_socket_io);
+                }
+            }
+
+            if (((size_t)send_result < gathered_size) ||
+                (socket_io_instance->io_state != IO_STATE_OPEN))
+            {
+                /* the socket is full, simply wait until next dowork */
+                break;
+            }
+        }
+
+        first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
+    }
+
+    indicate_writable(socket_io_instance);
+}
+
+/* reads until the socket has no more data; returns non-zero when the peer closed the connection or recv failed */
+static int receive_bytes(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    int result = 0;
+
+    if (socket_io_instance->receive_buffer == NULL)
+    {
+        socket_io_instance->receive_buffer = (unsigned char*)malloc(socket_io_instance->receive_buffer_size);
+    }
+
+    if (socket_io_instance->receive_buffer == NULL)
+    {
+        LogError("Socketio_Failure: NULL allocating input buffer.");
+        indicate_error(socket_io_instance);
+    }
+    else
+    {
+        ssize_t received;
+
+        do
+        {
+            received = recv(socket_io_instance->socket, socket_io_instance->receive_buffer, socket_io_instance->receive_buffer_size, 0);
+            socket_io_instance->receive_statistics.recv_call_count++;
+            if (received > 0)
+            {
+                socket_io_instance->receive_statistics.received_byte_count += (uint64_t)received;
+                socket_io_instance->statistics.messages_received++;
+                if (socket_io_instance->on_bytes_received != NULL)
+                {
+                    /* explictly ignoring here the result of the callback */
+                    (void)socket_io_instance->on_bytes_received(socket_io_instance->on_bytes_received_context, socket_io_instance->receive_buffer, (size_t)received);
+                }
+            }
+            else if ((received == 0) ||
+                ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+            {
+                result = __LINE__;
+            }
+            /* a short read means the socket has been drained, this saves the recv call that would fail with EAGAIN */
+        } while ((received > 0) && ((size_t)received == socket_io_instance->receive_buffer_size) && (socket_io_instance->io_state == IO_STATE_OPEN));
+
+#ifdef TCP_QUICKACK
+        if ((result == 0) && (socket_io_instance->io_state == IO_STATE_OPEN))
+        {
+            rearm_quickack(socket_io_instance);
+        }
+#endif
+    }
+
+    return result;
+}
+
+#ifdef __linux__
+static void advance_open(SOCKET_IO_INSTANCE* socket_io_instance);
+static void fail_open(SOCKET_IO_INSTANCE* socket_io_instance);
+
+static unsigned int get_io_loop_events(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    unsigned int events;
+
+    if (socket_io_instance->io_state == IO_STATE_OPENING)
+    {
+        /* a connection in progress completes with write readiness */
+        events = IO_LOOP_EVENT_WRITE;
+    }
+    else
+    {
+        /* write readiness is only watched while there is something to send, otherwise the loop would wake up constantly */
+        events = IO_LOOP_EVENT_READ;
+        if (list_get_head_item(socket_io_instance->pending_io_list) != NULL)
+        {
+            events |= IO_LOOP_EVENT_WRITE;
+        }
+    }
+
+    return events;
+}
+
+static void update_io_loop_events(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (socket_io_instance->io_loop_registration != NULL)
+    {
+        unsigned int events = get_io_loop_events(socket_io_instance);
+
+        if (events != socket_io_instance->io_loop_events)
+        {
+            if (io_loop_modify(socket_io_instance->io_loop_registration, events) != 0)
+            {
+                LogError("Failure: io_loop_modify failed.");
+                socket_io_instance->io_state = IO_STATE_ERROR;
+                indicate_error(socket_io_instance);
+            }
+            else
+            {
+                socket_io_instance->io_loop_events = events;
+            }
+        }
+    }
+}
+
+static void unregister_from_io_loop(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (socket_io_instance->io_loop_registration != NULL)
+    {
+        io_loop_unregister(socket_io_instance->io_loop_registration);
+        socket_io_instance->io_loop_registration = NULL;
+    }
+}
+
+static void on_io_loop_event(void* context, unsigned int events)
+{
+    SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)context;
+
+    if (socket_io_instance->io_state == IO_STATE_OPENING)
+    {
+        advance_open(socket_io_instance);
+    }
+    else if (socket_io_instance->io_state == IO_STATE_OPEN)
+    {
+        if ((events & IO_LOOP_EVENT_WRITE) != 0)
+        {
+            send_pending_io(socket_io_instance);
+        }
+
+        if ((socket_io_instance->io_state == IO_STATE_OPEN) &&
+            ((events & (IO_LOOP_EVENT_READ | IO_LOOP_EVENT_ERROR)) != 0))
+        {
+            if (receive_bytes(socket_io_instance) != 0)
+            {
+                /* level triggered readiness would report the closed socket forever, stop watching it */
+                LogError("Failure: connection closed by the peer or recv failed.");
+                unregister_from_io_loop(socket_io_instance);
+                socket_io_instance->io_state = IO_STATE_ERROR;
+                indicate_error(socket_io_instance);
+            }
+        }
+
+        if (socket_io_instance->io_state == IO_STATE_OPEN)
+        {
+            update_io_loop_events(socket_io_instance);
+        }
+    }
+}
+
+static int register_with_io_loop(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    int result;
+
+    if (socket_io_instance->io_loop == NULL)
+    {
+        result = 0;
+    }
+    else
+    {
+        socket_io_instance->io_loop_events = get_io_loop_events(socket_io_instance);
+        socket_io_instance->io_loop_registration = io_loop_register(socket_io_instance->io_loop, socket_io_instance->socket, socket_io_instance->io_loop_events, on_io_loop_event, socket_io_instance);
+        if (socket_io_instance->io_loop_registration == NULL)
+        {
+            LogError("Failure: io_loop_register failed.");
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static void stop_open_timer(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (socket_io_instance->open_timer != NULL)
+    {
+        timer_wheel_cancel_timer(io_loop_get_timer_wheel(socket_io_instance->io_loop), socket_io_instance->open_timer);
+        socket_io_instance->open_timer = NULL;
+    }
+}
+
+static int start_open_timer(SOCKET_IO_INSTANCE* socket_io_instance);
+
+static void on_open_timer_expired(void* context)
+{
+    SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)context;
+    socket_io_instance->open_timer = NULL;
+
+    advance_open(socket_io_instance);
+    if ((socket_io_instance->io_state == IO_STATE_OPENING) &&
+        (start_open_timer(socket_io_instance) != 0))
+    {
+        fail_open(socket_io_instance);
+    }
+}
+
+/* without dowork calls, the io loop has to poll the lookup and check the connect timeout */
+static int start_open_timer(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    int result;
+
+    if ((socket_io_instance->io_loop == NULL) ||
+        (socket_io_instance->open_timer != NULL))
+    {
+        result = 0;
+    }
+    else
+    {
+        socket_io_instance->open_timer = timer_wheel_start_timer(io_loop_get_timer_wheel(socket_io_instance->io_loop), OPEN_POLL_INTERVAL_MS, on_open_timer_expired, socket_io_instance);
+        if (socket_io_instance->open_timer == NULL)
+        {
+            LogError("Failure: timer_wheel_start_timer failed.");
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+#endif
+
+static void indicate_open_complete(SOCKET_IO_INSTANCE* socket_io_instance, IO_OPEN_RESULT open_result)
+{
+    ON_IO_OPEN_COMPLETE on_io_open_complete = socket_io_instance->on_io_open_complete;
+    socket_io_instance->on_io_open_complete = NULL;
+
+    if (on_io_open_complete != NULL)
+    {
+        on_io_open_complete(socket_io_instance->on_io_open_complete_context, open_result);
+    }
+}
+
+static void close_connect_attempt(CONNECT_ATTEMPT* connect_attempt)
+{
+#ifdef __linux__
+    if (connect_attempt->io_loop_registration != NULL)
+    {
+        io_loop_unregister(connect_attempt->io_loop_registration);
+        connect_attempt->io_loop_registration = NULL;
+    }
+#endif
+    if (connect_attempt->socket != INVALID_SOCKET)
+    {
+        close(connect_attempt->socket);
+        connect_attempt->socket = INVALID_SOCKET;
+    }
+}
+
+/* closes the connections still in progress and releases the resolved addresses */
+static void close_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    size_t i;
+
+    for (i = 0; i < socket_io_instance->connect_attempt_count; i++)
+    {
+        close_connect_attempt(&socket_io_instance->connect_attempts[i]);
+    }
 
-#define SOCKET_SUCCESS          0
-#define INVALID_SOCKET          -1
+    free(socket_io_instance->connect_attempts);
+    socket_io_instance->connect_attempts = NULL;
+    socket_io_instance->connect_attempt_count = 0;
+    free((void*)socket_io_instance->connect_addresses);
+    socket_io_instance->connect_addresses = NULL;
+    socket_io_instance->connect_address_count = 0;
 
-// connect timeout in seconds
-#define CONNECT_TIMEOUT         10
+    if (socket_io_instance->dns_resolver != NULL)
+    {
+        dns_resolver_destroy(socket_io_instance->dns_resolver);
+        socket_io_instance->dns_resolver = NULL;
+    }
+}
 
-typedef enum IO_STATE_TAG
+/* releases what was acquired while opening and goes back to the closed state */
+static void abort_open(SOCKET_IO_INSTANCE* socket_io_instance)
 {
-    IO_STATE_CLOSED,
-    IO_STATE_OPENING,
-    IO_STATE_OPEN,
-    IO_STATE_CLOSING,
-    IO_STATE_ERROR
-} IO_STATE;
+#ifdef __linux__
+    stop_open_timer(socket_io_instance);
+    unregister_from_io_loop(socket_io_instance);
+#endif
+    close_connect_attempts(socket_io_instance);
 
-typedef struct PENDING_SOCKET_IO_TAG
+    if (socket_io_instance->socket != INVALID_SOCKET)
+    {
+        close(socket_io_instance->socket);
+        socket_io_instance->socket = INVALID_SOCKET;
+    }
+
+    socket_io_instance->io_state = IO_STATE_CLOSED;
+}
+
+static void fail_open(SOCKET_IO_INSTANCE* socket_io_instance)
 {
-    unsigned char* bytes;
-    size_t size;
-    ON_SEND_COMPLETE on_send_complete;
-    void* callback_context;
-    LIST_HANDLE pending_io_list;
-} PENDING_SOCKET_IO;
+    abort_open(socket_io_instance);
+    indicate_open_complete(socket_io_instance, IO_OPEN_ERROR);
+}
 
-typedef struct SOCKET_IO_INSTANCE_TAG
+/* keeps the connection that completed first and drops the other attempts */
+static void complete_open(SOCKET_IO_INSTANCE* socket_io_instance, CONNECT_ATTEMPT* connect_attempt)
 {
-    int socket;
-    ON_BYTES_RECEIVED on_bytes_received;
-    ON_IO_ERROR on_io_error;
-    void* on_bytes_received_context;
-    void* on_io_error_context;
-    char* hostname;
-    int port;
-    IO_STATE io_state;
-    LIST_HANDLE pending_io_list;
-} SOCKET_IO_INSTANCE;
+    socket_io_instance->socket = connect_attempt->socket;
+    connect_attempt->socket = INVALID_SOCKET;
+#ifdef __linux__
+    socket_io_instance->io_loop_registration = connect_attempt->io_loop_registration;
+    socket_io_instance->io_loop_events = IO_LOOP_EVENT_WRITE;
+    connect_attempt->io_loop_registration = NULL;
+#endif
+    close_connect_attempts(socket_io_instance);
 
-/*this function will clone an option given by name and value*/
-static void* socketio_CloneOption(const char* name, const void* value)
+    socket_io_instance->io_state = IO_STATE_OPEN;
+#ifdef __linux__
+    stop_open_timer(socket_io_instance);
+    /* stop watching for the connection and start watching for incoming bytes */
+    update_io_loop_events(socket_io_instance);
+#endif
+    indicate_open_complete(socket_io_instance, IO_OPEN_OK);
+}
+
+static const struct addrinfo* find_address(const struct addrinfo* addr_info, int family, bool is_same_family)
 {
-    (void)name;
-    (void)value;
-    return NULL;
+    while ((addr_info != NULL) &&
+        ((addr_info->ai_family == family) != is_same_family))
+    {
+        addr_info = addr_info->ai_next;
+    }
+
+    return addr_info;
 }
 
-/*this function destroys an option previously created*/
-static void socketio_DestroyOption(const char* name, const void* value)
+/* orders the resolved addresses the way RFC 8305 section 4 recommends: alternating between the
+   address families, starting with the family of the address the resolver preferred */
+static int prepare_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance, const struct addrinfo* addr_info)
 {
-    (void)name;
-    (void)value;
+    int result;
+    size_t address_count = 0;
+    const struct addrinfo* address;
+
+    for (address = addr_info; address != NULL; address = address->ai_next)
+    {
+        address_count++;
+    }
+
+    socket_io_instance->connect_addresses = (const struct addrinfo**)malloc(address_count * sizeof(const struct addrinfo*));
+    socket_io_instance->connect_attempts = (CONNECT_ATTEMPT*)malloc(address_count * sizeof(CONNECT_ATTEMPT));
+    if ((socket_io_instance->connect_addresses == NULL) ||
+        (socket_io_instance->connect_attempts == NULL))
+    {
+        LogError("Allocation Failure: connect attempts");
+        result = __LINE__;
+    }
+    else if (tickcounter_get_current_ms(socket_io_instance->tick_counter, &socket_io_instance->connect_start_time) != 0)
+    {
+        LogError("Failure: tickcounter_get_current_ms failed.");
+        result = __LINE__;
+    }
+    else
+    {
+        int preferred_family = addr_info->ai_family;
+        const struct addrinfo* preferred_address = find_address(addr_info, preferred_family, true);
+        const struct addrinfo* other_address = find_address(addr_info, preferred_family, false);
+        size_t i;
+
+        for (i = 0; i < address_count; i++)
+        {
+            if ((other_address == NULL) ||
+                ((preferred_address != NULL) && ((i % 2) == 0)))
+            {
+                socket_io_instance->connect_addresses[i] = preferred_address;
+                preferred_address = find_address(preferred_address->ai_next, preferred_family, true);
+            }
+            else
+            {
+                socket_io_instance->connect_addresses[i] = other_address;
+                other_address = find_address(other_address->ai_next, preferred_family, false);
+            }
+        }
+
+        socket_io_instance->connect_address_count = address_count;
+        socket_io_instance->last_connect_attempt_time = socket_io_instance->connect_start_time;
+        result = 0;
+    }
+
+    return result;
 }
 
-static OPTIONHANDLER_HANDLE socketio_retrieveoptions(CONCRETE_IO_HANDLE handle)
+#ifdef __linux__
+static int register_connect_attempt(SOCKET_IO_INSTANCE* socket_io_instance, CONNECT_ATTEMPT* connect_attempt)
 {
-    OPTIONHANDLER_HANDLE result;
-    (void)handle;
-    result = OptionHandler_Create(socketio_CloneOption, socketio_DestroyOption, socketio_setoption);
-    if (result == NULL)
+    int result;
+
+    if (socket_io_instance->io_loop == NULL)
     {
-        LogError("unable to OptionHandler_Create");
-        /*return as is*/
+        result = 0;
     }
     else
     {
-        /*insert here work to add the options to "result" handle*/
+        /* a connection in progress completes with write readiness */
+        connect_attempt->io_loop_registration = io_loop_register(socket_io_instance->io_loop, connect_attempt->socket, IO_LOOP_EVENT_WRITE, on_io_loop_event, socket_io_instance);
+        if (connect_attempt->io_loop_registration == NULL)
+        {
+            LogError("Failure: io_loop_register failed.");
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
     }
+
     return result;
 }
 
-static const IO_INTERFACE_DESCRIPTION socket_io_interface_description = 
+static void unregister_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance)
 {
-    socketio_retrieveoptions,
-    socketio_create,
-    socketio_destroy,
-    socketio_open,
-    socketio_close,
-    socketio_send,
-    socketio_dowork,
-    socketio_setoption
-};
+    size_t i;
 
-static void indicate_error(SOCKET_IO_INSTANCE* socket_io_instance)
+    for (i = 0; i < socket_io_instance->connect_attempt_count; i++)
+    {
+        CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[i];
+        if (connect_attempt->io_loop_registration != NULL)
+        {
+            io_loop_unregister(connect_attempt->io_loop_registration);
+            connect_attempt->io_loop_registration = NULL;
+        }
+    }
+}
+
+/* called when the io loop is set while connections are in progress */
+static int register_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance)
 {
-    if (socket_io_instance->on_io_error != NULL)
+    int result = 0;
+    size_t i;
+
+    for (i = 0; i < socket_io_instance->connect_attempt_count; i++)
     {
-        socket_io_instance->on_io_error(socket_io_instance->on_io_error_context);
+        CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[i];
+        if ((connect_attempt->socket != INVALID_SOCKET) &&
+            (register_connect_attempt(socket_io_instance, connect_attempt) != 0))
+        {
+            result = __LINE__;
+            break;
+        }
     }
+
+    if (result != 0)
+    {
+        unregister_connect_attempts(socket_io_instance);
+    }
+
+    return result;
 }
+#endif
 
-static int add_pending_io(SOCKET_IO_INSTANCE* socket_io_instance, const unsigned char* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+/* creates a non-blocking socket and starts connecting it to the next address */
+static int start_connect_attempt(SOCKET_IO_INSTANCE* socket_io_instance)
 {
     int result;
-    PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)malloc(sizeof(PENDING_SOCKET_IO));
-    if (pending_socket_io == NULL)
+    int flags;
+    const struct addrinfo* addr_info = socket_io_instance->connect_addresses[socket_io_instance->connect_attempt_count];
+    CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[socket_io_instance->connect_attempt_count];
+
+    socket_io_instance->connect_attempt_count++;
+#ifdef __linux__
+    connect_attempt->io_loop_registration = NULL;
+#endif
+    connect_attempt->socket = socket(addr_info->ai_family, addr_info->ai_socktype, addr_info->ai_protocol);
+    if (connect_attempt->socket < SOCKET_SUCCESS)
+    {
+        LogError("Failure: socket create failure %d.", errno);
+        connect_attempt->socket = INVALID_SOCKET;
+        result = __LINE__;
+    }
+    else if ((-1 == (flags = fcntl(connect_attempt->socket, F_GETFL, 0))) ||
+        (fcntl(connect_attempt->socket, F_SETFL, flags | O_NONBLOCK) == -1))
+    {
+        LogError("Failure: fcntl failure.");
+        close_connect_attempt(connect_attempt);
+        result = __LINE__;
+    }
+    else if (apply_socket_options(socket_io_instance, connect_attempt->socket) != 0)
     {
+        /* the options have to be set before connect, the buffer sizes determine the window scale */
+        close_connect_attempt(connect_attempt);
+        result = __LINE__;
+    }
+#ifdef __linux__
+    else if (register_connect_attempt(socket_io_instance, connect_attempt) != 0)
+    {
+        LogError("Failure: cannot add the socket to the io loop.");
+        close_connect_attempt(connect_attempt);
+        result = __LINE__;
+    }
+#endif
+    else if ((connect(connect_attempt->socket, addr_info->ai_addr, addr_info->ai_addrlen) != 0) &&
+        (errno != EINPROGRESS))
+    {
+        LogError("Failure: connect failure %d.", errno);
+        close_connect_attempt(connect_attempt);
         result = __LINE__;
     }
     else
     {
-        pending_socket_io->bytes = (unsigned char*)malloc(size);
-        if (pending_socket_io->bytes == NULL)
+        result = 0;
+    }
+
+    return result;
+}
+
+/* checks, without blocking, whether a connection in progress completed or failed */
+static int poll_connect_attempt(CONNECT_ATTEMPT* connect_attempt, bool* is_connected)
+{
+    int result;
+    struct pollfd poll_fd;
+    int poll_result;
+
+    poll_fd.fd = connect_attempt->socket;
+    poll_fd.events = POLLOUT;
+    poll_fd.revents = 0;
+    poll_result = poll(&poll_fd, 1, 0);
+    *is_connected = false;
+    if ((poll_result < 0) && (errno != EINTR))
+    {
+        LogError("Failure: poll failure %d.", errno);
+        result = __LINE__;
+    }
+    else if (poll_result > 0)
+    {
+        int so_error = 0;
+        socklen_t len = sizeof(so_error);
+        if (getsockopt(connect_attempt->socket, SOL_SOCKET, SO_ERROR, &so_error, &len) != 0)
         {
-            LogError("Allocation Failure: Unable to allocate pending list.");
-            free(pending_socket_io);
+            LogError("Failure: getsockopt failure %d.", errno);
+            result = __LINE__;
+        }
+        else if (so_error != 0)
+        {
+            LogError("Failure: connect failure %d (%s).", so_error, strerror(so_error));
             result = __LINE__;
         }
         else
         {
-            pending_socket_io->size = size;
-            pending_socket_io->on_send_complete = on_send_complete;
-            pending_socket_io->callback_context = callback_context;
-            pending_socket_io->pending_io_list = socket_io_instance->pending_io_list;
-            (void)memcpy(pending_socket_io->bytes, buffer, size);
+            *is_connected = true;
+            result = 0;
+        }
+    }
+    else
+    {
+        /* still connecting */
+        result = 0;
+    }
 
-            if (list_add(socket_io_instance->pending_io_list, pending_socket_io) == NULL)
+    return result;
+}
+
+/* races the connections to the resolved addresses (RFC 8305 section 5): the next address is tried
+   when all the attempts in progress failed or CONNECTION_ATTEMPT_DELAY_MS after the last one started,
+   and the first connection that completes wins */
+static void advance_connect_attempts(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    size_t running_count = 0;
+    size_t i;
+    uint64_t now;
+
+    for (i = 0; i < socket_io_instance->connect_attempt_count; i++)
+    {
+        CONNECT_ATTEMPT* connect_attempt = &socket_io_instance->connect_attempts[i];
+        if (connect_attempt->socket != INVALID_SOCKET)
+        {
+            bool is_connected;
+            if (poll_connect_attempt(connect_attempt, &is_connected) != 0)
             {
-                LogError("Failure: Unable to add socket to pending list.");
-                free(pending_socket_io->bytes);
-                free(pending_socket_io);
-                result = __LINE__;
+                close_connect_attempt(connect_attempt);
+            }
+            else if (is_connected)
+            {
+                break;
             }
             else
             {
-                result = 0;
+                running_count++;
             }
         }
     }
 
-    return result;
+    if (i < socket_io_instance->connect_attempt_count)
+    {
+        complete_open(socket_io_instance, &socket_io_instance->connect_attempts[i]);
+    }
+    else if (tickcounter_get_current_ms(socket_io_instance->tick_counter, &now) != 0)
+    {
+        LogError("Failure: tickcounter_get_current_ms failed.");
+        fail_open(socket_io_instance);
+    }
+    else if (now - socket_io_instance->connect_start_time >= (uint64_t)CONNECT_TIMEOUT * 1000)
+    {
+        LogError("Failure: connect timed out.");
+        fail_open(socket_io_instance);
+    }
+    else
+    {
+        while ((socket_io_instance->connect_attempt_count < socket_io_instance->connect_address_count) &&
+            ((running_count == 0) || (now - socket_io_instance->last_connect_attempt_time >= CONNECTION_ATTEMPT_DELAY_MS)))
+        {
+            if (start_connect_attempt(socket_io_instance) == 0)
+            {
+                socket_io_instance->last_connect_attempt_time = now;
+                running_count++;
+            }
+        }
+
+        if (running_count == 0)
+        {
+            LogError("Failure: cannot connect to %s.", socket_io_instance->hostname);
+            fail_open(socket_io_instance);
+        }
+    }
+}
+
+static void advance_open(SOCKET_IO_INSTANCE* socket_io_instance)
+{
+    if (socket_io_instance->connect_addresses != NULL)
+    {
+        advance_connect_attempts(socket_io_instance);
+    }
+    else if (dns_resolver_is_complete(socket_io_instance->dns_resolver))
+    {
+        /* the addresses are owned by the resolver, it is kept until the open completes */
+        const struct addrinfo* addr_info = dns_resolver_get_addrinfo(socket_io_instance->dns_resolver);
+        if (addr_info == NULL)
+        {
+            LogError("Failure: cannot resolve %s.", socket_io_instance->hostname);
+            fail_open(socket_io_instance);
+        }
+        else if (prepare_connect_attempts(socket_io_instance, addr_info) != 0)
+        {
+            fail_open(socket_io_instance);
+        }
+        else
+        {
+            advance_connect_attempts(socket_io_instance);
+        }
+    }
+    else
+    {
+        /* still resolving */
+    }
 }
 
 CONCRETE_IO_HANDLE socketio_create(void* io_create_parameters)
@@ -209,6 +1361,34 @@ CONCRETE_IO_HANDLE socketio_create(void* io_create_parameters)
                     result->on_bytes_received_context = NULL;
                     result->on_io_error_context = NULL;
                     result->io_state = IO_STATE_CLOSED;
+                    result->receive_buffer = NULL;
+                    result->receive_buffer_size = SOCKETIO_DEFAULT_RECEIVE_BUFFER_SIZE;
+                    result->receive_statistics.recv_call_count = 0;
+                    result->receive_statistics.received_byte_count = 0;
+                    (void)memset(&result->statistics, 0, sizeof(result->statistics));
+                    result->send_high_watermark = 0;
+                    result->send_low_watermark = 0;
+                    result->on_writable.on_writable = NULL;
+                    result->on_writable.context = NULL;
+                    result->is_send_blocked = false;
+                    (void)memset(result->socket_option_values, 0, sizeof(result->socket_option_values));
+                    (void)memset(result->socket_option_is_set, 0, sizeof(result->socket_option_is_set));
+                    result->on_io_open_complete = NULL;
+                    result->on_io_open_complete_context = NULL;
+                    result->dns_resolver = NULL;
+                    result->tick_counter = NULL;
+                    result->connect_start_time = 0;
+                    result->connect_addresses = NULL;
+                    result->connect_address_count = 0;
+                    result->connect_attempts = NULL;
+                    result->connect_attempt_count = 0;
+                    result->last_connect_attempt_time = 0;
+#ifdef __linux__
+                    result->io_loop = NULL;
+                    result->io_loop_registration = NULL;
+                    result->io_loop_events = 0;
+                    result->open_timer = NULL;
+#endif
                 }
             }
         }
@@ -226,6 +1406,17 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
     if (socket_io != NULL)
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+#ifdef __linux__
+        stop_open_timer(socket_io_instance);
+        unregister_from_io_loop(socket_io_instance);
+#endif
+        close_connect_attempts(socket_io_instance);
+
+        if (socket_io_instance->tick_counter != NULL)
+        {
+            tickcounter_destroy(socket_io_instance->tick_counter);
+        }
+
         /* we cannot do much if the close fails, so just ignore the result */
         if (socket_io_instance->socket != INVALID_SOCKET)
         {
@@ -248,6 +1439,7 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
         }
 
         list_destroy(socket_io_instance->pending_io_list);
+        free(socket_io_instance->receive_buffer);
         free(socket_io_instance->hostname);
         free(socket_io);
     }
@@ -256,8 +1448,6 @@ void socketio_destroy(CONCRETE_IO_HANDLE socket_io)
 int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context)
 {
     int result;
-	int retval = -1;
-	int select_errno = 0;
 
     SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
     if (socket_io == NULL)
@@ -272,6 +1462,12 @@ int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_c
             LogError("Failure: socket state is not closed.");
             result = __LINE__;
         }
+        else if ((socket_io_instance->tick_counter == NULL) &&
+            ((socket_io_instance->tick_counter = tickcounter_create()) == NULL))
+        {
+            LogError("Failure: tickcounter_create failed.");
+            result = __LINE__;
+        }
         else if (socket_io_instance->socket != INVALID_SOCKET)
         {
             // Opening an accepted socket
@@ -279,135 +1475,61 @@ int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_c
             socket_io_instance->on_bytes_received = on_bytes_received;
             socket_io_instance->on_io_error = on_io_error;
             socket_io_instance->on_io_error_context = on_io_error_context;
+            socket_io_instance->is_send_blocked = false;
 
-            socket_io_instance->io_state = IO_STATE_OPEN;
-
-            if (on_io_open_complete != NULL)
+#ifdef __linux__
+            if (register_with_io_loop(socket_io_instance) != 0)
             {
-                on_io_open_complete(on_io_open_complete_context, IO_OPEN_OK);
+                LogError("Failure: cannot add the socket to the io loop.");
+                result = __LINE__;
             }
+            else
+#endif
+            {
+                socket_io_instance->io_state = IO_STATE_OPEN;
 
-            result = 0;
+                if (on_io_open_complete != NULL)
+                {
+                    on_io_open_complete(on_io_open_complete_context, IO_OPEN_OK);
+                }
+
+                result = 0;
+            }
         }
         else
         {
-            struct addrinfo* addrInfo;
-            char portString[16];
-
-            socket_io_instance->socket = socket(AF_INET, SOCK_STREAM, 0);
-            if (socket_io_instance->socket < SOCKET_SUCCESS)
+            /* the lookup runs on a helper thread, socketio_dowork connects once it completes */
+            socket_io_instance->dns_resolver = dns_resolver_create(socket_io_instance->hostname, socket_io_instance->port);
+            if (socket_io_instance->dns_resolver == NULL)
             {
-                LogError("Failure: socket create failure %d.", socket_io_instance->socket);
+                LogError("Failure: dns_resolver_create failed.");
                 result = __LINE__;
             }
-            else
-            {
-                struct addrinfo addrHint = { 0 };
-                addrHint.ai_family = AF_INET;
-                addrHint.ai_socktype = SOCK_STREAM;
-                addrHint.ai_protocol = 0;
-
-                sprintf(portString, "%u", socket_io_instance->port);
-                int err = getaddrinfo(socket_io_instance->hostname, portString, &addrHint, &addrInfo);
-                if (err != 0)
-                {
-                    LogError("Failure: getaddrinfo failure %d.", err);
-                    close(socket_io_instance->socket);
-                    socket_io_instance->socket = INVALID_SOCKET;
-                    result = __LINE__;
-                }
-                else
-                {
-                    int flags;
-                    if ((-1 == (flags = fcntl(socket_io_instance->socket, F_GETFL, 0))) ||
-                        (fcntl(socket_io_instance->socket, F_SETFL, flags | O_NONBLOCK) == -1))
-                    {
-                        LogError("Failure: fcntl failure.");
-                        close(socket_io_instance->socket);
-                        socket_io_instance->socket = INVALID_SOCKET;
-                        result = __LINE__;
-                    }
-                    else
-                    {
-                        err = connect(socket_io_instance->socket, addrInfo->ai_addr, sizeof(*addrInfo->ai_addr));
-                        if ((err != 0) && (errno != EINPROGRESS))
-                        {
-                            LogError("Failure: connect failure %d.", errno);
-                            close(socket_io_instance->socket);
-                            socket_io_instance->socket = INVALID_SOCKET;
-                            result = __LINE__;
-                        }
-                        else
-                        {
-                            if (err != 0)
-                            {
-                                fd_set fdset;
-                                struct timeval tv;
-
-                                FD_ZERO(&fdset);
-                                FD_SET(socket_io_instance->socket, &fdset);
-                                tv.tv_sec = CONNECT_TIMEOUT;
-                                tv.tv_usec = 0;
-
-								do
-								{
-									retval = select(socket_io_instance->socket + 1, NULL, &fdset, NULL, &tv);
-
-									if (retval < 0)
-									{
-										select_errno = errno;
-									}
-								} while (retval < 0 && select_errno == EINTR);
-								
-                                if (retval != 1)
-                                {
-                                    LogError("Failure: select failure.");
-                                    close(socket_io_instance->socket);
-                                    socket_io_instance->socket = INVALID_SOCKET;
-                                    result = __LINE__;
-                                }
-                                else
-                                {
-                                    int so_error = 0;
-                                    socklen_t len = sizeof(so_error);
-                                    err = getsockopt(socket_io_instance->socket, SOL_SOCKET, SO_ERROR, &so_error, &len);
-                                    if (err != 0)
-                                    {
-                                        LogError("Failure: getsockopt failure %d.", errno);
-                                        close(socket_io_instance->socket);
-                                        socket_io_instance->socket = INVALID_SOCKET;
-                                        result = __LINE__;
-                                    }
-                                    else if (so_error != 0)
-                                    {
-                                        err = so_error;
-                                        LogError("Failure: connect failure %d.", so_error);
-                                        close(socket_io_instance->socket);
-                                        socket_io_instance->socket = INVALID_SOCKET;
-                                        result = __LINE__;
-                                    }
-                                }
-                            }
-                            if (err == 0)
-                            {
-                                socket_io_instance->on_bytes_received = on_bytes_received;
-                                socket_io_instance->on_bytes_received_context = on_bytes_received_context;
+            else
+            {
+                socket_io_instance->on_bytes_received = on_bytes_received;
+                socket_io_instance->on_bytes_received_context = on_bytes_received_context;
 
-                                socket_io_instance->on_io_error = on_io_error;
-                                socket_io_instance->on_io_error_context = on_io_error_context;
+                socket_io_instance->on_io_error = on_io_error;
+                socket_io_instance->on_io_error_context = on_io_error_context;
 
-                                socket_io_instance->io_state = IO_STATE_OPEN;
+                socket_io_instance->on_io_open_complete = on_io_open_complete;
+                socket_io_instance->on_io_open_complete_context = on_io_open_complete_context;
+                socket_io_instance->is_send_blocked = false;
 
-                                if (on_io_open_complete != NULL)
-                                {
-                                    on_io_open_complete(on_io_open_complete_context, IO_OPEN_OK);
-                                }
+                socket_io_instance->io_state = IO_STATE_OPENING;
 
-                                result = 0;
-                            }
-                        }
-                    }
-                    freeaddrinfo(addrInfo);
+#ifdef __linux__
+                if (start_open_timer(socket_io_instance) != 0)
+                {
+                    abort_open(socket_io_instance);
+                    socket_io_instance->on_io_open_complete = NULL;
+                    result = __LINE__;
+                }
+                else
+#endif
+                {
+                    result = 0;
                 }
             }
         }
@@ -427,9 +1549,17 @@ int socketio_close(CONCRETE_IO_HANDLE socket_io, ON_IO_CLOSE_COMPLETE on_io_clos
     else
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
-        if ((socket_io_instance->io_state != IO_STATE_CLOSED) && (socket_io_instance->io_state != IO_STATE_CLOSING))
+        if (socket_io_instance->io_state == IO_STATE_OPENING)
+        {
+            abort_open(socket_io_instance);
+            indicate_open_complete(socket_io_instance, IO_OPEN_CANCELLED);
+        }
+        else if ((socket_io_instance->io_state != IO_STATE_CLOSED) && (socket_io_instance->io_state != IO_STATE_CLOSING))
         {
             // Only close if the socket isn't already in the closed or closing state
+#ifdef __linux__
+            unregister_from_io_loop(socket_io_instance);
+#endif
             (void)shutdown(socket_io_instance->socket, SHUT_RDWR);
             close(socket_io_instance->socket);
             socket_io_instance->socket = INVALID_SOCKET;
@@ -467,6 +1597,11 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
             LogError("Failure: socket state is not opened.");
             result = __LINE__;
         }
+        else if (is_send_queue_full(socket_io_instance))
+        {
+            /* not an error, the producer waits for on_writable */
+            result = XIO_SEND_WOULD_BLOCK;
+        }
         else
         {
             LIST_ITEM_HANDLE first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
@@ -491,7 +1626,16 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
                     {
                         if (errno == EAGAIN) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
                         {
-                            /*do nothing*/
+                            /* queue all the data, it is sent by the next dowork */
+                            if (add_pending_io(socket_io_instance, buffer, size, on_send_complete, callback_context) != 0)
+                            {
+                                LogError("Failure: add_pending_io failed.");
+                                result = __LINE__;
+                            }
+                            else
+                            {
+                                result = 0;
+                            }
                         }
                         else
                         {
@@ -516,6 +1660,7 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
                 }
                 else
                 {
+                    xio_statistics_add_send_latency(&socket_io_instance->statistics, 0);
                     if (on_send_complete != NULL)
                     {
                         on_send_complete(callback_context, IO_SEND_OK);
@@ -524,104 +1669,160 @@ int socketio_send(CONCRETE_IO_HANDLE socket_io, const void* buffer, size_t size,
                     result = 0;
                 }
             }
+
+            record_send(socket_io_instance, result, size);
+
+#ifdef __linux__
+            /* start watching for write readiness if data was queued */
+            update_io_loop_events(socket_io_instance);
+#endif
         }
     }
 
     return result;
 }
 
-void socketio_dowork(CONCRETE_IO_HANDLE socket_io)
+int socketio_send_vectored(CONCRETE_IO_HANDLE socket_io, const XIO_BUFFER* buffers, size_t buffer_count, ON_SEND_COMPLETE on_send_complete, void* callback_context)
 {
-    if (socket_io != NULL)
+    int result;
+
+    if ((socket_io == NULL) ||
+        (buffers == NULL) ||
+        (buffer_count == 0))
+    {
+        /* Invalid arguments */
+        LogError("Invalid argument: send_vectored given invalid parameter");
+        result = __LINE__;
+    }
+    else
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
-        if (socket_io_instance->io_state == IO_STATE_OPEN)
+        size_t size = 0;
+        size_t i;
+
+        for (i = 0; i < buffer_count; i++)
         {
-            int received = 1;
+            if ((buffers[i].buffer == NULL) && (buffers[i].size > 0))
+            {
+                break;
+            }
+            size += buffers[i].size;
+        }
 
-            LIST_ITEM_HANDLE first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
-            while (first_pending_io != NULL)
+        if ((i < buffer_count) || (size == 0))
+        {
+            LogError("Invalid argument: send_vectored given an invalid segment");
+            result = __LINE__;
+        }
+        else if (socket_io_instance->io_state != IO_STATE_OPEN)
+        {
+            LogError("Failure: socket state is not opened.");
+            result = __LINE__;
+        }
+        else if (is_send_queue_full(socket_io_instance))
+        {
+            /* not an error, the producer waits for on_writable */
+            result = XIO_SEND_WOULD_BLOCK;
+        }
+        else if ((list_get_head_item(socket_io_instance->pending_io_list) != NULL) ||
+            (buffer_count > MAX_SEND_IOVEC_COUNT))
+        {
+            /* keep the ordering with what is already queued */
+            if (add_pending_io_vectored(socket_io_instance, buffers, buffer_count, 0, on_send_complete, callback_context) != 0)
             {
-                PENDING_SOCKET_IO* pending_socket_io = (PENDING_SOCKET_IO*)list_item_get_value(first_pending_io);
-                if (pending_socket_io == NULL)
-                {
-                    socket_io_instance->io_state = IO_STATE_ERROR;
-                    indicate_error(socket_io_instance);
-                    LogError("Failure: retrieving socket from list");
-                    break;
-                }
+                LogError("Failure: add_pending_io failed.");
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
+            }
 
-                int send_result = send(socket_io_instance->socket, pending_socket_io->bytes, pending_socket_io->size, 0);
-                if (send_result != pending_socket_io->size)
-                {
-                    if (send_result == INVALID_SOCKET)
-                    {
-                        if (errno == EAGAIN) /*send says "come back later" with EAGAIN - likely the socket buffer cannot accept more data*/
-                        {
-                            /*do nothing until next dowork */
-                            break;
-                        }
-                        else
-                        {
-                            free(pending_socket_io->bytes);
-                            free(pending_socket_io);
-                            (void)list_remove(socket_io_instance->pending_io_list, first_pending_io);
+            record_send(socket_io_instance, result, size);
+        }
+        else
+        {
+            struct iovec iov[MAX_SEND_IOVEC_COUNT];
+            struct msghdr message;
+            ssize_t send_result;
 
-                            LogError("Failure: sending Socket information. errno=%d (%s).", errno, strerror(errno));
-                            socket_io_instance->io_state = IO_STATE_ERROR;
-                            indicate_error(socket_io_instance);
-                        }
-                    }
-                    else
-                    {
-                        /* simply wait until next dowork */
-                        (void)memmove(pending_socket_io->bytes, pending_socket_io->bytes + send_result, pending_socket_io->size - send_result);
-                        pending_socket_io->size -= send_result;
-                        break;
-                    }
-                }
-                else
-                {
-                    if (pending_socket_io->on_send_complete != NULL)
-                    {
-                        pending_socket_io->on_send_complete(pending_socket_io->callback_context, IO_SEND_OK);
-                    }
+            for (i = 0; i < buffer_count; i++)
+            {
+                iov[i].iov_base = (void*)buffers[i].buffer;
+                iov[i].iov_len = buffers[i].size;
+            }
 
-                    free(pending_socket_io->bytes);
-                    free(pending_socket_io);
-                    if (list_remove(socket_io_instance->pending_io_list, first_pending_io) != 0)
-                    {
-                        socket_io_instance->io_state = IO_STATE_ERROR;
-                        indicate_error(socket_io_instance);
-                        LogError("Failure: unable to remove socket from list");
-                    }
+            (void)memset(&message, 0, sizeof(message));
+            message.msg_iov = iov;
+            message.msg_iovlen = buffer_count;
+            send_result = sendmsg(socket_io_instance->socket, &message, 0);
+            if ((send_result < 0) &&
+                (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            {
+                indicate_error(socket_io_instance);
+                LogError("Failure: sending socket failed. errno=%d (%s).", errno, strerror(errno));
+                result = __LINE__;
+            }
+            else if ((send_result >= 0) && ((size_t)send_result == size))
+            {
+                xio_statistics_add_send_latency(&socket_io_instance->statistics, 0);
+                if (on_send_complete != NULL)
+                {
+                    on_send_complete(callback_context, IO_SEND_OK);
                 }
 
-                first_pending_io = list_get_head_item(socket_io_instance->pending_io_list);
+                result = 0;
             }
-
-            while (received > 0)
+            else
             {
-                unsigned char* recv_bytes = malloc(RECEIVE_BYTES_VALUE);
-                if (recv_bytes == NULL)
+                /* queue what was not sent, it is sent by the next dowork */
+                size_t sent_size = (send_result < 0) ? 0 : (size_t)send_result;
+                if (add_pending_io_vectored(socket_io_instance, buffers, buffer_count, sent_size, on_send_complete, callback_context) != 0)
                 {
-                    LogError("Socketio_Failure: NULL allocating input buffer.");
-                    indicate_error(socket_io_instance);
+                    LogError("Failure: add_pending_io failed.");
+                    result = __LINE__;
                 }
                 else
                 {
-                    received = recv(socket_io_instance->socket, recv_bytes, RECEIVE_BYTES_VALUE, 0);
-                    if (received > 0)
-                    {
-                        if (socket_io_instance->on_bytes_received != NULL)
-                        {
-                            /* explictly ignoring here the result of the callback */
-                            (void)socket_io_instance->on_bytes_received(socket_io_instance->on_bytes_received_context, recv_bytes, received);
-                        }
-                    }
-                    free(recv_bytes);
+                    result = 0;
                 }
             }
+
+            record_send(socket_io_instance, result, size);
+        }
+
+#ifdef __linux__
+        if (result == 0)
+        {
+            /* start watching for write readiness if data was queued */
+            update_io_loop_events(socket_io_instance);
+        }
+#endif
+    }
+
+    return result;
+}
+
+void socketio_dowork(CONCRETE_IO_HANDLE socket_io)
+{
+    if (socket_io != NULL)
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+#ifdef __linux__
+        if (socket_io_instance->io_loop_registration != NULL)
+        {
+            /* io_loop_wait services this socket when it becomes ready */
+        }
+        else
+#endif
+        if (socket_io_instance->io_state == IO_STATE_OPENING)
+        {
+            advance_open(socket_io_instance);
+        }
+        else if (socket_io_instance->io_state == IO_STATE_OPEN)
+        {
+            send_pending_io(socket_io_instance);
+            (void)receive_bytes(socket_io_instance);
         }
     }
 }
@@ -644,26 +1845,128 @@ int socketio_setoption(CONCRETE_IO_HANDLE socket_io, const char* optionName, con
     else
     {
         SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+        size_t socket_option_index = find_socket_option(optionName);
 
-        if (strcmp(optionName, "tcp_keepalive") == 0)
+        if (socket_option_index < SOCKET_OPTION_COUNT)
         {
-            result = setsockopt(socket_io_instance->socket, SOL_SOCKET, SO_KEEPALIVE, value, sizeof(int));
-            if (result == -1) result = errno;
+            const SOCKET_OPTION* socket_option = &socket_options[socket_option_index];
+            size_t i;
+
+            /* the option is applied to the sockets that exist and remembered for the ones the next opens create */
+            result = 0;
+            if ((socket_io_instance->socket != INVALID_SOCKET) &&
+                (setsockopt(socket_io_instance->socket, socket_option->level, socket_option->option_name, value, sizeof(int)) == -1))
+            {
+                result = errno;
+            }
+
+            for (i = 0; (result == 0) && (i < socket_io_instance->connect_attempt_count); i++)
+            {
+                if ((socket_io_instance->connect_attempts[i].socket != INVALID_SOCKET) &&
+                    (setsockopt(socket_io_instance->connect_attempts[i].socket, socket_option->level, socket_option->option_name, value, sizeof(int)) == -1))
+                {
+                    result = errno;
+                }
+            }
+
+            if (result != 0)
+            {
+                LogError("Failure: cannot set the %s option, errno %d.", optionName, result);
+            }
+            else
+            {
+                socket_io_instance->socket_option_values[socket_option_index] = *(const int*)value;
+                socket_io_instance->socket_option_is_set[socket_option_index] = true;
+            }
         }
-        else if (strcmp(optionName, "tcp_keepalive_time") == 0)
+        else if (strcmp(optionName, OPTION_SEND_HIGH_WATERMARK) == 0)
         {
-#ifdef __APPLE__
-            result = setsockopt(socket_io_instance->socket, IPPROTO_TCP, TCP_KEEPALIVE, value, sizeof(int));
-#else
-            result = setsockopt(socket_io_instance->socket, SOL_TCP, TCP_KEEPIDLE, value, sizeof(int));
-#endif
-            if (result == -1) result = errno;
+            /* the queue drains to the low watermark, it cannot be above the high watermark whichever is set first */
+            size_t send_high_watermark = *(const size_t*)value;
+            if ((send_high_watermark != 0) && (socket_io_instance->send_low_watermark > send_high_watermark))
+            {
+                LogError("Failure: the send high watermark %zu is below the send low watermark %zu.", send_high_watermark, socket_io_instance->send_low_watermark);
+                result = __LINE__;
+            }
+            else
+            {
+                socket_io_instance->send_high_watermark = send_high_watermark;
+                result = 0;
+            }
+        }
+        else if (strcmp(optionName, OPTION_SEND_LOW_WATERMARK) == 0)
+        {
+            size_t send_low_watermark = *(const size_t*)value;
+            if ((socket_io_instance->send_high_watermark != 0) && (send_low_watermark > socket_io_instance->send_high_watermark))
+            {
+                LogError("Failure: the send low watermark %zu is above the send high watermark %zu.", send_low_watermark, socket_io_instance->send_high_watermark);
+                result = __LINE__;
+            }
+            else
+            {
+                socket_io_instance->send_low_watermark = send_low_watermark;
+                result = 0;
+            }
+        }
+        else if (strcmp(optionName, OPTION_ON_WRITABLE) == 0)
+        {
+            socket_io_instance->on_writable = *(const XIO_WRITABLE_CALLBACK*)value;
+            result = 0;
+        }
+        else if (strcmp(optionName, OPTION_RECEIVE_BUFFER_SIZE) == 0)
+        {
+            size_t receive_buffer_size = *(const size_t*)value;
+            if ((receive_buffer_size == 0) || (receive_buffer_size > INT_MAX))
+            {
+                LogError("Failure: invalid receive buffer size %zu.", receive_buffer_size);
+                result = __LINE__;
+            }
+            else
+            {
+                /* the buffer is allocated again with the new size by the next receive */
+                free(socket_io_instance->receive_buffer);
+                socket_io_instance->receive_buffer = NULL;
+                socket_io_instance->receive_buffer_size = receive_buffer_size;
+                result = 0;
+            }
         }
-        else if (strcmp(optionName, "tcp_keepalive_interval") == 0)
+#ifdef __linux__
+        else if (strcmp(optionName, OPTION_IO_LOOP) == 0)
         {
-            result = setsockopt(socket_io_instance->socket, SOL_TCP, TCP_KEEPINTVL, value, sizeof(int));
-            if (result == -1) result = errno;
+            if (socket_io_instance->io_loop != NULL)
+            {
+                LogError("Failure: the io loop is already set.");
+                result = __LINE__;
+            }
+            else
+            {
+                socket_io_instance->io_loop = (IO_LOOP_HANDLE)value;
+                if ((socket_io_instance->io_state == IO_STATE_OPEN) &&
+                    (register_with_io_loop(socket_io_instance) != 0))
+                {
+                    socket_io_instance->io_loop = NULL;
+                    result = __LINE__;
+                }
+                else if ((socket_io_instance->io_state == IO_STATE_OPENING) &&
+                    (register_connect_attempts(socket_io_instance) != 0))
+                {
+                    socket_io_instance->io_loop = NULL;
+                    result = __LINE__;
+                }
+                else if ((socket_io_instance->io_state == IO_STATE_OPENING) &&
+                    (start_open_timer(socket_io_instance) != 0))
+                {
+                    unregister_connect_attempts(socket_io_instance);
+                    socket_io_instance->io_loop = NULL;
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+            }
         }
+#endif
         else
         {
             result = __LINE__;
@@ -678,3 +1981,73 @@ const IO_INTERFACE_DESCRIPTION* socketio_get_interface_description(void)
     return &socket_io_interface_description;
 }
 
+int socketio_get_statistics(CONCRETE_IO_HANDLE socket_io, XIO_STATISTICS* statistics)
+{
+    int result;
+
+    if ((socket_io == NULL) ||
+        (statistics == NULL))
+    {
+        LogError("Invalid argument: socket_io=%p, statistics=%p", socket_io, statistics);
+        result = __LINE__;
+    }
+    else
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+        *statistics = socket_io_instance->statistics;
+        statistics->bytes_received = socket_io_instance->receive_statistics.received_byte_count;
+        result = 0;
+    }
+
+    return result;
+}
+
+/* the socket of an open connection, for the layers that hand it to the kernel (kTLS); the io still owns it */
+int socketio_get_socket(CONCRETE_IO_HANDLE socket_io, intptr_t* socket_handle)
+{
+    int result;
+
+    if ((socket_io == NULL) ||
+        (socket_handle == NULL))
+    {
+        LogError("Invalid argument: socket_io=%p, socket_handle=%p", socket_io, socket_handle);
+        result = __LINE__;
+    }
+    else
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+        if (socket_io_instance->socket == INVALID_SOCKET)
+        {
+            LogError("The socket is not connected.");
+            result = __LINE__;
+        }
+        else
+        {
+            *socket_handle = (intptr_t)socket_io_instance->socket;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int socketio_get_receive_statistics(CONCRETE_IO_HANDLE socket_io, SOCKETIO_RECEIVE_STATISTICS* statistics)
+{
+    int result;
+
+    if ((socket_io == NULL) ||
+        (statistics == NULL))
+    {
+        LogError("Invalid argument: socket_io=%p, statistics=%p", socket_io, statistics);
+        result = __LINE__;
+    }
+    else
+    {
+        SOCKET_IO_INSTANCE* socket_io_instance = (SOCKET_IO_INSTANCE*)socket_io;
+        *statistics = socket_io_instance->receive_statistics;
+        result = 0;
+    }
+
+    return result;
+}
+
@@ -0,0 +1,481 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __linux__
+/* accept4 is a GNU extension */
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include "azure_c_shared_utility/socketio_listener.h"
+#include "azure_c_shared_utility/socketio.h"
+#include "azure_c_shared_utility/optionhandler.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+#include "azure_c_shared_utility/xlogging.h"
+#ifdef __linux__
+#include "azure_c_shared_utility/io_loop.h"
+#endif
+
+#define INVALID_SOCKET          -1
+
+typedef struct SOCKETIO_LISTENER_INSTANCE_TAG
+{
+    char* address;
+    int port;
+    int backlog;
+    int socket;
+    ON_SOCKETIO_LISTENER_ACCEPT on_accept;
+    void* on_accept_context;
+    /*the options set on every accepted XIO_HANDLE*/
+    OPTIONHANDLER_HANDLE accepted_io_options;
+    /*a socketio that is never opened, it validates the options before they are kept*/
+    CONCRETE_IO_HANDLE option_validator;
+#ifdef __linux__
+    IO_LOOP_HANDLE io_loop;
+    IO_LOOP_REGISTRATION_HANDLE io_loop_registration;
+#endif
+} SOCKETIO_LISTENER_INSTANCE;
+
+static void* socketio_listener_CloneOption(const char* name, const void* value)
+{
+    void* result;
+
+    if ((strcmp(name, OPTION_RECEIVE_BUFFER_SIZE) == 0) ||
+        (strcmp(name, OPTION_SEND_HIGH_WATERMARK) == 0) ||
+        (strcmp(name, OPTION_SEND_LOW_WATERMARK) == 0))
+    {
+        result = malloc(sizeof(size_t));
+        if (result != NULL)
+        {
+            *(size_t*)result = *(const size_t*)value;
+        }
+    }
+    else
+    {
+        /* all the other socketio options kept for the accepted connections are ints, OPTION_ON_WRITABLE is refused by
+           socketio_listener_setoption */
+        result = malloc(sizeof(int));
+        if (result != NULL)
+        {
+            *(int*)result = *(const int*)value;
+        }
+    }
+
+    if (result == NULL)
+    {
+        LogError("unable to clone the %s option", name);
+    }
+
+    return result;
+}
+
+static void socketio_listener_DestroyOption(const char* name, const void* value)
+{
+    (void)name;
+    free((void*)value);
+}
+
+/* accepts the pending connections until there are none left or a batch is complete */
+static void accept_connections(SOCKETIO_LISTENER_INSTANCE* listener_instance)
+{
+    size_t i;
+
+    for (i = 0; (i < SOCKETIO_LISTENER_ACCEPT_BATCH_SIZE) && (listener_instance->socket != INVALID_SOCKET); i++)
+    {
+        int accepted_socket;
+
+        /* Codes_SRS_SOCKETIO_LISTENER_01_013: [ socketio_listener_dowork shall accept at most SOCKETIO_LISTENER_ACCEPT_BATCH_SIZE connections, each as a non-blocking socket. ]*/
+#ifdef __linux__
+        accepted_socket = accept4(listener_instance->socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        accepted_socket = accept(listener_instance->socket, NULL, NULL);
+        if (accepted_socket != INVALID_SOCKET)
+        {
+            int flags = fcntl(accepted_socket, F_GETFL, 0);
+            if ((flags == -1) ||
+                (fcntl(accepted_socket, F_SETFL, flags | O_NONBLOCK) == -1))
+            {
+                LogError("Failure: fcntl failure.");
+                (void)close(accepted_socket);
+                continue;
+            }
+        }
+#endif
+        if (accepted_socket == INVALID_SOCKET)
+        {
+            /* Codes_SRS_SOCKETIO_LISTENER_01_014: [ socketio_listener_dowork shall stop accepting when there is no pending connection. ]*/
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) && (errno != ECONNABORTED))
+            {
+                LogError("Failure: accept failure %d.", errno);
+            }
+
+            if (errno != ECONNABORTED)
+            {
+                break;
+            }
+        }
+        else
+        {
+            SOCKETIO_CONFIG socketio_config;
+            XIO_HANDLE accepted_io;
+
+            socketio_config.hostname = NULL;
+            socketio_config.port = listener_instance->port;
+            socketio_config.accepted_socket = &accepted_socket;
+
+            /* Codes_SRS_SOCKETIO_LISTENER_01_015: [ Each accepted socket shall be wrapped in an XIO_HANDLE created with the socketio interface description. ]*/
+            accepted_io = xio_create(socketio_get_interface_description(), &socketio_config);
+            if (accepted_io == NULL)
+            {
+                /* Codes_SRS_SOCKETIO_LISTENER_01_018: [ If the XIO_HANDLE cannot be created or configured, the connection shall be closed. ]*/
+                LogError("Failure: xio_create failed for an accepted connection.");
+                (void)close(accepted_socket);
+            }
+            /* Codes_SRS_SOCKETIO_LISTENER_01_016: [ The options set with socketio_listener_setoption shall be set on the XIO_HANDLE. ]*/
+            else if ((listener_instance->accepted_io_options != NULL) &&
+                (OptionHandler_FeedOptions(listener_instance->accepted_io_options, accepted_io) != OPTIONHANDLER_OK))
+            {
+                LogError("Failure: cannot set the options of an accepted connection.");
+                xio_destroy(accepted_io);
+            }
+#ifdef __linux__
+            else if ((listener_instance->io_loop != NULL) &&
+                (xio_setoption(accepted_io, OPTION_IO_LOOP, listener_instance->io_loop) != 0))
+            {
+                LogError("Failure: cannot set the io loop of an accepted connection.");
+                xio_destroy(accepted_io);
+            }
+#endif
+            else
+            {
+                /* Codes_SRS_SOCKETIO_LISTENER_01_017: [ The XIO_HANDLE shall be passed to on_accept, which owns it from then on. ]*/
+                listener_instance->on_accept(listener_instance->on_accept_context, accepted_io);
+            }
+        }
+    }
+}
+
+#ifdef __linux__
+static void on_io_loop_event(void* context, unsigned int events)
+{
+    (void)events;
+    accept_connections((SOCKETIO_LISTENER_INSTANCE*)context);
+}
+#endif
+
+static void close_listening_socket(SOCKETIO_LISTENER_INSTANCE* listener_instance)
+{
+#ifdef __linux__
+    if (listener_instance->io_loop_registration != NULL)
+    {
+        io_loop_unregister(listener_instance->io_loop_registration);
+        listener_instance->io_loop_registration = NULL;
+    }
+#endif
+    if (listener_instance->socket != INVALID_SOCKET)
+    {
+        (void)close(listener_instance->socket);
+        listener_instance->socket = INVALID_SOCKET;
+    }
+}
+
+SOCKETIO_LISTENER_HANDLE socketio_listener_create(const SOCKETIO_LISTENER_CONFIG* config)
+{
+    SOCKETIO_LISTENER_INSTANCE* result;
+
+    /* Codes_SRS_SOCKETIO_LISTENER_01_001: [ If config is NULL or its port is not between 0 and 65535, socketio_listener_create shall fail and return NULL. ]*/
+    if ((config == NULL) ||
+        (config->port < 0) || (config->port > 65535))
+    {
+        LogError("Invalid argument: config=%p", config);
+        result = NULL;
+    }
+    /* Codes_SRS_SOCKETIO_LISTENER_01_002: [ socketio_listener_create shall allocate a new listener and copy the address. ]*/
+    else if ((result = (SOCKETIO_LISTENER_INSTANCE*)malloc(sizeof(SOCKETIO_LISTENER_INSTANCE))) == NULL)
+    {
+        LogError("Allocation Failure: SOCKETIO_LISTENER_INSTANCE");
+    }
+    else
+    {
+        SOCKETIO_CONFIG socketio_config;
+
+        /* the validator is never opened, the host name only has to be set */
+        socketio_config.hostname = "localhost";
+        socketio_config.port = 0;
+        socketio_config.accepted_socket = NULL;
+
+        result->address = NULL;
+        result->port = config->port;
+        result->backlog = (config->backlog > 0) ? config->backlog : SOCKETIO_LISTENER_DEFAULT_BACKLOG;
+        result->socket = INVALID_SOCKET;
+        result->on_accept = NULL;
+        result->on_accept_context = NULL;
+        result->accepted_io_options = NULL;
+#ifdef __linux__
+        result->io_loop = NULL;
+        result->io_loop_registration = NULL;
+#endif
+
+        if ((config->address != NULL) &&
+            ((result->address = (char*)malloc(strlen(config->address) + 1)) == NULL))
+        {
+            /* Codes_SRS_SOCKETIO_LISTENER_01_003: [ If any error occurs, socketio_listener_create shall fail and return NULL. ]*/
+            LogError("Allocation Failure: address");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->option_validator = socketio_create(&socketio_config)) == NULL)
+        {
+            LogError("Failure: socketio_create failed.");
+            free(result->address);
+            free(result);
+            result = NULL;
+        }
+        else if (config->address != NULL)
+        {
+            (void)strcpy(result->address, config->address);
+        }
+    }
+
+    return result;
+}
+
+void socketio_listener_destroy(SOCKETIO_LISTENER_HANDLE listener)
+{
+    /* Codes_SRS_SOCKETIO_LISTENER_01_004: [ If listener is NULL, socketio_listener_destroy shall do nothing. ]*/
+    if (listener != NULL)
+    {
+        /* Codes_SRS_SOCKETIO_LISTENER_01_005: [ socketio_listener_destroy shall close the listening socket and free the listener. ]*/
+        close_listening_socket(listener);
+        if (listener->accepted_io_options != NULL)
+        {
+            OptionHandler_Destroy(listener->accepted_io_options);
+        }
+        socketio_destroy(listener->option_validator);
+        free(listener->address);
+        free(listener);
+    }
+}
+
+int socketio_listener_start(SOCKETIO_LISTENER_HANDLE listener, ON_SOCKETIO_LISTENER_ACCEPT on_accept, void* on_accept_context)
+{
+    int result;
+
+    /* Codes_SRS_SOCKETIO_LISTENER_01_006: [ If listener or on_accept is NULL, socketio_listener_start shall fail and return a non-zero value. ]*/
+    if ((listener == NULL) || (on_accept == NULL))
+    {
+        LogError("Invalid arguments: listener=%p, on_accept=%p", listener, on_accept);
+        result = __LINE__;
+    }
+    /* Codes_SRS_SOCKETIO_LISTENER_01_007: [ If the listener is already started, socketio_listener_start shall fail and return a non-zero value. ]*/
+    else if (listener->socket != INVALID_SOCKET)
+    {
+        LogError("Failure: the listener is already started.");
+        result = __LINE__;
+    }
+    else
+    {
+        struct addrinfo addr_hint;
+        struct addrinfo* addr_info;
+        char port_string[16];
+        int error;
+
+        (void)memset(&addr_hint, 0, sizeof(addr_hint));
+        addr_hint.ai_family = AF_UNSPEC;
+        addr_hint.ai_socktype = SOCK_STREAM;
+        addr_hint.ai_flags = AI_PASSIVE | AI_NUMERICHOST;
+        (void)sprintf(port_string, "%d", listener->port);
+
+        /* Codes_SRS_SOCKETIO_LISTENER_01_008: [ socketio_listener_start shall create a non-blocking socket bound to the configured address and port, with SO_REUSEADDR set, and listen on it with the configured backlog. ]*/
+        if ((error = getaddrinfo(listener->address, port_string, &addr_hint, &addr_info)) != 0)
+        {
+            LogError("Failure: cannot parse the address %s: %s.", (listener->address == NULL) ? "NULL" : listener->address, gai_strerror(error));
+            result = __LINE__;
+        }
+        else
+        {
+            int reuse_address = 1;
+            int flags;
+
+            listener->socket = socket(addr_info->ai_family, addr_info->ai_socktype, addr_info->ai_protocol);
+            if (listener->socket == INVALID_SOCKET)
+            {
+                LogError("Failure: socket create failure %d.", errno);
+                result = __LINE__;
+            }
+            else if ((setsockopt(listener->socket, SOL_SOCKET, SO_REUSEADDR, &reuse_address, sizeof(reuse_address)) != 0) ||
+                ((flags = fcntl(listener->socket, F_GETFL, 0)) == -1) ||
+                (fcntl(listener->socket, F_SETFL, flags | O_NONBLOCK) == -1))
+            {
+                LogError("Failure: cannot configure the listening socket, errno %d.", errno);
+                result = __LINE__;
+            }
+            else if (bind(listener->socket, addr_info->ai_addr, addr_info->ai_addrlen) != 0)
+            {
+                LogError("Failure: bind failure %d.", errno);
+                result = __LINE__;
+            }
+            else if (listen(listener->socket, listener->backlog) != 0)
+            {
+                LogError("Failure: listen failure %d.", errno);
+                result = __LINE__;
+            }
+#ifdef __linux__
+            /* Codes_SRS_SOCKETIO_LISTENER_01_009: [ If an io loop was set, socketio_listener_start shall register the listening socket with it. ]*/
+            else if ((listener->io_loop != NULL) &&
+                ((listener->io_loop_registration = io_loop_register(listener->io_loop, listener->socket, IO_LOOP_EVENT_READ, on_io_loop_event, listener)) == NULL))
+            {
+                LogError("Failure: io_loop_register failed.");
+                result = __LINE__;
+            }
+#endif
+            else
+            {
+                listener->on_accept = on_accept;
+                listener->on_accept_context = on_accept_context;
+                result = 0;
+            }
+
+            /* Codes_SRS_SOCKETIO_LISTENER_01_010: [ If any error occurs, socketio_listener_start shall fail and return a non-zero value. ]*/
+            if (result != 0)
+            {
+                close_listening_socket(listener);
+            }
+
+            freeaddrinfo(addr_info);
+        }
+    }
+
+    return result;
+}
+
+void socketio_listener_stop(SOCKETIO_LISTENER_HANDLE listener)
+{
+    /* Codes_SRS_SOCKETIO_LISTENER_01_011: [ If listener is NULL, socketio_listener_stop shall do nothing. ]*/
+    if (listener != NULL)
+    {
+        /* Codes_SRS_SOCKETIO_LISTENER_01_012: [ socketio_listener_stop shall close the listening socket. ]*/
+        close_listening_socket(listener);
+    }
+}
+
+void socketio_listener_dowork(SOCKETIO_LISTENER_HANDLE listener)
+{
+    /* Codes_SRS_SOCKETIO_LISTENER_01_019: [ If listener is NULL or not started, socketio_listener_dowork shall do nothing. ]*/
+    if ((listener != NULL) &&
+        (listener->socket != INVALID_SOCKET))
+    {
+        accept_connections(listener);
+    }
+}
+
+int socketio_listener_get_port(SOCKETIO_LISTENER_HANDLE listener, int* port)
+{
+    int result;
+
+    /* Codes_SRS_SOCKETIO_LISTENER_01_020: [ If listener or port is NULL, or the listener is not started, socketio_listener_get_port shall fail and return a non-zero value. ]*/
+    if ((listener == NULL) || (port == NULL))
+    {
+        LogError("Invalid arguments: listener=%p, port=%p", listener, port);
+        result = __LINE__;
+    }
+    else if (listener->socket == INVALID_SOCKET)
+    {
+        LogError("Failure: the listener is not started.");
+        result = __LINE__;
+    }
+    else
+    {
+        struct sockaddr_storage address;
+        socklen_t address_length = sizeof(address);
+
+        /* Codes_SRS_SOCKETIO_LISTENER_01_021: [ socketio_listener_get_port shall return the port the listening socket is bound to. ]*/
+        if (getsockname(listener->socket, (struct sockaddr*)&address, &address_length) != 0)
+        {
+            LogError("Failure: getsockname failure %d.", errno);
+            result = __LINE__;
+        }
+        else
+        {
+            *port = (address.ss_family == AF_INET6) ?
+                (int)ntohs(((struct sockaddr_in6*)&address)->sin6_port) :
+                (int)ntohs(((struct sockaddr_in*)&address)->sin_port);
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int socketio_listener_setoption(SOCKETIO_LISTENER_HANDLE listener, const char* option_name, const void* value)
+{
+    int result;
+
+    /* Codes_SRS_SOCKETIO_LISTENER_01_022: [ If listener, option_name or value is NULL, socketio_listener_setoption shall fail and return a non-zero value. ]*/
+    if ((listener == NULL) || (option_name == NULL) || (value == NULL))
+    {
+        LogError("Invalid arguments: listener=%p, option_name=%p, value=%p", listener, option_name, value);
+        result = __LINE__;
+    }
+#ifdef __linux__
+    else if (strcmp(option_name, OPTION_IO_LOOP) == 0)
+    {
+        /* Codes_SRS_SOCKETIO_LISTENER_01_023: [ OPTION_IO_LOOP shall only be accepted before the listener is started and only once. ]*/
+        if ((listener->io_loop != NULL) ||
+            (listener->socket != INVALID_SOCKET))
+        {
+            LogError("Failure: the io loop can only be set once, before the listener is started.");
+            result = __LINE__;
+        }
+        else
+        {
+            listener->io_loop = (IO_LOOP_HANDLE)value;
+            result = 0;
+        }
+    }
+#endif
+    else if (strcmp(option_name, OPTION_ON_WRITABLE) == 0)
+    {
+        /* Codes_SRS_SOCKETIO_LISTENER_01_025: [ OPTION_ON_WRITABLE shall be refused, its callback context cannot be shared by all the accepted XIO_HANDLEs. ]*/
+        LogError("Failure: OPTION_ON_WRITABLE has to be set on each accepted XIO_HANDLE.");
+        result = __LINE__;
+    }
+    /* Codes_SRS_SOCKETIO_LISTENER_01_024: [ Any other option shall be validated with socketio_setoption and kept to be set on the accepted XIO_HANDLEs. The size_t options (OPTION_RECEIVE_BUFFER_SIZE, OPTION_SEND_HIGH_WATERMARK, OPTION_SEND_LOW_WATERMARK) shall be kept as size_t. ]*/
+    else if (socketio_setoption(listener->option_validator, option_name, value) != 0)
+    {
+        LogError("Failure: %s is not a valid socketio option.", option_name);
+        result = __LINE__;
+    }
+    else if ((listener->accepted_io_options == NULL) &&
+        ((listener->accepted_io_options = OptionHandler_Create(socketio_listener_CloneOption, socketio_listener_DestroyOption, (pfSetOption)xio_setoption)) == NULL))
+    {
+        LogError("Failure: OptionHandler_Create failed.");
+        result = __LINE__;
+    }
+    else if (OptionHandler_AddOption(listener->accepted_io_options, option_name, value) != OPTIONHANDLER_OK)
+    {
+        LogError("Failure: OptionHandler_AddOption failed.");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
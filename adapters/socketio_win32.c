@@ -86,7 +86,10 @@ static const IO_INTERFACE_DESCRIPTION socket_io_interface_description =
     socketio_close,
     socketio_send,
     socketio_dowork,
-    socketio_setoption
+    socketio_setoption,
+    NULL,
+    NULL,
+    NULL
 };
 
 static void indicate_error(SOCKET_IO_INSTANCE* socket_io_instance)
@@ -618,3 +621,27 @@ const IO_INTERFACE_DESCRIPTION* socketio_get_interface_description(void)
 {
     return &socket_io_interface_description;
 }
+
+int socketio_get_statistics(CONCRETE_IO_HANDLE socket_io, XIO_STATISTICS* statistics)
+{
+    (void)socket_io;
+    (void)statistics;
+    LogError("Statistics are not collected by this socketio adapter.");
+    return __LINE__;
+}
+
+int socketio_get_socket(CONCRETE_IO_HANDLE socket_io, intptr_t* socket_handle)
+{
+    (void)socket_io;
+    (void)socket_handle;
+    LogError("The socket is not exposed by this socketio adapter.");
+    return __LINE__;
+}
+
+int socketio_get_receive_statistics(CONCRETE_IO_HANDLE socket_io, SOCKETIO_RECEIVE_STATISTICS* statistics)
+{
+    (void)socket_io;
+    (void)statistics;
+    LogError("Receive statistics are not collected by this socketio adapter.");
+    return __LINE__;
+}
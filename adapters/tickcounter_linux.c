@@ -13,29 +13,72 @@
 #include "azure_c_shared_utility/tickcounter.h"
 #include "azure_c_shared_utility/xlogging.h"
 
-#define INVALID_TIME_VALUE      (time_t)(-1)
+/* CLOCK_MONOTONIC is not affected by changes to the wall clock. The coarse clock is
+   cheaper to read (no hardware counter access) but only advances once per scheduler tick. */
+#if defined(TICKCOUNTER_USE_COARSE_CLOCK) && defined(CLOCK_MONOTONIC_COARSE)
+#define TICKCOUNTER_CLOCK_ID    CLOCK_MONOTONIC_COARSE
+#else
+#define TICKCOUNTER_CLOCK_ID    CLOCK_MONOTONIC
+#endif
+
+#define NANOSECONDS_IN_1_SECOND         1000000000ULL
+#define NANOSECONDS_IN_1_MICROSECOND    1000ULL
+#define NANOSECONDS_IN_1_MILLISECOND    1000000ULL
+
 typedef struct TICK_COUNTER_INSTANCE_TAG
 {
-    time_t init_time_value;
-    uint64_t current_ms;
+    uint64_t init_time_ns;
 } TICK_COUNTER_INSTANCE;
 
+static int get_monotonic_time_ns(uint64_t* time_ns)
+{
+    int result;
+    struct timespec time_value;
+
+    if (clock_gettime(TICKCOUNTER_CLOCK_ID, &time_value) != 0)
+    {
+        LogError("tickcounter failed: clock_gettime failed.");
+        result = __LINE__;
+    }
+    else
+    {
+        *time_ns = ((uint64_t)time_value.tv_sec * NANOSECONDS_IN_1_SECOND) + (uint64_t)time_value.tv_nsec;
+        result = 0;
+    }
+
+    return result;
+}
+
+static int get_elapsed_ns(TICK_COUNTER_HANDLE tick_counter, uint64_t* elapsed_ns)
+{
+    int result;
+    uint64_t time_ns;
+
+    if (get_monotonic_time_ns(&time_ns) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        TICK_COUNTER_INSTANCE* tick_counter_instance = (TICK_COUNTER_INSTANCE*)tick_counter;
+        *elapsed_ns = time_ns - tick_counter_instance->init_time_ns;
+        result = 0;
+    }
+
+    return result;
+}
+
 TICK_COUNTER_HANDLE tickcounter_create(void)
 {
     TICK_COUNTER_INSTANCE* result = (TICK_COUNTER_INSTANCE*)malloc(sizeof(TICK_COUNTER_INSTANCE));
     if (result != NULL)
     {
-        result->init_time_value = time(NULL);
-        if (result->init_time_value == INVALID_TIME_VALUE)
+        if (get_monotonic_time_ns(&result->init_time_ns) != 0)
         {
-            LogError("tickcounter failed: time return INVALID_TIME.");
+            LogError("tickcounter failed: cannot read the monotonic clock.");
             free(result);
             result = NULL;
         }
-        else
-        {
-            result->current_ms = 0;
-        }
     }
     return result;
 }
@@ -59,16 +102,40 @@ int tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, uint64_t* curre
     }
     else
     {
-        time_t time_value = time(NULL);
-        if (time_value == INVALID_TIME_VALUE)
+        uint64_t elapsed_ns;
+        if (get_elapsed_ns(tick_counter, &elapsed_ns) != 0)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            *current_ms = elapsed_ns / NANOSECONDS_IN_1_MILLISECOND;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int tickcounter_get_current_us(TICK_COUNTER_HANDLE tick_counter, uint64_t* current_us)
+{
+    int result;
+
+    if (tick_counter == NULL || current_us == NULL)
+    {
+        LogError("tickcounter failed: Invalid Arguments.");
+        result = __LINE__;
+    }
+    else
+    {
+        uint64_t elapsed_ns;
+        if (get_elapsed_ns(tick_counter, &elapsed_ns) != 0)
         {
             result = __LINE__;
         }
         else
         {
-            TICK_COUNTER_INSTANCE* tick_counter_instance = (TICK_COUNTER_INSTANCE*)tick_counter;
-            tick_counter_instance->current_ms = (uint64_t)(difftime(time_value, tick_counter_instance->init_time_value) * 1000);
-            *current_ms = tick_counter_instance->current_ms;
+            *current_us = elapsed_ns / NANOSECONDS_IN_1_MICROSECOND;
             result = 0;
         }
     }
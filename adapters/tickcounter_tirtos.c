@@ -75,3 +75,27 @@ int tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, uint64_t* curre
 
     return result;
 }
+
+int tickcounter_get_current_us(TICK_COUNTER_HANDLE tick_counter, uint64_t* current_us)
+{
+    int result;
+    uint64_t current_ms;
+
+    if (current_us == NULL)
+    {
+        LogError("tickcounter failed: Invalid Arguments.");
+        result = __LINE__;
+    }
+    else if (tickcounter_get_current_ms(tick_counter, &current_ms) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        /* time() only has a resolution of one second */
+        *current_us = current_ms * 1000;
+        result = 0;
+    }
+
+    return result;
+}
@@ -120,3 +120,33 @@ int tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, uint64_t* curre
     }
     return result;
 }
+
+int tickcounter_get_current_us(TICK_COUNTER_HANDLE tick_counter, uint64_t* current_us)
+{
+    int result;
+    uint64_t current_ms;
+    if (current_us == NULL)
+    {
+        LogError("tickcounter failed: Invalid Arguments.");
+        result = __LINE__;
+    }
+    else if (tickcounter_get_current_ms(tick_counter, &current_ms) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        TICK_COUNTER_INSTANCE* tick_counter_instance = (TICK_COUNTER_INSTANCE*)tick_counter;
+        if (tick_counter_instance->backup_time_value == INVALID_TIME_VALUE)
+        {
+            // the performance counter path accumulates microseconds in current_ms
+            *current_us = tick_counter_instance->current_ms;
+        }
+        else
+        {
+            *current_us = current_ms * 1000;
+        }
+        result = 0;
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file dns_resolver.h
+ *	@brief	 Resolves a host name to IPv4 and IPv6 addresses without
+ *			 blocking the caller. The lookup runs on a helper thread; the
+ *			 caller polls for its completion from its dowork.
+ *
+ *	@details Results are kept in a process-wide cache so that reconnecting
+ *			 to the same host does not wait for the system resolver again.
+ *			 Concurrent lookups of the same host share one getaddrinfo call.
+ */
+
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+struct addrinfo;
+
+typedef struct DNS_RESOLVER_INSTANCE_TAG* DNS_RESOLVER_HANDLE;
+
+/** @brief Has the signature of getaddrinfo, which is the default lookup function. */
+typedef int(*DNS_RESOLVER_GETADDRINFO)(const char* node, const char* service, const struct addrinfo* hints, struct addrinfo** res);
+/** @brief Has the signature of freeaddrinfo, frees what the lookup function returned. */
+typedef void(*DNS_RESOLVER_FREEADDRINFO)(struct addrinfo* res);
+
+#define DNS_RESOLVER_DEFAULT_TTL_MS             30000
+#define DNS_RESOLVER_DEFAULT_NEGATIVE_TTL_MS    1000
+#define DNS_RESOLVER_DEFAULT_STALE_TTL_MS       0
+#define DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT    64
+
+/** @brief Controls the process-wide cache of lookup results. */
+typedef struct DNS_RESOLVER_CACHE_OPTIONS_TAG
+{
+    /** @brief How long the addresses of a successful lookup are reused. */
+    uint32_t ttl_ms;
+    /** @brief How long a failed lookup is reported again without asking the resolver. */
+    uint32_t negative_ttl_ms;
+    /** @brief How long after @c ttl_ms expired the addresses are still used
+     *		   while a lookup refreshes them in the background. 0 disables it. */
+    uint32_t stale_ttl_ms;
+    /** @brief Number of host names kept, the least recently used ones are
+     *		   dropped first. 0 disables the cache. */
+    size_t max_entry_count;
+} DNS_RESOLVER_CACHE_OPTIONS;
+
+/**
+ * @brief	Starts resolving @p hostname to TCP addresses.
+ *
+ * @param	hostname	The host name or numeric address to resolve.
+ * @param	port		The port stored in the resolved addresses.
+ *
+ * @return	A valid @c DNS_RESOLVER_HANDLE when the lookup was started or
+ * 			@c NULL otherwise. When the result is cached the lookup is
+ * 			already complete.
+ */
+MOCKABLE_FUNCTION(, DNS_RESOLVER_HANDLE, dns_resolver_create, const char*, hostname, int, port);
+
+/**
+ * @brief	Frees the resolver. It can be called while the lookup is still
+ * 			running; its result is then discarded when it completes.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_destroy, DNS_RESOLVER_HANDLE, dns_resolver);
+
+/**
+ * @brief	Checks whether the lookup completed, successfully or not. Never blocks.
+ */
+MOCKABLE_FUNCTION(, bool, dns_resolver_is_complete, DNS_RESOLVER_HANDLE, dns_resolver);
+
+/**
+ * @brief	Gets the resolved addresses, in the order they should be tried.
+ *
+ * @return	The addresses, owned by the resolver, or @c NULL when the lookup
+ * 			failed or did not complete yet.
+ */
+MOCKABLE_FUNCTION(, const struct addrinfo*, dns_resolver_get_addrinfo, DNS_RESOLVER_HANDLE, dns_resolver);
+
+/**
+ * @brief	Changes the cache options. Entries already cached keep the
+ * 			expiry time they were stored with.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, dns_resolver_set_cache_options, const DNS_RESOLVER_CACHE_OPTIONS*, options);
+
+/**
+ * @brief	Drops all the cached results.
+ */
+MOCKABLE_FUNCTION(, void, dns_resolver_clear_cache);
+
+/**
+ * @brief	Replaces getaddrinfo, for instance with a local stub in tests.
+ * 			Passing @c NULL for both functions restores getaddrinfo and
+ * 			freeaddrinfo. Lookups already running keep their functions.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, dns_resolver_set_lookup_functions, DNS_RESOLVER_GETADDRINFO, getaddrinfo_function, DNS_RESOLVER_FREEADDRINFO, freeaddrinfo_function);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DNS_RESOLVER_H */
@@ -0,0 +1,103 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file io_loop.h
+ *	@brief	 An event loop that multiplexes many file descriptors and a timer
+ *			 wheel. Callbacks fire only when a descriptor is ready, so idle
+ *			 connections cost nothing. The Linux implementation uses epoll.
+ */
+
+#ifndef IO_LOOP_H
+#define IO_LOOP_H
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdint.h>
+#endif
+
+#include "azure_c_shared_utility/timer_wheel.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/** @brief The descriptor is readable, or the peer closed the connection. */
+#define IO_LOOP_EVENT_READ      0x01
+/** @brief The descriptor is writable, or a pending connect completed. */
+#define IO_LOOP_EVENT_WRITE     0x02
+/** @brief An error or hang up occurred. Always reported, whatever events were requested. */
+#define IO_LOOP_EVENT_ERROR     0x04
+
+/** @brief Wait for events until one occurs. */
+#define IO_LOOP_WAIT_INFINITE   UINT32_MAX
+
+typedef struct IO_LOOP_INSTANCE_TAG* IO_LOOP_HANDLE;
+typedef struct IO_LOOP_REGISTRATION_INSTANCE_TAG* IO_LOOP_REGISTRATION_HANDLE;
+
+/** @brief Called from ::io_loop_wait with the events that are ready on the descriptor. */
+typedef void(*ON_IO_LOOP_EVENT)(void* context, unsigned int events);
+
+/**
+ * @brief	Creates an io loop and its timer wheel.
+ *
+ * @return	A valid @c IO_LOOP_HANDLE when successful or @c NULL otherwise.
+ */
+MOCKABLE_FUNCTION(, IO_LOOP_HANDLE, io_loop_create);
+
+/**
+ * @brief	Frees the io loop. All the descriptors must have been unregistered.
+ */
+MOCKABLE_FUNCTION(, void, io_loop_destroy, IO_LOOP_HANDLE, io_loop);
+
+/**
+ * @brief	Starts watching @p fd for @p events.
+ *
+ * @param	io_loop				The io loop.
+ * @param	fd					The descriptor. It should be non-blocking.
+ * @param	events				A combination of @c IO_LOOP_EVENT_READ and @c IO_LOOP_EVENT_WRITE.
+ * @param	on_io_loop_event	Called from ::io_loop_wait when the descriptor is ready.
+ * @param	context				Passed to @p on_io_loop_event.
+ *
+ * @return	A registration handle or @c NULL on failure.
+ */
+MOCKABLE_FUNCTION(, IO_LOOP_REGISTRATION_HANDLE, io_loop_register, IO_LOOP_HANDLE, io_loop, int, fd, unsigned int, events, ON_IO_LOOP_EVENT, on_io_loop_event, void*, context);
+
+/**
+ * @brief	Changes the events watched for a registered descriptor.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, io_loop_modify, IO_LOOP_REGISTRATION_HANDLE, registration, unsigned int, events);
+
+/**
+ * @brief	Stops watching a descriptor. Must be called before the descriptor
+ * 			is closed. It is safe to call from an event callback; no further
+ * 			events are reported for the registration.
+ */
+MOCKABLE_FUNCTION(, void, io_loop_unregister, IO_LOOP_REGISTRATION_HANDLE, registration);
+
+/**
+ * @brief	Blocks until at least one descriptor is ready, the timer wheel
+ * 			needs servicing or @p timeout_ms elapses, then calls the
+ * 			callbacks of the ready descriptors and of the expired timers.
+ * 			It can return before @p timeout_ms without calling any callback;
+ * 			callers are expected to call it in a loop.
+ *
+ * @param	io_loop		The io loop.
+ * @param	timeout_ms	The maximum time to block, 0 to poll or
+ * 						@c IO_LOOP_WAIT_INFINITE.
+ *
+ * @return	0 on success (including a timeout), a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, io_loop_wait, IO_LOOP_HANDLE, io_loop, uint32_t, timeout_ms);
+
+/**
+ * @brief	Gets the timer wheel serviced by ::io_loop_wait. It is owned by
+ * 			the io loop.
+ */
+MOCKABLE_FUNCTION(, TIMER_WHEEL_HANDLE, io_loop_get_timer_wheel, IO_LOOP_HANDLE, io_loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IO_LOOP_H */
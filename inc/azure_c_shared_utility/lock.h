@@ -18,7 +18,10 @@
 #include "azure_c_shared_utility/umock_c_prod.h"
 
 #ifdef __cplusplus
+#include <cstdint>
 extern "C" {
+#else
+#include <stdint.h>
 #endif
 
 typedef void* LOCK_HANDLE;
@@ -31,6 +34,17 @@ typedef void* LOCK_HANDLE;
 */
 DEFINE_ENUM(LOCK_RESULT, LOCK_RESULT_VALUES);
 
+/** @brief Contention counters collected for a lock when the library is built
+*		   with @c LOCK_COLLECT_STATISTICS defined.
+*/
+typedef struct LOCK_STATISTICS_TAG
+{
+    const char* name;
+    uint64_t acquire_count;
+    uint64_t contended_count;
+    uint64_t total_wait_ns;
+} LOCK_STATISTICS;
+
 /**
  * @brief	This API creates and returns a valid lock handle.
  *
@@ -38,6 +52,17 @@ DEFINE_ENUM(LOCK_RESULT, LOCK_RESULT_VALUES);
  */
 MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init);
 
+/**
+ * @brief	This API creates and returns a valid lock handle that carries a
+ * 			name used to identify it in the lock statistics.
+ *
+ * @param	name	A name for the lock. The name is copied; @c NULL is
+ * 					accepted and yields an unnamed lock.
+ *
+ * @return	A valid @c LOCK_HANDLE when successful or @c NULL otherwise.
+ */
+MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init_Named, const char*, name);
+
 /**
  * @brief	Acquires a lock on the given lock handle. Uses platform
  * 			specific mutex primitives in its implementation.
@@ -70,6 +95,30 @@ MOCKABLE_FUNCTION(, LOCK_RESULT, Unlock, LOCK_HANDLE, handle);
  */
 MOCKABLE_FUNCTION(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, handle);
 
+/**
+ * @brief	Retrieves the contention counters of the given lock.
+ *
+ * @param	handle		A valid handle to the lock.
+ * @param	statistics	Receives the counters. The @c name member stays
+ * 						valid until the lock is destroyed.
+ *
+ * 			The counters are read without taking @p handle, so the owner of the
+ * 			lock may call this while holding it.
+ *
+ * @return	Returns @c LOCK_OK when the counters have been retrieved and
+ * 			@c LOCK_ERROR when an error occurs or when the lock adapter was
+ * 			not built with @c LOCK_COLLECT_STATISTICS.
+ */
+MOCKABLE_FUNCTION(, LOCK_RESULT, Lock_GetStatistics, LOCK_HANDLE, handle, LOCK_STATISTICS*, statistics);
+
+/**
+ * @brief	Logs the contention counters of every live lock.
+ *
+ * 			Does nothing but log a notice when the lock adapter was not built
+ * 			with @c LOCK_COLLECT_STATISTICS.
+ */
+MOCKABLE_FUNCTION(, void, Lock_DumpStatistics);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file memio.h
+ *	@brief	 In-memory transport that connects two XIO_HANDLEs in the same
+ *			 process, so that tlsio, wsio or httpapi_compact can be exercised
+ *			 and benchmarked without the network stack.
+ *
+ *	@details A pipe has two endpoints, each one used by one XIO_HANDLE created
+ *			 with ::memio_get_interface_description. The bytes sent on one
+ *			 endpoint are delivered by the ::xio_dowork of the other one, after
+ *			 the configured latency and at the configured bandwidth. When the
+ *			 pipe uses a manual clock, time only moves with
+ *			 ::memio_pipe_advance_time, which makes the runs reproducible.
+ *			 Pipes are not thread safe, both endpoints are meant to be driven
+ *			 from the same thread.
+ */
+
+#ifndef MEMIO_H
+#define MEMIO_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_c_shared_utility/xio.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+typedef struct MEMIO_PIPE_INSTANCE_TAG* MEMIO_PIPE_HANDLE;
+
+typedef enum MEMIO_ENDPOINT_TAG
+{
+    MEMIO_ENDPOINT_CLIENT,
+    MEMIO_ENDPOINT_SERVER
+} MEMIO_ENDPOINT;
+
+typedef struct MEMIO_PIPE_CONFIG_TAG
+{
+    /** @brief Time between a byte leaving one endpoint and reaching the other one. */
+    uint32_t latency_us;
+    /** @brief Bytes per second in each direction, 0 for no limit. */
+    uint64_t bandwidth;
+    /** @brief Largest buffer passed to on_bytes_received, 0 to deliver each
+     *		   send in one call. Small values exercise the partial record
+     *		   and frame handling of the layers above. */
+    size_t chunk_size;
+    /** @brief When true the time only moves with ::memio_pipe_advance_time. */
+    bool manual_clock;
+} MEMIO_PIPE_CONFIG;
+
+/** @brief The io_create_parameters of ::xio_create for memio. */
+typedef struct MEMIO_CONFIG_TAG
+{
+    MEMIO_PIPE_HANDLE pipe;
+    MEMIO_ENDPOINT endpoint;
+} MEMIO_CONFIG;
+
+/**
+ * @brief	Creates a pipe. @p config can be @c NULL for a pipe without
+ * 			latency and bandwidth limits that uses the tick counter.
+ *
+ * @return	A valid @c MEMIO_PIPE_HANDLE or @c NULL on failure.
+ */
+MOCKABLE_FUNCTION(, MEMIO_PIPE_HANDLE, memio_pipe_create, const MEMIO_PIPE_CONFIG*, config);
+
+/**
+ * @brief	Releases the pipe. It is freed once the XIO_HANDLEs of both
+ * 			endpoints are destroyed too.
+ */
+MOCKABLE_FUNCTION(, void, memio_pipe_destroy, MEMIO_PIPE_HANDLE, pipe);
+
+/**
+ * @brief	Moves the manual clock of the pipe forward. The bytes that become
+ * 			due are delivered by the next ::xio_dowork of their endpoint.
+ *
+ * @return	0 on success, a non-zero value if the pipe does not use a manual clock.
+ */
+MOCKABLE_FUNCTION(, int, memio_pipe_advance_time, MEMIO_PIPE_HANDLE, pipe, uint32_t, elapsed_us);
+
+MOCKABLE_FUNCTION(, CONCRETE_IO_HANDLE, memio_create, void*, io_create_parameters);
+MOCKABLE_FUNCTION(, void, memio_destroy, CONCRETE_IO_HANDLE, memio);
+MOCKABLE_FUNCTION(, int, memio_open, CONCRETE_IO_HANDLE, memio, ON_IO_OPEN_COMPLETE, on_io_open_complete, void*, on_io_open_complete_context, ON_BYTES_RECEIVED, on_bytes_received, void*, on_bytes_received_context, ON_IO_ERROR, on_io_error, void*, on_io_error_context);
+MOCKABLE_FUNCTION(, int, memio_close, CONCRETE_IO_HANDLE, memio, ON_IO_CLOSE_COMPLETE, on_io_close_complete, void*, callback_context);
+MOCKABLE_FUNCTION(, int, memio_send, CONCRETE_IO_HANDLE, memio, const void*, buffer, size_t, size, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
+MOCKABLE_FUNCTION(, void, memio_dowork, CONCRETE_IO_HANDLE, memio);
+MOCKABLE_FUNCTION(, int, memio_setoption, CONCRETE_IO_HANDLE, memio, const char*, optionName, const void*, value);
+MOCKABLE_FUNCTION(, OPTIONHANDLER_HANDLE, memio_retrieveoptions, CONCRETE_IO_HANDLE, memio);
+
+MOCKABLE_FUNCTION(, const IO_INTERFACE_DESCRIPTION*, memio_get_interface_description);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMIO_H */
@@ -32,6 +32,47 @@ extern "C"
     static const char* OPTION_CURL_FORBID_REUSE = "CURLOPT_FORBID_REUSE";
     static const char* OPTION_CURL_VERBOSE = "CURLOPT_VERBOSE";
 
+    /* value is an IO_LOOP_HANDLE; the socket is then serviced by io_loop_wait instead of xio_dowork */
+    static const char* OPTION_IO_LOOP = "io_loop";
+    /* value is a size_t, the size of the buffer that socketio passes to each recv call */
+    static const char* OPTION_RECEIVE_BUFFER_SIZE = "receive_buffer_size";
+    /* values are size_t, 0 for no limit; once the queued bytes reach the high watermark the sends fail with
+       XIO_SEND_WOULD_BLOCK until the queue drains to the low watermark, which is signalled by OPTION_ON_WRITABLE */
+    static const char* OPTION_SEND_HIGH_WATERMARK = "send_high_watermark";
+    static const char* OPTION_SEND_LOW_WATERMARK = "send_low_watermark";
+    /* value is an XIO_WRITABLE_CALLBACK */
+    static const char* OPTION_ON_WRITABLE = "on_writable";
+    /* value is a size_t, the size of the buffer that tlsio passes to each SSL_read call */
+    static const char* OPTION_TLS_RECEIVE_BUFFER_SIZE = "tls_receive_buffer_size";
+    /* value is a size_t, the most received ciphertext that tlsio_wolfssl holds until wolfSSL decrypts it; the
+       connection fails with on_io_error when the underlying io delivers more */
+    static const char* OPTION_TLS_MAX_PENDING_RECEIVE_BYTES = "tls_max_pending_receive_bytes";
+    /* values are ints, one of the TLSIO_VERSION_* values of tlsio.h; they apply from the next open */
+    static const char* OPTION_TLS_MIN_VERSION = "tls_min_version";
+    static const char* OPTION_TLS_MAX_VERSION = "tls_max_version";
+    /* values are strings in the syntax of the TLS library: the cipher list for TLS 1.2 and below, the TLS 1.3
+       ciphersuites and the key exchange groups (e.g. "X25519:P-256"); they apply from the next open */
+    static const char* OPTION_TLS_CIPHER_LIST = "tls_cipher_list";
+    static const char* OPTION_TLS_CIPHERSUITES = "tls_ciphersuites";
+    static const char* OPTION_TLS_GROUPS = "tls_groups";
+    /* value is an int, non-zero to let the kernel encrypt the records (Linux kTLS) once the handshake is done; the
+       connection keeps the user space encryption when the kernel, the TLS library or the cipher do not support it.
+       Only the sent records are offloaded, the received ones are still decrypted by the TLS library. tlsio_openssl
+       only honors it when the library is built with use_ktls */
+    static const char* OPTION_TLS_KTLS = "tls_ktls";
+
+    /* socket options, the values are ints; they can be set before the socket is connected */
+    static const char* OPTION_TCP_KEEPALIVE = "tcp_keepalive";
+    static const char* OPTION_TCP_KEEPALIVE_TIME = "tcp_keepalive_time";
+    static const char* OPTION_TCP_KEEPALIVE_INTERVAL = "tcp_keepalive_interval";
+    static const char* OPTION_TCP_NODELAY = "tcp_nodelay";
+    static const char* OPTION_TCP_SEND_BUFFER_SIZE = "tcp_send_buffer_size";
+    static const char* OPTION_TCP_RECEIVE_BUFFER_SIZE = "tcp_receive_buffer_size";
+    static const char* OPTION_TCP_QUICKACK = "tcp_quickack";
+    static const char* OPTION_TCP_NOTSENT_LOWAT = "tcp_notsent_lowat";
+    static const char* OPTION_TCP_USER_TIMEOUT = "tcp_user_timeout";
+    static const char* OPTION_SOCKET_BUSY_POLL = "socket_busy_poll";
+
 #ifdef __cplusplus
 }
 #endif
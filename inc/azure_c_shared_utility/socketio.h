@@ -7,8 +7,10 @@
 #ifdef __cplusplus
 extern "C" {
 #include <cstddef>
+#include <cstdint>
 #else
 #include <stddef.h>
+#include <stdint.h>
 #endif /* __cplusplus */
 
 #include "azure_c_shared_utility/xio.h"
@@ -24,15 +26,28 @@ typedef struct SOCKETIO_CONFIG_TAG
 
 #define RECEIVE_BYTES_VALUE     64
 
+/* size of the per connection receive buffer of socketio_berkeley, it can be changed with OPTION_RECEIVE_BUFFER_SIZE */
+#define SOCKETIO_DEFAULT_RECEIVE_BUFFER_SIZE    (16 * 1024)
+
+typedef struct SOCKETIO_RECEIVE_STATISTICS_TAG
+{
+    uint64_t recv_call_count;
+    uint64_t received_byte_count;
+} SOCKETIO_RECEIVE_STATISTICS;
+
 MOCKABLE_FUNCTION(, CONCRETE_IO_HANDLE, socketio_create, void*, io_create_parameters);
 MOCKABLE_FUNCTION(, void, socketio_destroy, CONCRETE_IO_HANDLE, socket_io);
 MOCKABLE_FUNCTION(, int, socketio_open, CONCRETE_IO_HANDLE, socket_io, ON_IO_OPEN_COMPLETE, on_io_open_complete, void*, on_io_open_complete_context, ON_BYTES_RECEIVED, on_bytes_received, void*, on_bytes_received_context, ON_IO_ERROR, on_io_error, void*, on_io_error_context);
 MOCKABLE_FUNCTION(, int, socketio_close, CONCRETE_IO_HANDLE, socket_io, ON_IO_CLOSE_COMPLETE, on_io_close_complete, void*, callback_context);
 MOCKABLE_FUNCTION(, int, socketio_send, CONCRETE_IO_HANDLE, socket_io, const void*, buffer, size_t, size, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
+MOCKABLE_FUNCTION(, int, socketio_send_vectored, CONCRETE_IO_HANDLE, socket_io, const XIO_BUFFER*, buffers, size_t, buffer_count, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
 MOCKABLE_FUNCTION(, void, socketio_dowork, CONCRETE_IO_HANDLE, socket_io);
 MOCKABLE_FUNCTION(, int, socketio_setoption, CONCRETE_IO_HANDLE, socket_io, const char*, optionName, const void*, value);
 
 MOCKABLE_FUNCTION(, const IO_INTERFACE_DESCRIPTION*, socketio_get_interface_description);
+MOCKABLE_FUNCTION(, int, socketio_get_statistics, CONCRETE_IO_HANDLE, socket_io, XIO_STATISTICS*, statistics);
+MOCKABLE_FUNCTION(, int, socketio_get_receive_statistics, CONCRETE_IO_HANDLE, socket_io, SOCKETIO_RECEIVE_STATISTICS*, statistics);
+MOCKABLE_FUNCTION(, int, socketio_get_socket, CONCRETE_IO_HANDLE, socket_io, intptr_t*, socket_handle);
 
 #ifdef __cplusplus
 }
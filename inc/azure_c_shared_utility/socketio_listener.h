@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file socketio_listener.h
+ *	@brief	 Accepts TCP connections and hands each one over as a socketio
+ *			 XIO_HANDLE, so that servers run on the same xio stack as the
+ *			 clients (for instance with tlsio or wsio layered on top).
+ */
+
+#ifndef SOCKETIO_LISTENER_H
+#define SOCKETIO_LISTENER_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif
+
+#include "azure_c_shared_utility/xio.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/** @brief Maximum number of connections accepted by one ::socketio_listener_dowork call. */
+#define SOCKETIO_LISTENER_ACCEPT_BATCH_SIZE     64
+
+/** @brief Backlog used when the configuration does not specify one. */
+#define SOCKETIO_LISTENER_DEFAULT_BACKLOG       128
+
+typedef struct SOCKETIO_LISTENER_INSTANCE_TAG* SOCKETIO_LISTENER_HANDLE;
+
+typedef struct SOCKETIO_LISTENER_CONFIG_TAG
+{
+    /** @brief Numeric IPv4 or IPv6 address to bind to, @c NULL for all interfaces. */
+    const char* address;
+    /** @brief Port to listen on, 0 lets the system pick one (see ::socketio_listener_get_port). */
+    int port;
+    /** @brief Length of the queue of pending connections, 0 for the default. */
+    int backlog;
+} SOCKETIO_LISTENER_CONFIG;
+
+/**
+ * @brief	Called for every accepted connection. The callback owns
+ * 			@p accepted_io: it opens it with ::xio_open and destroys it with
+ * 			::xio_destroy. The connection is already established, so the
+ * 			open completes synchronously.
+ */
+typedef void(*ON_SOCKETIO_LISTENER_ACCEPT)(void* context, XIO_HANDLE accepted_io);
+
+/**
+ * @brief	Creates a listener. Nothing is bound until ::socketio_listener_start.
+ *
+ * @return	A valid @c SOCKETIO_LISTENER_HANDLE or @c NULL on failure.
+ */
+MOCKABLE_FUNCTION(, SOCKETIO_LISTENER_HANDLE, socketio_listener_create, const SOCKETIO_LISTENER_CONFIG*, config);
+
+/**
+ * @brief	Stops the listener and frees it. Connections already handed over
+ * 			are not affected.
+ */
+MOCKABLE_FUNCTION(, void, socketio_listener_destroy, SOCKETIO_LISTENER_HANDLE, listener);
+
+/**
+ * @brief	Binds and starts listening. The connections are accepted by
+ * 			::socketio_listener_dowork, or by the io loop when
+ * 			@c OPTION_IO_LOOP is set.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, socketio_listener_start, SOCKETIO_LISTENER_HANDLE, listener, ON_SOCKETIO_LISTENER_ACCEPT, on_accept, void*, on_accept_context);
+
+/**
+ * @brief	Closes the listening socket. The listener can be started again.
+ */
+MOCKABLE_FUNCTION(, void, socketio_listener_stop, SOCKETIO_LISTENER_HANDLE, listener);
+
+/**
+ * @brief	Accepts the pending connections, at most
+ * 			@c SOCKETIO_LISTENER_ACCEPT_BATCH_SIZE of them. Never blocks.
+ */
+MOCKABLE_FUNCTION(, void, socketio_listener_dowork, SOCKETIO_LISTENER_HANDLE, listener);
+
+/**
+ * @brief	Gets the port the listener is bound to, useful when it was
+ * 			configured with port 0.
+ *
+ * @return	0 on success, a non-zero value if the listener is not started.
+ */
+MOCKABLE_FUNCTION(, int, socketio_listener_get_port, SOCKETIO_LISTENER_HANDLE, listener, int*, port);
+
+/**
+ * @brief	Sets an option. @c OPTION_IO_LOOP makes the io loop accept the
+ * 			connections and is also set on every accepted XIO_HANDLE. The
+ * 			socket options of socketio (@c OPTION_TCP_NODELAY and the like)
+ * 			are set on every accepted XIO_HANDLE.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, socketio_listener_setoption, SOCKETIO_LISTENER_HANDLE, listener, const char*, option_name, const void*, value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOCKETIO_LISTENER_H */
@@ -0,0 +1,109 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file threadpool.h
+ *	@brief	 A fixed size pool of worker threads built on ThreadAPI, Lock and
+ *			 Condition that executes work items and reports their completion
+ *			 through callbacks.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+typedef struct THREADPOOL_INSTANCE_TAG* THREADPOOL_HANDLE;
+
+#define THREADPOOL_MODE_VALUES \
+    THREADPOOL_MODE_SHARED_QUEUE, \
+    THREADPOOL_MODE_WORK_STEALING
+
+/** @brief How work items are distributed to the worker threads.
+ *
+ *	@c THREADPOOL_MODE_SHARED_QUEUE keeps a single FIFO queue that all
+ *	workers take from. @c THREADPOOL_MODE_WORK_STEALING gives every worker
+ *	its own queue; a worker whose queue is empty steals from the back of the
+ *	other queues, which keeps all workers busy when work item sizes are uneven.
+ *	In both modes a worker takes an item under the lock of its queue only; the
+ *	pool-wide lock is taken by ::threadpool_schedule_work and by workers that
+ *	found every queue empty and go idle.
+ */
+DEFINE_ENUM(THREADPOOL_MODE, THREADPOOL_MODE_VALUES);
+
+#define THREADPOOL_WORK_RESULT_VALUES \
+    THREADPOOL_WORK_OK, \
+    THREADPOOL_WORK_CANCELLED
+
+DEFINE_ENUM(THREADPOOL_WORK_RESULT, THREADPOOL_WORK_RESULT_VALUES);
+
+/** @brief A work item. The return value is passed to the completion callback. */
+typedef int(*THREADPOOL_WORK_FUNCTION)(void* context);
+
+/** @brief Called on the worker thread once a work item has run, or from
+ *		   ::threadpool_shutdown with @c THREADPOOL_WORK_CANCELLED when the
+ *		   work item was discarded before it ran.
+ */
+typedef void(*ON_THREADPOOL_WORK_COMPLETE)(void* context, THREADPOOL_WORK_RESULT work_result, int work_function_result);
+
+/**
+ * @brief	Creates a pool and starts @p thread_count worker threads.
+ *
+ * @param	thread_count	Number of worker threads, must be greater than 0.
+ * @param	mode			How work items are distributed to the workers.
+ *
+ * @return	A valid @c THREADPOOL_HANDLE when successful or @c NULL otherwise.
+ */
+MOCKABLE_FUNCTION(, THREADPOOL_HANDLE, threadpool_create, size_t, thread_count, THREADPOOL_MODE, mode);
+
+/**
+ * @brief	Queues a work item.
+ *
+ * @param	threadpool					The pool.
+ * @param	work_function				The function to execute on a worker thread.
+ * @param	work_context				Passed to @p work_function.
+ * @param	on_work_complete			Optional completion callback.
+ * @param	on_work_complete_context	Passed to @p on_work_complete.
+ *
+ * @return	0 when the work item was queued, a non-zero value when the
+ * 			arguments are invalid, the pool is shut down or queuing fails.
+ */
+MOCKABLE_FUNCTION(, int, threadpool_schedule_work, THREADPOOL_HANDLE, threadpool, THREADPOOL_WORK_FUNCTION, work_function, void*, work_context, ON_THREADPOOL_WORK_COMPLETE, on_work_complete, void*, on_work_complete_context);
+
+/**
+ * @brief	Stops accepting work and joins all worker threads.
+ *
+ * @param	threadpool		The pool.
+ * @param	cancel_pending	When @c true, work items that have not started yet
+ * 							are discarded and completed with
+ * 							@c THREADPOOL_WORK_CANCELLED. When @c false, the
+ * 							queued work items are executed before the workers
+ * 							exit.
+ *
+ * 			Must not be called from a worker thread.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, threadpool_shutdown, THREADPOOL_HANDLE, threadpool, bool, cancel_pending);
+
+/**
+ * @brief	Frees the pool. If ::threadpool_shutdown was not called, the pool
+ * 			is first shut down with the queued work items executed.
+ *
+ * @param	threadpool	The pool.
+ */
+MOCKABLE_FUNCTION(, void, threadpool_destroy, THREADPOOL_HANDLE, threadpool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREADPOOL_H */
@@ -18,6 +18,8 @@ extern "C" {
     MOCKABLE_FUNCTION(, TICK_COUNTER_HANDLE, tickcounter_create);
     MOCKABLE_FUNCTION(, void, tickcounter_destroy, TICK_COUNTER_HANDLE, tick_counter);
     MOCKABLE_FUNCTION(, int, tickcounter_get_current_ms, TICK_COUNTER_HANDLE, tick_counter, uint64_t*, current_ms);
+    /* Same origin as tickcounter_get_current_ms, in microseconds. The resolution depends on the adapter. */
+    MOCKABLE_FUNCTION(, int, tickcounter_get_current_us, TICK_COUNTER_HANDLE, tick_counter, uint64_t*, current_us);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,88 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file timer_wheel.h
+ *	@brief	 A hierarchical timer wheel driven by tickcounter. Many timers share
+ *			 one clock; expired timers are reported from ::timer_wheel_dowork,
+ *			 so the wheel can be driven from the same loop that calls
+ *			 xio_dowork.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdint.h>
+#endif
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+/** @brief Returned by ::timer_wheel_get_next_timeout when no timer is running. */
+#define TIMER_WHEEL_NO_TIMEOUT UINT32_MAX
+
+typedef struct TIMER_WHEEL_INSTANCE_TAG* TIMER_WHEEL_HANDLE;
+typedef struct TIMER_INSTANCE_TAG* TIMER_HANDLE;
+
+/** @brief Called from ::timer_wheel_dowork once the timer expired. The timer
+ *		   handle is no longer valid after the callback returns.
+ */
+typedef void(*ON_TIMER_EXPIRED)(void* context);
+
+/**
+ * @brief	Creates a timer wheel with its own tick counter.
+ *
+ * @return	A valid @c TIMER_WHEEL_HANDLE when successful or @c NULL otherwise.
+ */
+MOCKABLE_FUNCTION(, TIMER_WHEEL_HANDLE, timer_wheel_create);
+
+/**
+ * @brief	Frees the timer wheel and all running timers, without calling
+ * 			their callbacks. Must not be called from a timer callback.
+ */
+MOCKABLE_FUNCTION(, void, timer_wheel_destroy, TIMER_WHEEL_HANDLE, timer_wheel);
+
+/**
+ * @brief	Starts a one shot timer in O(1).
+ *
+ * @param	timer_wheel			The timer wheel.
+ * @param	timeout_ms			Milliseconds until the timer expires.
+ * @param	on_timer_expired	Called from ::timer_wheel_dowork when the timer expires.
+ * @param	context				Passed to @p on_timer_expired.
+ *
+ * @return	A handle that can be passed to ::timer_wheel_cancel_timer, or @c NULL on failure.
+ */
+MOCKABLE_FUNCTION(, TIMER_HANDLE, timer_wheel_start_timer, TIMER_WHEEL_HANDLE, timer_wheel, uint32_t, timeout_ms, ON_TIMER_EXPIRED, on_timer_expired, void*, context);
+
+/**
+ * @brief	Cancels a running timer in O(1). The timer handle is no longer
+ * 			valid afterwards. Cancelling the timer whose callback is
+ * 			executing is allowed and does nothing.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, timer_wheel_cancel_timer, TIMER_WHEEL_HANDLE, timer_wheel, TIMER_HANDLE, timer);
+
+/**
+ * @brief	Advances the wheel to the current tick count and calls the
+ * 			callbacks of all the expired timers.
+ */
+MOCKABLE_FUNCTION(, void, timer_wheel_dowork, TIMER_WHEEL_HANDLE, timer_wheel);
+
+/**
+ * @brief	Gets how long the caller can wait before it needs to call
+ * 			::timer_wheel_dowork again. The value never exceeds the time
+ * 			until the next timer expires; it is @c TIMER_WHEEL_NO_TIMEOUT
+ * 			when no timer is running.
+ *
+ * @return	0 on success, a non-zero value otherwise.
+ */
+MOCKABLE_FUNCTION(, int, timer_wheel_get_next_timeout, TIMER_WHEEL_HANDLE, timer_wheel, uint32_t*, timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_WHEEL_H */
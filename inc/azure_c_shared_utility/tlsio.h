@@ -4,10 +4,19 @@
 #ifndef TLSIO_H
 #define TLSIO_H
 
+#include "azure_c_shared_utility/xio.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
+/* values of the OPTION_TLS_MIN_VERSION and OPTION_TLS_MAX_VERSION options, the protocol versions as they appear on
+   the wire; TLSIO_VERSION_DEFAULT leaves the bound to the TLS library */
+#define TLSIO_VERSION_DEFAULT   0
+#define TLSIO_VERSION_1_0       0x0301
+#define TLSIO_VERSION_1_1       0x0302
+#define TLSIO_VERSION_1_2       0x0303
+#define TLSIO_VERSION_1_3       0x0304
 
 typedef struct TLSIO_CONFIG_TAG
 {
@@ -15,6 +24,16 @@ typedef struct TLSIO_CONFIG_TAG
 	int port;
 } TLSIO_CONFIG;
 
+/* io_create_parameters of the layered tlsio interfaces (e.g. tlsio_openssl_get_layered_interface_description): the
+   records go through an io created with underlying_io_interface and underlying_io_parameters (e.g. memio and a
+   MEMIO_CONFIG) instead of a socketio connected to hostname:port, tls_config.hostname still names the server */
+typedef struct TLSIO_LAYERED_CONFIG_TAG
+{
+	TLSIO_CONFIG tls_config;
+	const IO_INTERFACE_DESCRIPTION* underlying_io_interface;
+	void* underlying_io_parameters;
+} TLSIO_LAYERED_CONFIG;
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -7,24 +7,59 @@
 #ifdef __cplusplus
 extern "C" {
 #include <cstddef>
+#include <cstdint>
 #else
 #include <stddef.h>
+#include <stdint.h>
 #endif /* __cplusplus */
 
 #include "azure_c_shared_utility/xio.h"
 
+/* size of the buffer passed to SSL_read, one TLS record (16 KB of plaintext) is delivered in one on_bytes_received call;
+   it can be changed with the OPTION_TLS_RECEIVE_BUFFER_SIZE option */
+#define TLSIO_OPENSSL_DEFAULT_RECEIVE_BUFFER_SIZE   (16 * 1024)
+
+/* sessions kept by the process wide cache used to resume the handshakes to a hostname:port, see
+   tlsio_openssl_set_session_cache_limits */
+#define TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_SIZE            64
+#define TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_TTL_SECONDS     3600
+
+typedef struct TLSIO_OPENSSL_SESSION_CACHE_STATISTICS_TAG
+{
+    /* handshakes completed by all the tlsio_openssl instances */
+    uint64_t handshakes;
+    /* handshakes that offered a cached session to the server */
+    uint64_t sessions_offered;
+    /* handshakes in which the server accepted the offered session, the hit rate is resumed_handshakes / handshakes */
+    uint64_t resumed_handshakes;
+    uint64_t sessions_stored;
+    /* sessions dropped because they were older than the TTL, or the least recently used one when the cache was full */
+    uint64_t sessions_evicted;
+    size_t session_count;
+} TLSIO_OPENSSL_SESSION_CACHE_STATISTICS;
+
 extern int tlsio_openssl_init(void);
 extern void tlsio_openssl_deinit(void);
 
 extern CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters);
+/* io_create_parameters is a TLSIO_LAYERED_CONFIG */
+extern CONCRETE_IO_HANDLE tlsio_openssl_create_layered(void* io_create_parameters);
 extern void tlsio_openssl_destroy(CONCRETE_IO_HANDLE tls_io);
 extern int tlsio_openssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context);
 extern int tlsio_openssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context);
 extern int tlsio_openssl_send(CONCRETE_IO_HANDLE tls_io, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context);
 extern void tlsio_openssl_dowork(CONCRETE_IO_HANDLE tls_io);
 extern int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, const void* value);
+extern int tlsio_openssl_get_statistics(CONCRETE_IO_HANDLE tls_io, XIO_STATISTICS* statistics);
 
 extern const IO_INTERFACE_DESCRIPTION* tlsio_openssl_get_interface_description(void);
+extern const IO_INTERFACE_DESCRIPTION* tlsio_openssl_get_layered_interface_description(void);
+
+/* Sessions are cached per hostname:port (and trusted/client certificates) once a handshake completes and are
+   offered again by the next tlsio_openssl_open to the same endpoint. Changing the limits clears the cache,
+   max_sessions 0 disables it. Both functions can only be called between tlsio_openssl_init and tlsio_openssl_deinit. */
+extern int tlsio_openssl_set_session_cache_limits(size_t max_sessions, uint32_t time_to_live_seconds);
+extern int tlsio_openssl_get_session_cache_statistics(TLSIO_OPENSSL_SESSION_CACHE_STATISTICS* statistics);
 
 #ifdef __cplusplus
 }
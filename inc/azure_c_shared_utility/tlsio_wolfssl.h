@@ -14,15 +14,27 @@ extern "C" {
 #include "azure_c_shared_utility/xio.h"
 #include "azure_c_shared_utility/xlogging.h"
 
+/* default of OPTION_TLS_MAX_PENDING_RECEIVE_BYTES, room for what the socket buffers between two tlsio_wolfssl_dowork */
+#define TLSIO_WOLFSSL_DEFAULT_MAX_PENDING_RECEIVE_BYTES     (4 * 1024 * 1024)
+
+/* creates the locks of the WOLFSSL_CTX shared by the instances with the same trusted certificates and of the
+   session cache, without them every open builds its own context and does a full handshake */
+extern int tlsio_wolfssl_init(void);
+extern void tlsio_wolfssl_deinit(void);
+
 extern CONCRETE_IO_HANDLE tlsio_wolfssl_create(void* io_create_parameters);
+/* io_create_parameters is a TLSIO_LAYERED_CONFIG */
+extern CONCRETE_IO_HANDLE tlsio_wolfssl_create_layered(void* io_create_parameters);
 extern void tlsio_wolfssl_destroy(CONCRETE_IO_HANDLE tls_io);
 extern int tlsio_wolfssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context);
 extern int tlsio_wolfssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context);
 extern int tlsio_wolfssl_send(CONCRETE_IO_HANDLE tls_io, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context);
 extern void tlsio_wolfssl_dowork(CONCRETE_IO_HANDLE tls_io);
 extern int tlsio_wolfssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, const void* value);
+extern int tlsio_wolfssl_get_statistics(CONCRETE_IO_HANDLE tls_io, XIO_STATISTICS* statistics);
 
 extern const IO_INTERFACE_DESCRIPTION* tlsio_wolfssl_get_interface_description(void);
+extern const IO_INTERFACE_DESCRIPTION* tlsio_wolfssl_get_layered_interface_description(void);
 
 #ifdef __cplusplus
 }
@@ -36,6 +36,7 @@ extern int wsio_setoption(CONCRETE_IO_HANDLE socket_io, const char* optionName,
 extern void* wsio_CloneOption(const char* name, const void* value);
 extern void wsio_DestroyOption(const char* name, const void* value);
 extern OPTIONHANDLER_HANDLE wsio_retrieveoptions(CONCRETE_IO_HANDLE handle);
+extern int wsio_get_statistics(CONCRETE_IO_HANDLE ws_io, XIO_STATISTICS* statistics);
 
 extern const IO_INTERFACE_DESCRIPTION* wsio_get_interface_description(void);
 
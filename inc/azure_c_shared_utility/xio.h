@@ -11,9 +11,11 @@
 
 #ifdef __cplusplus
 #include <cstddef>
+#include <cstdint>
 extern "C" {
 #else
 #include <stddef.h>
+#include <stdint.h>
 #endif /* __cplusplus */
 
 typedef struct XIO_INSTANCE_TAG* XIO_HANDLE;
@@ -38,6 +40,60 @@ typedef void(*ON_SEND_COMPLETE)(void* context, IO_SEND_RESULT send_result);
 typedef void(*ON_IO_OPEN_COMPLETE)(void* context, IO_OPEN_RESULT open_result);
 typedef void(*ON_IO_CLOSE_COMPLETE)(void* context);
 typedef void(*ON_IO_ERROR)(void* context);
+typedef void(*ON_IO_WRITABLE)(void* context);
+
+/* returned by xio_send and xio_send_vectored when the bytes queued by the io reached OPTION_SEND_HIGH_WATERMARK.
+   It is not a failure: the io stays open, the payload was not accepted and on_send_complete is not called for it, and
+   the on_writable callback tells when to send it again. Any other non-zero value is a failure. */
+#define XIO_SEND_WOULD_BLOCK    (-1)
+
+/* value of OPTION_ON_WRITABLE */
+typedef struct XIO_WRITABLE_CALLBACK_TAG
+{
+    ON_IO_WRITABLE on_writable;
+    void* context;
+} XIO_WRITABLE_CALLBACK;
+
+/* one segment of a message sent with xio_send_vectored */
+typedef struct XIO_BUFFER_TAG
+{
+    const void* buffer;
+    size_t size;
+} XIO_BUFFER;
+
+/* bucket 0 of the send latency histogram counts the sends that completed at once, bucket i the ones that took
+   from 2^(i-1) to 2^i microseconds and the last bucket the ones that took longer */
+#define XIO_SEND_LATENCY_BUCKET_COUNT   24
+
+/* counters of one connection, each layer counts what goes through it so that the layers of a stack can be compared */
+typedef struct XIO_STATISTICS_TAG
+{
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    /* number of sends accepted and of on_bytes_received calls */
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    /* sends queued by this layer that did not complete yet */
+    size_t pending_send_count;
+    size_t pending_send_bytes;
+    /* sends that failed or completed with IO_SEND_ERROR, and on_io_error calls */
+    uint64_t send_error_count;
+    uint64_t io_error_count;
+    /* time from the send to its completion, only for the sends this layer queues */
+    uint64_t send_latency_histogram[XIO_SEND_LATENCY_BUCKET_COUNT];
+    /* connection setup of the last open, in microseconds from the open call and 0 when the event did not happen yet or
+       the layer does not track it: underlying transport connected, first handshake bytes (ClientHello) sent, handshake
+       complete and first application byte received */
+    uint64_t connected_us;
+    uint64_t handshake_started_us;
+    uint64_t handshake_complete_us;
+    uint64_t first_byte_received_us;
+    /* time spent by the layer itself in the handshake, in decoding the received bytes and in encoding the sent ones,
+       for tlsio the time inside the TLS library without the time it waits for the underlying io */
+    uint64_t handshake_processing_us;
+    uint64_t receive_processing_us;
+    uint64_t send_processing_us;
+} XIO_STATISTICS;
 
 typedef OPTIONHANDLER_HANDLE (*IO_RETRIEVEOPTIONS)(CONCRETE_IO_HANDLE concrete_io);
 typedef CONCRETE_IO_HANDLE(*IO_CREATE)(void* io_create_parameters);
@@ -47,6 +103,9 @@ typedef int(*IO_CLOSE)(CONCRETE_IO_HANDLE concrete_io, ON_IO_CLOSE_COMPLETE on_i
 typedef int(*IO_SEND)(CONCRETE_IO_HANDLE concrete_io, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context);
 typedef void(*IO_DOWORK)(CONCRETE_IO_HANDLE concrete_io);
 typedef int(*IO_SETOPTION)(CONCRETE_IO_HANDLE concrete_io, const char* optionName, const void* value);
+typedef int(*IO_SEND_VECTORED)(CONCRETE_IO_HANDLE concrete_io, const XIO_BUFFER* buffers, size_t buffer_count, ON_SEND_COMPLETE on_send_complete, void* callback_context);
+typedef int(*IO_GET_STATISTICS)(CONCRETE_IO_HANDLE concrete_io, XIO_STATISTICS* statistics);
+typedef int(*IO_GET_SOCKET)(CONCRETE_IO_HANDLE concrete_io, intptr_t* socket_handle);
 
 
 typedef struct IO_INTERFACE_DESCRIPTION_TAG
@@ -59,6 +118,12 @@ typedef struct IO_INTERFACE_DESCRIPTION_TAG
     IO_SEND concrete_io_send;
     IO_DOWORK concrete_io_dowork;
     IO_SETOPTION concrete_io_setoption;
+    /* optional, when NULL xio_send_vectored concatenates the segments and calls concrete_io_send */
+    IO_SEND_VECTORED concrete_io_send_vectored;
+    /* optional, when NULL xio_get_statistics fails */
+    IO_GET_STATISTICS concrete_io_get_statistics;
+    /* optional, only the ios that own an OS socket provide it; when NULL xio_get_socket fails */
+    IO_GET_SOCKET concrete_io_get_socket;
 } IO_INTERFACE_DESCRIPTION;
 
 MOCKABLE_FUNCTION(, XIO_HANDLE, xio_create, const IO_INTERFACE_DESCRIPTION*, io_interface_description, const void*, io_create_parameters);
@@ -66,9 +131,15 @@ MOCKABLE_FUNCTION(, void, xio_destroy, XIO_HANDLE, xio);
 MOCKABLE_FUNCTION(, int, xio_open, XIO_HANDLE, xio, ON_IO_OPEN_COMPLETE, on_io_open_complete, void*, on_io_open_complete_context, ON_BYTES_RECEIVED, on_bytes_received, void*, on_bytes_received_context, ON_IO_ERROR, on_io_error, void*, on_io_error_context);
 MOCKABLE_FUNCTION(, int, xio_close, XIO_HANDLE, xio, ON_IO_CLOSE_COMPLETE, on_io_close_complete, void*, callback_context);
 MOCKABLE_FUNCTION(, int, xio_send, XIO_HANDLE, xio, const void*, buffer, size_t, size, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
+MOCKABLE_FUNCTION(, int, xio_send_vectored, XIO_HANDLE, xio, const XIO_BUFFER*, buffers, size_t, buffer_count, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
 MOCKABLE_FUNCTION(, void, xio_dowork, XIO_HANDLE, xio);
 MOCKABLE_FUNCTION(, int, xio_setoption, XIO_HANDLE, xio, const char*, optionName, const void*, value);
 MOCKABLE_FUNCTION(, OPTIONHANDLER_HANDLE, xio_retrieveoptions, XIO_HANDLE, xio);
+MOCKABLE_FUNCTION(, int, xio_get_statistics, XIO_HANDLE, xio, XIO_STATISTICS*, statistics);
+MOCKABLE_FUNCTION(, int, xio_get_socket, XIO_HANDLE, xio, intptr_t*, socket_handle);
+
+/* helper for the concrete IOs, adds one send that took latency_us to the histogram */
+MOCKABLE_FUNCTION(, void, xio_statistics_add_send_latency, XIO_STATISTICS*, statistics, uint64_t, latency_us);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,520 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Measures the receive throughput of tlsio_openssl against a TLS server running in the same process on the
+   loopback interface. The server side is plain OpenSSL over memory BIOs on top of a connection accepted by
+   socketio_listener, so only the client side of the measurement goes through tlsio_openssl.
+   With the memio transport the records go through a memio pipe instead of the loopback interface, which leaves
+   the cost of the TLS layer without the network stack.
+
+   usage: tlsio_openssl_throughput [megabytes] [tls_receive_buffer_size] [socket|memio] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "openssl/ssl.h"
+#include "openssl/err.h"
+#include "openssl/evp.h"
+#include "openssl/x509.h"
+#include "openssl/pem.h"
+#include "azure_c_shared_utility/platform.h"
+#include "azure_c_shared_utility/xio.h"
+#include "azure_c_shared_utility/tlsio.h"
+#include "azure_c_shared_utility/tlsio_openssl.h"
+#include "azure_c_shared_utility/socketio_listener.h"
+#include "azure_c_shared_utility/memio.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+
+#define DEFAULT_MEGABYTES           256
+#define SERVER_RECORD_SIZE          (16 * 1024)
+/* the server stops encrypting while this many bytes wait in the socketio queue */
+#define SERVER_MAX_PENDING_BYTES    (256 * 1024)
+
+typedef struct SERVER_CONNECTION_TAG
+{
+    XIO_HANDLE io;
+    SSL* ssl;
+    BIO* in_bio;
+    BIO* out_bio;
+    bool is_handshake_done;
+    bool is_error;
+    uint64_t bytes_to_send;
+    /* socketio reports its queue, memio keeps no statistics */
+    bool has_statistics;
+} SERVER_CONNECTION;
+
+typedef struct CLIENT_TAG
+{
+    bool is_open;
+    bool is_error;
+    uint64_t bytes_received;
+    uint64_t receive_call_count;
+} CLIENT;
+
+static SSL_CTX* g_server_context;
+static SERVER_CONNECTION g_server_connection;
+static uint64_t g_total_bytes;
+
+/* builds a self-signed certificate for the server and returns it in PEM form for the TrustedCerts option */
+static char* create_server_credentials(SSL_CTX* ssl_context)
+{
+    char* result = NULL;
+    EVP_PKEY* key = NULL;
+    EVP_PKEY_CTX* key_context = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    X509* certificate = X509_new();
+
+    if ((key_context == NULL) ||
+        (certificate == NULL) ||
+        (EVP_PKEY_keygen_init(key_context) <= 0) ||
+        (EVP_PKEY_CTX_set_rsa_keygen_bits(key_context, 2048) <= 0) ||
+        (EVP_PKEY_keygen(key_context, &key) <= 0))
+    {
+        (void)printf("Cannot generate the server key.\r\n");
+    }
+    else
+    {
+        X509_NAME* name = X509_get_subject_name(certificate);
+        BIO* pem_bio = BIO_new(BIO_s_mem());
+        char* pem_data;
+        long pem_size;
+
+        (void)X509_set_version(certificate, 2);
+        (void)ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        (void)X509_gmtime_adj(X509_get_notBefore(certificate), -3600);
+        (void)X509_gmtime_adj(X509_get_notAfter(certificate), 24 * 3600);
+        (void)X509_set_pubkey(certificate, key);
+        (void)X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+        (void)X509_set_issuer_name(certificate, name);
+
+        if ((pem_bio == NULL) ||
+            (X509_sign(certificate, key, EVP_sha256()) <= 0) ||
+            (SSL_CTX_use_certificate(ssl_context, certificate) != 1) ||
+            (SSL_CTX_use_PrivateKey(ssl_context, key) != 1) ||
+            (PEM_write_bio_X509(pem_bio, certificate) != 1) ||
+            ((pem_size = BIO_get_mem_data(pem_bio, &pem_data)) <= 0) ||
+            ((result = (char*)malloc((size_t)pem_size + 1)) == NULL))
+        {
+            (void)printf("Cannot build the server certificate.\r\n");
+        }
+        else
+        {
+            (void)memcpy(result, pem_data, (size_t)pem_size);
+            result[pem_size] = '\0';
+        }
+
+        BIO_free(pem_bio);
+    }
+
+    EVP_PKEY_free(key);
+    X509_free(certificate);
+    EVP_PKEY_CTX_free(key_context);
+
+    return result;
+}
+
+static void flush_server_records(SERVER_CONNECTION* connection)
+{
+    unsigned char ciphertext[SERVER_RECORD_SIZE + 1024];
+    int size;
+
+    while ((!connection->is_error) &&
+        ((size = BIO_read(connection->out_bio, ciphertext, sizeof(ciphertext))) > 0))
+    {
+        if (xio_send(connection->io, ciphertext, (size_t)size, NULL, NULL) != 0)
+        {
+            (void)printf("Server send failed.\r\n");
+            connection->is_error = true;
+        }
+    }
+}
+
+/* encrypts the payload a record at a time, as long as the socketio queue does not grow too large; a memio pipe is
+   given at most SERVER_MAX_PENDING_BYTES per call instead */
+static void pump_server_payload(SERVER_CONNECTION* connection)
+{
+    static unsigned char payload[SERVER_RECORD_SIZE];
+    XIO_STATISTICS statistics;
+    size_t encrypted = 0;
+
+    while ((connection->is_handshake_done) &&
+        (!connection->is_error) &&
+        (connection->bytes_to_send > 0) &&
+        (encrypted < SERVER_MAX_PENDING_BYTES) &&
+        ((!connection->has_statistics) ||
+        ((xio_get_statistics(connection->io, &statistics) == 0) &&
+        (statistics.pending_send_bytes < SERVER_MAX_PENDING_BYTES))))
+    {
+        int size = (connection->bytes_to_send < sizeof(payload)) ? (int)connection->bytes_to_send : (int)sizeof(payload);
+        if (SSL_write(connection->ssl, payload, size) != size)
+        {
+            (void)printf("SSL_write failed on the server.\r\n");
+            connection->is_error = true;
+        }
+        else
+        {
+            connection->bytes_to_send -= (uint64_t)size;
+            encrypted += (size_t)size;
+            flush_server_records(connection);
+        }
+    }
+}
+
+static void on_server_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    SERVER_CONNECTION* connection = (SERVER_CONNECTION*)context;
+    unsigned char discarded[1024];
+
+    if (BIO_write(connection->in_bio, buffer, (int)size) != (int)size)
+    {
+        connection->is_error = true;
+    }
+    else if (!connection->is_handshake_done)
+    {
+        int handshake_result = SSL_do_handshake(connection->ssl);
+        flush_server_records(connection);
+        if (handshake_result == 1)
+        {
+            connection->is_handshake_done = true;
+        }
+        else if (SSL_get_error(connection->ssl, handshake_result) != SSL_ERROR_WANT_READ)
+        {
+            (void)printf("Server handshake failed.\r\n");
+            ERR_print_errors_fp(stdout);
+            connection->is_error = true;
+        }
+    }
+    else
+    {
+        while (SSL_read(connection->ssl, discarded, sizeof(discarded)) > 0)
+        {
+        }
+    }
+}
+
+static void on_server_io_error(void* context)
+{
+    SERVER_CONNECTION* connection = (SERVER_CONNECTION*)context;
+    connection->is_error = true;
+}
+
+static void on_server_accept(void* context, XIO_HANDLE accepted_io)
+{
+    SERVER_CONNECTION* connection = (SERVER_CONNECTION*)context;
+
+    if (connection->io != NULL)
+    {
+        xio_destroy(accepted_io);
+    }
+    else
+    {
+        connection->io = accepted_io;
+        connection->ssl = SSL_new(g_server_context);
+        connection->in_bio = BIO_new(BIO_s_mem());
+        connection->out_bio = BIO_new(BIO_s_mem());
+        connection->bytes_to_send = g_total_bytes;
+
+        if ((connection->ssl == NULL) ||
+            (connection->in_bio == NULL) ||
+            (connection->out_bio == NULL))
+        {
+            connection->is_error = true;
+        }
+        else
+        {
+            SSL_set_bio(connection->ssl, connection->in_bio, connection->out_bio);
+            SSL_set_accept_state(connection->ssl);
+            if (xio_open(accepted_io, NULL, NULL, on_server_bytes_received, connection, on_server_io_error, connection) != 0)
+            {
+                connection->is_error = true;
+            }
+        }
+    }
+}
+
+static void on_client_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    CLIENT* client = (CLIENT*)context;
+
+    if (open_result == IO_OPEN_OK)
+    {
+        client->is_open = true;
+    }
+    else
+    {
+        (void)printf("Client open failed.\r\n");
+        client->is_error = true;
+    }
+}
+
+static void on_client_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    CLIENT* client = (CLIENT*)context;
+    (void)buffer;
+    client->bytes_received += size;
+    client->receive_call_count++;
+}
+
+static void on_client_io_error(void* context)
+{
+    CLIENT* client = (CLIENT*)context;
+    client->is_error = true;
+}
+
+static SSL_CTX* create_server_context(void)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    SSL_CTX* result = SSL_CTX_new(TLS_server_method());
+    if (result != NULL)
+    {
+        /* accept whatever protocol version the client offers, the measurement is about tlsio */
+        SSL_CTX_set_security_level(result, 0);
+        (void)SSL_CTX_set_min_proto_version(result, 0);
+    }
+#else
+    SSL_CTX* result = SSL_CTX_new(SSLv23_server_method());
+#endif
+
+    return result;
+}
+
+static int run_transfer(SOCKETIO_LISTENER_HANDLE listener, XIO_HANDLE client_io, CLIENT* client, TICK_COUNTER_HANDLE tick_counter, size_t receive_buffer_size)
+{
+    int result;
+    uint64_t start_time = 0;
+    uint64_t end_time = 0;
+
+    while ((!client->is_error) &&
+        (!g_server_connection.is_error) &&
+        (client->bytes_received < g_total_bytes))
+    {
+        /* the clock starts once the handshake is done */
+        if ((start_time == 0) && (client->is_open))
+        {
+            (void)tickcounter_get_current_us(tick_counter, &start_time);
+        }
+
+        if (listener != NULL)
+        {
+            socketio_listener_dowork(listener);
+        }
+        xio_dowork(client_io);
+        if (g_server_connection.io != NULL)
+        {
+            xio_dowork(g_server_connection.io);
+            pump_server_payload(&g_server_connection);
+        }
+    }
+
+    (void)tickcounter_get_current_us(tick_counter, &end_time);
+
+    if (client->bytes_received < g_total_bytes)
+    {
+        (void)printf("The transfer failed after %llu bytes.\r\n", (unsigned long long)client->bytes_received);
+        result = __LINE__;
+    }
+    else
+    {
+        double seconds = (double)(end_time - start_time) / 1000000.0;
+        (void)printf("tls_receive_buffer_size %zu over %s: %llu bytes in %.3f s, %.1f MB/s, %llu on_bytes_received calls, %.0f bytes per call\r\n",
+            receive_buffer_size,
+            (listener != NULL) ? "the loopback interface" : "memio",
+            (unsigned long long)client->bytes_received,
+            seconds,
+            ((double)client->bytes_received / (1024.0 * 1024.0)) / seconds,
+            (unsigned long long)client->receive_call_count,
+            (double)client->bytes_received / (double)client->receive_call_count);
+        result = 0;
+    }
+
+    return result;
+}
+
+/* the listener is NULL when the server endpoint was attached to a memio pipe */
+static int run_client(const IO_INTERFACE_DESCRIPTION* tlsio_interface, void* tlsio_parameters, SOCKETIO_LISTENER_HANDLE listener, const char* server_certificate, TICK_COUNTER_HANDLE tick_counter, size_t receive_buffer_size)
+{
+    int result;
+    CLIENT client;
+    XIO_HANDLE client_io;
+
+    (void)memset(&client, 0, sizeof(client));
+
+    client_io = xio_create(tlsio_interface, tlsio_parameters);
+    if (client_io == NULL)
+    {
+        (void)printf("Cannot create the client.\r\n");
+        result = __LINE__;
+    }
+    else
+    {
+        if ((xio_setoption(client_io, "TrustedCerts", server_certificate) != 0) ||
+            (xio_setoption(client_io, OPTION_TLS_RECEIVE_BUFFER_SIZE, &receive_buffer_size) != 0) ||
+            (xio_open(client_io, on_client_open_complete, &client, on_client_bytes_received, &client, on_client_io_error, &client) != 0))
+        {
+            (void)printf("Cannot open the client.\r\n");
+            result = __LINE__;
+        }
+        else
+        {
+            result = run_transfer(listener, client_io, &client, tick_counter, receive_buffer_size);
+            (void)xio_close(client_io, NULL, NULL);
+        }
+
+        xio_destroy(client_io);
+    }
+
+    if (g_server_connection.io != NULL)
+    {
+        (void)xio_close(g_server_connection.io, NULL, NULL);
+        xio_destroy(g_server_connection.io);
+        SSL_free(g_server_connection.ssl);
+    }
+
+    return result;
+}
+
+static int run_over_loopback(const char* server_certificate, TICK_COUNTER_HANDLE tick_counter, size_t receive_buffer_size)
+{
+    int result;
+    SOCKETIO_LISTENER_CONFIG listener_config;
+    SOCKETIO_LISTENER_HANDLE listener;
+
+    listener_config.address = "127.0.0.1";
+    listener_config.port = 0;
+    listener_config.backlog = 0;
+
+    if ((listener = socketio_listener_create(&listener_config)) == NULL)
+    {
+        (void)printf("Cannot create the listener.\r\n");
+        result = __LINE__;
+    }
+    else
+    {
+        TLSIO_CONFIG tlsio_config;
+        int port;
+
+        g_server_connection.has_statistics = true;
+
+        if ((socketio_listener_start(listener, on_server_accept, &g_server_connection) != 0) ||
+            (socketio_listener_get_port(listener, &port) != 0))
+        {
+            (void)printf("Cannot start the listener.\r\n");
+            result = __LINE__;
+        }
+        else
+        {
+            tlsio_config.hostname = "127.0.0.1";
+            tlsio_config.port = port;
+
+            result = run_client(tlsio_openssl_get_interface_description(), &tlsio_config, listener, server_certificate, tick_counter, receive_buffer_size);
+        }
+
+        socketio_listener_destroy(listener);
+    }
+
+    return result;
+}
+
+static int run_over_memio(const char* server_certificate, TICK_COUNTER_HANDLE tick_counter, size_t receive_buffer_size)
+{
+    int result;
+    MEMIO_PIPE_HANDLE pipe;
+
+    /* no latency and no bandwidth limit, every send is delivered by the next dowork of the peer */
+    if ((pipe = memio_pipe_create(NULL)) == NULL)
+    {
+        (void)printf("Cannot create the memio pipe.\r\n");
+        result = __LINE__;
+    }
+    else
+    {
+        MEMIO_CONFIG server_config;
+        MEMIO_CONFIG client_config;
+        XIO_HANDLE server_io;
+
+        server_config.pipe = pipe;
+        server_config.endpoint = MEMIO_ENDPOINT_SERVER;
+        client_config.pipe = pipe;
+        client_config.endpoint = MEMIO_ENDPOINT_CLIENT;
+
+        if ((server_io = xio_create(memio_get_interface_description(), &server_config)) == NULL)
+        {
+            (void)printf("Cannot create the server endpoint.\r\n");
+            result = __LINE__;
+        }
+        else
+        {
+            TLSIO_LAYERED_CONFIG tlsio_config;
+
+            /* the hostname still keys the session cache */
+            tlsio_config.tls_config.hostname = "memio";
+            tlsio_config.tls_config.port = 0;
+            tlsio_config.underlying_io_interface = memio_get_interface_description();
+            tlsio_config.underlying_io_parameters = &client_config;
+
+            on_server_accept(&g_server_connection, server_io);
+            result = run_client(tlsio_openssl_get_layered_interface_description(), &tlsio_config, NULL, server_certificate, tick_counter, receive_buffer_size);
+        }
+
+        memio_pipe_destroy(pipe);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    size_t receive_buffer_size = (argc > 2) ? (size_t)strtoul(argv[2], NULL, 10) : TLSIO_OPENSSL_DEFAULT_RECEIVE_BUFFER_SIZE;
+    bool use_memio = (argc > 3) && (strcmp(argv[3], "memio") == 0);
+    TICK_COUNTER_HANDLE tick_counter;
+    char* server_certificate;
+
+    g_total_bytes = (uint64_t)((argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_MEGABYTES) * 1024 * 1024;
+
+    if (platform_init() != 0)
+    {
+        (void)printf("platform_init failed.\r\n");
+        result = __LINE__;
+    }
+    else
+    {
+        if ((g_server_context = create_server_context()) == NULL)
+        {
+            (void)printf("Cannot create the server context.\r\n");
+            result = __LINE__;
+        }
+        else
+        {
+            if ((server_certificate = create_server_credentials(g_server_context)) == NULL)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                if ((tick_counter = tickcounter_create()) == NULL)
+                {
+                    (void)printf("Cannot create the tick counter.\r\n");
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = use_memio ?
+                        run_over_memio(server_certificate, tick_counter, receive_buffer_size) :
+                        run_over_loopback(server_certificate, tick_counter, receive_buffer_size);
+
+                    tickcounter_destroy(tick_counter);
+                }
+
+                free(server_certificate);
+            }
+
+            SSL_CTX_free(g_server_context);
+        }
+
+        platform_deinit();
+    }
+
+    return result;
+}
@@ -44,7 +44,7 @@ int gballoc_init(void)
         result = __LINE__;
     }
     /* Codes_SRS_GBALLOC_01_026: [gballoc_Init shall create a lock handle that will be used to make the other gballoc APIs thread-safe.] */
-    else if ((gballocThreadSafeLock = Lock_Init()) == NULL)
+    else if ((gballocThreadSafeLock = Lock_Init_Named("gballoc")) == NULL)
     {
         /* Codes_SRS_GBALLOC_01_027: [If the Lock creation fails, gballoc_init shall return a non-zero value.]*/
         result = __LINE__;
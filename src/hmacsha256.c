@@ -7,9 +7,115 @@
 #endif
 #include "azure_c_shared_utility/gballoc.h"
 
+#include <limits.h>
 #include "azure_c_shared_utility/hmacsha256.h"
 #include "azure_c_shared_utility/hmac.h"
 #include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+/* the hash is computed by the TLS library the build links when there is one (see use_reference_hmac in
+   CMakeLists.txt), its SHA-256 uses the SHA and vector extensions of the CPU. The portable code of hmac.c is
+   used otherwise and when the library fails. */
+#if defined(HMACSHA256_USE_OPENSSL)
+#include "openssl/hmac.h"
+#include "openssl/evp.h"
+#elif defined(HMACSHA256_USE_WOLFSSL)
+/* the old names of wolfSSL (SHA256, Sha256...) clash with the ones of sha.h */
+#define NO_OLD_SHA_NAMES
+#include "wolfssl/wolfcrypt/hmac.h"
+#endif
+
+#define HMACSHA256_HASH_SIZE 32
+
+#if defined(HMACSHA256_USE_OPENSSL)
+static int compute_library_hmac(const unsigned char* key, size_t keyLen, const unsigned char* payload, size_t payloadLen, unsigned char* hash)
+{
+    int result;
+    unsigned int hash_size = 0;
+
+    if ((keyLen > INT_MAX) ||
+        (HMAC(EVP_sha256(), key, (int)keyLen, payload, payloadLen, hash, &hash_size) == NULL) ||
+        (hash_size != HMACSHA256_HASH_SIZE))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+#elif defined(HMACSHA256_USE_WOLFSSL)
+static int compute_library_hmac(const unsigned char* key, size_t keyLen, const unsigned char* payload, size_t payloadLen, unsigned char* hash)
+{
+    int result;
+    Hmac hmac_context;
+
+    if ((keyLen > UINT_MAX) ||
+        (payloadLen > UINT_MAX) ||
+        (wc_HmacInit(&hmac_context, NULL, INVALID_DEVID) != 0))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        if ((wc_HmacSetKey(&hmac_context, WC_SHA256, key, (word32)keyLen) != 0) ||
+            (wc_HmacUpdate(&hmac_context, payload, (word32)payloadLen) != 0) ||
+            (wc_HmacFinal(&hmac_context, hash) != 0))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+
+        wc_HmacFree(&hmac_context);
+    }
+
+    return result;
+}
+#endif
+
+static int compute_reference_hmac(const unsigned char* key, size_t keyLen, const unsigned char* payload, size_t payloadLen, unsigned char* hash)
+{
+    int result;
+
+    if ((keyLen > INT_MAX) ||
+        (payloadLen > INT_MAX) ||
+        (hmac(SHA256, payload, (int)payloadLen, key, (int)keyLen, hash) != 0))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static int compute_hmac(const unsigned char* key, size_t keyLen, const unsigned char* payload, size_t payloadLen, unsigned char* hash)
+{
+    int result;
+
+#if defined(HMACSHA256_USE_OPENSSL) || defined(HMACSHA256_USE_WOLFSSL)
+    if (compute_library_hmac(key, keyLen, payload, payloadLen, hash) == 0)
+    {
+        result = 0;
+    }
+    else
+    {
+        LogError("The TLS library failed computing the HMAC-SHA256, using the reference implementation.");
+        result = compute_reference_hmac(key, keyLen, payload, payloadLen, hash);
+    }
+#else
+    result = compute_reference_hmac(key, keyLen, payload, payloadLen, hash);
+#endif
+
+    return result;
+}
 
 HMACSHA256_RESULT HMACSHA256_ComputeHash(const unsigned char* key, size_t keyLen, const unsigned char* payload, size_t payloadLen, BUFFER_HANDLE hash)
 {
@@ -25,8 +131,8 @@ HMACSHA256_RESULT HMACSHA256_ComputeHash(const unsigned char* key, size_t keyLen
     }
     else
     {
-        if ((BUFFER_enlarge(hash, 32) != 0) ||
-            (hmac(SHA256, payload, (int)payloadLen, key, (int)keyLen, BUFFER_u_char(hash) ) != 0))
+        if ((BUFFER_enlarge(hash, HMACSHA256_HASH_SIZE) != 0) ||
+            (compute_hmac(key, keyLen, payload, payloadLen, BUFFER_u_char(hash)) != 0))
         {
             result = HMACSHA256_ERROR;
         }
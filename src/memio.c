@@ -0,0 +1,652 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/memio.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/optionhandler.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#define ENDPOINT_COUNT  2
+
+typedef enum IO_STATE_TAG
+{
+    IO_STATE_CLOSED,
+    IO_STATE_OPEN,
+    IO_STATE_ERROR
+} IO_STATE;
+
+/* bytes of one send, waiting to be delivered to the receiving endpoint */
+typedef struct MEMIO_SEGMENT_TAG
+{
+    struct MEMIO_SEGMENT_TAG* next;
+    unsigned char* bytes;
+    size_t size;
+    size_t delivered;
+    uint64_t delivery_time;
+} MEMIO_SEGMENT;
+
+/* a send whose bytes did not finish leaving the sending endpoint */
+typedef struct MEMIO_PENDING_SEND_TAG
+{
+    struct MEMIO_PENDING_SEND_TAG* next;
+    uint64_t complete_time;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+} MEMIO_PENDING_SEND;
+
+/* the bytes flowing towards one endpoint */
+typedef struct MEMIO_DIRECTION_TAG
+{
+    MEMIO_SEGMENT* head;
+    MEMIO_SEGMENT* tail;
+    /* when the link is done transmitting the bytes queued so far */
+    uint64_t link_free_time;
+} MEMIO_DIRECTION;
+
+typedef struct MEMIO_INSTANCE_TAG
+{
+    struct MEMIO_PIPE_INSTANCE_TAG* pipe;
+    MEMIO_ENDPOINT endpoint;
+    IO_STATE io_state;
+    ON_BYTES_RECEIVED on_bytes_received;
+    void* on_bytes_received_context;
+    ON_IO_ERROR on_io_error;
+    void* on_io_error_context;
+    MEMIO_PENDING_SEND* pending_sends_head;
+    MEMIO_PENDING_SEND* pending_sends_tail;
+} MEMIO_INSTANCE;
+
+typedef struct MEMIO_PIPE_INSTANCE_TAG
+{
+    MEMIO_PIPE_CONFIG config;
+    TICK_COUNTER_HANDLE tick_counter;
+    uint64_t manual_time;
+    /* held by the creator and by each endpoint instance */
+    size_t reference_count;
+    MEMIO_INSTANCE* endpoints[ENDPOINT_COUNT];
+    /* indexed by the receiving endpoint */
+    MEMIO_DIRECTION directions[ENDPOINT_COUNT];
+    /* an endpoint that was closed stays closed, the peer sees an error once it drained its bytes */
+    bool is_shut_down[ENDPOINT_COUNT];
+} MEMIO_PIPE_INSTANCE;
+
+static const IO_INTERFACE_DESCRIPTION memio_interface_description =
+{
+    memio_retrieveoptions,
+    memio_create,
+    memio_destroy,
+    memio_open,
+    memio_close,
+    memio_send,
+    memio_dowork,
+    memio_setoption,
+    NULL,
+    NULL,
+    NULL
+};
+
+static MEMIO_ENDPOINT get_peer(MEMIO_ENDPOINT endpoint)
+{
+    return (endpoint == MEMIO_ENDPOINT_CLIENT) ? MEMIO_ENDPOINT_SERVER : MEMIO_ENDPOINT_CLIENT;
+}
+
+static int get_pipe_time(MEMIO_PIPE_INSTANCE* pipe_instance, uint64_t* current_us)
+{
+    int result;
+
+    if (pipe_instance->tick_counter == NULL)
+    {
+        *current_us = pipe_instance->manual_time;
+        result = 0;
+    }
+    else if (tickcounter_get_current_us(pipe_instance->tick_counter, current_us) != 0)
+    {
+        LogError("Failed getting the current time");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static void free_segments(MEMIO_DIRECTION* direction)
+{
+    while (direction->head != NULL)
+    {
+        MEMIO_SEGMENT* segment = direction->head;
+        direction->head = segment->next;
+        free(segment->bytes);
+        free(segment);
+    }
+
+    direction->tail = NULL;
+}
+
+static void release_pipe(MEMIO_PIPE_INSTANCE* pipe_instance)
+{
+    pipe_instance->reference_count--;
+    if (pipe_instance->reference_count == 0)
+    {
+        size_t i;
+        for (i = 0; i < ENDPOINT_COUNT; i++)
+        {
+            free_segments(&pipe_instance->directions[i]);
+        }
+
+        if (pipe_instance->tick_counter != NULL)
+        {
+            tickcounter_destroy(pipe_instance->tick_counter);
+        }
+
+        free(pipe_instance);
+    }
+}
+
+/* completes the sends whose bytes left the endpoint by current_time, all of them when cancelling */
+static void complete_pending_sends(MEMIO_INSTANCE* memio_instance, uint64_t current_time, IO_SEND_RESULT send_result)
+{
+    while ((memio_instance->pending_sends_head != NULL) &&
+        ((send_result == IO_SEND_CANCELLED) || (memio_instance->pending_sends_head->complete_time <= current_time)))
+    {
+        MEMIO_PENDING_SEND* pending_send = memio_instance->pending_sends_head;
+        memio_instance->pending_sends_head = pending_send->next;
+        if (memio_instance->pending_sends_head == NULL)
+        {
+            memio_instance->pending_sends_tail = NULL;
+        }
+
+        if (pending_send->on_send_complete != NULL)
+        {
+            pending_send->on_send_complete(pending_send->callback_context, send_result);
+        }
+
+        free(pending_send);
+    }
+}
+
+static void shut_down(MEMIO_INSTANCE* memio_instance)
+{
+    MEMIO_PIPE_INSTANCE* pipe_instance = memio_instance->pipe;
+
+    memio_instance->io_state = IO_STATE_CLOSED;
+    pipe_instance->is_shut_down[memio_instance->endpoint] = true;
+    /* the bytes that did not reach this endpoint are lost, like with a reset connection */
+    free_segments(&pipe_instance->directions[memio_instance->endpoint]);
+    complete_pending_sends(memio_instance, 0, IO_SEND_CANCELLED);
+}
+
+MEMIO_PIPE_HANDLE memio_pipe_create(const MEMIO_PIPE_CONFIG* config)
+{
+    MEMIO_PIPE_INSTANCE* result;
+
+    /* Codes_SRS_MEMIO_01_001: [ memio_pipe_create shall allocate a new pipe with the settings of config, or without latency, bandwidth limit and chunking when config is NULL. ]*/
+    result = (MEMIO_PIPE_INSTANCE*)malloc(sizeof(MEMIO_PIPE_INSTANCE));
+    if (result == NULL)
+    {
+        /* Codes_SRS_MEMIO_01_003: [ If any error occurs, memio_pipe_create shall fail and return NULL. ]*/
+        LogError("Failed allocating the memio pipe");
+    }
+    else
+    {
+        (void)memset(result, 0, sizeof(MEMIO_PIPE_INSTANCE));
+        if (config != NULL)
+        {
+            result->config = *config;
+        }
+
+        /* Codes_SRS_MEMIO_01_002: [ Unless config asks for a manual clock, memio_pipe_create shall create a tick counter to measure the time. ]*/
+        if ((!result->config.manual_clock) &&
+            ((result->tick_counter = tickcounter_create()) == NULL))
+        {
+            /* Codes_SRS_MEMIO_01_003: [ If any error occurs, memio_pipe_create shall fail and return NULL. ]*/
+            LogError("Failed creating the tick counter");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            result->reference_count = 1;
+        }
+    }
+
+    return result;
+}
+
+void memio_pipe_destroy(MEMIO_PIPE_HANDLE pipe)
+{
+    /* Codes_SRS_MEMIO_01_004: [ If pipe is NULL, memio_pipe_destroy shall do nothing. ]*/
+    if (pipe != NULL)
+    {
+        /* Codes_SRS_MEMIO_01_005: [ memio_pipe_destroy shall release the reference of the creator, the pipe is freed when the memio instances of its endpoints are destroyed too. ]*/
+        release_pipe(pipe);
+    }
+}
+
+int memio_pipe_advance_time(MEMIO_PIPE_HANDLE pipe, uint32_t elapsed_us)
+{
+    int result;
+
+    /* Codes_SRS_MEMIO_01_006: [ If pipe is NULL or the pipe does not use a manual clock, memio_pipe_advance_time shall fail and return a non-zero value. ]*/
+    if ((pipe == NULL) ||
+        (!pipe->config.manual_clock))
+    {
+        LogError("Invalid arguments: pipe = %p", pipe);
+        result = __LINE__;
+    }
+    else
+    {
+        /* Codes_SRS_MEMIO_01_007: [ memio_pipe_advance_time shall move the manual clock of the pipe forward by elapsed_us and return 0. ]*/
+        pipe->manual_time += elapsed_us;
+        result = 0;
+    }
+
+    return result;
+}
+
+CONCRETE_IO_HANDLE memio_create(void* io_create_parameters)
+{
+    MEMIO_INSTANCE* result;
+    MEMIO_CONFIG* memio_config = (MEMIO_CONFIG*)io_create_parameters;
+
+    /* Codes_SRS_MEMIO_01_008: [ If io_create_parameters is NULL, its pipe is NULL or its endpoint is not MEMIO_ENDPOINT_CLIENT or MEMIO_ENDPOINT_SERVER, memio_create shall fail and return NULL. ]*/
+    if ((memio_config == NULL) ||
+        (memio_config->pipe == NULL) ||
+        ((memio_config->endpoint != MEMIO_ENDPOINT_CLIENT) && (memio_config->endpoint != MEMIO_ENDPOINT_SERVER)))
+    {
+        LogError("Invalid arguments: io_create_parameters = %p", io_create_parameters);
+        result = NULL;
+    }
+    /* Codes_SRS_MEMIO_01_009: [ If the endpoint is already used by another memio instance, memio_create shall fail and return NULL. ]*/
+    else if (memio_config->pipe->endpoints[memio_config->endpoint] != NULL)
+    {
+        LogError("The memio endpoint is already in use");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_MEMIO_01_010: [ memio_create shall allocate a new instance attached to the endpoint and take a reference on the pipe. ]*/
+        result = (MEMIO_INSTANCE*)malloc(sizeof(MEMIO_INSTANCE));
+        if (result == NULL)
+        {
+            /* Codes_SRS_MEMIO_01_011: [ If any error occurs, memio_create shall fail and return NULL. ]*/
+            LogError("Failed allocating the memio instance");
+        }
+        else
+        {
+            (void)memset(result, 0, sizeof(MEMIO_INSTANCE));
+            result->pipe = memio_config->pipe;
+            result->endpoint = memio_config->endpoint;
+            result->io_state = IO_STATE_CLOSED;
+            result->pipe->endpoints[result->endpoint] = result;
+            result->pipe->reference_count++;
+        }
+    }
+
+    return result;
+}
+
+void memio_destroy(CONCRETE_IO_HANDLE memio)
+{
+    /* Codes_SRS_MEMIO_01_012: [ If memio is NULL, memio_destroy shall do nothing. ]*/
+    if (memio != NULL)
+    {
+        MEMIO_INSTANCE* memio_instance = (MEMIO_INSTANCE*)memio;
+        MEMIO_PIPE_INSTANCE* pipe_instance = memio_instance->pipe;
+
+        /* Codes_SRS_MEMIO_01_013: [ memio_destroy shall close the instance if it is open, free it and release its reference on the pipe. ]*/
+        if (memio_instance->io_state != IO_STATE_CLOSED)
+        {
+            shut_down(memio_instance);
+        }
+
+        pipe_instance->endpoints[memio_instance->endpoint] = NULL;
+        free(memio_instance);
+        release_pipe(pipe_instance);
+    }
+}
+
+int memio_open(CONCRETE_IO_HANDLE memio, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context)
+{
+    int result;
+
+    /* Codes_SRS_MEMIO_01_014: [ If memio is NULL, memio_open shall fail and return a non-zero value. ]*/
+    if (memio == NULL)
+    {
+        LogError("Invalid arguments: memio = %p", memio);
+        result = __LINE__;
+    }
+    else
+    {
+        MEMIO_INSTANCE* memio_instance = (MEMIO_INSTANCE*)memio;
+
+        /* Codes_SRS_MEMIO_01_015: [ If the instance is not closed or its endpoint was already closed once, memio_open shall fail and return a non-zero value. ]*/
+        if ((memio_instance->io_state != IO_STATE_CLOSED) ||
+            memio_instance->pipe->is_shut_down[memio_instance->endpoint])
+        {
+            LogError("The memio endpoint cannot be opened");
+            result = __LINE__;
+        }
+        else
+        {
+            /* Codes_SRS_MEMIO_01_016: [ memio_open shall open the instance and call on_io_open_complete with IO_OPEN_OK before returning 0. ]*/
+            memio_instance->on_bytes_received = on_bytes_received;
+            memio_instance->on_bytes_received_context = on_bytes_received_context;
+            memio_instance->on_io_error = on_io_error;
+            memio_instance->on_io_error_context = on_io_error_context;
+            memio_instance->io_state = IO_STATE_OPEN;
+
+            if (on_io_open_complete != NULL)
+            {
+                on_io_open_complete(on_io_open_complete_context, IO_OPEN_OK);
+            }
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int memio_close(CONCRETE_IO_HANDLE memio, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context)
+{
+    int result;
+
+    /* Codes_SRS_MEMIO_01_017: [ If memio is NULL, memio_close shall fail and return a non-zero value. ]*/
+    if (memio == NULL)
+    {
+        LogError("Invalid arguments: memio = %p", memio);
+        result = __LINE__;
+    }
+    else
+    {
+        MEMIO_INSTANCE* memio_instance = (MEMIO_INSTANCE*)memio;
+
+        /* Codes_SRS_MEMIO_01_018: [ memio_close shall shut the endpoint down: the bytes not yet delivered to it are dropped, its pending sends complete with IO_SEND_CANCELLED and the peer gets an error once it received the bytes sent before the close. ]*/
+        if (memio_instance->io_state != IO_STATE_CLOSED)
+        {
+            shut_down(memio_instance);
+        }
+
+        /* Codes_SRS_MEMIO_01_019: [ memio_close shall call on_io_close_complete and return 0. ]*/
+        if (on_io_close_complete != NULL)
+        {
+            on_io_close_complete(callback_context);
+        }
+
+        result = 0;
+    }
+
+    return result;
+}
+
+int memio_send(CONCRETE_IO_HANDLE memio, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+
+    /* Codes_SRS_MEMIO_01_020: [ If memio or buffer is NULL or size is 0, memio_send shall fail and return a non-zero value. ]*/
+    if ((memio == NULL) ||
+        (buffer == NULL) ||
+        (size == 0))
+    {
+        LogError("Invalid arguments: memio = %p, buffer = %p, size = %lu", memio, buffer, (unsigned long)size);
+        result = __LINE__;
+    }
+    else
+    {
+        MEMIO_INSTANCE* memio_instance = (MEMIO_INSTANCE*)memio;
+        MEMIO_PIPE_INSTANCE* pipe_instance = memio_instance->pipe;
+        MEMIO_ENDPOINT peer = get_peer(memio_instance->endpoint);
+        uint64_t current_time;
+
+        /* Codes_SRS_MEMIO_01_021: [ If the instance is not open or the peer endpoint was closed, memio_send shall fail and return a non-zero value. ]*/
+        if ((memio_instance->io_state != IO_STATE_OPEN) ||
+            pipe_instance->is_shut_down[peer])
+        {
+            LogError("The memio endpoint is not open");
+            result = __LINE__;
+        }
+        else if (get_pipe_time(pipe_instance, &current_time) != 0)
+        {
+            /* Codes_SRS_MEMIO_01_025: [ If any error occurs, memio_send shall fail and return a non-zero value. ]*/
+            result = __LINE__;
+        }
+        else
+        {
+            MEMIO_SEGMENT* segment = (MEMIO_SEGMENT*)malloc(sizeof(MEMIO_SEGMENT));
+            if (segment == NULL)
+            {
+                /* Codes_SRS_MEMIO_01_025: [ If any error occurs, memio_send shall fail and return a non-zero value. ]*/
+                LogError("Failed allocating the memio segment");
+                result = __LINE__;
+            }
+            else if ((segment->bytes = (unsigned char*)malloc(size)) == NULL)
+            {
+                /* Codes_SRS_MEMIO_01_025: [ If any error occurs, memio_send shall fail and return a non-zero value. ]*/
+                LogError("Failed allocating the memio segment bytes");
+                free(segment);
+                result = __LINE__;
+            }
+            else
+            {
+                MEMIO_DIRECTION* direction = &pipe_instance->directions[peer];
+                uint64_t transmit_start = (direction->link_free_time > current_time) ? direction->link_free_time : current_time;
+                uint64_t transmit_end = transmit_start;
+                MEMIO_PENDING_SEND* pending_send = NULL;
+
+                /* Codes_SRS_MEMIO_01_022: [ When the pipe has a bandwidth, the bytes shall leave the endpoint at that rate once the bytes sent before them left. ]*/
+                if (pipe_instance->config.bandwidth != 0)
+                {
+                    transmit_end += (((uint64_t)size * 1000000) + pipe_instance->config.bandwidth - 1) / pipe_instance->config.bandwidth;
+                }
+
+                if ((transmit_end > current_time) &&
+                    ((pending_send = (MEMIO_PENDING_SEND*)malloc(sizeof(MEMIO_PENDING_SEND))) == NULL))
+                {
+                    /* Codes_SRS_MEMIO_01_025: [ If any error occurs, memio_send shall fail and return a non-zero value. ]*/
+                    LogError("Failed allocating the pending send");
+                    free(segment->bytes);
+                    free(segment);
+                    result = __LINE__;
+                }
+                else
+                {
+                    /* Codes_SRS_MEMIO_01_023: [ memio_send shall copy the bytes and queue them for the peer, due latency_us after they left the endpoint. ]*/
+                    (void)memcpy(segment->bytes, buffer, size);
+                    segment->size = size;
+                    segment->delivered = 0;
+                    segment->delivery_time = transmit_end + pipe_instance->config.latency_us;
+                    segment->next = NULL;
+                    if (direction->tail == NULL)
+                    {
+                        direction->head = segment;
+                    }
+                    else
+                    {
+                        direction->tail->next = segment;
+                    }
+                    direction->tail = segment;
+                    direction->link_free_time = transmit_end;
+
+                    if (pending_send == NULL)
+                    {
+                        /* Codes_SRS_MEMIO_01_024: [ When the bytes left the endpoint at once, memio_send shall call on_send_complete with IO_SEND_OK, otherwise memio_dowork shall call it once they left. ]*/
+                        if (on_send_complete != NULL)
+                        {
+                            on_send_complete(callback_context, IO_SEND_OK);
+                        }
+                    }
+                    else
+                    {
+                        pending_send->complete_time = transmit_end;
+                        pending_send->on_send_complete = on_send_complete;
+                        pending_send->callback_context = callback_context;
+                        pending_send->next = NULL;
+                        if (memio_instance->pending_sends_tail == NULL)
+                        {
+                            memio_instance->pending_sends_head = pending_send;
+                        }
+                        else
+                        {
+                            memio_instance->pending_sends_tail->next = pending_send;
+                        }
+                        memio_instance->pending_sends_tail = pending_send;
+                    }
+
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void memio_dowork(CONCRETE_IO_HANDLE memio)
+{
+    /* Codes_SRS_MEMIO_01_026: [ If memio is NULL, memio_dowork shall do nothing. ]*/
+    if (memio != NULL)
+    {
+        MEMIO_INSTANCE* memio_instance = (MEMIO_INSTANCE*)memio;
+        MEMIO_PIPE_INSTANCE* pipe_instance = memio_instance->pipe;
+        MEMIO_DIRECTION* direction = &pipe_instance->directions[memio_instance->endpoint];
+        uint64_t current_time;
+
+        /* Codes_SRS_MEMIO_01_027: [ If the instance is not open, memio_dowork shall do nothing. ]*/
+        if ((memio_instance->io_state == IO_STATE_OPEN) &&
+            (get_pipe_time(pipe_instance, &current_time) == 0))
+        {
+            /* Codes_SRS_MEMIO_01_028: [ memio_dowork shall call on_send_complete with IO_SEND_OK for the sends whose bytes left the endpoint. ]*/
+            complete_pending_sends(memio_instance, current_time, IO_SEND_OK);
+
+            /* Codes_SRS_MEMIO_01_029: [ memio_dowork shall pass the bytes that are due to on_bytes_received, in the order they were sent and at most chunk_size bytes per call when chunk_size is not 0. ]*/
+            while ((memio_instance->io_state == IO_STATE_OPEN) &&
+                (direction->head != NULL) &&
+                (direction->head->delivery_time <= current_time))
+            {
+                MEMIO_SEGMENT* segment = direction->head;
+                const unsigned char* chunk = segment->bytes + segment->delivered;
+                size_t chunk_size = segment->size - segment->delivered;
+
+                if ((pipe_instance->config.chunk_size != 0) &&
+                    (chunk_size > pipe_instance->config.chunk_size))
+                {
+                    chunk_size = pipe_instance->config.chunk_size;
+                }
+
+                segment->delivered += chunk_size;
+                if (segment->delivered == segment->size)
+                {
+                    /* unlinked before the callback, which may close the instance and free the queue */
+                    direction->head = segment->next;
+                    if (direction->head == NULL)
+                    {
+                        direction->tail = NULL;
+                    }
+                }
+                else
+                {
+                    segment = NULL;
+                }
+
+                if (memio_instance->on_bytes_received != NULL)
+                {
+                    memio_instance->on_bytes_received(memio_instance->on_bytes_received_context, chunk, chunk_size);
+                }
+
+                if (segment != NULL)
+                {
+                    free(segment->bytes);
+                    free(segment);
+                }
+            }
+
+            /* Codes_SRS_MEMIO_01_030: [ Once the peer endpoint was closed and all the bytes it sent were received, memio_dowork shall call on_io_error. ]*/
+            if ((memio_instance->io_state == IO_STATE_OPEN) &&
+                (direction->head == NULL) &&
+                pipe_instance->is_shut_down[get_peer(memio_instance->endpoint)])
+            {
+                memio_instance->io_state = IO_STATE_ERROR;
+                if (memio_instance->on_io_error != NULL)
+                {
+                    memio_instance->on_io_error(memio_instance->on_io_error_context);
+                }
+            }
+        }
+    }
+}
+
+int memio_setoption(CONCRETE_IO_HANDLE memio, const char* optionName, const void* value)
+{
+    int result;
+
+    /* Codes_SRS_MEMIO_01_031: [ If memio, optionName or value is NULL, memio_setoption shall fail and return a non-zero value. ]*/
+    if ((memio == NULL) ||
+        (optionName == NULL) ||
+        (value == NULL))
+    {
+        LogError("Invalid arguments: memio = %p, optionName = %p, value = %p", memio, optionName, value);
+        result = __LINE__;
+    }
+    else
+    {
+        /* Codes_SRS_MEMIO_01_032: [ memio has no options, memio_setoption shall fail and return a non-zero value. ]*/
+        LogError("Option %s is not supported by memio", optionName);
+        result = __LINE__;
+    }
+
+    return result;
+}
+
+static void* memio_CloneOption(const char* name, const void* value)
+{
+    (void)name;
+    (void)value;
+    return NULL;
+}
+
+static void memio_DestroyOption(const char* name, const void* value)
+{
+    (void)name;
+    (void)value;
+}
+
+OPTIONHANDLER_HANDLE memio_retrieveoptions(CONCRETE_IO_HANDLE memio)
+{
+    OPTIONHANDLER_HANDLE result;
+
+    /* Codes_SRS_MEMIO_01_033: [ If memio is NULL, memio_retrieveoptions shall fail and return NULL. ]*/
+    if (memio == NULL)
+    {
+        LogError("Invalid arguments: memio = %p", memio);
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_MEMIO_01_034: [ memio_retrieveoptions shall return an empty OPTIONHANDLER_HANDLE. ]*/
+        result = OptionHandler_Create(memio_CloneOption, memio_DestroyOption, memio_setoption);
+        if (result == NULL)
+        {
+            LogError("Failed creating the option handler");
+        }
+    }
+
+    return result;
+}
+
+/* Codes_SRS_MEMIO_01_035: [ memio_get_interface_description shall return a pointer to an IO_INTERFACE_DESCRIPTION structure that contains pointers to the memio functions. ]*/
+const IO_INTERFACE_DESCRIPTION* memio_get_interface_description(void)
+{
+    return &memio_interface_description;
+}
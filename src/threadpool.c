@@ -0,0 +1,473 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/threadpool.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+DEFINE_ENUM_STRINGS(THREADPOOL_MODE, THREADPOOL_MODE_VALUES);
+DEFINE_ENUM_STRINGS(THREADPOOL_WORK_RESULT, THREADPOOL_WORK_RESULT_VALUES);
+
+typedef enum THREADPOOL_STATE_TAG
+{
+    THREADPOOL_STATE_RUNNING,
+    THREADPOOL_STATE_SHUTTING_DOWN,
+    THREADPOOL_STATE_SHUT_DOWN
+} THREADPOOL_STATE;
+
+typedef struct THREADPOOL_WORK_ITEM_TAG
+{
+    DLIST_ENTRY entry;
+    THREADPOOL_WORK_FUNCTION work_function;
+    void* work_context;
+    ON_THREADPOOL_WORK_COMPLETE on_work_complete;
+    void* on_work_complete_context;
+} THREADPOOL_WORK_ITEM;
+
+typedef struct THREADPOOL_QUEUE_TAG
+{
+    LOCK_HANDLE lock;
+    DLIST_ENTRY items;
+} THREADPOOL_QUEUE;
+
+typedef struct THREADPOOL_WORKER_TAG
+{
+    struct THREADPOOL_INSTANCE_TAG* threadpool;
+    size_t queue_index;
+    THREAD_HANDLE thread;
+} THREADPOOL_WORKER;
+
+typedef struct THREADPOOL_INSTANCE_TAG
+{
+    THREADPOOL_MODE mode;
+    size_t thread_count;
+    size_t started_thread_count;
+    THREADPOOL_WORKER* workers;
+    /*one shared queue, or one queue per worker in work stealing mode*/
+    size_t queue_count;
+    THREADPOOL_QUEUE* queues;
+    /*state_lock guards state and next_queue_index, idle workers wait on work_available with it; it is always taken
+    before a queue lock. A worker that finds work only takes the queue locks.*/
+    LOCK_HANDLE state_lock;
+    COND_HANDLE work_available;
+    THREADPOOL_STATE state;
+    size_t next_queue_index;
+} THREADPOOL_INSTANCE;
+
+static THREADPOOL_WORK_ITEM* pop_work_item(THREADPOOL_QUEUE* queue, bool from_tail)
+{
+    THREADPOOL_WORK_ITEM* result;
+
+    if (Lock(queue->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock the work queue");
+        result = NULL;
+    }
+    else
+    {
+        if (DList_IsListEmpty(&queue->items))
+        {
+            result = NULL;
+        }
+        else
+        {
+            PDLIST_ENTRY entry = from_tail ? queue->items.Blink : queue->items.Flink;
+            (void)DList_RemoveEntryList(entry);
+            result = containingRecord(entry, THREADPOOL_WORK_ITEM, entry);
+        }
+        (void)Unlock(queue->lock);
+    }
+
+    return result;
+}
+
+static THREADPOOL_WORK_ITEM* take_work_item(THREADPOOL_INSTANCE* threadpool, size_t home_queue_index)
+{
+    /*own queue first, in FIFO order*/
+    THREADPOOL_WORK_ITEM* result = pop_work_item(&threadpool->queues[home_queue_index], false);
+    size_t i;
+
+    /*then steal the most recently queued item of the other queues so that the owner keeps its oldest work*/
+    for (i = 1; (result == NULL) && (i < threadpool->queue_count); i++)
+    {
+        result = pop_work_item(&threadpool->queues[(home_queue_index + i) % threadpool->queue_count], true);
+    }
+
+    return result;
+}
+
+static int threadpool_worker_thread(void* arg)
+{
+    THREADPOOL_WORKER* worker = (THREADPOOL_WORKER*)arg;
+    THREADPOOL_INSTANCE* threadpool = worker->threadpool;
+    bool exit_worker = false;
+
+    while (!exit_worker)
+    {
+        THREADPOOL_WORK_ITEM* work_item = take_work_item(threadpool, worker->queue_index);
+
+        if (work_item == NULL)
+        {
+            if (Lock(threadpool->state_lock) != LOCK_OK)
+            {
+                LogError("unable to Lock the threadpool state");
+                exit_worker = true;
+            }
+            else
+            {
+                /*threadpool_schedule_work posts work_available under state_lock after queuing the item, so looking at
+                the queues again with state_lock held before waiting cannot miss a wake up*/
+                work_item = take_work_item(threadpool, worker->queue_index);
+                while ((work_item == NULL) &&
+                    (!exit_worker) &&
+                    (threadpool->state == THREADPOOL_STATE_RUNNING))
+                {
+                    if (Condition_Wait(threadpool->work_available, threadpool->state_lock, 0) != COND_OK)
+                    {
+                        LogError("Condition_Wait failed, worker exits");
+                        exit_worker = true;
+                    }
+                    else
+                    {
+                        work_item = take_work_item(threadpool, worker->queue_index);
+                    }
+                }
+
+                if ((work_item == NULL) && (!exit_worker))
+                {
+                    /*shutting down with nothing left to run; Condition_Post wakes a single waiter, so pass the wake up along*/
+                    (void)Condition_Post(threadpool->work_available);
+                    exit_worker = true;
+                }
+
+                (void)Unlock(threadpool->state_lock);
+            }
+        }
+
+        if (work_item != NULL)
+        {
+            int work_function_result = work_item->work_function(work_item->work_context);
+            if (work_item->on_work_complete != NULL)
+            {
+                work_item->on_work_complete(work_item->on_work_complete_context, THREADPOOL_WORK_OK, work_function_result);
+            }
+
+            free(work_item);
+        }
+    }
+
+    return 0;
+}
+
+static void join_workers(THREADPOOL_INSTANCE* threadpool)
+{
+    size_t i;
+    for (i = 0; i < threadpool->started_thread_count; i++)
+    {
+        int thread_result;
+        if (ThreadAPI_Join(threadpool->workers[i].thread, &thread_result) != THREADAPI_OK)
+        {
+            LogError("unable to ThreadAPI_Join worker %zu", i);
+        }
+    }
+    threadpool->started_thread_count = 0;
+}
+
+static void free_threadpool(THREADPOOL_INSTANCE* threadpool)
+{
+    if (threadpool->queues != NULL)
+    {
+        size_t i;
+        for (i = 0; i < threadpool->queue_count; i++)
+        {
+            if (threadpool->queues[i].lock != NULL)
+            {
+                (void)Lock_Deinit(threadpool->queues[i].lock);
+            }
+        }
+        free(threadpool->queues);
+    }
+    free(threadpool->workers);
+    Condition_Deinit(threadpool->work_available);
+    (void)Lock_Deinit(threadpool->state_lock);
+    free(threadpool);
+}
+
+THREADPOOL_HANDLE threadpool_create(size_t thread_count, THREADPOOL_MODE mode)
+{
+    THREADPOOL_INSTANCE* result;
+
+    /*Codes_SRS_THREADPOOL_01_001: [ If thread_count is 0 or mode is not a known THREADPOOL_MODE, threadpool_create shall fail and return NULL. ]*/
+    if ((thread_count == 0) ||
+        ((mode != THREADPOOL_MODE_SHARED_QUEUE) && (mode != THREADPOOL_MODE_WORK_STEALING)))
+    {
+        LogError("invalid arguments: size_t thread_count=%zu, THREADPOOL_MODE mode=%d", thread_count, (int)mode);
+        result = NULL;
+    }
+    else if ((result = (THREADPOOL_INSTANCE*)malloc(sizeof(THREADPOOL_INSTANCE))) == NULL)
+    {
+        /*Codes_SRS_THREADPOOL_01_003: [ If any resource cannot be created, threadpool_create shall free everything it created and return NULL. ]*/
+        LogError("unable to malloc THREADPOOL_INSTANCE");
+    }
+    else
+    {
+        result->mode = mode;
+        result->thread_count = thread_count;
+        result->started_thread_count = 0;
+        /*Codes_SRS_THREADPOOL_01_004: [ In THREADPOOL_MODE_WORK_STEALING mode every worker shall own a work queue; in THREADPOOL_MODE_SHARED_QUEUE mode all workers shall share one queue. ]*/
+        result->queue_count = (mode == THREADPOOL_MODE_WORK_STEALING) ? thread_count : 1;
+        result->state = THREADPOOL_STATE_RUNNING;
+        result->next_queue_index = 0;
+        result->workers = NULL;
+        result->queues = NULL;
+        result->work_available = NULL;
+
+        if ((result->state_lock = Lock_Init_Named("threadpool")) == NULL)
+        {
+            LogError("unable to Lock_Init_Named");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->work_available = Condition_Init()) == NULL)
+        {
+            LogError("unable to Condition_Init");
+            (void)Lock_Deinit(result->state_lock);
+            free(result);
+            result = NULL;
+        }
+        else if (((result->queues = (THREADPOOL_QUEUE*)calloc(result->queue_count, sizeof(THREADPOOL_QUEUE))) == NULL) ||
+            ((result->workers = (THREADPOOL_WORKER*)calloc(thread_count, sizeof(THREADPOOL_WORKER))) == NULL))
+        {
+            LogError("unable to allocate the work queues and workers");
+            free_threadpool(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < result->queue_count; i++)
+            {
+                DList_InitializeListHead(&result->queues[i].items);
+                if ((result->queues[i].lock = Lock_Init_Named("threadpool_queue")) == NULL)
+                {
+                    LogError("unable to Lock_Init_Named for queue %zu", i);
+                    break;
+                }
+            }
+
+            if (i < result->queue_count)
+            {
+                free_threadpool(result);
+                result = NULL;
+            }
+            else
+            {
+                /*Codes_SRS_THREADPOOL_01_002: [ threadpool_create shall start thread_count worker threads by calling ThreadAPI_Create. ]*/
+                for (i = 0; i < thread_count; i++)
+                {
+                    result->workers[i].threadpool = result;
+                    result->workers[i].queue_index = i % result->queue_count;
+                    if (ThreadAPI_Create(&result->workers[i].thread, threadpool_worker_thread, &result->workers[i]) != THREADAPI_OK)
+                    {
+                        LogError("unable to ThreadAPI_Create worker %zu", i);
+                        break;
+                    }
+                    result->started_thread_count++;
+                }
+
+                if (i < thread_count)
+                {
+                    if (Lock(result->state_lock) == LOCK_OK)
+                    {
+                        result->state = THREADPOOL_STATE_SHUTTING_DOWN;
+                        (void)Condition_Post(result->work_available);
+                        (void)Unlock(result->state_lock);
+                        join_workers(result);
+                        free_threadpool(result);
+                    }
+                    else
+                    {
+                        /*workers might still reference the instance, leaking it is the only safe option*/
+                        LogError("unable to Lock the threadpool state, the instance is leaked");
+                    }
+                    result = NULL;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+int threadpool_schedule_work(THREADPOOL_HANDLE threadpool, THREADPOOL_WORK_FUNCTION work_function, void* work_context, ON_THREADPOOL_WORK_COMPLETE on_work_complete, void* on_work_complete_context)
+{
+    int result;
+
+    /*Codes_SRS_THREADPOOL_01_005: [ If threadpool or work_function is NULL, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+    if ((threadpool == NULL) || (work_function == NULL))
+    {
+        LogError("invalid arguments: THREADPOOL_HANDLE threadpool=%p, THREADPOOL_WORK_FUNCTION work_function=%p", threadpool, work_function);
+        result = __LINE__;
+    }
+    else
+    {
+        THREADPOOL_WORK_ITEM* work_item = (THREADPOOL_WORK_ITEM*)malloc(sizeof(THREADPOOL_WORK_ITEM));
+        if (work_item == NULL)
+        {
+            /*Codes_SRS_THREADPOOL_01_008: [ If any other error occurs, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+            LogError("unable to malloc THREADPOOL_WORK_ITEM");
+            result = __LINE__;
+        }
+        else
+        {
+            work_item->work_function = work_function;
+            work_item->work_context = work_context;
+            work_item->on_work_complete = on_work_complete;
+            work_item->on_work_complete_context = on_work_complete_context;
+
+            if (Lock(threadpool->state_lock) != LOCK_OK)
+            {
+                LogError("unable to Lock the threadpool state");
+                free(work_item);
+                result = __LINE__;
+            }
+            else
+            {
+                if (threadpool->state != THREADPOOL_STATE_RUNNING)
+                {
+                    /*Codes_SRS_THREADPOOL_01_007: [ If threadpool_shutdown has been called, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+                    LogError("threadpool is shut down");
+                    free(work_item);
+                    result = __LINE__;
+                }
+                else
+                {
+                    /*Codes_SRS_THREADPOOL_01_006: [ threadpool_schedule_work shall queue the work item, distributing work items round robin over the work queues, and wake up one idle worker. ]*/
+                    THREADPOOL_QUEUE* queue = &threadpool->queues[threadpool->next_queue_index];
+                    threadpool->next_queue_index = (threadpool->next_queue_index + 1) % threadpool->queue_count;
+
+                    if (Lock(queue->lock) != LOCK_OK)
+                    {
+                        LogError("unable to Lock the work queue");
+                        free(work_item);
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        DList_InsertTailList(&queue->items, &work_item->entry);
+                        (void)Unlock(queue->lock);
+
+                        (void)Condition_Post(threadpool->work_available);
+                        result = 0;
+                    }
+                }
+
+                (void)Unlock(threadpool->state_lock);
+            }
+        }
+    }
+
+    return result;
+}
+
+int threadpool_shutdown(THREADPOOL_HANDLE threadpool, bool cancel_pending)
+{
+    int result;
+
+    if (threadpool == NULL)
+    {
+        /*Codes_SRS_THREADPOOL_01_009: [ If threadpool is NULL, threadpool_shutdown shall fail and return a non-zero value. ]*/
+        LogError("invalid argument: THREADPOOL_HANDLE threadpool=NULL");
+        result = __LINE__;
+    }
+    else if (Lock(threadpool->state_lock) != LOCK_OK)
+    {
+        LogError("unable to Lock the threadpool state");
+        result = __LINE__;
+    }
+    else if (threadpool->state != THREADPOOL_STATE_RUNNING)
+    {
+        /*Codes_SRS_THREADPOOL_01_010: [ If the pool is already shut down, threadpool_shutdown shall fail and return a non-zero value. ]*/
+        LogError("threadpool already shut down");
+        (void)Unlock(threadpool->state_lock);
+        result = __LINE__;
+    }
+    else
+    {
+        DLIST_ENTRY cancelled_items;
+        size_t i;
+
+        DList_InitializeListHead(&cancelled_items);
+        threadpool->state = THREADPOOL_STATE_SHUTTING_DOWN;
+
+        if (cancel_pending)
+        {
+            /*Codes_SRS_THREADPOOL_01_012: [ If cancel_pending is true, the work items that have not started shall be removed and completed with THREADPOOL_WORK_CANCELLED after the workers are joined. ]*/
+            for (i = 0; i < threadpool->queue_count; i++)
+            {
+                if (Lock(threadpool->queues[i].lock) != LOCK_OK)
+                {
+                    LogError("unable to Lock work queue %zu, its items will run", i);
+                }
+                else
+                {
+                    while (!DList_IsListEmpty(&threadpool->queues[i].items))
+                    {
+                        DList_InsertTailList(&cancelled_items, DList_RemoveHeadList(&threadpool->queues[i].items));
+                    }
+                    (void)Unlock(threadpool->queues[i].lock);
+                }
+            }
+        }
+
+        (void)Condition_Post(threadpool->work_available);
+        (void)Unlock(threadpool->state_lock);
+
+        /*Codes_SRS_THREADPOOL_01_011: [ threadpool_shutdown shall stop accepting work and join all the worker threads; when cancel_pending is false the queued work items shall be executed first. ]*/
+        join_workers(threadpool);
+        threadpool->state = THREADPOOL_STATE_SHUT_DOWN;
+
+        while (!DList_IsListEmpty(&cancelled_items))
+        {
+            THREADPOOL_WORK_ITEM* work_item = containingRecord(DList_RemoveHeadList(&cancelled_items), THREADPOOL_WORK_ITEM, entry);
+            if (work_item->on_work_complete != NULL)
+            {
+                work_item->on_work_complete(work_item->on_work_complete_context, THREADPOOL_WORK_CANCELLED, 0);
+            }
+            free(work_item);
+        }
+
+        result = 0;
+    }
+
+    return result;
+}
+
+void threadpool_destroy(THREADPOOL_HANDLE threadpool)
+{
+    /*Codes_SRS_THREADPOOL_01_013: [ If threadpool is NULL, threadpool_destroy shall do nothing. ]*/
+    if (threadpool != NULL)
+    {
+        /*Codes_SRS_THREADPOOL_01_014: [ If the pool was not shut down, threadpool_destroy shall shut it down executing the queued work items, then free all resources. ]*/
+        if ((threadpool->state == THREADPOOL_STATE_RUNNING) &&
+            (threadpool_shutdown(threadpool, false) != 0))
+        {
+            LogError("unable to shut down the threadpool, the instance is leaked");
+        }
+        else
+        {
+            free_threadpool(threadpool);
+        }
+    }
+}
@@ -0,0 +1,408 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/timer_wheel.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+/*one tick is one millisecond. Level 0 holds the timers expiring in the next 64 ms, level 1 in the next 4 s,
+level 2 in the next 4.5 min and level 3 in the next 4.6 h. Timers further out are parked in level 3 and
+placed again when their slot is cascaded.*/
+#define TIMER_WHEEL_LEVEL_COUNT     4
+#define TIMER_WHEEL_SLOT_BITS       6
+#define TIMER_WHEEL_SLOT_COUNT      (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK       (TIMER_WHEEL_SLOT_COUNT - 1)
+#define TIMER_WHEEL_LEVEL_SHIFT(level)  ((level) * TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_MAX_DELTA       (((uint64_t)1 << (TIMER_WHEEL_LEVEL_COUNT * TIMER_WHEEL_SLOT_BITS)) - 1)
+
+typedef struct TIMER_INSTANCE_TAG
+{
+    DLIST_ENTRY entry;
+    uint64_t expiry_tick;
+    ON_TIMER_EXPIRED on_timer_expired;
+    void* context;
+} TIMER_INSTANCE;
+
+typedef struct TIMER_WHEEL_INSTANCE_TAG
+{
+    TICK_COUNTER_HANDLE tick_counter;
+    /*all the ticks up to and including current_tick have been processed*/
+    uint64_t current_tick;
+    size_t timer_count;
+    TIMER_INSTANCE* expiring_timer;
+    DLIST_ENTRY slots[TIMER_WHEEL_LEVEL_COUNT][TIMER_WHEEL_SLOT_COUNT];
+} TIMER_WHEEL_INSTANCE;
+
+static void add_timer_to_slot(TIMER_WHEEL_INSTANCE* timer_wheel, TIMER_INSTANCE* timer)
+{
+    uint64_t slot_tick;
+    uint64_t delta;
+    size_t level;
+
+    if (timer->expiry_tick <= timer_wheel->current_tick)
+    {
+        /*a cascaded timer that expires on the tick being processed*/
+        slot_tick = timer_wheel->current_tick;
+        delta = 0;
+    }
+    else if (timer->expiry_tick - timer_wheel->current_tick > TIMER_WHEEL_MAX_DELTA)
+    {
+        /*too far out, park it in the last slot that level 3 can address; it is placed again when that slot is cascaded*/
+        slot_tick = timer_wheel->current_tick + TIMER_WHEEL_MAX_DELTA;
+        delta = TIMER_WHEEL_MAX_DELTA;
+    }
+    else
+    {
+        slot_tick = timer->expiry_tick;
+        delta = timer->expiry_tick - timer_wheel->current_tick;
+    }
+
+    for (level = 0; level < TIMER_WHEEL_LEVEL_COUNT - 1; level++)
+    {
+        if (delta < ((uint64_t)1 << TIMER_WHEEL_LEVEL_SHIFT(level + 1)))
+        {
+            break;
+        }
+    }
+
+    DList_InsertTailList(&timer_wheel->slots[level][(slot_tick >> TIMER_WHEEL_LEVEL_SHIFT(level)) & TIMER_WHEEL_SLOT_MASK], &timer->entry);
+}
+
+static void detach_slot(PDLIST_ENTRY slot, PDLIST_ENTRY detached)
+{
+    /*splice the whole slot into detached, leaving the slot empty*/
+    DList_InitializeListHead(detached);
+    DList_InsertTailList(slot, detached);
+    (void)DList_RemoveEntryList(slot);
+    DList_InitializeListHead(slot);
+}
+
+static void cascade(TIMER_WHEEL_INSTANCE* timer_wheel, size_t level, size_t slot_index)
+{
+    DLIST_ENTRY detached;
+    detach_slot(&timer_wheel->slots[level][slot_index], &detached);
+
+    while (!DList_IsListEmpty(&detached))
+    {
+        TIMER_INSTANCE* timer = containingRecord(DList_RemoveHeadList(&detached), TIMER_INSTANCE, entry);
+        add_timer_to_slot(timer_wheel, timer);
+    }
+}
+
+static void process_tick(TIMER_WHEEL_INSTANCE* timer_wheel)
+{
+    DLIST_ENTRY expired;
+    size_t slot_index = (size_t)(timer_wheel->current_tick & TIMER_WHEEL_SLOT_MASK);
+
+    if (slot_index == 0)
+    {
+        size_t level;
+        for (level = 1; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+        {
+            size_t level_slot_index = (size_t)((timer_wheel->current_tick >> TIMER_WHEEL_LEVEL_SHIFT(level)) & TIMER_WHEEL_SLOT_MASK);
+            cascade(timer_wheel, level, level_slot_index);
+            if (level_slot_index != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    /*callbacks can start and cancel timers, so the expired timers are moved out of the wheel first*/
+    detach_slot(&timer_wheel->slots[0][slot_index], &expired);
+    while (!DList_IsListEmpty(&expired))
+    {
+        TIMER_INSTANCE* timer = containingRecord(DList_RemoveHeadList(&expired), TIMER_INSTANCE, entry);
+        timer_wheel->timer_count--;
+
+        /*Codes_SRS_TIMER_WHEEL_01_014: [ timer_wheel_dowork shall call on_timer_expired for every timer that expired, and free the timer afterwards. ]*/
+        timer_wheel->expiring_timer = timer;
+        timer->on_timer_expired(timer->context);
+        timer_wheel->expiring_timer = NULL;
+        free(timer);
+    }
+}
+
+TIMER_WHEEL_HANDLE timer_wheel_create(void)
+{
+    TIMER_WHEEL_INSTANCE* result;
+
+    /*Codes_SRS_TIMER_WHEEL_01_001: [ timer_wheel_create shall allocate a new timer wheel and create its tick counter by calling tickcounter_create. ]*/
+    result = (TIMER_WHEEL_INSTANCE*)malloc(sizeof(TIMER_WHEEL_INSTANCE));
+    if (result == NULL)
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_002: [ If any error occurs, timer_wheel_create shall fail and return NULL. ]*/
+        LogError("Cannot allocate timer wheel");
+    }
+    else
+    {
+        result->tick_counter = tickcounter_create();
+        if (result->tick_counter == NULL)
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_002: [ If any error occurs, timer_wheel_create shall fail and return NULL. ]*/
+            LogError("Cannot create the tick counter");
+            free(result);
+            result = NULL;
+        }
+        else if (tickcounter_get_current_ms(result->tick_counter, &result->current_tick) != 0)
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_002: [ If any error occurs, timer_wheel_create shall fail and return NULL. ]*/
+            LogError("Cannot get the current tick count");
+            tickcounter_destroy(result->tick_counter);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t level;
+            size_t slot_index;
+
+            for (level = 0; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+            {
+                for (slot_index = 0; slot_index < TIMER_WHEEL_SLOT_COUNT; slot_index++)
+                {
+                    DList_InitializeListHead(&result->slots[level][slot_index]);
+                }
+            }
+
+            result->timer_count = 0;
+            result->expiring_timer = NULL;
+        }
+    }
+
+    return result;
+}
+
+void timer_wheel_destroy(TIMER_WHEEL_HANDLE timer_wheel)
+{
+    /*Codes_SRS_TIMER_WHEEL_01_003: [ If timer_wheel is NULL, timer_wheel_destroy shall do nothing. ]*/
+    if (timer_wheel == NULL)
+    {
+        LogError("NULL timer_wheel");
+    }
+    else
+    {
+        size_t level;
+        size_t slot_index;
+
+        /*Codes_SRS_TIMER_WHEEL_01_004: [ timer_wheel_destroy shall free all the running timers without calling their callbacks, destroy the tick counter and free the timer wheel. ]*/
+        for (level = 0; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+        {
+            for (slot_index = 0; slot_index < TIMER_WHEEL_SLOT_COUNT; slot_index++)
+            {
+                while (!DList_IsListEmpty(&timer_wheel->slots[level][slot_index]))
+                {
+                    TIMER_INSTANCE* timer = containingRecord(DList_RemoveHeadList(&timer_wheel->slots[level][slot_index]), TIMER_INSTANCE, entry);
+                    free(timer);
+                }
+            }
+        }
+
+        tickcounter_destroy(timer_wheel->tick_counter);
+        free(timer_wheel);
+    }
+}
+
+TIMER_HANDLE timer_wheel_start_timer(TIMER_WHEEL_HANDLE timer_wheel, uint32_t timeout_ms, ON_TIMER_EXPIRED on_timer_expired, void* context)
+{
+    TIMER_INSTANCE* result;
+
+    if ((timer_wheel == NULL) ||
+        (on_timer_expired == NULL))
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_005: [ If timer_wheel or on_timer_expired is NULL, timer_wheel_start_timer shall fail and return NULL. ]*/
+        LogError("Bad arguments: timer_wheel = %p, on_timer_expired = %p",
+            timer_wheel, on_timer_expired);
+        result = NULL;
+    }
+    else
+    {
+        uint64_t current_ms;
+
+        if (tickcounter_get_current_ms(timer_wheel->tick_counter, &current_ms) != 0)
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_007: [ If any error occurs, timer_wheel_start_timer shall fail and return NULL. ]*/
+            LogError("Cannot get the current tick count");
+            result = NULL;
+        }
+        else
+        {
+            result = (TIMER_INSTANCE*)malloc(sizeof(TIMER_INSTANCE));
+            if (result == NULL)
+            {
+                /*Codes_SRS_TIMER_WHEEL_01_007: [ If any error occurs, timer_wheel_start_timer shall fail and return NULL. ]*/
+                LogError("Cannot allocate timer");
+            }
+            else
+            {
+                /*Codes_SRS_TIMER_WHEEL_01_006: [ timer_wheel_start_timer shall insert a new timer expiring timeout_ms milliseconds from the current tick count in the slot matching its expiry tick. ]*/
+                result->expiry_tick = current_ms + timeout_ms;
+                if (result->expiry_tick <= timer_wheel->current_tick)
+                {
+                    /*the current tick was already processed, a 0 ms timer expires on the next one*/
+                    result->expiry_tick = timer_wheel->current_tick + 1;
+                }
+                result->on_timer_expired = on_timer_expired;
+                result->context = context;
+
+                add_timer_to_slot(timer_wheel, result);
+                timer_wheel->timer_count++;
+            }
+        }
+    }
+
+    return result;
+}
+
+int timer_wheel_cancel_timer(TIMER_WHEEL_HANDLE timer_wheel, TIMER_HANDLE timer)
+{
+    int result;
+
+    if ((timer_wheel == NULL) ||
+        (timer == NULL))
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_008: [ If timer_wheel or timer is NULL, timer_wheel_cancel_timer shall fail and return a non-zero value. ]*/
+        LogError("Bad arguments: timer_wheel = %p, timer = %p",
+            timer_wheel, timer);
+        result = __LINE__;
+    }
+    else if (timer == timer_wheel->expiring_timer)
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_010: [ If timer is the timer whose callback is executing, timer_wheel_cancel_timer shall do nothing and return 0. ]*/
+        result = 0;
+    }
+    else
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_009: [ timer_wheel_cancel_timer shall unlink the timer from its slot and free it. ]*/
+        (void)DList_RemoveEntryList(&timer->entry);
+        timer_wheel->timer_count--;
+        free(timer);
+        result = 0;
+    }
+
+    return result;
+}
+
+void timer_wheel_dowork(TIMER_WHEEL_HANDLE timer_wheel)
+{
+    if (timer_wheel == NULL)
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_011: [ If timer_wheel is NULL, timer_wheel_dowork shall do nothing. ]*/
+        LogError("NULL timer_wheel");
+    }
+    else
+    {
+        uint64_t current_ms;
+
+        if (tickcounter_get_current_ms(timer_wheel->tick_counter, &current_ms) != 0)
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_012: [ If getting the current tick count fails, timer_wheel_dowork shall do nothing. ]*/
+            LogError("Cannot get the current tick count");
+        }
+        else
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_013: [ timer_wheel_dowork shall process every tick between the last processed tick and the current tick count, cascading the timers of the upper levels into the lower levels. ]*/
+            while (timer_wheel->current_tick < current_ms)
+            {
+                if (timer_wheel->timer_count == 0)
+                {
+                    /*nothing can expire, skip the idle ticks*/
+                    timer_wheel->current_tick = current_ms;
+                }
+                else
+                {
+                    timer_wheel->current_tick++;
+                    process_tick(timer_wheel);
+                }
+            }
+        }
+    }
+}
+
+int timer_wheel_get_next_timeout(TIMER_WHEEL_HANDLE timer_wheel, uint32_t* timeout_ms)
+{
+    int result;
+
+    if ((timer_wheel == NULL) ||
+        (timeout_ms == NULL))
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_015: [ If timer_wheel or timeout_ms is NULL, timer_wheel_get_next_timeout shall fail and return a non-zero value. ]*/
+        LogError("Bad arguments: timer_wheel = %p, timeout_ms = %p",
+            timer_wheel, timeout_ms);
+        result = __LINE__;
+    }
+    else if (timer_wheel->timer_count == 0)
+    {
+        /*Codes_SRS_TIMER_WHEEL_01_016: [ If no timer is running, timer_wheel_get_next_timeout shall set timeout_ms to TIMER_WHEEL_NO_TIMEOUT and return 0. ]*/
+        *timeout_ms = TIMER_WHEEL_NO_TIMEOUT;
+        result = 0;
+    }
+    else
+    {
+        uint64_t current_ms;
+
+        if (tickcounter_get_current_ms(timer_wheel->tick_counter, &current_ms) != 0)
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_018: [ If getting the current tick count fails, timer_wheel_get_next_timeout shall fail and return a non-zero value. ]*/
+            LogError("Cannot get the current tick count");
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_TIMER_WHEEL_01_017: [ Otherwise timer_wheel_get_next_timeout shall set timeout_ms to the time until the earliest tick at which a timer expires or is cascaded to a lower level. ]*/
+            uint64_t next_tick = UINT64_MAX;
+            size_t level;
+            size_t slot_index;
+
+            for (level = 0; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+            {
+                size_t shift = TIMER_WHEEL_LEVEL_SHIFT(level);
+                uint64_t level_span = (uint64_t)1 << (shift + TIMER_WHEEL_SLOT_BITS);
+
+                for (slot_index = 0; slot_index < TIMER_WHEEL_SLOT_COUNT; slot_index++)
+                {
+                    if (!DList_IsListEmpty(&timer_wheel->slots[level][slot_index]))
+                    {
+                        /*the first tick after current_tick that maps to this slot*/
+                        uint64_t slot_tick = (timer_wheel->current_tick & ~(level_span - 1)) | ((uint64_t)slot_index << shift);
+                        if (slot_tick <= timer_wheel->current_tick)
+                        {
+                            slot_tick += level_span;
+                        }
+
+                        if (slot_tick < next_tick)
+                        {
+                            next_tick = slot_tick;
+                        }
+                    }
+                }
+            }
+
+            if (next_tick <= current_ms)
+            {
+                *timeout_ms = 0;
+            }
+            else if (next_tick - current_ms >= TIMER_WHEEL_NO_TIMEOUT)
+            {
+                *timeout_ms = TIMER_WHEEL_NO_TIMEOUT - 1;
+            }
+            else
+            {
+                *timeout_ms = (uint32_t)(next_tick - current_ms);
+            }
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
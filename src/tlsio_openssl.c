@@ -12,6 +12,7 @@
 #include "openssl/opensslv.h"
 #include <stdio.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/tlsio.h"
 #include "azure_c_shared_utility/tlsio_openssl.h"
@@ -19,7 +20,19 @@
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/shared_util_options.h"
 #include "azure_c_shared_utility/x509_openssl.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+
+/* kTLS is only built with use_ktls: the sent records are offloaded but the received ones are not, and it has not
+   been exercised on a kTLS capable kernel by the tests */
+#if defined(TLSIO_OPENSSL_USE_KTLS) && defined(__linux__) && (OPENSSL_VERSION_NUMBER >= 0x30000000L) && !defined(OPENSSL_NO_KTLS)
+#define TLSIO_OPENSSL_KTLS
+#endif
+
+/* how long a close waits to send the close_notify before it closes the connection anyway */
+#define TLSIO_OPENSSL_CLOSE_TIMEOUT_US  (2 * 1000 * 1000)
 
 typedef enum TLSIO_STATE_TAG
 {
@@ -27,6 +40,8 @@ typedef enum TLSIO_STATE_TAG
     TLSIO_STATE_OPENING_UNDERLYING_IO,
     TLSIO_STATE_IN_HANDSHAKE,
     TLSIO_STATE_OPEN,
+    /* the close_notify waits for the underlying io to accept it, or in kTLS send mode for its queue to drain */
+    TLSIO_STATE_SENDING_CLOSE_NOTIFY,
     TLSIO_STATE_CLOSING,
     TLSIO_STATE_ERROR
 } TLSIO_STATE;
@@ -52,8 +67,43 @@ typedef struct TLS_IO_INSTANCE_TAG
     char* certificate;
     const char* x509certificate;
     const char* x509privatekey;
+    /* plaintext bytes, the sends are queued by the underlying io; get_statistics adds the records kept in out_bio */
+    XIO_STATISTICS statistics;
+    /* copy of the option forwarded to the underlying io, checked before a record is encrypted */
+    size_t send_high_watermark;
+    /* allocated on the first SSL_read and reused, a full record is delivered in one on_bytes_received call */
+    unsigned char* receive_buffer;
+    size_t receive_buffer_size;
+    /* protocol configuration, applied to the context of the next open */
+    int tls_min_version;
+    int tls_max_version;
+    char* tls_cipher_list;
+    char* tls_ciphersuites;
+    char* tls_groups;
+    /* OPTION_TLS_KTLS; the handshake then writes to the socket directly so that OpenSSL can program the kernel */
+    int ktls_requested;
+    /* the kernel encrypts what is sent on the socket, the plaintext is passed to the underlying io as is */
+    bool is_ktls_send;
+    /* clock of the connection events and of the time spent in OpenSSL that are kept in statistics */
+    TICK_COUNTER_HANDLE tick_counter;
+    uint64_t open_time_us;
+    /* OPTION_ON_WRITABLE; the underlying io calls on_underlying_io_writable, which first sends the records kept in out_bio */
+    XIO_WRITABLE_CALLBACK on_writable;
+    uint64_t close_deadline_us;
+    /* PENDING_SEND entries of the sends the underlying io has not completed yet */
+    DLIST_ENTRY pending_sends;
 } TLS_IO_INSTANCE;
 
+/* the context of a send passed to the underlying io, on_underlying_io_send_complete records its latency */
+typedef struct PENDING_SEND_TAG
+{
+    DLIST_ENTRY entry;
+    TLS_IO_INSTANCE* tls_io_instance;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+    uint64_t send_time_us;
+} PENDING_SEND;
+
 struct CRYPTO_dynlock_value 
 {
     LOCK_HANDLE lock; 
@@ -108,6 +158,46 @@ static void* tlsio_openssl_CloneOption(const char* name, const void* value)
                 /*return as is*/
             }
         }
+        else if (strcmp(name, OPTION_TLS_RECEIVE_BUFFER_SIZE) == 0)
+        {
+            result = malloc(sizeof(size_t));
+            if (result == NULL)
+            {
+                LogError("unable to clone the %s option", name);
+            }
+            else
+            {
+                *(size_t*)result = *(const size_t*)value;
+            }
+        }
+        else if (
+            (strcmp(name, OPTION_TLS_MIN_VERSION) == 0) ||
+            (strcmp(name, OPTION_TLS_MAX_VERSION) == 0) ||
+            (strcmp(name, OPTION_TLS_KTLS) == 0)
+            )
+        {
+            result = malloc(sizeof(int));
+            if (result == NULL)
+            {
+                LogError("unable to clone the %s option", name);
+            }
+            else
+            {
+                *(int*)result = *(const int*)value;
+            }
+        }
+        else if (
+            (strcmp(name, OPTION_TLS_CIPHER_LIST) == 0) ||
+            (strcmp(name, OPTION_TLS_CIPHERSUITES) == 0) ||
+            (strcmp(name, OPTION_TLS_GROUPS) == 0)
+            )
+        {
+            if (mallocAndStrcpy_s((char**)&result, value) != 0)
+            {
+                LogError("unable to mallocAndStrcpy_s the %s value", name);
+                result = NULL;
+            }
+        }
         else
         {
             LogError("not handled option : %s", name);
@@ -120,7 +210,7 @@ static void* tlsio_openssl_CloneOption(const char* name, const void* value)
 /*this function destroys an option previously created*/
 static void tlsio_openssl_DestroyOption(const char* name, const void* value)
 {
-    /*since all options for this layer are actually string copies., disposing of one is just calling free*/
+    /*all options for this layer are string, size_t or int copies, disposing of one is just calling free*/
     if (
         (name == NULL) || (value == NULL)
         )
@@ -132,7 +222,14 @@ static void tlsio_openssl_DestroyOption(const char* name, const void* value)
         if (
             (strcmp(name, "TrustedCerts") == 0) ||
             (strcmp(name, "x509certificate") == 0) ||
-            (strcmp(name, "x509privatekey") == 0)
+            (strcmp(name, "x509privatekey") == 0) ||
+            (strcmp(name, OPTION_TLS_RECEIVE_BUFFER_SIZE) == 0) ||
+            (strcmp(name, OPTION_TLS_MIN_VERSION) == 0) ||
+            (strcmp(name, OPTION_TLS_MAX_VERSION) == 0) ||
+            (strcmp(name, OPTION_TLS_KTLS) == 0) ||
+            (strcmp(name, OPTION_TLS_CIPHER_LIST) == 0) ||
+            (strcmp(name, OPTION_TLS_CIPHERSUITES) == 0) ||
+            (strcmp(name, OPTION_TLS_GROUPS) == 0)
         )
         {
             free((void*)value);
@@ -191,6 +288,69 @@ static OPTIONHANDLER_HANDLE tlsio_openssl_retrieveoptions(CONCRETE_IO_HANDLE han
                 OptionHandler_Destroy(result);
                 result = NULL;
             }
+            else if (
+                (tls_io_instance->receive_buffer_size != TLSIO_OPENSSL_DEFAULT_RECEIVE_BUFFER_SIZE) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_RECEIVE_BUFFER_SIZE, &tls_io_instance->receive_buffer_size) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_RECEIVE_BUFFER_SIZE);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_min_version != TLSIO_VERSION_DEFAULT) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_MIN_VERSION, &tls_io_instance->tls_min_version) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_MIN_VERSION);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_max_version != TLSIO_VERSION_DEFAULT) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_MAX_VERSION, &tls_io_instance->tls_max_version) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_MAX_VERSION);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_cipher_list != NULL) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_CIPHER_LIST, tls_io_instance->tls_cipher_list) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_CIPHER_LIST);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_ciphersuites != NULL) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_CIPHERSUITES, tls_io_instance->tls_ciphersuites) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_CIPHERSUITES);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->tls_groups != NULL) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_GROUPS, tls_io_instance->tls_groups) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_GROUPS);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                (tls_io_instance->ktls_requested != 0) &&
+                (OptionHandler_AddOption(result, OPTION_TLS_KTLS, &tls_io_instance->ktls_requested) != 0)
+                )
+            {
+                LogError("unable to save the %s option", OPTION_TLS_KTLS);
+                OptionHandler_Destroy(result);
+                result = NULL;
+            }
             else
             {
                 /*all is fine, all interesting options have been saved*/
@@ -210,7 +370,26 @@ static const IO_INTERFACE_DESCRIPTION tlsio_openssl_interface_description =
     tlsio_openssl_close,
     tlsio_openssl_send,
     tlsio_openssl_dowork,
-    tlsio_openssl_setoption
+    tlsio_openssl_setoption,
+    NULL,
+    tlsio_openssl_get_statistics,
+    NULL
+};
+
+/* the same io created from a TLSIO_LAYERED_CONFIG */
+static const IO_INTERFACE_DESCRIPTION tlsio_openssl_layered_interface_description =
+{
+    tlsio_openssl_retrieveoptions,
+    tlsio_openssl_create_layered,
+    tlsio_openssl_destroy,
+    tlsio_openssl_open,
+    tlsio_openssl_close,
+    tlsio_openssl_send,
+    tlsio_openssl_dowork,
+    tlsio_openssl_setoption,
+    NULL,
+    tlsio_openssl_get_statistics,
+    NULL
 };
 
 static LOCK_HANDLE * openssl_locks = NULL;
@@ -265,7 +444,7 @@ static struct CRYPTO_dynlock_value* openssl_dynamic_locks_create_cb(const char*
     }
     else
     {
-        result->lock = Lock_Init();
+        result->lock = Lock_Init_Named("openssl_dynamic");
         if (result->lock == NULL)
         {
             LogError("Failed to create lock for dynamic lock (%s:%d).", file, line);
@@ -364,7 +543,9 @@ static int openssl_static_locks_install(void)
             int i;
             for(i = 0; i < CRYPTO_num_locks(); i++)
             {
-                openssl_locks[i] = Lock_Init();
+                char lock_name[32];
+                (void)snprintf(lock_name, sizeof(lock_name), "openssl_static_%d", i);
+                openssl_locks[i] = Lock_Init_Named(lock_name);
                 if (openssl_locks[i] == NULL)
                 {
                     LogError("Failed to allocate lock %d", i);
@@ -394,6 +575,7 @@ static int openssl_static_locks_install(void)
 
 static void indicate_error(TLS_IO_INSTANCE* tls_io_instance)
 {
+    tls_io_instance->statistics.io_error_count++;
     if (tls_io_instance->on_io_error == NULL)
     {
         LogError("NULL on_io_error.");
@@ -416,188 +598,709 @@ static void indicate_open_complete(TLS_IO_INSTANCE* tls_io_instance, IO_OPEN_RES
     }
 }
 
-static int write_outgoing_bytes(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+typedef struct TLSIO_SESSION_CACHE_ENTRY_TAG
 {
-    int result;
+    char* hostname;
+    int port;
+    /* a session is only offered by instances that trust and present the same certificates as the one that stored it */
+    char* certificate;
+    char* x509certificate;
+    SSL_SESSION* session;
+    /* times of session_cache_tick_counter, the TTL counts from the store and the eviction picks the least recently
+       used entry */
+    uint64_t stored_us;
+    uint64_t last_used_us;
+} TLSIO_SESSION_CACHE_ENTRY;
+
+static LOCK_HANDLE session_cache_lock = NULL;
+/* monotonic, a change of the wall clock does not expire the cached sessions or keep them forever */
+static TICK_COUNTER_HANDLE session_cache_tick_counter = NULL;
+static TLSIO_SESSION_CACHE_ENTRY* session_cache_entries = NULL;
+static size_t session_cache_count = 0;
+static size_t session_cache_max_sessions = TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_SIZE;
+static uint32_t session_cache_ttl_seconds = TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_TTL_SECONDS;
+static TLSIO_OPENSSL_SESSION_CACHE_STATISTICS session_cache_statistics;
+
+static bool are_strings_equal(const char* left, const char* right)
+{
+    return ((left == NULL) && (right == NULL)) ||
+        ((left != NULL) && (right != NULL) && (strcmp(left, right) == 0));
+}
+
+static bool is_session_cache_entry_for(const TLSIO_SESSION_CACHE_ENTRY* entry, const TLS_IO_INSTANCE* tls_io_instance)
+{
+    return (entry->port == tls_io_instance->port) &&
+        are_strings_equal(entry->hostname, tls_io_instance->hostname) &&
+        are_strings_equal(entry->certificate, tls_io_instance->certificate) &&
+        are_strings_equal(entry->x509certificate, tls_io_instance->x509certificate);
+}
 
-    int pending = BIO_ctrl_pending(tls_io_instance->out_bio);
-    if (pending <= 0)
+static void free_session_cache_entry(TLSIO_SESSION_CACHE_ENTRY* entry)
+{
+    SSL_SESSION_free(entry->session);
+    free(entry->hostname);
+    free(entry->certificate);
+    free(entry->x509certificate);
+}
+
+static uint64_t get_session_cache_time_us(void)
+{
+    uint64_t result;
+
+    if (tickcounter_get_current_us(session_cache_tick_counter, &result) != 0)
     {
         result = 0;
     }
-    else
+
+    return result;
+}
+
+/* the caller holds session_cache_lock */
+static void remove_session_cache_entry(size_t index)
+{
+    free_session_cache_entry(&session_cache_entries[index]);
+    session_cache_count--;
+    if (index != session_cache_count)
+    {
+        session_cache_entries[index] = session_cache_entries[session_cache_count];
+    }
+}
+
+/* the caller holds session_cache_lock */
+static void clear_session_cache(void)
+{
+    while (session_cache_count > 0)
     {
-        unsigned char* bytes_to_send = malloc(pending);
-        if (bytes_to_send == NULL)
+        remove_session_cache_entry(session_cache_count - 1);
+    }
+}
+
+/* the caller holds session_cache_lock, returns the index of the live entry or session_cache_count */
+static size_t find_session_cache_entry(const TLS_IO_INSTANCE* tls_io_instance)
+{
+    size_t index = 0;
+    uint64_t now_us = get_session_cache_time_us();
+
+    while (index < session_cache_count)
+    {
+        if (now_us - session_cache_entries[index].stored_us > (uint64_t)session_cache_ttl_seconds * 1000000)
         {
-            result = __LINE__;
-            LogError("NULL bytes_to_send.");
+            remove_session_cache_entry(index);
+            session_cache_statistics.sessions_evicted++;
+        }
+        else if (is_session_cache_entry_for(&session_cache_entries[index], tls_io_instance))
+        {
+            break;
         }
         else
         {
-            if (BIO_read(tls_io_instance->out_bio, bytes_to_send, pending) != pending)
+            index++;
+        }
+    }
+
+    return index;
+}
+
+/* offers the session cached for the endpoint of the instance, if any, to its next handshake */
+static void resume_cached_session(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if ((session_cache_lock != NULL) &&
+        (Lock(session_cache_lock) == LOCK_OK))
+    {
+        size_t index = find_session_cache_entry(tls_io_instance);
+        if (index < session_cache_count)
+        {
+            if (SSL_set_session(tls_io_instance->ssl, session_cache_entries[index].session) != 1)
             {
-                result = __LINE__;
-                log_ERR_get_error("BIO_read not in pending state.");
+                log_ERR_get_error("Failed calling SSL_set_session.");
             }
             else
             {
-                if (xio_send(tls_io_instance->underlying_io, bytes_to_send, pending, on_send_complete, callback_context) != 0)
-                {
-                    result = __LINE__;
-                    LogError("Error in xio_send.");
-                }
-                else
-                {
-                    result = 0;
-                }
+                session_cache_entries[index].last_used_us = get_session_cache_time_us();
+                session_cache_statistics.sessions_offered++;
             }
-
-            free(bytes_to_send);
         }
-    }
 
-    return result;
+        (void)Unlock(session_cache_lock);
+    }
 }
 
-static int send_handshake_bytes(TLS_IO_INSTANCE* tls_io_instance)
+static int store_session(TLS_IO_INSTANCE* tls_io_instance, SSL_SESSION* session)
 {
     int result;
-    int r = 0;
-    int pending = 0;
 
-    if (SSL_is_init_finished(tls_io_instance->ssl))
+    if ((session_cache_lock == NULL) ||
+        (Lock(session_cache_lock) != LOCK_OK))
     {
-        tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-        indicate_open_complete(tls_io_instance, IO_OPEN_OK);
-        result = 0;
+        result = __LINE__;
     }
     else
     {
-        SSL_do_handshake(tls_io_instance->ssl);
-        if (SSL_is_init_finished(tls_io_instance->ssl))
+        size_t index = find_session_cache_entry(tls_io_instance);
+        if (index < session_cache_count)
         {
-            tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-            indicate_open_complete(tls_io_instance, IO_OPEN_OK);
+            /* a newer ticket for the same endpoint */
+            SSL_SESSION_free(session_cache_entries[index].session);
+            session_cache_entries[index].session = session;
+            session_cache_entries[index].stored_us = get_session_cache_time_us();
+            session_cache_entries[index].last_used_us = session_cache_entries[index].stored_us;
+            session_cache_statistics.sessions_stored++;
             result = 0;
         }
+        else if (session_cache_max_sessions == 0)
+        {
+            result = __LINE__;
+        }
+        else if ((session_cache_entries == NULL) &&
+            ((session_cache_entries = (TLSIO_SESSION_CACHE_ENTRY*)malloc(session_cache_max_sessions * sizeof(TLSIO_SESSION_CACHE_ENTRY))) == NULL))
+        {
+            LogError("Cannot allocate the session cache.");
+            result = __LINE__;
+        }
         else
         {
-            if (write_outgoing_bytes(tls_io_instance, NULL, NULL) != 0)
+            TLSIO_SESSION_CACHE_ENTRY entry;
+
+            memset(&entry, 0, sizeof(entry));
+            entry.port = tls_io_instance->port;
+
+            if ((mallocAndStrcpy_s(&entry.hostname, tls_io_instance->hostname) != 0) ||
+                ((tls_io_instance->certificate != NULL) && (mallocAndStrcpy_s(&entry.certificate, tls_io_instance->certificate) != 0)) ||
+                ((tls_io_instance->x509certificate != NULL) && (mallocAndStrcpy_s(&entry.x509certificate, tls_io_instance->x509certificate) != 0)))
             {
+                free(entry.hostname);
+                free(entry.certificate);
+                free(entry.x509certificate);
+                LogError("Cannot allocate the session cache entry.");
                 result = __LINE__;
-                LogError("Error in write_outgoing_bytes.");
             }
             else
             {
-                if (SSL_is_init_finished(tls_io_instance->ssl))
+                if (session_cache_count == session_cache_max_sessions)
                 {
-                    tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
-                    indicate_open_complete(tls_io_instance, IO_OPEN_OK);
+                    /* evict the least recently used session */
+                    size_t least_recently_used = 0;
+                    size_t i;
+                    for (i = 1; i < session_cache_count; i++)
+                    {
+                        if (session_cache_entries[i].last_used_us < session_cache_entries[least_recently_used].last_used_us)
+                        {
+                            least_recently_used = i;
+                        }
+                    }
+
+                    remove_session_cache_entry(least_recently_used);
+                    session_cache_statistics.sessions_evicted++;
                 }
 
+                entry.session = session;
+                entry.stored_us = get_session_cache_time_us();
+                entry.last_used_us = entry.stored_us;
+                session_cache_entries[session_cache_count++] = entry;
+                session_cache_statistics.sessions_stored++;
                 result = 0;
             }
         }
+
+        (void)Unlock(session_cache_lock);
     }
 
     return result;
 }
 
-static void on_underlying_io_close_complete(void* context)
+/* new_session_cb of the SSL_CTX, called when the handshake completes and for every TLS 1.3 ticket received afterwards */
+static int on_new_session(SSL* ssl, SSL_SESSION* session)
 {
-    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+    int result;
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)SSL_get_app_data(ssl);
 
-    switch (tls_io_instance->tlsio_state)
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+    if ((tls_io_instance == NULL) ||
+        (SSL_SESSION_is_resumable(session) != 1))
+#else
+    if (tls_io_instance == NULL)
+#endif
     {
-        default:
-        case TLSIO_STATE_NOT_OPEN:
-        case TLSIO_STATE_OPEN:
-            break;
+        result = 0;
+    }
+    else
+    {
+        /* 1 keeps the reference OpenSSL passed in */
+        result = (store_session(tls_io_instance, session) == 0) ? 1 : 0;
+    }
 
-        case TLSIO_STATE_OPENING_UNDERLYING_IO:
-        case TLSIO_STATE_IN_HANDSHAKE:
-            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
-            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
-            break;
+    return result;
+}
 
-        case TLSIO_STATE_CLOSING:
-            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
+/* the records written by OpenSSL go to out_bio and through the underlying io again */
+static int attach_memory_bio(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+    BIO* out_bio = BIO_new(BIO_s_mem());
 
-            if (tls_io_instance->on_io_close_complete != NULL)
-            {
-                tls_io_instance->on_io_close_complete(tls_io_instance->on_io_close_complete_context);
-            }
-            break;
+    if ((out_bio == NULL) ||
+        (BIO_set_mem_eof_return(out_bio, -1) <= 0))
+    {
+        (void)BIO_free(out_bio);
+        log_ERR_get_error("Failed BIO_new for out BIO.");
+        result = __LINE__;
+    }
+    else
+    {
+        /* frees the socket BIO, a record OpenSSL could not finish writing to it goes to out_bio on the next call */
+        SSL_set0_wbio(tls_io_instance->ssl, out_bio);
+        tls_io_instance->out_bio = out_bio;
+        result = 0;
     }
+
+    return result;
 }
 
-static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_result)
+/* OpenSSL only programs the kernel with the traffic keys when it writes to a socket BIO, so in kTLS mode the
+   handshake is written to the socket of the underlying io directly. The received bytes still go through the
+   underlying io and the input memory BIO: kTLS receive would need the record type of every recvmsg. */
+static void attach_socket_bio(TLS_IO_INSTANCE* tls_io_instance)
 {
-    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+#ifdef TLSIO_OPENSSL_KTLS
+    intptr_t socket_handle;
+    BIO* socket_bio;
+    XIO_STATISTICS underlying_statistics;
 
-    if (tls_io_instance->tlsio_state == TLSIO_STATE_OPENING_UNDERLYING_IO)
+    if (xio_get_socket(tls_io_instance->underlying_io, &socket_handle) != 0)
     {
-        if (open_result == IO_OPEN_OK)
-        {
-            tls_io_instance->tlsio_state = TLSIO_STATE_IN_HANDSHAKE;
-
-            if (send_handshake_bytes(tls_io_instance) != 0)
-            {
-                if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
-                {
-                    indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
-                    LogError("Error in xio_close.");
-                }
-            }
-        }
-        else
-        {
-            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
-            LogError("Invalid tlsio_state. Expected state is TLSIO_STATE_OPENING_UNDERLYING_IO.");
-        }
+        LogInfo("The underlying io does not expose its socket, kTLS is not used.");
     }
+    else if ((xio_get_statistics(tls_io_instance->underlying_io, &underlying_statistics) != 0) ||
+        (underlying_statistics.pending_send_bytes > 0))
+    {
+        /* a direct write would overtake the bytes queued by the underlying io */
+        LogInfo("The underlying io has queued bytes, kTLS is not used.");
+    }
+    else if ((socket_bio = BIO_new_socket((int)socket_handle, BIO_NOCLOSE)) == NULL)
+    {
+        log_ERR_get_error("Failed calling BIO_new_socket, kTLS is not used.");
+    }
+    else
+    {
+        /* frees the output memory BIO */
+        SSL_set0_wbio(tls_io_instance->ssl, socket_bio);
+        tls_io_instance->out_bio = NULL;
+    }
+#else
+    (void)tls_io_instance;
+    LogInfo("kTLS is not enabled in this build (use_ktls) or not supported by this platform or OpenSSL build.");
+#endif
 }
 
-static void on_underlying_io_error(void* context)
+/* after the handshake either the kernel encrypts the socket writes, or the connection goes back to the memory BIO */
+static int complete_ktls_setup(TLS_IO_INSTANCE* tls_io_instance)
 {
-    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+    int result;
 
-    switch (tls_io_instance->tlsio_state)
+#ifdef TLSIO_OPENSSL_KTLS
+    if (tls_io_instance->out_bio != NULL)
     {
-        default:
-            break;
-
-        case TLSIO_STATE_OPENING_UNDERLYING_IO:
-        case TLSIO_STATE_IN_HANDSHAKE:
-            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
-            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
-            break;
-
-        case TLSIO_STATE_OPEN:
-            indicate_error(tls_io_instance);
-            break;
+        result = 0;
+    }
+    else if (BIO_get_ktls_send(SSL_get_wbio(tls_io_instance->ssl)))
+    {
+        tls_io_instance->is_ktls_send = true;
+        result = 0;
     }
+    else
+    {
+        LogInfo("kTLS is not available for this connection, the records are encrypted by OpenSSL.");
+        result = attach_memory_bio(tls_io_instance);
+    }
+#else
+    (void)tls_io_instance;
+    result = 0;
+#endif
+
+    return result;
 }
 
-static int decode_ssl_received_bytes(TLS_IO_INSTANCE* tls_io_instance)
+static uint64_t get_current_us(TLS_IO_INSTANCE* tls_io_instance)
 {
-    int result = 0;
-    unsigned char buffer[64];
+    uint64_t result;
 
-    int rcv_bytes = 1;
-    while (rcv_bytes > 0)
+    if (tickcounter_get_current_us(tls_io_instance->tick_counter, &result) != 0)
     {
-        rcv_bytes = SSL_read(tls_io_instance->ssl, buffer, sizeof(buffer));
-        if (rcv_bytes > 0)
-        {
+        result = 0;
+    }
+
+    return result;
+}
+
+static PENDING_SEND* create_pending_send(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    PENDING_SEND* result = (PENDING_SEND*)malloc(sizeof(PENDING_SEND));
+    if (result == NULL)
+    {
+        LogError("Cannot allocate memory for the pending send.");
+    }
+    else
+    {
+        result->tls_io_instance = tls_io_instance;
+        result->on_send_complete = on_send_complete;
+        result->callback_context = callback_context;
+        result->send_time_us = get_current_us(tls_io_instance);
+        DList_InsertTailList(&tls_io_instance->pending_sends, &result->entry);
+    }
+
+    return result;
+}
+
+static void on_underlying_io_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    PENDING_SEND* pending_send = (PENDING_SEND*)context;
+    TLS_IO_INSTANCE* tls_io_instance = pending_send->tls_io_instance;
+
+    if (send_result == IO_SEND_OK)
+    {
+        uint64_t now = get_current_us(tls_io_instance);
+        xio_statistics_add_send_latency(&tls_io_instance->statistics, (now > pending_send->send_time_us) ? (now - pending_send->send_time_us) : 0);
+    }
+
+    (void)DList_RemoveEntryList(&pending_send->entry);
+    if (pending_send->on_send_complete != NULL)
+    {
+        pending_send->on_send_complete(pending_send->callback_context, send_result);
+    }
+
+    free(pending_send);
+}
+
+/* the underlying io drops the sends it has not completed when it is closed, and a failed send may not complete */
+static void free_pending_sends(TLS_IO_INSTANCE* tls_io_instance)
+{
+    while (!DList_IsListEmpty(&tls_io_instance->pending_sends))
+    {
+        free(containingRecord(DList_RemoveHeadList(&tls_io_instance->pending_sends), PENDING_SEND, entry));
+    }
+}
+
+/* only the first occurrence since the open is kept, at least 1 us after it as 0 means that the event did not happen */
+static void record_connection_event(TLS_IO_INSTANCE* tls_io_instance, uint64_t* event_us)
+{
+    if (*event_us == 0)
+    {
+        uint64_t now_us = get_current_us(tls_io_instance);
+        *event_us = (now_us > tls_io_instance->open_time_us) ? (now_us - tls_io_instance->open_time_us) : 1;
+    }
+}
+
+/* the BIOs are memory BIOs, the time spent in an OpenSSL call is the time spent encrypting and decrypting */
+static void add_processing_time(TLS_IO_INSTANCE* tls_io_instance, uint64_t start_us, uint64_t* processing_us)
+{
+    uint64_t now_us = get_current_us(tls_io_instance);
+
+    if (now_us > start_us)
+    {
+        *processing_us += now_us - start_us;
+    }
+}
+
+static void indicate_handshake_complete(TLS_IO_INSTANCE* tls_io_instance)
+{
+    record_connection_event(tls_io_instance, &tls_io_instance->statistics.handshake_complete_us);
+
+    if (complete_ktls_setup(tls_io_instance) != 0)
+    {
+        tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
+        indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+    }
+    else
+    {
+        tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
+
+        if ((session_cache_lock != NULL) &&
+            (Lock(session_cache_lock) == LOCK_OK))
+        {
+            session_cache_statistics.handshakes++;
+            if (SSL_session_reused(tls_io_instance->ssl))
+            {
+                session_cache_statistics.resumed_handshakes++;
+            }
+
+            (void)Unlock(session_cache_lock);
+        }
+
+        indicate_open_complete(tls_io_instance, IO_OPEN_OK);
+    }
+}
+
+/* a record is only encrypted when the underlying io accepts it, one refused after SSL_write would be lost */
+static bool is_underlying_send_queue_full(TLS_IO_INSTANCE* tls_io_instance)
+{
+    XIO_STATISTICS underlying_statistics;
+
+    return (tls_io_instance->send_high_watermark != 0) &&
+        (xio_get_statistics(tls_io_instance->underlying_io, &underlying_statistics) == 0) &&
+        (underlying_statistics.pending_send_bytes >= tls_io_instance->send_high_watermark);
+}
+
+/* records written by OpenSSL on its own (handshake, close_notify) that the underlying io did not accept yet */
+static bool has_kept_records(TLS_IO_INSTANCE* tls_io_instance)
+{
+    return (tls_io_instance->out_bio != NULL) &&
+        (BIO_ctrl_pending(tls_io_instance->out_bio) > 0);
+}
+
+/* the records are kept in out_bio while the underlying io refuses them and on_underlying_io_writable sends them
+   later. tlsio_openssl_send checks the queue before it encrypts, so only records without a callback are kept. */
+static int write_outgoing_bytes(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+    char* bytes_to_send;
+    long pending;
+
+    if (tls_io_instance->out_bio == NULL)
+    {
+        /* the records are written to the socket by OpenSSL, see attach_socket_bio */
+        result = 0;
+    }
+    /* hand the ciphertext to the underlying io straight from the memory BIO, the underlying io copies
+       only what it cannot send right away */
+    else if ((pending = BIO_get_mem_data(tls_io_instance->out_bio, &bytes_to_send)) <= 0)
+    {
+        result = 0;
+    }
+    else if (is_underlying_send_queue_full(tls_io_instance))
+    {
+        result = 0;
+    }
+    else
+    {
+        int send_result = xio_send(tls_io_instance->underlying_io, bytes_to_send, (size_t)pending, on_send_complete, callback_context);
+        if (send_result == XIO_SEND_WOULD_BLOCK)
+        {
+            result = 0;
+        }
+        else
+        {
+            if (send_result != 0)
+            {
+                result = __LINE__;
+                LogError("Error in xio_send.");
+            }
+            else
+            {
+                result = 0;
+            }
+
+            /* the bytes are consumed whether or not the send was accepted, as they were when they were read out of the BIO */
+            if (BIO_reset(tls_io_instance->out_bio) != 1)
+            {
+                result = __LINE__;
+                log_ERR_get_error("BIO_reset failed.");
+            }
+        }
+    }
+
+    return result;
+}
+
+static int send_handshake_bytes(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+    int r = 0;
+    int pending = 0;
+
+    if (SSL_is_init_finished(tls_io_instance->ssl))
+    {
+        indicate_handshake_complete(tls_io_instance);
+        result = 0;
+    }
+    else
+    {
+        uint64_t start_us = get_current_us(tls_io_instance);
+        int handshake_result = SSL_do_handshake(tls_io_instance->ssl);
+        /* only a socket BIO refuses a write, the memory BIO grows */
+        bool is_socket_write_refused = (handshake_result <= 0) &&
+            (SSL_get_error(tls_io_instance->ssl, handshake_result) == SSL_ERROR_WANT_WRITE) &&
+            (tls_io_instance->out_bio == NULL);
+
+        if (is_socket_write_refused)
+        {
+            /* nothing would wake the io loop once the socket drains, so the handshake goes back to the memory BIO
+               and the queue of the underlying io, without kTLS */
+            LogInfo("The socket refused a handshake record, kTLS is not used.");
+            if (attach_memory_bio(tls_io_instance) == 0)
+            {
+                (void)SSL_do_handshake(tls_io_instance->ssl);
+            }
+        }
+
+        add_processing_time(tls_io_instance, start_us, &tls_io_instance->statistics.handshake_processing_us);
+
+        if (is_socket_write_refused && (tls_io_instance->out_bio == NULL))
+        {
+            result = __LINE__;
+            LogError("Error in attach_memory_bio.");
+        }
+        /* flushed even when the handshake is complete, a TLS 1.3 client sends its Finished message last */
+        else if (write_outgoing_bytes(tls_io_instance, NULL, NULL) != 0)
+        {
+            result = __LINE__;
+            LogError("Error in write_outgoing_bytes.");
+        }
+        else
+        {
+            /* the first flight is the ClientHello */
+            record_connection_event(tls_io_instance, &tls_io_instance->statistics.handshake_started_us);
+
+            if (SSL_is_init_finished(tls_io_instance->ssl))
+            {
+                indicate_handshake_complete(tls_io_instance);
+            }
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static void on_underlying_io_close_complete(void* context)
+{
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+
+    free_pending_sends(tls_io_instance);
+
+    switch (tls_io_instance->tlsio_state)
+    {
+        default:
+        case TLSIO_STATE_NOT_OPEN:
+        case TLSIO_STATE_OPEN:
+            break;
+
+        case TLSIO_STATE_OPENING_UNDERLYING_IO:
+        case TLSIO_STATE_IN_HANDSHAKE:
+            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
+            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+            break;
+
+        case TLSIO_STATE_CLOSING:
+            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
+
+            if (tls_io_instance->on_io_close_complete != NULL)
+            {
+                tls_io_instance->on_io_close_complete(tls_io_instance->on_io_close_complete_context);
+            }
+            break;
+    }
+}
+
+/* the on_writable callback of the underlying io; the producer can send again once the kept records were accepted */
+static void on_underlying_io_writable(void* context)
+{
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+
+    if (write_outgoing_bytes(tls_io_instance, NULL, NULL) != 0)
+    {
+        LogError("Error in write_outgoing_bytes.");
+    }
+    else if ((tls_io_instance->tlsio_state == TLSIO_STATE_OPEN) &&
+        (!has_kept_records(tls_io_instance)) &&
+        (tls_io_instance->on_writable.on_writable != NULL))
+    {
+        tls_io_instance->on_writable.on_writable(tls_io_instance->on_writable.context);
+    }
+}
+
+static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+
+    if (tls_io_instance->tlsio_state == TLSIO_STATE_OPENING_UNDERLYING_IO)
+    {
+        if (open_result == IO_OPEN_OK)
+        {
+            tls_io_instance->tlsio_state = TLSIO_STATE_IN_HANDSHAKE;
+            record_connection_event(tls_io_instance, &tls_io_instance->statistics.connected_us);
+
+            if (tls_io_instance->ktls_requested != 0)
+            {
+                attach_socket_bio(tls_io_instance);
+            }
+
+            if (send_handshake_bytes(tls_io_instance) != 0)
+            {
+                if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+                {
+                    indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+                    LogError("Error in xio_close.");
+                }
+            }
+        }
+        else
+        {
+            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+            LogError("Invalid tlsio_state. Expected state is TLSIO_STATE_OPENING_UNDERLYING_IO.");
+        }
+    }
+}
+
+static void on_underlying_io_error(void* context)
+{
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+
+    switch (tls_io_instance->tlsio_state)
+    {
+        default:
+            break;
+
+        case TLSIO_STATE_OPENING_UNDERLYING_IO:
+        case TLSIO_STATE_IN_HANDSHAKE:
+            tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
+            indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
+            break;
+
+        case TLSIO_STATE_OPEN:
+            indicate_error(tls_io_instance);
+            break;
+
+        case TLSIO_STATE_SENDING_CLOSE_NOTIFY:
+            /* the close_notify cannot be sent any more, tlsio_openssl_dowork completes the close */
+            tls_io_instance->close_deadline_us = 0;
+            break;
+    }
+}
+
+static int decode_ssl_received_bytes(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result = 0;
+    int rcv_bytes = 1;
+
+    if (tls_io_instance->receive_buffer == NULL)
+    {
+        tls_io_instance->receive_buffer = (unsigned char*)malloc(tls_io_instance->receive_buffer_size);
+        if (tls_io_instance->receive_buffer == NULL)
+        {
+            LogError("Cannot allocate the %zu bytes receive buffer.", tls_io_instance->receive_buffer_size);
+            result = __LINE__;
+            rcv_bytes = 0;
+        }
+    }
+
+    while (rcv_bytes > 0)
+    {
+        uint64_t start_us = get_current_us(tls_io_instance);
+        rcv_bytes = SSL_read(tls_io_instance->ssl, tls_io_instance->receive_buffer, (int)tls_io_instance->receive_buffer_size);
+        add_processing_time(tls_io_instance, start_us, &tls_io_instance->statistics.receive_processing_us);
+        if (rcv_bytes > 0)
+        {
+            record_connection_event(tls_io_instance, &tls_io_instance->statistics.first_byte_received_us);
+            tls_io_instance->statistics.messages_received++;
+            tls_io_instance->statistics.bytes_received += (uint64_t)rcv_bytes;
             if (tls_io_instance->on_bytes_received == NULL)
             {
                 LogError("NULL on_bytes_received.");
             }
             else
             {
-                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, buffer, rcv_bytes);
+                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, tls_io_instance->receive_buffer, rcv_bytes);
             }
         }
     }
@@ -646,16 +1349,54 @@ static void on_underlying_io_bytes_received(void* context, const unsigned char*
     }
 }
 
-static void destroy_openssl_instance(TLS_IO_INSTANCE* tls_io_instance)
+/* an SSL_CTX holds the parsed trusted certificates, the default CA store, the x509 credentials and the protocol
+   configuration, so it is shared
+   by all the instances with the same TLS configuration instead of being built on every tlsio_openssl_open. A context
+   that is no longer used is kept for the next connection with the same configuration, until a context for another
+   configuration is created. */
+typedef struct TLSIO_SHARED_CONTEXT_TAG
 {
-    if (tls_io_instance != NULL)
-    {
-        SSL_free(tls_io_instance->ssl);
-        SSL_CTX_free(tls_io_instance->ssl_context);
-    }
+    char* certificate;
+    char* x509certificate;
+    char* x509privatekey;
+    int tls_min_version;
+    int tls_max_version;
+    char* tls_cipher_list;
+    char* tls_ciphersuites;
+    char* tls_groups;
+    SSL_CTX* ssl_context;
+    size_t ref_count;
+    struct TLSIO_SHARED_CONTEXT_TAG* next;
+} TLSIO_SHARED_CONTEXT;
+
+static LOCK_HANDLE shared_contexts_lock = NULL;
+static TLSIO_SHARED_CONTEXT* shared_contexts = NULL;
+
+static bool is_shared_context_for(const TLSIO_SHARED_CONTEXT* shared_context, const TLS_IO_INSTANCE* tls_io_instance)
+{
+    return are_strings_equal(shared_context->certificate, tls_io_instance->certificate) &&
+        are_strings_equal(shared_context->x509certificate, tls_io_instance->x509certificate) &&
+        are_strings_equal(shared_context->x509privatekey, tls_io_instance->x509privatekey) &&
+        (shared_context->tls_min_version == tls_io_instance->tls_min_version) &&
+        (shared_context->tls_max_version == tls_io_instance->tls_max_version) &&
+        are_strings_equal(shared_context->tls_cipher_list, tls_io_instance->tls_cipher_list) &&
+        are_strings_equal(shared_context->tls_ciphersuites, tls_io_instance->tls_ciphersuites) &&
+        are_strings_equal(shared_context->tls_groups, tls_io_instance->tls_groups);
 }
 
-static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char* certValue)
+static void free_shared_context(TLSIO_SHARED_CONTEXT* shared_context)
+{
+    SSL_CTX_free(shared_context->ssl_context);
+    free(shared_context->certificate);
+    free(shared_context->x509certificate);
+    free(shared_context->x509privatekey);
+    free(shared_context->tls_cipher_list);
+    free(shared_context->tls_ciphersuites);
+    free(shared_context->tls_groups);
+    free(shared_context);
+}
+
+static int add_certificate_to_store(SSL_CTX* ssl_context, const char* certValue)
 {
     int result = 0;
 
@@ -664,7 +1405,7 @@ static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char
         BIO* cert_memory_bio;
         X509* xcert;
 
-        X509_STORE* cert_store = SSL_CTX_get_cert_store(tls_io_instance->ssl_context);
+        X509_STORE* cert_store = SSL_CTX_get_cert_store(ssl_context);
         if (cert_store == NULL)
         {
             log_ERR_get_error("Failed calling SSL_CTX_get_cert_store.");
@@ -691,13 +1432,15 @@ static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char
                     if (X509_STORE_add_cert(cert_store, xcert) != 1)
                     {
                         log_ERR_get_error("Failed calling X509_STORE_add_cert.");
-                        X509_free(xcert);
                         result = __LINE__;
                     }
                     else
                     {
                         result = 0;
                     }
+
+                    /* the store keeps its own reference */
+                    X509_free(xcert);
                 }
                 BIO_free(cert_memory_bio);
             }
@@ -706,39 +1449,367 @@ static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance, const char
     return result;
 }
 
-static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
+static int set_protocol_versions(SSL_CTX* ssl_context, int min_version, int max_version)
 {
     int result;
 
-    tlsInstance->ssl_context = SSL_CTX_new(TLSv1_method());
-    if (tlsInstance->ssl_context == NULL)
+    /* SSL 2 and 3 are never negotiated, whatever the bounds */
+    (void)SSL_CTX_set_options(ssl_context, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    if ((min_version != TLSIO_VERSION_DEFAULT) &&
+        (SSL_CTX_set_min_proto_version(ssl_context, min_version) != 1))
+    {
+        log_ERR_get_error("Failed calling SSL_CTX_set_min_proto_version.");
+        result = __LINE__;
+    }
+    else if ((max_version != TLSIO_VERSION_DEFAULT) &&
+        (SSL_CTX_set_max_proto_version(ssl_context, max_version) != 1))
     {
+        log_ERR_get_error("Failed calling SSL_CTX_set_max_proto_version.");
         result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+#else
+    /* the version negotiating method of older OpenSSL versions is bounded with the SSL_OP_NO_* options */
+    if ((min_version > TLSIO_VERSION_1_2) ||
+        ((max_version != TLSIO_VERSION_DEFAULT) && (max_version < TLSIO_VERSION_1_0)))
+    {
+        LogError("TLS versions %x to %x are not supported by this OpenSSL version.", min_version, max_version);
+        result = __LINE__;
+    }
+    else
+    {
+        long options = 0;
+
+        if ((min_version > TLSIO_VERSION_1_0) || ((max_version != TLSIO_VERSION_DEFAULT) && (max_version < TLSIO_VERSION_1_0)))
+        {
+            options |= SSL_OP_NO_TLSv1;
+        }
+        if ((min_version > TLSIO_VERSION_1_1) || ((max_version != TLSIO_VERSION_DEFAULT) && (max_version < TLSIO_VERSION_1_1)))
+        {
+            options |= SSL_OP_NO_TLSv1_1;
+        }
+        if ((max_version != TLSIO_VERSION_DEFAULT) && (max_version < TLSIO_VERSION_1_2))
+        {
+            options |= SSL_OP_NO_TLSv1_2;
+        }
+
+        (void)SSL_CTX_set_options(ssl_context, options);
+        result = 0;
+    }
+#endif
+
+    return result;
+}
+
+static int set_cipher_configuration(SSL_CTX* ssl_context, const TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+
+    if ((tls_io_instance->tls_cipher_list != NULL) &&
+        (SSL_CTX_set_cipher_list(ssl_context, tls_io_instance->tls_cipher_list) != 1))
+    {
+        log_ERR_get_error("Failed calling SSL_CTX_set_cipher_list.");
+        result = __LINE__;
+    }
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+    else if ((tls_io_instance->tls_ciphersuites != NULL) &&
+        (SSL_CTX_set_ciphersuites(ssl_context, tls_io_instance->tls_ciphersuites) != 1))
+    {
+        log_ERR_get_error("Failed calling SSL_CTX_set_ciphersuites.");
+        result = __LINE__;
+    }
+    else if ((tls_io_instance->tls_groups != NULL) &&
+        (SSL_CTX_set1_groups_list(ssl_context, tls_io_instance->tls_groups) != 1))
+    {
+        log_ERR_get_error("Failed calling SSL_CTX_set1_groups_list.");
+        result = __LINE__;
+    }
+#else
+    else if (tls_io_instance->tls_ciphersuites != NULL)
+    {
+        LogError("TLS 1.3 ciphersuites need OpenSSL 1.1.1 or later.");
+        result = __LINE__;
+    }
+#if (OPENSSL_VERSION_NUMBER >= 0x10002000L)
+    else if ((tls_io_instance->tls_groups != NULL) &&
+        (SSL_CTX_set1_curves_list(ssl_context, tls_io_instance->tls_groups) != 1))
+    {
+        log_ERR_get_error("Failed calling SSL_CTX_set1_curves_list.");
+        result = __LINE__;
+    }
+#else
+    else if (tls_io_instance->tls_groups != NULL)
+    {
+        LogError("Key exchange groups need OpenSSL 1.0.2 or later.");
+        result = __LINE__;
+    }
+#endif
+#endif
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static SSL_CTX* create_ssl_context(const TLS_IO_INSTANCE* tls_io_instance)
+{
+    /* negotiate the highest version both ends support, within the bounds set with the options */
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    SSL_CTX* result = SSL_CTX_new(TLS_client_method());
+#else
+    SSL_CTX* result = SSL_CTX_new(SSLv23_client_method());
+#endif
+    if (result == NULL)
+    {
         log_ERR_get_error("Failed allocating OpenSSL context.");
     }
-    else if (add_certificate_to_store(tlsInstance, tlsInstance->certificate) != 0)
+    else if (
+        (set_protocol_versions(result, tls_io_instance->tls_min_version, tls_io_instance->tls_max_version) != 0) ||
+        (set_cipher_configuration(result, tls_io_instance) != 0)
+        )
+    {
+        SSL_CTX_free(result);
+        result = NULL;
+        LogError("unable to apply the TLS protocol configuration.");
+    }
+    else if (add_certificate_to_store(result, tls_io_instance->certificate) != 0)
     {
-        SSL_CTX_free(tlsInstance->ssl_context);
+        SSL_CTX_free(result);
+        result = NULL;
         log_ERR_get_error("unable to add_certificate_to_store.");
-        result = __LINE__;
     }
     /*x509 authentication can only be build before underlying connection is realized*/
-    else if(
-            (tlsInstance->x509certificate != NULL) &&
-            (tlsInstance->x509privatekey != NULL) &&
-            (x509_openssl_add_credentials(tlsInstance->ssl_context, tlsInstance->x509certificate, tlsInstance->x509privatekey) != 0)
+    else if (
+            (tls_io_instance->x509certificate != NULL) &&
+            (tls_io_instance->x509privatekey != NULL) &&
+            (x509_openssl_add_credentials(result, tls_io_instance->x509certificate, tls_io_instance->x509privatekey) != 0)
         )
+    {
+        SSL_CTX_free(result);
+        result = NULL;
+        log_ERR_get_error("unable to use x509 authentication");
+    }
+    else
+    {
+        SSL_CTX_set_verify(result, SSL_VERIFY_PEER, NULL);
+
+        /* the sessions are kept in the process wide cache rather than in the context */
+        (void)SSL_CTX_set_session_cache_mode(result, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(result, on_new_session);
+
+        // Specifies that the default locations for which CA certificates are loaded should be used.
+        if (SSL_CTX_set_default_verify_paths(result) != 1)
         {
-            SSL_CTX_free(tlsInstance->ssl_context);
-            log_ERR_get_error("unable to use x509 authentication");
-            result = __LINE__;
+            // This is only a warning to the user. They can still specify the certificate via SetOption.
+            LogInfo("WARNING: Unable to specify the default location for CA certificates on this platform.");
         }
+    }
+
+    return result;
+}
+
+/* the reference taken for an instance is dropped by release_ssl_context with SSL_CTX_free */
+static int add_ssl_context_reference(SSL_CTX* ssl_context)
+{
+    int result;
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    if (SSL_CTX_up_ref(ssl_context) != 1)
+    {
+        LogError("Failed to add a reference to the shared context.");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+#else
+    (void)CRYPTO_add(&ssl_context->references, 1, CRYPTO_LOCK_SSL_CTX);
+    result = 0;
+#endif
+
+    return result;
+}
+
+/* the caller holds shared_contexts_lock */
+static void remove_unused_shared_contexts(void)
+{
+    TLSIO_SHARED_CONTEXT** link = &shared_contexts;
+    while (*link != NULL)
+    {
+        if ((*link)->ref_count == 0)
+        {
+            TLSIO_SHARED_CONTEXT* shared_context = *link;
+            *link = shared_context->next;
+            free_shared_context(shared_context);
+        }
+        else
+        {
+            link = &(*link)->next;
+        }
+    }
+}
+
+/* returns the context shared by the instances with the same configuration, released with release_ssl_context.
+   The instance owns a reference of its own, so the context outlives the shared list freed by tlsio_openssl_deinit. */
+static SSL_CTX* acquire_ssl_context(const TLS_IO_INSTANCE* tls_io_instance)
+{
+    SSL_CTX* result;
+
+    if (shared_contexts_lock == NULL)
+    {
+        /* tlsio_openssl_init was not called, the context is not shared */
+        result = create_ssl_context(tls_io_instance);
+    }
+    else if (Lock(shared_contexts_lock) != LOCK_OK)
+    {
+        LogError("Failed to lock the shared contexts.");
+        result = NULL;
+    }
+    else
+    {
+        TLSIO_SHARED_CONTEXT* shared_context = shared_contexts;
+        while ((shared_context != NULL) &&
+            (!is_shared_context_for(shared_context, tls_io_instance)))
+        {
+            shared_context = shared_context->next;
+        }
+
+        if (shared_context != NULL)
+        {
+            if (add_ssl_context_reference(shared_context->ssl_context) != 0)
+            {
+                result = NULL;
+            }
+            else
+            {
+                shared_context->ref_count++;
+                result = shared_context->ssl_context;
+            }
+        }
+        else
+        {
+            remove_unused_shared_contexts();
+
+            shared_context = (TLSIO_SHARED_CONTEXT*)malloc(sizeof(TLSIO_SHARED_CONTEXT));
+            if (shared_context == NULL)
+            {
+                LogError("Failed allocating the shared context.");
+                result = NULL;
+            }
+            else
+            {
+                memset(shared_context, 0, sizeof(TLSIO_SHARED_CONTEXT));
+
+                shared_context->tls_min_version = tls_io_instance->tls_min_version;
+                shared_context->tls_max_version = tls_io_instance->tls_max_version;
+
+                if (((tls_io_instance->certificate != NULL) && (mallocAndStrcpy_s(&shared_context->certificate, tls_io_instance->certificate) != 0)) ||
+                    ((tls_io_instance->x509certificate != NULL) && (mallocAndStrcpy_s(&shared_context->x509certificate, tls_io_instance->x509certificate) != 0)) ||
+                    ((tls_io_instance->x509privatekey != NULL) && (mallocAndStrcpy_s(&shared_context->x509privatekey, tls_io_instance->x509privatekey) != 0)) ||
+                    ((tls_io_instance->tls_cipher_list != NULL) && (mallocAndStrcpy_s(&shared_context->tls_cipher_list, tls_io_instance->tls_cipher_list) != 0)) ||
+                    ((tls_io_instance->tls_ciphersuites != NULL) && (mallocAndStrcpy_s(&shared_context->tls_ciphersuites, tls_io_instance->tls_ciphersuites) != 0)) ||
+                    ((tls_io_instance->tls_groups != NULL) && (mallocAndStrcpy_s(&shared_context->tls_groups, tls_io_instance->tls_groups) != 0)) ||
+                    ((shared_context->ssl_context = create_ssl_context(tls_io_instance)) == NULL))
+                {
+                    LogError("Failed creating the shared context.");
+                    free_shared_context(shared_context);
+                    result = NULL;
+                }
+                else if (add_ssl_context_reference(shared_context->ssl_context) != 0)
+                {
+                    free_shared_context(shared_context);
+                    result = NULL;
+                }
+                else
+                {
+                    shared_context->ref_count = 1;
+                    shared_context->next = shared_contexts;
+                    shared_contexts = shared_context;
+                    result = shared_context->ssl_context;
+                }
+            }
+        }
+
+        (void)Unlock(shared_contexts_lock);
+    }
+
+    return result;
+}
+
+static void release_ssl_context(SSL_CTX* ssl_context)
+{
+    if (ssl_context != NULL)
+    {
+        if (shared_contexts_lock == NULL)
+        {
+            SSL_CTX_free(ssl_context);
+        }
+        else if (Lock(shared_contexts_lock) != LOCK_OK)
+        {
+            LogError("Failed to lock the shared contexts.");
+        }
+        else
+        {
+            TLSIO_SHARED_CONTEXT** link = &shared_contexts;
+            while ((*link != NULL) &&
+                ((*link)->ssl_context != ssl_context))
+            {
+                link = &(*link)->next;
+            }
+
+            if (*link != NULL)
+            {
+                /* kept with a ref_count of 0 until another configuration needs a context */
+                (*link)->ref_count--;
+            }
+
+            (void)Unlock(shared_contexts_lock);
+
+            /* the reference of the instance, or the context itself when it was created before tlsio_openssl_init */
+            SSL_CTX_free(ssl_context);
+        }
+    }
+}
+
+static void destroy_openssl_instance(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if (tls_io_instance != NULL)
+    {
+        /* frees the BIOs */
+        SSL_free(tls_io_instance->ssl);
+        tls_io_instance->ssl = NULL;
+        tls_io_instance->in_bio = NULL;
+        tls_io_instance->out_bio = NULL;
+        tls_io_instance->is_ktls_send = false;
+        release_ssl_context(tls_io_instance->ssl_context);
+        tls_io_instance->ssl_context = NULL;
+    }
+}
+
+static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
+{
+    int result;
+
+    tlsInstance->ssl_context = acquire_ssl_context(tlsInstance);
+    if (tlsInstance->ssl_context == NULL)
+    {
+        result = __LINE__;
+        LogError("Failed getting the OpenSSL context.");
+    }
     else
     {
         tlsInstance->in_bio = BIO_new(BIO_s_mem());
         if (tlsInstance->in_bio == NULL)
         {
-            SSL_CTX_free(tlsInstance->ssl_context);
+            release_ssl_context(tlsInstance->ssl_context);
             log_ERR_get_error("Failed BIO_new for in BIO.");
             result = __LINE__;
         }
@@ -748,65 +1819,46 @@ static int create_openssl_instance(TLS_IO_INSTANCE* tlsInstance)
             if (tlsInstance->out_bio == NULL)
             {
                 (void)BIO_free(tlsInstance->in_bio);
-                SSL_CTX_free(tlsInstance->ssl_context);
+                release_ssl_context(tlsInstance->ssl_context);
                 result = __LINE__;
                 log_ERR_get_error("Failed BIO_new for out BIO.");
             }
             else
             {
-                const IO_INTERFACE_DESCRIPTION* underlying_io_interface = socketio_get_interface_description();
-                if (underlying_io_interface == NULL)
+                if ((BIO_set_mem_eof_return(tlsInstance->in_bio, -1) <= 0) ||
+                    (BIO_set_mem_eof_return(tlsInstance->out_bio, -1) <= 0))
                 {
                     (void)BIO_free(tlsInstance->in_bio);
                     (void)BIO_free(tlsInstance->out_bio);
-                    SSL_CTX_free(tlsInstance->ssl_context);
+                    release_ssl_context(tlsInstance->ssl_context);
                     result = __LINE__;
-                    LogError("Failed getting socket IO interface description.");
+                    log_ERR_get_error("Failed BIO_set_mem_eof_return.");
                 }
                 else
                 {
-                    SOCKETIO_CONFIG socketio_config;
-                    socketio_config.hostname = tlsInstance->hostname;
-                    socketio_config.port = tlsInstance->port;
-                    socketio_config.accepted_socket = NULL;
-
-                    tlsInstance->underlying_io = xio_create(underlying_io_interface, &socketio_config);
-                    if ((tlsInstance->underlying_io == NULL) ||
-                        (BIO_set_mem_eof_return(tlsInstance->in_bio, -1) <= 0) ||
-                        (BIO_set_mem_eof_return(tlsInstance->out_bio, -1) <= 0))
+                    tlsInstance->ssl = SSL_new(tlsInstance->ssl_context);
+                    if (tlsInstance->ssl == NULL)
                     {
                         (void)BIO_free(tlsInstance->in_bio);
                         (void)BIO_free(tlsInstance->out_bio);
-                        SSL_CTX_free(tlsInstance->ssl_context);
-                        result = __LINE__;
-                        LogError("Failed xio_create.");
-                    }
-                    else
-                    {
-                        SSL_CTX_set_verify(tlsInstance->ssl_context, SSL_VERIFY_PEER, NULL);
-
-                        // Specifies that the default locations for which CA certificates are loaded should be used.
-                        if (SSL_CTX_set_default_verify_paths(tlsInstance->ssl_context) != 1)
-                        {
-                            // This is only a warning to the user. They can still specify the certificate via SetOption.
-                            LogInfo("WARNING: Unable to specify the default location for CA certificates on this platform.");
-                        }
-
-                        tlsInstance->ssl = SSL_new(tlsInstance->ssl_context);
-                        if (tlsInstance->ssl == NULL)
-                        {
-                            (void)BIO_free(tlsInstance->in_bio);
-                            (void)BIO_free(tlsInstance->out_bio);
-                            SSL_CTX_free(tlsInstance->ssl_context);
-                            log_ERR_get_error("Failed creating OpenSSL instance.");
-                            result = __LINE__;
-                        }
-                        else
+                        release_ssl_context(tlsInstance->ssl_context);
+                        log_ERR_get_error("Failed creating OpenSSL instance.");
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        SSL_set_bio(tlsInstance->ssl, tlsInstance->in_bio, tlsInstance->out_bio);
+                        SSL_set_connect_state(tlsInstance->ssl);
+                        (void)SSL_set_app_data(tlsInstance->ssl, tlsInstance);
+                        resume_cached_session(tlsInstance);
+#ifdef TLSIO_OPENSSL_KTLS
+                        if (tlsInstance->ktls_requested != 0)
                         {
-                            SSL_set_bio(tlsInstance->ssl, tlsInstance->in_bio, tlsInstance->out_bio);
-                            SSL_set_connect_state(tlsInstance->ssl);
-                            result = 0;
+                            (void)SSL_set_options(tlsInstance->ssl, SSL_OP_ENABLE_KTLS);
                         }
+#endif
+                        tlsInstance->is_ktls_send = false;
+                        result = 0;
                     }
                 }
             }
@@ -830,20 +1882,66 @@ int tlsio_openssl_init(void)
     }
 
     openssl_dynamic_locks_install();
+
+    if (session_cache_lock == NULL)
+    {
+        if ((session_cache_tick_counter = tickcounter_create()) == NULL)
+        {
+            LogError("Failed to create the session cache tick counter, sessions will not be resumed.");
+        }
+        else if ((session_cache_lock = Lock_Init()) == NULL)
+        {
+            LogError("Failed to create the session cache lock, sessions will not be resumed.");
+            tickcounter_destroy(session_cache_tick_counter);
+            session_cache_tick_counter = NULL;
+        }
+    }
+
+    if ((shared_contexts_lock == NULL) &&
+        ((shared_contexts_lock = Lock_Init()) == NULL))
+    {
+        LogError("Failed to create the shared contexts lock, every connection will build its own context.");
+    }
+
     return 0;
 }
 
 void tlsio_openssl_deinit(void)
 {
+    if (shared_contexts_lock != NULL)
+    {
+        /* this drops the reference of the list only, the instances still alive release their own in release_ssl_context */
+        while (shared_contexts != NULL)
+        {
+            TLSIO_SHARED_CONTEXT* shared_context = shared_contexts;
+            shared_contexts = shared_context->next;
+            free_shared_context(shared_context);
+        }
+
+        (void)Lock_Deinit(shared_contexts_lock);
+        shared_contexts_lock = NULL;
+    }
+
+    if (session_cache_lock != NULL)
+    {
+        clear_session_cache();
+        free(session_cache_entries);
+        session_cache_entries = NULL;
+        (void)Lock_Deinit(session_cache_lock);
+        session_cache_lock = NULL;
+        tickcounter_destroy(session_cache_tick_counter);
+        session_cache_tick_counter = NULL;
+    }
+
     openssl_dynamic_locks_uninstall();
     openssl_static_locks_uninstall();
 
     ERR_free_strings();
 }
 
-CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters)
+/* underlying_io_interface NULL means a socketio connected to hostname:port */
+static TLS_IO_INSTANCE* create_tls_io_instance(const TLSIO_CONFIG* tls_io_config, const IO_INTERFACE_DESCRIPTION* underlying_io_interface, void* underlying_io_parameters)
 {
-    TLSIO_CONFIG* tls_io_config = io_create_parameters;
     TLS_IO_INSTANCE* result;
 
     if (tls_io_config == NULL)
@@ -886,12 +1984,93 @@ CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters)
 
             result->x509certificate = NULL;
             result->x509privatekey = NULL;
+
+            result->receive_buffer = NULL;
+            result->receive_buffer_size = TLSIO_OPENSSL_DEFAULT_RECEIVE_BUFFER_SIZE;
+
+            result->tls_min_version = TLSIO_VERSION_DEFAULT;
+            result->tls_max_version = TLSIO_VERSION_DEFAULT;
+            result->tls_cipher_list = NULL;
+            result->tls_ciphersuites = NULL;
+            result->tls_groups = NULL;
+
+            result->ktls_requested = 0;
+            result->is_ktls_send = false;
+            DList_InitializeListHead(&result->pending_sends);
+
+            result->tick_counter = tickcounter_create();
+            if (result->tick_counter == NULL)
+            {
+                LogError("Failed creating the tick counter.");
+                free(result->hostname);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                SOCKETIO_CONFIG socketio_config;
+
+                if (underlying_io_interface == NULL)
+                {
+                    socketio_config.hostname = result->hostname;
+                    socketio_config.port = result->port;
+                    socketio_config.accepted_socket = NULL;
+
+                    underlying_io_interface = socketio_get_interface_description();
+                    underlying_io_parameters = &socketio_config;
+                }
+
+                if (underlying_io_interface == NULL)
+                {
+                    LogError("Failed getting socket IO interface description.");
+                    tickcounter_destroy(result->tick_counter);
+                    free(result->hostname);
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    result->underlying_io = xio_create(underlying_io_interface, underlying_io_parameters);
+                    if (result->underlying_io == NULL)
+                    {
+                        LogError("Failed xio_create.");
+                        tickcounter_destroy(result->tick_counter);
+                        free(result->hostname);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+            }
         }
     }
 
     return result;
 }
 
+CONCRETE_IO_HANDLE tlsio_openssl_create(void* io_create_parameters)
+{
+    return create_tls_io_instance((const TLSIO_CONFIG*)io_create_parameters, NULL, NULL);
+}
+
+CONCRETE_IO_HANDLE tlsio_openssl_create_layered(void* io_create_parameters)
+{
+    const TLSIO_LAYERED_CONFIG* tls_io_layered_config = (const TLSIO_LAYERED_CONFIG*)io_create_parameters;
+    TLS_IO_INSTANCE* result;
+
+    if ((tls_io_layered_config == NULL) ||
+        (tls_io_layered_config->underlying_io_interface == NULL))
+    {
+        result = NULL;
+        LogError("NULL tls_io_layered_config or underlying_io_interface.");
+    }
+    else
+    {
+        result = create_tls_io_instance(&tls_io_layered_config->tls_config, tls_io_layered_config->underlying_io_interface, tls_io_layered_config->underlying_io_parameters);
+    }
+
+    return result;
+}
+
 void tlsio_openssl_destroy(CONCRETE_IO_HANDLE tls_io)
 {
     if (tls_io == NULL)
@@ -909,7 +2088,19 @@ void tlsio_openssl_destroy(CONCRETE_IO_HANDLE tls_io)
         free(tls_io_instance->hostname);
         free((void*)tls_io_instance->x509certificate);
         free((void*)tls_io_instance->x509privatekey);
+        free(tls_io_instance->receive_buffer);
+        free(tls_io_instance->tls_cipher_list);
+        free(tls_io_instance->tls_ciphersuites);
+        free(tls_io_instance->tls_groups);
+        if (tls_io_instance->ssl != NULL)
+        {
+            /* a close still waiting for the close_notify has not freed the connection */
+            destroy_openssl_instance(tls_io_instance);
+        }
+        /* the underlying io may still complete sends while it is destroyed */
         xio_destroy(tls_io_instance->underlying_io);
+        free_pending_sends(tls_io_instance);
+        tickcounter_destroy(tls_io_instance->tick_counter);
         free(tls_io);
     }
 }
@@ -943,6 +2134,12 @@ int tlsio_openssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open
             tls_io_instance->on_io_error = on_io_error;
             tls_io_instance->on_io_error_context = on_io_error_context;
 
+            tls_io_instance->open_time_us = get_current_us(tls_io_instance);
+            tls_io_instance->statistics.connected_us = 0;
+            tls_io_instance->statistics.handshake_started_us = 0;
+            tls_io_instance->statistics.handshake_complete_us = 0;
+            tls_io_instance->statistics.first_byte_received_us = 0;
+
             tls_io_instance->tlsio_state = TLSIO_STATE_OPENING_UNDERLYING_IO;
 
             if (create_openssl_instance(tls_io_instance) != 0)
@@ -965,6 +2162,84 @@ int tlsio_openssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open
     return result;
 }
 
+static int close_underlying_io(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+
+    tls_io_instance->tlsio_state = TLSIO_STATE_CLOSING;
+
+    if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+    {
+        result = __LINE__;
+        tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
+        LogError("Error in xio_close.");
+    }
+    else
+    {
+        destroy_openssl_instance(tls_io_instance);
+        result = 0;
+    }
+
+    return result;
+}
+
+/* returns true once the close_notify was accepted by the underlying io, or written to the socket in kTLS send mode */
+static bool send_close_notify(TLS_IO_INSTANCE* tls_io_instance)
+{
+    bool result;
+    XIO_STATISTICS underlying_statistics;
+
+    if ((!tls_io_instance->is_ktls_send) &&
+        ((SSL_get_shutdown(tls_io_instance->ssl) & SSL_SENT_SHUTDOWN) != 0))
+    {
+        /* already in out_bio, on_underlying_io_writable sends it */
+        result = !has_kept_records(tls_io_instance);
+    }
+    else if ((tls_io_instance->is_ktls_send) &&
+        (xio_get_statistics(tls_io_instance->underlying_io, &underlying_statistics) == 0) &&
+        (underlying_statistics.pending_send_bytes > 0))
+    {
+        /* OpenSSL writes the close_notify to the socket directly, it would overtake the plaintext still queued */
+        result = false;
+    }
+    else
+    {
+        /* OpenSSL does not resume the session of a connection freed without close_notify */
+        int shutdown_result = SSL_shutdown(tls_io_instance->ssl);
+        if ((shutdown_result < 0) &&
+            (SSL_get_error(tls_io_instance->ssl, shutdown_result) == SSL_ERROR_WANT_WRITE))
+        {
+            /* the socket is full (kTLS), the alert stays in OpenSSL until the next SSL_shutdown */
+            result = false;
+        }
+        else if (write_outgoing_bytes(tls_io_instance, NULL, NULL) != 0)
+        {
+            LogError("Error in write_outgoing_bytes.");
+            result = true;
+        }
+        else
+        {
+            result = !has_kept_records(tls_io_instance);
+        }
+    }
+
+    return result;
+}
+
+/* called by tlsio_openssl_dowork, outside of the callbacks of the underlying io */
+static void close_when_close_notify_sent(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if ((get_current_us(tls_io_instance) < tls_io_instance->close_deadline_us) &&
+        (!send_close_notify(tls_io_instance)))
+    {
+        /* retried on the next tlsio_openssl_dowork */
+    }
+    else if (close_underlying_io(tls_io_instance) != 0)
+    {
+        LogError("Error in close_underlying_io.");
+    }
+}
+
 int tlsio_openssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context)
 {
     int result = 0;
@@ -979,6 +2254,7 @@ int tlsio_openssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_cl
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
 
         if ((tls_io_instance->tlsio_state == TLSIO_STATE_NOT_OPEN) ||
+            (tls_io_instance->tlsio_state == TLSIO_STATE_SENDING_CLOSE_NOTIFY) ||
             (tls_io_instance->tlsio_state == TLSIO_STATE_CLOSING))
         {
             result = __LINE__;
@@ -986,20 +2262,20 @@ int tlsio_openssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_cl
         }
         else
         {
-            tls_io_instance->tlsio_state = TLSIO_STATE_CLOSING;
             tls_io_instance->on_io_close_complete = on_io_close_complete;
             tls_io_instance->on_io_close_complete_context = callback_context;
 
-            if (xio_close(tls_io_instance->underlying_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+            if ((tls_io_instance->tlsio_state == TLSIO_STATE_OPEN) &&
+                (!send_close_notify(tls_io_instance)))
             {
-                result = __LINE__;
-                tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
-                LogError("Error in xio_close.");
+                /* the close completes in tlsio_openssl_dowork once the close_notify was sent */
+                tls_io_instance->tlsio_state = TLSIO_STATE_SENDING_CLOSE_NOTIFY;
+                tls_io_instance->close_deadline_us = get_current_us(tls_io_instance) + TLSIO_OPENSSL_CLOSE_TIMEOUT_US;
+                result = 0;
             }
             else
             {
-                destroy_openssl_instance(tls_io_instance);
-                result = 0;
+                result = close_underlying_io(tls_io_instance);
             }
         }
     }
@@ -1025,26 +2301,67 @@ int tlsio_openssl_send(CONCRETE_IO_HANDLE tls_io, const void* buffer, size_t siz
             result = __LINE__;
             LogError("Invalid tlsio_state. Expected state is TLSIO_STATE_OPEN.");
         }
+        else if ((is_underlying_send_queue_full(tls_io_instance)) ||
+            (has_kept_records(tls_io_instance)))
+        {
+            /* on_underlying_io_writable sends the kept records and then calls the on_writable callback set with OPTION_ON_WRITABLE */
+            result = XIO_SEND_WOULD_BLOCK;
+        }
         else
         {
-            int res = SSL_write(tls_io_instance->ssl, buffer, size);
-            if (res != size)
+            /* on failure it stays on pending_sends until the close, the underlying io may have completed it */
+            PENDING_SEND* pending_send = create_pending_send(tls_io_instance, on_send_complete, callback_context);
+            if (pending_send == NULL)
             {
                 result = __LINE__;
-                log_ERR_get_error("SSL_write error.");
+                LogError("Error in create_pending_send.");
             }
-            else
+            else if (tls_io_instance->is_ktls_send)
             {
-                if (write_outgoing_bytes(tls_io_instance, on_send_complete, callback_context) != 0)
+                /* the kernel frames and encrypts the records */
+                if (xio_send(tls_io_instance->underlying_io, buffer, size, on_underlying_io_send_complete, pending_send) != 0)
                 {
                     result = __LINE__;
-                    LogError("Error in write_outgoing_bytes.");
+                    LogError("Error in xio_send.");
                 }
                 else
                 {
                     result = 0;
                 }
             }
+            else
+            {
+                uint64_t start_us = get_current_us(tls_io_instance);
+                int res = SSL_write(tls_io_instance->ssl, buffer, size);
+                add_processing_time(tls_io_instance, start_us, &tls_io_instance->statistics.send_processing_us);
+                if (res != size)
+                {
+                    result = __LINE__;
+                    log_ERR_get_error("SSL_write error.");
+                }
+                else
+                {
+                    if (write_outgoing_bytes(tls_io_instance, on_underlying_io_send_complete, pending_send) != 0)
+                    {
+                        result = __LINE__;
+                        LogError("Error in write_outgoing_bytes.");
+                    }
+                    else
+                    {
+                        result = 0;
+                    }
+                }
+            }
+
+            if (result == 0)
+            {
+                tls_io_instance->statistics.messages_sent++;
+                tls_io_instance->statistics.bytes_sent += size;
+            }
+            else
+            {
+                tls_io_instance->statistics.send_error_count++;
+            }
         }
     }
 
@@ -1065,6 +2382,11 @@ void tlsio_openssl_dowork(CONCRETE_IO_HANDLE tls_io)
             (tls_io_instance->tlsio_state != TLSIO_STATE_ERROR))
         {
             xio_dowork(tls_io_instance->underlying_io);
+
+            if (tls_io_instance->tlsio_state == TLSIO_STATE_SENDING_CLOSE_NOTIFY)
+            {
+                close_when_close_notify_sent(tls_io_instance);
+            }
         }
     }
 }
@@ -1104,11 +2426,7 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
                 result = 0;
             }
 
-            // If we're previously connected then add the cert to the context
-            if (tls_io_instance->ssl_context != NULL)
-            {
-                result = add_certificate_to_store(tls_io_instance, cert);
-            }
+            // The context of a connection may be shared with other instances, the certificate is used from the next open
         }
         else if (strcmp("x509certificate", optionName) == 0)
         {
@@ -1131,6 +2449,85 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
                 }
             }
         }
+        else if (strcmp(OPTION_TLS_RECEIVE_BUFFER_SIZE, optionName) == 0)
+        {
+            size_t receive_buffer_size = *(const size_t*)value;
+            if ((receive_buffer_size == 0) || (receive_buffer_size > INT_MAX))
+            {
+                LogError("invalid TLS receive buffer size %zu", receive_buffer_size);
+                result = __LINE__;
+            }
+            else
+            {
+                /* the buffer is allocated again with the new size by the next SSL_read */
+                free(tls_io_instance->receive_buffer);
+                tls_io_instance->receive_buffer = NULL;
+                tls_io_instance->receive_buffer_size = receive_buffer_size;
+                result = 0;
+            }
+        }
+        else if (
+            (strcmp(OPTION_TLS_MIN_VERSION, optionName) == 0) ||
+            (strcmp(OPTION_TLS_MAX_VERSION, optionName) == 0)
+            )
+        {
+            int version = *(const int*)value;
+            if ((version != TLSIO_VERSION_DEFAULT) &&
+                ((version < TLSIO_VERSION_1_0) || (version > TLSIO_VERSION_1_3)))
+            {
+                LogError("invalid TLS version %x", version);
+                result = __LINE__;
+            }
+            else
+            {
+                /* the context of the next open is created or looked up with the new version */
+                if (strcmp(OPTION_TLS_MIN_VERSION, optionName) == 0)
+                {
+                    tls_io_instance->tls_min_version = version;
+                }
+                else
+                {
+                    tls_io_instance->tls_max_version = version;
+                }
+
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_ON_WRITABLE, optionName) == 0)
+        {
+            /* the underlying io calls on_underlying_io_writable, which calls this one */
+            tls_io_instance->on_writable = *(const XIO_WRITABLE_CALLBACK*)value;
+            result = 0;
+        }
+        else if (strcmp(OPTION_TLS_KTLS, optionName) == 0)
+        {
+            /* used from the next open, falls back to the memory BIOs when kTLS is not available */
+            tls_io_instance->ktls_requested = *(const int*)value;
+            result = 0;
+        }
+        else if (
+            (strcmp(OPTION_TLS_CIPHER_LIST, optionName) == 0) ||
+            (strcmp(OPTION_TLS_CIPHERSUITES, optionName) == 0) ||
+            (strcmp(OPTION_TLS_GROUPS, optionName) == 0)
+            )
+        {
+            char** setting = (strcmp(OPTION_TLS_CIPHER_LIST, optionName) == 0) ? &tls_io_instance->tls_cipher_list :
+                (strcmp(OPTION_TLS_CIPHERSUITES, optionName) == 0) ? &tls_io_instance->tls_ciphersuites :
+                &tls_io_instance->tls_groups;
+            char* copy;
+
+            if (mallocAndStrcpy_s(&copy, (const char*)value) != 0)
+            {
+                LogError("unable to mallocAndStrcpy_s the %s value", optionName);
+                result = __LINE__;
+            }
+            else
+            {
+                free(*setting);
+                *setting = copy;
+                result = 0;
+            }
+        }
         else if (strcmp("x509privatekey", optionName) == 0)
         {
             if (tls_io_instance->x509privatekey != NULL)
@@ -1162,6 +2559,17 @@ int tlsio_openssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
             else
             {
                 result = xio_setoption(tls_io_instance->underlying_io, optionName, value);
+                if ((result == 0) &&
+                    (strcmp(optionName, OPTION_SEND_HIGH_WATERMARK) == 0))
+                {
+                    /* the underlying io only refuses a record once it has a high watermark */
+                    XIO_WRITABLE_CALLBACK underlying_io_writable;
+                    underlying_io_writable.on_writable = on_underlying_io_writable;
+                    underlying_io_writable.context = tls_io_instance;
+
+                    tls_io_instance->send_high_watermark = *(const size_t*)value;
+                    result = xio_setoption(tls_io_instance->underlying_io, OPTION_ON_WRITABLE, &underlying_io_writable);
+                }
             }
         }
     }
@@ -1173,3 +2581,95 @@ const IO_INTERFACE_DESCRIPTION* tlsio_openssl_get_interface_description(void)
 {
     return &tlsio_openssl_interface_description;
 }
+
+const IO_INTERFACE_DESCRIPTION* tlsio_openssl_get_layered_interface_description(void)
+{
+    return &tlsio_openssl_layered_interface_description;
+}
+
+int tlsio_openssl_get_statistics(CONCRETE_IO_HANDLE tls_io, XIO_STATISTICS* statistics)
+{
+    int result;
+
+    if ((tls_io == NULL) ||
+        (statistics == NULL))
+    {
+        result = __LINE__;
+        LogError("Invalid arguments: tls_io = %p, statistics = %p.", tls_io, statistics);
+    }
+    else
+    {
+        TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
+        *statistics = tls_io_instance->statistics;
+        if (has_kept_records(tls_io_instance))
+        {
+            /* the records kept in out_bio until the underlying io accepts them */
+            statistics->pending_send_count++;
+            statistics->pending_send_bytes += BIO_ctrl_pending(tls_io_instance->out_bio);
+        }
+        result = 0;
+    }
+
+    return result;
+}
+
+int tlsio_openssl_set_session_cache_limits(size_t max_sessions, uint32_t time_to_live_seconds)
+{
+    int result;
+
+    if (session_cache_lock == NULL)
+    {
+        result = __LINE__;
+        LogError("The session cache is not initialized, call platform_init first.");
+    }
+    else if (Lock(session_cache_lock) != LOCK_OK)
+    {
+        result = __LINE__;
+        LogError("Failed to lock the session cache.");
+    }
+    else
+    {
+        /* the entries array is allocated again with the new size by the next stored session */
+        clear_session_cache();
+        free(session_cache_entries);
+        session_cache_entries = NULL;
+        session_cache_max_sessions = max_sessions;
+        session_cache_ttl_seconds = time_to_live_seconds;
+        result = 0;
+
+        (void)Unlock(session_cache_lock);
+    }
+
+    return result;
+}
+
+int tlsio_openssl_get_session_cache_statistics(TLSIO_OPENSSL_SESSION_CACHE_STATISTICS* statistics)
+{
+    int result;
+
+    if (statistics == NULL)
+    {
+        result = __LINE__;
+        LogError("NULL statistics.");
+    }
+    else if (session_cache_lock == NULL)
+    {
+        result = __LINE__;
+        LogError("The session cache is not initialized, call platform_init first.");
+    }
+    else if (Lock(session_cache_lock) != LOCK_OK)
+    {
+        result = __LINE__;
+        LogError("Failed to lock the session cache.");
+    }
+    else
+    {
+        *statistics = session_cache_statistics;
+        statistics->session_count = session_cache_count;
+        result = 0;
+
+        (void)Unlock(session_cache_lock);
+    }
+
+    return result;
+}
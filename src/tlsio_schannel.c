@@ -197,7 +197,10 @@ static const IO_INTERFACE_DESCRIPTION tlsio_schannel_interface_description =
     tlsio_schannel_close,
     tlsio_schannel_send,
     tlsio_schannel_dowork,
-    tlsio_schannel_setoption
+    tlsio_schannel_setoption,
+    NULL,
+    NULL,
+    NULL
 };
 
 static void indicate_error(TLS_IO_INSTANCE* tls_io_instance)
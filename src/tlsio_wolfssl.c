@@ -8,6 +8,7 @@
 
 #include "wolfssl/ssl.h"
 #include "wolfssl/error-ssl.h"
+#include "wolfssl/version.h"
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
@@ -15,7 +16,27 @@
 #include "azure_c_shared_utility/tlsio_wolfssl.h"
 #include "azure_c_shared_utility/socketio.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/shared_util_options.h"
 #include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+
+/* largest plaintext of a TLS record, wolfSSL_read returns at most one record */
+#define TLSIO_WOLFSSL_RECEIVE_BUFFER_SIZE   16384
+/* initial size of the ring of the ciphertext received by the underlying io and not read by wolfSSL yet, a few
+   records; it grows up to OPTION_TLS_MAX_PENDING_RECEIVE_BYTES */
+#define TLSIO_WOLFSSL_RECEIVE_RING_SIZE     65536
+/* endpoints whose last session is kept for resumption */
+#define TLSIO_WOLFSSL_SESSION_CACHE_SIZE    8
+/* how long a close waits for the underlying io to accept the close_notify */
+#define TLSIO_WOLFSSL_CLOSE_TIMEOUT_US      (2 * 1000 * 1000)
+
+/* since 5.3.0 wolfSSL_get_session returns the session of the WOLFSSL object, freed with it, and a reference that
+   outlives it is taken with wolfSSL_get1_session */
+#if defined(LIBWOLFSSL_VERSION_HEX) && (LIBWOLFSSL_VERSION_HEX >= 0x05003000)
+#define TLSIO_WOLFSSL_SESSION_REFERENCES
+#endif
 
 typedef enum TLSIO_STATE_ENUM_TAG
 {
@@ -23,6 +44,9 @@ typedef enum TLSIO_STATE_ENUM_TAG
     TLSIO_STATE_OPENING_UNDERLYING_IO,
     TLSIO_STATE_IN_HANDSHAKE,
     TLSIO_STATE_OPEN,
+    /* the close_notify waits in out_buffer or in the queue of the underlying io, tlsio_wolfssl_dowork closes it once
+       it was sent */
+    TLSIO_STATE_SENDING_CLOSE_NOTIFY,
     TLSIO_STATE_CLOSING,
     TLSIO_STATE_ERROR
 } TLSIO_STATE_ENUM;
@@ -41,15 +65,52 @@ typedef struct TLS_IO_INSTANCE_TAG
     WOLFSSL* ssl;
     WOLFSSL_CTX* ssl_context;
     TLSIO_STATE_ENUM tlsio_state;
-    unsigned char* socket_io_read_bytes;
-    size_t socket_io_read_byte_count;
+    /* ring of the received ciphertext, allocated on the first bytes and only grown when the underlying io
+       delivers more than it can hold, up to max_receive_ring_size */
+    unsigned char* receive_ring;
+    size_t receive_ring_size;
+    size_t receive_ring_head;
+    size_t receive_ring_count;
+    size_t max_receive_ring_size;
+    /* allocated on the first wolfSSL_read and reused, a full record is delivered in one on_bytes_received call */
+    unsigned char* receive_buffer;
+    /* records written by wolfSSL and not accepted by the underlying io yet, they are handed to it in one xio_send */
+    unsigned char* out_buffer;
+    size_t out_buffer_size;
+    size_t out_buffer_count;
+    /* callback of the send whose records are in out_buffer, NULL for the handshake and close_notify records */
     ON_SEND_COMPLETE on_send_complete;
     void* on_send_complete_callback_context;
+    /* OPTION_ON_WRITABLE; the underlying io calls on_underlying_io_writable, which first sends out_buffer */
+    XIO_WRITABLE_CALLBACK on_writable;
+    uint64_t close_deadline_us;
     char* certificate;
     char* hostname;
     int port;
+    /* plaintext bytes, the sends are queued by the underlying io; get_statistics adds the records kept in out_buffer */
+    XIO_STATISTICS statistics;
+    /* copy of the option forwarded to the underlying io, checked before a record is encrypted */
+    size_t send_high_watermark;
+    /* clock of the connection events and of the time spent in wolfSSL that are kept in statistics */
+    TICK_COUNTER_HANDLE tick_counter;
+    uint64_t open_time_us;
+    /* time spent in the underlying io from the wolfSSL callbacks, it is not part of the processing time */
+    uint64_t underlying_io_us;
+    /* PENDING_SEND entries of the sends the underlying io has not completed yet */
+    DLIST_ENTRY pending_sends;
 } TLS_IO_INSTANCE;
 
+/* the context of a send passed to the underlying io with its records, on_underlying_io_send_complete records its
+   latency */
+typedef struct PENDING_SEND_TAG
+{
+    DLIST_ENTRY entry;
+    TLS_IO_INSTANCE* tls_io_instance;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+    uint64_t send_time_us;
+} PENDING_SEND;
+
 /*this function will clone an option given by name and value*/
 static void* tlsio_wolfssl_CloneOption(const char* name, const void* value)
 {
@@ -125,11 +186,31 @@ static const IO_INTERFACE_DESCRIPTION tlsio_wolfssl_interface_description =
     tlsio_wolfssl_close,
     tlsio_wolfssl_send,
     tlsio_wolfssl_dowork,
-    tlsio_wolfssl_setoption
+    tlsio_wolfssl_setoption,
+    NULL,
+    tlsio_wolfssl_get_statistics,
+    NULL
+};
+
+/* the same io created from a TLSIO_LAYERED_CONFIG */
+static const IO_INTERFACE_DESCRIPTION tlsio_wolfssl_layered_interface_description =
+{
+    tlsio_wolfssl_retrieveoptions,
+    tlsio_wolfssl_create_layered,
+    tlsio_wolfssl_destroy,
+    tlsio_wolfssl_open,
+    tlsio_wolfssl_close,
+    tlsio_wolfssl_send,
+    tlsio_wolfssl_dowork,
+    tlsio_wolfssl_setoption,
+    NULL,
+    tlsio_wolfssl_get_statistics,
+    NULL
 };
 
 static void indicate_error(TLS_IO_INSTANCE* tls_io_instance)
 {
+    tls_io_instance->statistics.io_error_count++;
     if (tls_io_instance->on_io_error != NULL)
     {
         tls_io_instance->on_io_error(tls_io_instance->on_io_error_context);
@@ -144,27 +225,195 @@ static void indicate_open_complete(TLS_IO_INSTANCE* tls_io_instance, IO_OPEN_RES
     }
 }
 
+static uint64_t get_current_us(TLS_IO_INSTANCE* tls_io_instance)
+{
+    uint64_t result;
+
+    if (tickcounter_get_current_us(tls_io_instance->tick_counter, &result) != 0)
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+/* only the first occurrence since the open is kept, at least 1 us after it as 0 means that the event did not happen */
+static void record_connection_event(TLS_IO_INSTANCE* tls_io_instance, uint64_t* event_us)
+{
+    if (*event_us == 0)
+    {
+        uint64_t now_us = get_current_us(tls_io_instance);
+        *event_us = (now_us > tls_io_instance->open_time_us) ? (now_us - tls_io_instance->open_time_us) : 1;
+    }
+}
+
+/* wolfSSL reads and writes the underlying io from within its calls, that time is network time and is left out */
+static void add_processing_time(TLS_IO_INSTANCE* tls_io_instance, uint64_t start_us, uint64_t start_underlying_io_us, uint64_t* processing_us)
+{
+    uint64_t elapsed_us = get_current_us(tls_io_instance) - start_us;
+    uint64_t underlying_io_us = tls_io_instance->underlying_io_us - start_underlying_io_us;
+
+    if (elapsed_us > underlying_io_us)
+    {
+        *processing_us += elapsed_us - underlying_io_us;
+    }
+}
+
+static PENDING_SEND* create_pending_send(TLS_IO_INSTANCE* tls_io_instance, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    PENDING_SEND* result = (PENDING_SEND*)malloc(sizeof(PENDING_SEND));
+    if (result == NULL)
+    {
+        LogError("Cannot allocate memory for the pending send.");
+    }
+    else
+    {
+        result->tls_io_instance = tls_io_instance;
+        result->on_send_complete = on_send_complete;
+        result->callback_context = callback_context;
+        result->send_time_us = get_current_us(tls_io_instance);
+        DList_InsertTailList(&tls_io_instance->pending_sends, &result->entry);
+    }
+
+    return result;
+}
+
+static void on_underlying_io_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    PENDING_SEND* pending_send = (PENDING_SEND*)context;
+    TLS_IO_INSTANCE* tls_io_instance = pending_send->tls_io_instance;
+
+    if (send_result == IO_SEND_OK)
+    {
+        uint64_t now = get_current_us(tls_io_instance);
+        xio_statistics_add_send_latency(&tls_io_instance->statistics, (now > pending_send->send_time_us) ? (now - pending_send->send_time_us) : 0);
+    }
+
+    (void)DList_RemoveEntryList(&pending_send->entry);
+    if (pending_send->on_send_complete != NULL)
+    {
+        pending_send->on_send_complete(pending_send->callback_context, send_result);
+    }
+
+    free(pending_send);
+}
+
+/* the underlying io drops the sends it has not completed when it is closed, and a failed send may not complete */
+static void free_pending_sends(TLS_IO_INSTANCE* tls_io_instance)
+{
+    while (!DList_IsListEmpty(&tls_io_instance->pending_sends))
+    {
+        free(containingRecord(DList_RemoveHeadList(&tls_io_instance->pending_sends), PENDING_SEND, entry));
+    }
+}
+
 static int decode_ssl_received_bytes(TLS_IO_INSTANCE* tls_io_instance)
 {
     int result = 0;
-    unsigned char buffer[64];
-
     int rcv_bytes = 1;
+
+    if (tls_io_instance->receive_buffer == NULL)
+    {
+        tls_io_instance->receive_buffer = (unsigned char*)malloc(TLSIO_WOLFSSL_RECEIVE_BUFFER_SIZE);
+        if (tls_io_instance->receive_buffer == NULL)
+        {
+            LogError("Cannot allocate the %d bytes receive buffer.", TLSIO_WOLFSSL_RECEIVE_BUFFER_SIZE);
+            result = __LINE__;
+            rcv_bytes = 0;
+        }
+    }
+
     while (rcv_bytes > 0)
     {
-        rcv_bytes = wolfSSL_read(tls_io_instance->ssl, buffer, sizeof(buffer));
+        uint64_t start_us = get_current_us(tls_io_instance);
+        uint64_t start_underlying_io_us = tls_io_instance->underlying_io_us;
+        rcv_bytes = wolfSSL_read(tls_io_instance->ssl, tls_io_instance->receive_buffer, TLSIO_WOLFSSL_RECEIVE_BUFFER_SIZE);
+        add_processing_time(tls_io_instance, start_us, start_underlying_io_us, &tls_io_instance->statistics.receive_processing_us);
         if (rcv_bytes > 0)
         {
+            record_connection_event(tls_io_instance, &tls_io_instance->statistics.first_byte_received_us);
+            tls_io_instance->statistics.messages_received++;
+            tls_io_instance->statistics.bytes_received += (uint64_t)rcv_bytes;
             if (tls_io_instance->on_bytes_received != NULL)
             {
-                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, buffer, rcv_bytes);
+                tls_io_instance->on_bytes_received(tls_io_instance->on_bytes_received_context, tls_io_instance->receive_buffer, rcv_bytes);
+            }
+        }
+    }
+
+    return result;
+}
+
+/* a record is only encrypted when the underlying io accepts it, see tlsio_wolfssl_send */
+static bool is_underlying_send_queue_full(TLS_IO_INSTANCE* tls_io_instance)
+{
+    XIO_STATISTICS underlying_statistics;
+
+    return (tls_io_instance->send_high_watermark != 0) &&
+        (xio_get_statistics(tls_io_instance->socket_io, &underlying_statistics) == 0) &&
+        (underlying_statistics.pending_send_bytes >= tls_io_instance->send_high_watermark);
+}
+
+/* the records are kept in out_buffer while the underlying io refuses them, the next tlsio_wolfssl_dowork or
+   on_underlying_io_writable sends them */
+static int write_outgoing_bytes(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+
+    if ((tls_io_instance->out_buffer_count == 0) ||
+        (is_underlying_send_queue_full(tls_io_instance)))
+    {
+        result = 0;
+    }
+    else
+    {
+        uint64_t start_us = get_current_us(tls_io_instance);
+        int send_result = xio_send(tls_io_instance->socket_io, tls_io_instance->out_buffer, tls_io_instance->out_buffer_count, tls_io_instance->on_send_complete, tls_io_instance->on_send_complete_callback_context);
+        tls_io_instance->underlying_io_us += get_current_us(tls_io_instance) - start_us;
+
+        if (send_result == XIO_SEND_WOULD_BLOCK)
+        {
+            result = 0;
+        }
+        else
+        {
+            if (send_result != 0)
+            {
+                LogError("Error in xio_send.");
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
             }
+
+            /* the underlying io copied what it did not send, the callback goes with those records only */
+            tls_io_instance->out_buffer_count = 0;
+            tls_io_instance->on_send_complete = NULL;
+            tls_io_instance->on_send_complete_callback_context = NULL;
         }
     }
 
     return result;
 }
 
+/* the on_writable callback of the underlying io; the producer can send again once the kept records were accepted */
+static void on_underlying_io_writable(void* context)
+{
+    TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+
+    if (write_outgoing_bytes(tls_io_instance) != 0)
+    {
+        LogError("Error in write_outgoing_bytes.");
+    }
+    else if ((tls_io_instance->tlsio_state == TLSIO_STATE_OPEN) &&
+        (tls_io_instance->out_buffer_count == 0) &&
+        (tls_io_instance->on_writable.on_writable != NULL))
+    {
+        tls_io_instance->on_writable.on_writable(tls_io_instance->on_writable.context);
+    }
+}
+
 static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_result)
 {
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
@@ -177,32 +426,129 @@ static void on_underlying_io_open_complete(void* context, IO_OPEN_RESULT open_re
     else
     {
         int res;
+        uint64_t start_us;
+        uint64_t start_underlying_io_us;
         tls_io_instance->tlsio_state = TLSIO_STATE_IN_HANDSHAKE;
+        record_connection_event(tls_io_instance, &tls_io_instance->statistics.connected_us);
 
+        /* wolfSSL_connect runs the whole handshake, on_io_recv waits for the server flights */
+        start_us = get_current_us(tls_io_instance);
+        start_underlying_io_us = tls_io_instance->underlying_io_us;
         res = wolfSSL_connect(tls_io_instance->ssl);
+        add_processing_time(tls_io_instance, start_us, start_underlying_io_us, &tls_io_instance->statistics.handshake_processing_us);
         if (res != SSL_SUCCESS)
         {
             indicate_open_complete(tls_io_instance, IO_OPEN_ERROR);
             tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
         }
+        else if (write_outgoing_bytes(tls_io_instance) != 0)
+        {
+            /* the last flight of the client */
+            LogError("Error in write_outgoing_bytes.");
+        }
     }
 }
 
+/* copies the oldest size bytes of the ring, in at most two pieces when they wrap around its end */
+static void copy_from_receive_ring(TLS_IO_INSTANCE* tls_io_instance, unsigned char* destination, size_t size)
+{
+    size_t first_size = tls_io_instance->receive_ring_size - tls_io_instance->receive_ring_head;
+
+    if (first_size > size)
+    {
+        first_size = size;
+    }
+
+    (void)memcpy(destination, tls_io_instance->receive_ring + tls_io_instance->receive_ring_head, first_size);
+    (void)memcpy(destination + first_size, tls_io_instance->receive_ring, size - first_size);
+}
+
+/* the ring doubles up to max_receive_ring_size; the underlying io cannot be told to stop reading, so the bytes beyond
+   it fail the connection */
+static size_t get_receive_ring_size(TLS_IO_INSTANCE* tls_io_instance, size_t required_size)
+{
+    size_t max_ring_size = tls_io_instance->max_receive_ring_size;
+    size_t result = (tls_io_instance->receive_ring_size == 0) ? TLSIO_WOLFSSL_RECEIVE_RING_SIZE : tls_io_instance->receive_ring_size;
+
+    if (result > max_ring_size)
+    {
+        result = max_ring_size;
+    }
+
+    while (result < required_size)
+    {
+        result = (result > (max_ring_size / 2)) ? max_ring_size : (result * 2);
+    }
+
+    return result;
+}
+
+static int reserve_receive_ring(TLS_IO_INSTANCE* tls_io_instance, size_t size)
+{
+    int result;
+
+    if ((size > tls_io_instance->max_receive_ring_size) ||
+        (tls_io_instance->receive_ring_count > tls_io_instance->max_receive_ring_size - size))
+    {
+        LogError("Cannot hold %zu more received bytes, wolfSSL did not read %zu bytes yet and the limit is %zu bytes.", size, tls_io_instance->receive_ring_count, tls_io_instance->max_receive_ring_size);
+        result = __LINE__;
+    }
+    else
+    {
+        size_t new_ring_size = get_receive_ring_size(tls_io_instance, tls_io_instance->receive_ring_count + size);
+        if (new_ring_size == tls_io_instance->receive_ring_size)
+        {
+            result = 0;
+        }
+        else
+        {
+            unsigned char* new_ring = (unsigned char*)malloc(new_ring_size);
+            if (new_ring == NULL)
+            {
+                LogError("Cannot allocate the %zu bytes receive ring.", new_ring_size);
+                result = __LINE__;
+            }
+            else
+            {
+                if (tls_io_instance->receive_ring_count > 0)
+                {
+                    copy_from_receive_ring(tls_io_instance, new_ring, tls_io_instance->receive_ring_count);
+                }
+
+                free(tls_io_instance->receive_ring);
+                tls_io_instance->receive_ring = new_ring;
+                tls_io_instance->receive_ring_size = new_ring_size;
+                tls_io_instance->receive_ring_head = 0;
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
 static void on_underlying_io_bytes_received(void* context, const unsigned char* buffer, size_t size)
 {
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
 
-    unsigned char* new_socket_io_read_bytes = (unsigned char*)realloc(tls_io_instance->socket_io_read_bytes, tls_io_instance->socket_io_read_byte_count + size);
-    if (new_socket_io_read_bytes == NULL)
+    if (reserve_receive_ring(tls_io_instance, size) != 0)
     {
         tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
         indicate_error(tls_io_instance);
     }
     else
     {
-        tls_io_instance->socket_io_read_bytes = new_socket_io_read_bytes;
-        (void)memcpy(tls_io_instance->socket_io_read_bytes + tls_io_instance->socket_io_read_byte_count, buffer, size);
-        tls_io_instance->socket_io_read_byte_count += size;
+        size_t tail = (tls_io_instance->receive_ring_head + tls_io_instance->receive_ring_count) % tls_io_instance->receive_ring_size;
+        size_t first_size = tls_io_instance->receive_ring_size - tail;
+
+        if (first_size > size)
+        {
+            first_size = size;
+        }
+
+        (void)memcpy(tls_io_instance->receive_ring + tail, buffer, first_size);
+        (void)memcpy(tls_io_instance->receive_ring, buffer + first_size, size - first_size);
+        tls_io_instance->receive_ring_count += size;
     }
 }
 
@@ -227,6 +573,11 @@ static void on_underlying_io_error(void* context)
             tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
             indicate_error(tls_io_instance);
             break;
+
+        case TLSIO_STATE_SENDING_CLOSE_NOTIFY:
+            /* the close_notify cannot be sent anymore, tlsio_wolfssl_dowork completes the close */
+            tls_io_instance->close_deadline_us = 0;
+            break;
     }
 }
 
@@ -234,6 +585,8 @@ static void on_underlying_io_close_complete(void* context)
 {
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
 
+    free_pending_sends(tls_io_instance);
+
     if (tls_io_instance->tlsio_state == TLSIO_STATE_CLOSING)
     {
         if (tls_io_instance->on_io_close_complete != NULL)
@@ -248,10 +601,15 @@ static int on_io_recv(WOLFSSL *ssl, char *buf, int sz, void *context)
 {
     int result;
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
-    unsigned char* new_socket_io_read_bytes;
+    uint64_t start_us = get_current_us(tls_io_instance);
 
-    while (tls_io_instance->socket_io_read_byte_count == 0)
+    while (tls_io_instance->receive_ring_count == 0)
     {
+        /* the handshake waits here for the answer to the flight that is still in out_buffer */
+        if (write_outgoing_bytes(tls_io_instance) != 0)
+        {
+            LogError("Error in write_outgoing_bytes.");
+        }
         xio_dowork(tls_io_instance->socket_io);
         if (tls_io_instance->tlsio_state != TLSIO_STATE_IN_HANDSHAKE)
         {
@@ -259,30 +617,15 @@ static int on_io_recv(WOLFSSL *ssl, char *buf, int sz, void *context)
         }
     }
 
-    result = tls_io_instance->socket_io_read_byte_count;
-    if (result > sz)
-    {
-        result = sz;
-    }
+    tls_io_instance->underlying_io_us += get_current_us(tls_io_instance) - start_us;
+
+    result = (tls_io_instance->receive_ring_count > (size_t)sz) ? sz : (int)tls_io_instance->receive_ring_count;
 
     if (result > 0)
     {
-        (void)memcpy(buf, tls_io_instance->socket_io_read_bytes, result);
-        (void)memmove(tls_io_instance->socket_io_read_bytes, tls_io_instance->socket_io_read_bytes + result, tls_io_instance->socket_io_read_byte_count - result);
-        tls_io_instance->socket_io_read_byte_count -= result;
-        if (tls_io_instance->socket_io_read_byte_count > 0)
-        {
-            new_socket_io_read_bytes = (unsigned char*)realloc(tls_io_instance->socket_io_read_bytes, tls_io_instance->socket_io_read_byte_count);
-            if (new_socket_io_read_bytes != NULL)
-            {
-                tls_io_instance->socket_io_read_bytes = new_socket_io_read_bytes;
-            }
-        }
-        else
-        {
-            free(tls_io_instance->socket_io_read_bytes);
-            tls_io_instance->socket_io_read_bytes = NULL;
-        }
+        copy_from_receive_ring(tls_io_instance, (unsigned char*)buf, (size_t)result);
+        tls_io_instance->receive_ring_head = (tls_io_instance->receive_ring_head + (size_t)result) % tls_io_instance->receive_ring_size;
+        tls_io_instance->receive_ring_count -= (size_t)result;
     }
 
     if ((result == 0) && (tls_io_instance->tlsio_state == TLSIO_STATE_OPEN))
@@ -297,20 +640,57 @@ static int on_io_recv(WOLFSSL *ssl, char *buf, int sz, void *context)
     return result;
 }
 
+/* wolfSSL writes a send one record at a time; the records are collected in out_buffer and handed to the underlying
+   io by write_outgoing_bytes, so that a send is never cut between two records by an underlying io that is full */
 static int on_io_send(WOLFSSL *ssl, char *buf, int sz, void *context)
 {
     int result;
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
+    size_t new_out_buffer_size = (tls_io_instance->out_buffer_size == 0) ? TLSIO_WOLFSSL_RECEIVE_BUFFER_SIZE : tls_io_instance->out_buffer_size;
 
-    if (xio_send(tls_io_instance->socket_io, buf, sz, tls_io_instance->on_send_complete, tls_io_instance->on_send_complete_callback_context) != 0)
+    while ((new_out_buffer_size < tls_io_instance->out_buffer_count + (size_t)sz) && (new_out_buffer_size <= (SIZE_MAX / 2)))
     {
-        tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
-        indicate_error(tls_io_instance);
-        result = 0;
+        new_out_buffer_size *= 2;
+    }
+
+    if (new_out_buffer_size < tls_io_instance->out_buffer_count + (size_t)sz)
+    {
+        LogError("Cannot keep %d more bytes to send.", sz);
+        result = WOLFSSL_CBIO_ERR_GENERAL;
     }
     else
     {
-        result = sz;
+        if (new_out_buffer_size != tls_io_instance->out_buffer_size)
+        {
+            unsigned char* new_out_buffer = (unsigned char*)realloc(tls_io_instance->out_buffer, new_out_buffer_size);
+            if (new_out_buffer == NULL)
+            {
+                LogError("Cannot allocate the %zu bytes send buffer.", new_out_buffer_size);
+            }
+            else
+            {
+                tls_io_instance->out_buffer = new_out_buffer;
+                tls_io_instance->out_buffer_size = new_out_buffer_size;
+            }
+        }
+
+        if (tls_io_instance->out_buffer_size < tls_io_instance->out_buffer_count + (size_t)sz)
+        {
+            result = WOLFSSL_CBIO_ERR_GENERAL;
+        }
+        else
+        {
+            (void)memcpy(tls_io_instance->out_buffer + tls_io_instance->out_buffer_count, buf, (size_t)sz);
+            tls_io_instance->out_buffer_count += (size_t)sz;
+
+            if (tls_io_instance->tlsio_state == TLSIO_STATE_IN_HANDSHAKE)
+            {
+                /* the first flight is the ClientHello */
+                record_connection_event(tls_io_instance, &tls_io_instance->statistics.handshake_started_us);
+            }
+
+            result = sz;
+        }
     }
 
     return result;
@@ -321,6 +701,7 @@ static int on_handshake_done(WOLFSSL* ssl, void* context)
     TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)context;
     if (tls_io_instance->tlsio_state == TLSIO_STATE_IN_HANDSHAKE)
     {
+        record_connection_event(tls_io_instance, &tls_io_instance->statistics.handshake_complete_us);
         tls_io_instance->tlsio_state = TLSIO_STATE_OPEN;
         indicate_open_complete(tls_io_instance, IO_OPEN_OK);
     }
@@ -328,35 +709,302 @@ static int on_handshake_done(WOLFSSL* ssl, void* context)
     return 0;
 }
 
-static int add_certificate_to_store(TLS_IO_INSTANCE* tls_io_instance)
+static bool are_strings_equal(const char* left, const char* right)
 {
-    int result;
-    if (tls_io_instance->certificate != NULL)
+    return ((left == NULL) && (right == NULL)) ||
+        ((left != NULL) && (right != NULL) && (strcmp(left, right) == 0));
+}
+
+/* a WOLFSSL_CTX holds the parsed trusted certificates, so it is shared by all the instances that trust the same
+   certificates instead of being built and loaded on every tlsio_wolfssl_open. A context that is no longer used is
+   kept for the next connection, until a context for other certificates is created. */
+typedef struct TLSIO_SHARED_CONTEXT_TAG
+{
+    char* certificate;
+    WOLFSSL_CTX* ssl_context;
+    size_t ref_count;
+    struct TLSIO_SHARED_CONTEXT_TAG* next;
+} TLSIO_SHARED_CONTEXT;
+
+static LOCK_HANDLE shared_contexts_lock = NULL;
+static TLSIO_SHARED_CONTEXT* shared_contexts = NULL;
+
+static void free_shared_context(TLSIO_SHARED_CONTEXT* shared_context)
+{
+    wolfSSL_CTX_free(shared_context->ssl_context);
+    free(shared_context->certificate);
+    free(shared_context);
+}
+
+static WOLFSSL_CTX* create_ssl_context(const char* certificate)
+{
+    WOLFSSL_CTX* result = wolfSSL_CTX_new(wolfTLSv1_client_method());
+
+    if (result == NULL)
     {
-        int res = wolfSSL_CTX_load_verify_buffer(tls_io_instance->ssl_context, (const unsigned char*)tls_io_instance->certificate, strlen(tls_io_instance->certificate)+1, SSL_FILETYPE_PEM);
-        if (res != SSL_SUCCESS)
+        LogError("Failed creating the wolfSSL context.");
+    }
+    else if ((certificate != NULL) &&
+        (wolfSSL_CTX_load_verify_buffer(result, (const unsigned char*)certificate, strlen(certificate) + 1, SSL_FILETYPE_PEM) != SSL_SUCCESS))
+    {
+        LogError("Failed loading the trusted certificates.");
+        wolfSSL_CTX_free(result);
+        result = NULL;
+    }
+    else
+    {
+        wolfSSL_SetIOSend(result, on_io_send);
+        wolfSSL_SetIORecv(result, on_io_recv);
+    }
+
+    return result;
+}
+
+/* the caller holds shared_contexts_lock */
+static void remove_unused_shared_contexts(void)
+{
+    TLSIO_SHARED_CONTEXT** link = &shared_contexts;
+    while (*link != NULL)
+    {
+        if ((*link)->ref_count == 0)
         {
-            result = __LINE__;
+            TLSIO_SHARED_CONTEXT* shared_context = *link;
+            *link = shared_context->next;
+            free_shared_context(shared_context);
         }
         else
         {
-            result = 0;
+            link = &(*link)->next;
         }
     }
+}
+
+/* returns the context shared by the instances with the same trusted certificates, released with release_ssl_context */
+static WOLFSSL_CTX* acquire_ssl_context(const TLS_IO_INSTANCE* tls_io_instance)
+{
+    WOLFSSL_CTX* result;
+
+    if (shared_contexts_lock == NULL)
+    {
+        /* tlsio_wolfssl_init was not called, the context is not shared */
+        result = create_ssl_context(tls_io_instance->certificate);
+    }
+    else if (Lock(shared_contexts_lock) != LOCK_OK)
+    {
+        LogError("Failed to lock the shared contexts.");
+        result = NULL;
+    }
     else
     {
-        result = 0;
+        TLSIO_SHARED_CONTEXT* shared_context = shared_contexts;
+        while ((shared_context != NULL) &&
+            (!are_strings_equal(shared_context->certificate, tls_io_instance->certificate)))
+        {
+            shared_context = shared_context->next;
+        }
+
+        if (shared_context != NULL)
+        {
+            shared_context->ref_count++;
+            result = shared_context->ssl_context;
+        }
+        else
+        {
+            remove_unused_shared_contexts();
+
+            shared_context = (TLSIO_SHARED_CONTEXT*)malloc(sizeof(TLSIO_SHARED_CONTEXT));
+            if (shared_context == NULL)
+            {
+                LogError("Failed allocating the shared context.");
+                result = NULL;
+            }
+            else
+            {
+                memset(shared_context, 0, sizeof(TLSIO_SHARED_CONTEXT));
+
+                if (((tls_io_instance->certificate != NULL) && (mallocAndStrcpy_s(&shared_context->certificate, tls_io_instance->certificate) != 0)) ||
+                    ((shared_context->ssl_context = create_ssl_context(tls_io_instance->certificate)) == NULL))
+                {
+                    LogError("Failed creating the shared context.");
+                    free_shared_context(shared_context);
+                    result = NULL;
+                }
+                else
+                {
+                    shared_context->ref_count = 1;
+                    shared_context->next = shared_contexts;
+                    shared_contexts = shared_context;
+                    result = shared_context->ssl_context;
+                }
+            }
+        }
+
+        (void)Unlock(shared_contexts_lock);
     }
+
     return result;
 }
 
+static void release_ssl_context(WOLFSSL_CTX* ssl_context)
+{
+    if (ssl_context != NULL)
+    {
+        if (shared_contexts_lock == NULL)
+        {
+            wolfSSL_CTX_free(ssl_context);
+        }
+        else if (Lock(shared_contexts_lock) != LOCK_OK)
+        {
+            LogError("Failed to lock the shared contexts.");
+        }
+        else
+        {
+            TLSIO_SHARED_CONTEXT** link = &shared_contexts;
+            while ((*link != NULL) &&
+                ((*link)->ssl_context != ssl_context))
+            {
+                link = &(*link)->next;
+            }
+
+            if (*link == NULL)
+            {
+                /* created before tlsio_wolfssl_init */
+                wolfSSL_CTX_free(ssl_context);
+            }
+            else
+            {
+                /* kept with a ref_count of 0 until other certificates need a context */
+                (*link)->ref_count--;
+            }
+
+            (void)Unlock(shared_contexts_lock);
+        }
+    }
+}
+
+/* one session per endpoint, the oldest is replaced when the cache is full. wolfSSL checks the session timeout
+   itself when the session is offered. */
+typedef struct TLSIO_SESSION_CACHE_ENTRY_TAG
+{
+    char* hostname;
+    int port;
+    /* a session is only offered by instances that trust the same certificates as the one that stored it */
+    char* certificate;
+    WOLFSSL_SESSION* session;
+} TLSIO_SESSION_CACHE_ENTRY;
+
+static LOCK_HANDLE session_cache_lock = NULL;
+static TLSIO_SESSION_CACHE_ENTRY session_cache_entries[TLSIO_WOLFSSL_SESSION_CACHE_SIZE];
+static size_t session_cache_count = 0;
+static size_t session_cache_next_eviction = 0;
+
+static void free_session_cache_entry(TLSIO_SESSION_CACHE_ENTRY* entry)
+{
+#ifdef TLSIO_WOLFSSL_SESSION_REFERENCES
+    wolfSSL_SESSION_free(entry->session);
+#endif
+    free(entry->hostname);
+    free(entry->certificate);
+    memset(entry, 0, sizeof(TLSIO_SESSION_CACHE_ENTRY));
+}
+
+/* the caller holds session_cache_lock, returns the index of the entry or session_cache_count */
+static size_t find_session_cache_entry(const TLS_IO_INSTANCE* tls_io_instance)
+{
+    size_t index = 0;
+
+    while ((index < session_cache_count) &&
+        (!((session_cache_entries[index].port == tls_io_instance->port) &&
+        are_strings_equal(session_cache_entries[index].hostname, tls_io_instance->hostname) &&
+        are_strings_equal(session_cache_entries[index].certificate, tls_io_instance->certificate))))
+    {
+        index++;
+    }
+
+    return index;
+}
+
+/* offers the session cached for the endpoint of the instance, if any, to its next handshake */
+static void resume_cached_session(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if ((session_cache_lock != NULL) &&
+        (Lock(session_cache_lock) == LOCK_OK))
+    {
+        size_t index = find_session_cache_entry(tls_io_instance);
+        if ((index < session_cache_count) &&
+            (wolfSSL_set_session(tls_io_instance->ssl, session_cache_entries[index].session) != SSL_SUCCESS))
+        {
+            /* expired, the next handshake is a full one and stores a new session */
+            LogInfo("The cached session of %s:%d cannot be resumed.", tls_io_instance->hostname, tls_io_instance->port);
+        }
+
+        (void)Unlock(session_cache_lock);
+    }
+}
+
+/* keeps the session of a connection that completed its handshake for the next connection to the same endpoint */
+static void store_session(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if ((session_cache_lock != NULL) &&
+        (Lock(session_cache_lock) == LOCK_OK))
+    {
+#ifdef TLSIO_WOLFSSL_SESSION_REFERENCES
+        WOLFSSL_SESSION* session = wolfSSL_get1_session(tls_io_instance->ssl);
+#else
+        /* points into the session cache of wolfSSL, it outlives the WOLFSSL object */
+        WOLFSSL_SESSION* session = wolfSSL_get_session(tls_io_instance->ssl);
+#endif
+        if (session == NULL)
+        {
+            LogInfo("No session to cache for %s:%d.", tls_io_instance->hostname, tls_io_instance->port);
+        }
+        else
+        {
+            TLSIO_SESSION_CACHE_ENTRY entry;
+            size_t index = find_session_cache_entry(tls_io_instance);
+
+            memset(&entry, 0, sizeof(entry));
+            entry.port = tls_io_instance->port;
+            entry.session = session;
+
+            if ((mallocAndStrcpy_s(&entry.hostname, tls_io_instance->hostname) != 0) ||
+                ((tls_io_instance->certificate != NULL) && (mallocAndStrcpy_s(&entry.certificate, tls_io_instance->certificate) != 0)))
+            {
+                LogError("Cannot allocate the session cache entry.");
+                free_session_cache_entry(&entry);
+            }
+            else
+            {
+                if (index == session_cache_count)
+                {
+                    if (session_cache_count < TLSIO_WOLFSSL_SESSION_CACHE_SIZE)
+                    {
+                        session_cache_count++;
+                    }
+                    else
+                    {
+                        /* replace the oldest session */
+                        index = session_cache_next_eviction;
+                        session_cache_next_eviction = (session_cache_next_eviction + 1) % TLSIO_WOLFSSL_SESSION_CACHE_SIZE;
+                    }
+                }
+
+                free_session_cache_entry(&session_cache_entries[index]);
+                session_cache_entries[index] = entry;
+            }
+        }
+
+        (void)Unlock(session_cache_lock);
+    }
+}
+
 static int create_wolfssl_instance(TLS_IO_INSTANCE* tls_io_instance)
 {
     int result;
 
-    if (add_certificate_to_store(tls_io_instance) != 0)
+    tls_io_instance->ssl_context = acquire_ssl_context(tls_io_instance);
+    if (tls_io_instance->ssl_context == NULL)
     {
-        wolfSSL_CTX_free(tls_io_instance->ssl_context);
         result = __LINE__;
     }
     else
@@ -364,22 +1012,23 @@ static int create_wolfssl_instance(TLS_IO_INSTANCE* tls_io_instance)
         tls_io_instance->ssl = wolfSSL_new(tls_io_instance->ssl_context);
         if (tls_io_instance->ssl == NULL)
         {
-            wolfSSL_CTX_free(tls_io_instance->ssl_context);
+            release_ssl_context(tls_io_instance->ssl_context);
+            tls_io_instance->ssl_context = NULL;
             result = __LINE__;
         }
         else
         {
-            tls_io_instance->socket_io_read_bytes = NULL;
-            tls_io_instance->socket_io_read_byte_count = 0;
+            tls_io_instance->receive_ring_head = 0;
+            tls_io_instance->receive_ring_count = 0;
+            tls_io_instance->out_buffer_count = 0;
             tls_io_instance->on_send_complete = NULL;
             tls_io_instance->on_send_complete_callback_context = NULL;
 
             wolfSSL_set_using_nonblock(tls_io_instance->ssl, 1);
-            wolfSSL_SetIOSend(tls_io_instance->ssl_context, on_io_send);
-            wolfSSL_SetIORecv(tls_io_instance->ssl_context, on_io_recv);
             wolfSSL_SetHsDoneCb(tls_io_instance->ssl, on_handshake_done, tls_io_instance);
             wolfSSL_SetIOWriteCtx(tls_io_instance->ssl, tls_io_instance);
             wolfSSL_SetIOReadCtx(tls_io_instance->ssl, tls_io_instance);
+            resume_cached_session(tls_io_instance);
 
             tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
             result = 0;
@@ -391,6 +1040,9 @@ static int create_wolfssl_instance(TLS_IO_INSTANCE* tls_io_instance)
 static void destroy_wolfssl_instance(TLS_IO_INSTANCE* tls_io_instance)
 {
     wolfSSL_free(tls_io_instance->ssl);
+    tls_io_instance->ssl = NULL;
+    release_ssl_context(tls_io_instance->ssl_context);
+    tls_io_instance->ssl_context = NULL;
 }
 
 int tlsio_wolfssl_init(void)
@@ -398,16 +1050,54 @@ int tlsio_wolfssl_init(void)
     (void)wolfSSL_library_init();
     wolfSSL_load_error_strings();
 
+    if ((shared_contexts_lock == NULL) &&
+        ((shared_contexts_lock = Lock_Init()) == NULL))
+    {
+        LogError("Failed to create the shared contexts lock, every connection will build its own context.");
+    }
+
+    if ((session_cache_lock == NULL) &&
+        ((session_cache_lock = Lock_Init()) == NULL))
+    {
+        LogError("Failed to create the session cache lock, sessions will not be resumed.");
+    }
+
     return 0;
 }
 
 void tlsio_wolfssl_deinit(void)
 {
+    if (shared_contexts_lock != NULL)
+    {
+        /* the WOLFSSL objects still alive keep their own reference to the context */
+        while (shared_contexts != NULL)
+        {
+            TLSIO_SHARED_CONTEXT* shared_context = shared_contexts;
+            shared_contexts = shared_context->next;
+            free_shared_context(shared_context);
+        }
+
+        (void)Lock_Deinit(shared_contexts_lock);
+        shared_contexts_lock = NULL;
+    }
+
+    if (session_cache_lock != NULL)
+    {
+        while (session_cache_count > 0)
+        {
+            session_cache_count--;
+            free_session_cache_entry(&session_cache_entries[session_cache_count]);
+        }
+
+        session_cache_next_eviction = 0;
+        (void)Lock_Deinit(session_cache_lock);
+        session_cache_lock = NULL;
+    }
 }
 
-CONCRETE_IO_HANDLE tlsio_wolfssl_create(void* io_create_parameters)
+/* underlying_io_interface NULL means a socketio connected to hostname:port */
+static TLS_IO_INSTANCE* create_tls_io_instance(const TLSIO_CONFIG* tls_io_config, const IO_INTERFACE_DESCRIPTION* underlying_io_interface, void* underlying_io_parameters)
 {
-    TLSIO_CONFIG* tls_io_config = io_create_parameters;
     TLS_IO_INSTANCE* result;
 
     if (tls_io_config == NULL)
@@ -423,8 +1113,19 @@ CONCRETE_IO_HANDLE tlsio_wolfssl_create(void* io_create_parameters)
             mallocAndStrcpy_s(&result->hostname, tls_io_config->hostname);
             result->port = tls_io_config->port;
 
-            result->socket_io_read_bytes = 0;
-            result->socket_io_read_byte_count = 0;
+            result->receive_ring = NULL;
+            result->receive_ring_size = 0;
+            result->receive_ring_head = 0;
+            result->receive_ring_count = 0;
+            result->max_receive_ring_size = TLSIO_WOLFSSL_DEFAULT_MAX_PENDING_RECEIVE_BYTES;
+            result->receive_buffer = NULL;
+            result->out_buffer = NULL;
+            result->out_buffer_size = 0;
+            result->out_buffer_count = 0;
+            result->on_writable.on_writable = NULL;
+            result->on_writable.context = NULL;
+            result->close_deadline_us = 0;
+            DList_InitializeListHead(&result->pending_sends);
             result->socket_io = NULL;
 
             result->ssl = NULL;
@@ -445,41 +1146,74 @@ CONCRETE_IO_HANDLE tlsio_wolfssl_create(void* io_create_parameters)
 
             result->tlsio_state = TLSIO_STATE_NOT_OPEN;
 
-            result->ssl_context = wolfSSL_CTX_new(wolfTLSv1_client_method());
-            if (result->ssl_context == NULL)
+            result->tick_counter = tickcounter_create();
+            if (result->tick_counter == NULL)
             {
+                LogError("Failed creating the tick counter.");
+                free(result->hostname);
                 free(result);
                 result = NULL;
             }
             else
             {
-                const IO_INTERFACE_DESCRIPTION* socket_io_interface = socketio_get_interface_description();
-                if (socket_io_interface == NULL)
+                /* the context is acquired by tlsio_wolfssl_open, see acquire_ssl_context */
+                SOCKETIO_CONFIG socketio_config;
+
+                if (underlying_io_interface == NULL)
+                {
+                    socketio_config.hostname = result->hostname;
+                    socketio_config.port = result->port;
+                    socketio_config.accepted_socket = NULL;
+
+                    underlying_io_interface = socketio_get_interface_description();
+                    underlying_io_parameters = &socketio_config;
+                }
+
+                if (underlying_io_interface == NULL)
                 {
-                    wolfSSL_CTX_free(result->ssl_context);
+                    tickcounter_destroy(result->tick_counter);
+                    free(result->hostname);
                     free(result);
                     result = NULL;
                 }
                 else
                 {
-                    SOCKETIO_CONFIG socketio_config;
-                    socketio_config.hostname = result->hostname;
-                    socketio_config.port = result->port;
-                    socketio_config.accepted_socket = NULL;
-
-                    result->socket_io = xio_create(socket_io_interface, &socketio_config);
+                    result->socket_io = xio_create(underlying_io_interface, underlying_io_parameters);
                     if (result->socket_io == NULL)
                     {
                         LogError("Failure connecting to underlying socket_io");
-                        wolfSSL_CTX_free(result->ssl_context);
+                        tickcounter_destroy(result->tick_counter);
+                        free(result->hostname);
                         free(result);
                         result = NULL;
                     }
                 }
             }
+        }
+    }
 
+    return result;
+}
 
-        }
+CONCRETE_IO_HANDLE tlsio_wolfssl_create(void* io_create_parameters)
+{
+    return create_tls_io_instance((const TLSIO_CONFIG*)io_create_parameters, NULL, NULL);
+}
+
+CONCRETE_IO_HANDLE tlsio_wolfssl_create_layered(void* io_create_parameters)
+{
+    const TLSIO_LAYERED_CONFIG* tls_io_layered_config = (const TLSIO_LAYERED_CONFIG*)io_create_parameters;
+    TLS_IO_INSTANCE* result;
+
+    if ((tls_io_layered_config == NULL) ||
+        (tls_io_layered_config->underlying_io_interface == NULL))
+    {
+        result = NULL;
+        LogError("NULL tls_io_layered_config or underlying_io_interface.");
+    }
+    else
+    {
+        result = create_tls_io_instance(&tls_io_layered_config->tls_config, tls_io_layered_config->underlying_io_interface, tls_io_layered_config->underlying_io_parameters);
     }
 
     return result;
@@ -490,18 +1224,20 @@ void tlsio_wolfssl_destroy(CONCRETE_IO_HANDLE tls_io)
     if (tls_io != NULL)
     {
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
-        if (tls_io_instance->socket_io_read_bytes != NULL)
-        {
-            free(tls_io_instance->socket_io_read_bytes);
-        }
+        free(tls_io_instance->receive_ring);
+        free(tls_io_instance->receive_buffer);
+        free(tls_io_instance->out_buffer);
 
         if (tls_io_instance->certificate != NULL)
         {
             free(tls_io_instance->certificate);
             tls_io_instance->certificate = NULL;
         }
-        wolfSSL_CTX_free(tls_io_instance->ssl_context);
+        free(tls_io_instance->hostname);
+        /* the underlying io may still complete sends while it is destroyed */
         xio_destroy(tls_io_instance->socket_io);
+        free_pending_sends(tls_io_instance);
+        tickcounter_destroy(tls_io_instance->tick_counter);
         free(tls_io);
     }
 }
@@ -534,6 +1270,12 @@ int tlsio_wolfssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open
             tls_io_instance->on_io_error = on_io_error;
             tls_io_instance->on_io_error_context = on_io_error_context;
 
+            tls_io_instance->open_time_us = get_current_us(tls_io_instance);
+            tls_io_instance->statistics.connected_us = 0;
+            tls_io_instance->statistics.handshake_started_us = 0;
+            tls_io_instance->statistics.handshake_complete_us = 0;
+            tls_io_instance->statistics.first_byte_received_us = 0;
+
             tls_io_instance->tlsio_state = TLSIO_STATE_OPENING_UNDERLYING_IO;
 
             if (create_wolfssl_instance(tls_io_instance) != 0)
@@ -556,19 +1298,8 @@ int tlsio_wolfssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open
                 }
                 else
                 {
-                    int res;
-                    tls_io_instance->tlsio_state = TLSIO_STATE_IN_HANDSHAKE;
-                    res = wolfSSL_connect(tls_io_instance->ssl);
-                    if (res != SSL_SUCCESS)
-                    {
-                        LogError("Failed to connect to server.");
-                        tls_io_instance->tlsio_state = TLSIO_STATE_NOT_OPEN;
-                        result = __LINE__;
-                    }
-                    else
-                    {
-                        result = 0;
-                    }
+                    /* the underlying io can complete its open later, the handshake is started by on_underlying_io_open_complete */
+                    result = 0;
                 }
             }
         }
@@ -577,6 +1308,56 @@ int tlsio_wolfssl_open(CONCRETE_IO_HANDLE tls_io, ON_IO_OPEN_COMPLETE on_io_open
     return result;
 }
 
+static int close_underlying_io(TLS_IO_INSTANCE* tls_io_instance)
+{
+    int result;
+
+    tls_io_instance->tlsio_state = TLSIO_STATE_CLOSING;
+
+    if (xio_close(tls_io_instance->socket_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+    {
+        LogError("Error in xio_close.");
+        result = __LINE__;
+    }
+    else
+    {
+        destroy_wolfssl_instance(tls_io_instance);
+        result = 0;
+    }
+
+    return result;
+}
+
+/* called by tlsio_wolfssl_dowork, outside of the callbacks of the underlying io */
+/* the underlying io drops what it still queues when it is closed, the close_notify has to leave its queue first */
+static bool is_close_notify_sent(TLS_IO_INSTANCE* tls_io_instance)
+{
+    XIO_STATISTICS underlying_statistics;
+
+    return (tls_io_instance->out_buffer_count == 0) &&
+        ((xio_get_statistics(tls_io_instance->socket_io, &underlying_statistics) != 0) ||
+        (underlying_statistics.pending_send_bytes == 0));
+}
+
+static void close_when_close_notify_sent(TLS_IO_INSTANCE* tls_io_instance)
+{
+    if (write_outgoing_bytes(tls_io_instance) != 0)
+    {
+        LogError("Error in write_outgoing_bytes.");
+        tls_io_instance->close_deadline_us = 0;
+    }
+
+    if ((!is_close_notify_sent(tls_io_instance)) &&
+        (get_current_us(tls_io_instance) < tls_io_instance->close_deadline_us))
+    {
+        /* retried on the next tlsio_wolfssl_dowork */
+    }
+    else if (close_underlying_io(tls_io_instance) != 0)
+    {
+        LogError("Error in close_underlying_io.");
+    }
+}
+
 int tlsio_wolfssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context)
 {
     int result = 0;
@@ -590,25 +1371,41 @@ int tlsio_wolfssl_close(CONCRETE_IO_HANDLE tls_io, ON_IO_CLOSE_COMPLETE on_io_cl
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
 
         if ((tls_io_instance->tlsio_state == TLSIO_STATE_NOT_OPEN) ||
+            (tls_io_instance->tlsio_state == TLSIO_STATE_SENDING_CLOSE_NOTIFY) ||
             (tls_io_instance->tlsio_state == TLSIO_STATE_CLOSING))
         {
             result = __LINE__;
         }
         else
         {
-            tls_io_instance->tlsio_state = TLSIO_STATE_CLOSING;
             tls_io_instance->on_io_close_complete = on_io_close_complete;
             tls_io_instance->on_io_close_complete_context = callback_context;
 
-            if (xio_close(tls_io_instance->socket_io, on_underlying_io_close_complete, tls_io_instance) != 0)
+            if (tls_io_instance->tlsio_state == TLSIO_STATE_OPEN)
             {
-                result = __LINE__;
+                /* close_notify ends the connection cleanly, the session can then be resumed by the next one. It goes
+                   to out_buffer behind the records of the send that may still be kept there. */
+                (void)wolfSSL_shutdown(tls_io_instance->ssl);
+                store_session(tls_io_instance);
+
+                if (write_outgoing_bytes(tls_io_instance) != 0)
+                {
+                    LogError("Error in write_outgoing_bytes.");
+                }
             }
-            else
+
+            if ((tls_io_instance->tlsio_state == TLSIO_STATE_OPEN) &&
+                (!is_close_notify_sent(tls_io_instance)))
             {
-                destroy_wolfssl_instance(tls_io_instance);
+                /* the close completes in tlsio_wolfssl_dowork once the underlying io sent the close_notify */
+                tls_io_instance->tlsio_state = TLSIO_STATE_SENDING_CLOSE_NOTIFY;
+                tls_io_instance->close_deadline_us = get_current_us(tls_io_instance) + TLSIO_WOLFSSL_CLOSE_TIMEOUT_US;
                 result = 0;
             }
+            else
+            {
+                result = close_underlying_io(tls_io_instance);
+            }
         }
     }
 
@@ -631,19 +1428,59 @@ int tlsio_wolfssl_send(CONCRETE_IO_HANDLE tls_io, const void* buffer, size_t siz
         {
             result = __LINE__;
         }
+        else if (write_outgoing_bytes(tls_io_instance) != 0)
+        {
+            /* records written by wolfSSL on its own go first */
+            tls_io_instance->statistics.send_error_count++;
+            result = __LINE__;
+        }
+        else if ((is_underlying_send_queue_full(tls_io_instance)) ||
+            (tls_io_instance->out_buffer_count > 0))
+        {
+            /* the underlying io refused the records, on_underlying_io_writable sends them and then calls the
+               on_writable callback set with OPTION_ON_WRITABLE */
+            result = XIO_SEND_WOULD_BLOCK;
+        }
         else
         {
-            tls_io_instance->on_send_complete = on_send_complete;
-            tls_io_instance->on_send_complete_callback_context = callback_context;
+            /* on failure it stays on pending_sends until the close, the underlying io may have completed it */
+            PENDING_SEND* pending_send = create_pending_send(tls_io_instance, on_send_complete, callback_context);
+            uint64_t start_us = get_current_us(tls_io_instance);
+            uint64_t start_underlying_io_us = tls_io_instance->underlying_io_us;
+            int res;
+
+            if (pending_send == NULL)
+            {
+                res = -1;
+            }
+            else
+            {
+                res = wolfSSL_write(tls_io_instance->ssl, buffer, size);
+                add_processing_time(tls_io_instance, start_us, start_underlying_io_us, &tls_io_instance->statistics.send_processing_us);
+            }
 
-            int res = wolfSSL_write(tls_io_instance->ssl, buffer, size);
             if (res != size)
             {
+                tls_io_instance->statistics.send_error_count++;
                 result = __LINE__;
             }
             else
             {
-                result = 0;
+                /* out_buffer only holds the records of this send, the callback goes with them */
+                tls_io_instance->on_send_complete = on_underlying_io_send_complete;
+                tls_io_instance->on_send_complete_callback_context = pending_send;
+
+                if (write_outgoing_bytes(tls_io_instance) != 0)
+                {
+                    tls_io_instance->statistics.send_error_count++;
+                    result = __LINE__;
+                }
+                else
+                {
+                    tls_io_instance->statistics.messages_sent++;
+                    tls_io_instance->statistics.bytes_sent += size;
+                    result = 0;
+                }
             }
         }
     }
@@ -657,11 +1494,25 @@ void tlsio_wolfssl_dowork(CONCRETE_IO_HANDLE tls_io)
     {
         TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
 
-        if ((tls_io_instance->tlsio_state != TLSIO_STATE_NOT_OPEN) &&
-            (tls_io_instance->tlsio_state != TLSIO_STATE_ERROR))
+        if (tls_io_instance->tlsio_state == TLSIO_STATE_SENDING_CLOSE_NOTIFY)
         {
-            decode_ssl_received_bytes(tls_io_instance);
             xio_dowork(tls_io_instance->socket_io);
+            close_when_close_notify_sent(tls_io_instance);
+        }
+        else if ((tls_io_instance->tlsio_state != TLSIO_STATE_NOT_OPEN) &&
+            (tls_io_instance->tlsio_state != TLSIO_STATE_ERROR))
+        {
+            /* records kept by a full underlying io, or written by wolfSSL_read itself */
+            if (write_outgoing_bytes(tls_io_instance) != 0)
+            {
+                tls_io_instance->tlsio_state = TLSIO_STATE_ERROR;
+                indicate_error(tls_io_instance);
+            }
+            else
+            {
+                decode_ssl_received_bytes(tls_io_instance);
+                xio_dowork(tls_io_instance->socket_io);
+            }
         }
     }
 }
@@ -671,6 +1522,11 @@ const IO_INTERFACE_DESCRIPTION* tlsio_wolfssl_get_interface_description(void)
     return &tlsio_wolfssl_interface_description;
 }
 
+const IO_INTERFACE_DESCRIPTION* tlsio_wolfssl_get_layered_interface_description(void)
+{
+    return &tlsio_wolfssl_layered_interface_description;
+}
+
 int tlsio_wolfssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, const void* value)
 {
     int result;
@@ -705,6 +1561,27 @@ int tlsio_wolfssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
                 result = 0;
             }
         }
+        else if (strcmp(OPTION_TLS_MAX_PENDING_RECEIVE_BYTES, optionName) == 0)
+        {
+            size_t max_pending_receive_bytes = *(const size_t*)value;
+            if (max_pending_receive_bytes == 0)
+            {
+                LogError("Invalid %s value 0.", OPTION_TLS_MAX_PENDING_RECEIVE_BYTES);
+                result = __LINE__;
+            }
+            else
+            {
+                /* a ring that already grew past it is reallocated on the next received bytes */
+                tls_io_instance->max_receive_ring_size = max_pending_receive_bytes;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_ON_WRITABLE, optionName) == 0)
+        {
+            /* the underlying io calls on_underlying_io_writable, which calls this one */
+            tls_io_instance->on_writable = *(const XIO_WRITABLE_CALLBACK*)value;
+            result = 0;
+        }
         else if (tls_io_instance->socket_io == NULL)
         {
             result = __LINE__;
@@ -712,7 +1589,44 @@ int tlsio_wolfssl_setoption(CONCRETE_IO_HANDLE tls_io, const char* optionName, c
         else
         {
             result = xio_setoption(tls_io_instance->socket_io, optionName, value);
+            if ((result == 0) &&
+                (strcmp(optionName, OPTION_SEND_HIGH_WATERMARK) == 0))
+            {
+                /* the underlying io only refuses a record once it has a high watermark */
+                XIO_WRITABLE_CALLBACK underlying_io_writable;
+                underlying_io_writable.on_writable = on_underlying_io_writable;
+                underlying_io_writable.context = tls_io_instance;
+
+                tls_io_instance->send_high_watermark = *(const size_t*)value;
+                result = xio_setoption(tls_io_instance->socket_io, OPTION_ON_WRITABLE, &underlying_io_writable);
+            }
+        }
+    }
+
+    return result;
+}
+
+int tlsio_wolfssl_get_statistics(CONCRETE_IO_HANDLE tls_io, XIO_STATISTICS* statistics)
+{
+    int result;
+
+    if ((tls_io == NULL) ||
+        (statistics == NULL))
+    {
+        result = __LINE__;
+        LogError("Invalid arguments: tls_io = %p, statistics = %p.", tls_io, statistics);
+    }
+    else
+    {
+        TLS_IO_INSTANCE* tls_io_instance = (TLS_IO_INSTANCE*)tls_io;
+        *statistics = tls_io_instance->statistics;
+        if (tls_io_instance->out_buffer_count > 0)
+        {
+            /* the records kept in out_buffer until the underlying io accepts them */
+            statistics->pending_send_count++;
+            statistics->pending_send_bytes += tls_io_instance->out_buffer_count;
         }
+        result = 0;
     }
 
     return result;
@@ -18,6 +18,7 @@
 #include "azure_c_shared_utility/xio.h"
 #include "azure_c_shared_utility/shared_util_options.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 typedef enum IO_STATE_TAG
 {
@@ -36,6 +37,7 @@ typedef struct PENDING_SOCKET_IO_TAG
     void* callback_context;
     LIST_HANDLE pending_io_list;
     bool is_partially_sent;
+    uint64_t send_time;
 } PENDING_SOCKET_IO;
 
 typedef struct WSIO_INSTANCE_TAG
@@ -59,10 +61,19 @@ typedef struct WSIO_INSTANCE_TAG
     bool use_ssl;
     char* proxy_address;
     int proxy_port;
+    XIO_STATISTICS statistics;
+    /* 0 for no limit, compared with statistics.pending_send_bytes */
+    size_t send_high_watermark;
+    size_t send_low_watermark;
+    XIO_WRITABLE_CALLBACK on_writable;
+    /* set when the queue reached the high watermark, cleared once it drained to the low watermark */
+    bool is_send_blocked;
+    TICK_COUNTER_HANDLE tick_counter;
 } WSIO_INSTANCE;
 
 static void indicate_error(WSIO_INSTANCE* wsio_instance)
 {
+    wsio_instance->statistics.io_error_count++;
     wsio_instance->io_state = IO_STATE_ERROR;
     if (wsio_instance->on_io_error != NULL)
     {
@@ -80,6 +91,51 @@ static void indicate_open_complete(WSIO_INSTANCE* ws_io_instance, IO_OPEN_RESULT
     }
 }
 
+static bool is_send_queue_full(WSIO_INSTANCE* wsio_instance)
+{
+    bool result;
+
+    if ((wsio_instance->send_high_watermark != 0) &&
+        (wsio_instance->statistics.pending_send_bytes >= wsio_instance->send_high_watermark))
+    {
+        wsio_instance->is_send_blocked = true;
+        result = true;
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+static void indicate_writable(WSIO_INSTANCE* wsio_instance)
+{
+    if ((wsio_instance->is_send_blocked) &&
+        (wsio_instance->io_state == IO_STATE_OPEN) &&
+        (wsio_instance->statistics.pending_send_bytes <= wsio_instance->send_low_watermark))
+    {
+        wsio_instance->is_send_blocked = false;
+        if (wsio_instance->on_writable.on_writable != NULL)
+        {
+            wsio_instance->on_writable.on_writable(wsio_instance->on_writable.context);
+        }
+    }
+}
+
+static uint64_t get_time_us(WSIO_INSTANCE* wsio_instance)
+{
+    uint64_t result;
+
+    if ((wsio_instance->tick_counter == NULL) ||
+        (tickcounter_get_current_us(wsio_instance->tick_counter, &result) != 0))
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
 static int add_pending_io(WSIO_INSTANCE* ws_io_instance, const unsigned char* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
 {
     int result;
@@ -106,6 +162,7 @@ static int add_pending_io(WSIO_INSTANCE* ws_io_instance, const unsigned char* bu
             pending_socket_io->callback_context = callback_context;
             pending_socket_io->pending_io_list = ws_io_instance->pending_io_list;
             (void)memcpy(pending_socket_io->bytes, buffer, size);
+            pending_socket_io->send_time = get_time_us(ws_io_instance);
 
             /* Codes_SRS_WSIO_01_105: [The data and callback shall be queued by calling list_add on the list created in wsio_create.] */
             if (list_add(ws_io_instance->pending_io_list, pending_socket_io) == NULL)
@@ -117,6 +174,9 @@ static int add_pending_io(WSIO_INSTANCE* ws_io_instance, const unsigned char* bu
             }
             else
             {
+                ws_io_instance->statistics.pending_send_count++;
+                ws_io_instance->statistics.pending_send_bytes += size;
+                (void)is_send_queue_full(ws_io_instance);
                 result = 0;
             }
         }
@@ -129,6 +189,9 @@ static int remove_pending_io(WSIO_INSTANCE* wsio_instance, LIST_ITEM_HANDLE item
 {
     int result;
 
+    wsio_instance->statistics.pending_send_count--;
+    wsio_instance->statistics.pending_send_bytes -= pending_socket_io->size;
+
     free(pending_socket_io->bytes);
     free(pending_socket_io);
     if (list_remove(wsio_instance->pending_io_list, item_handle) != 0)
@@ -236,6 +299,8 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                     unsigned char* ws_buffer = (unsigned char*)malloc(LWS_SEND_BUFFER_PRE_PADDING + pending_socket_io->size + LWS_SEND_BUFFER_POST_PADDING);
                     if (ws_buffer == NULL)
                     {
+                        wsio_instance->statistics.send_error_count++;
+
                         /* Codes_SRS_WSIO_01_073: [If allocating the memory fails then the send_result callback callback shall be triggered with IO_SEND_ERROR.] */
                         if (pending_socket_io->on_send_complete != NULL)
                         {
@@ -276,6 +341,8 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                         /* Codes_SRS_WSIO_01_118: [If lws_write indicates more bytes sent than were passed to it an error shall be indicated via on_io_error.] */
                         if ((sent < 0) || ((size_t)sent > pending_socket_io->size))
                         {
+                            wsio_instance->statistics.send_error_count++;
+
                             /* Codes_SRS_WSIO_01_076: [If lws_write fails (result is less than 0) then the send_complete callback shall be triggered with IO_SEND_ERROR.] */
                             if (pending_socket_io->on_send_complete != NULL)
                             {
@@ -311,6 +378,7 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                                 /* Codes_SRS_WSIO_01_080: [If lws_write succeeds and less bytes than the complete payload have been sent, then the sent bytes shall be removed from the pending IO and only the leftover bytes shall be left as pending and sent upon subsequent events.] */
                                 (void)memmove(pending_socket_io->bytes, pending_socket_io->bytes + sent, (pending_socket_io->size - (size_t)sent));
                                 pending_socket_io->size -= sent;
+                                wsio_instance->statistics.pending_send_bytes -= (size_t)sent;
                                 pending_socket_io->is_partially_sent = true;
 
                                 /* Codes_SRS_WSIO_01_081: [If any pending IOs are in the list, lws_callback_on_writable shall be called, while passing the websockets instance obtained in wsio_open as arguments if:] */
@@ -318,6 +386,9 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                             }
                             else
                             {
+                                uint64_t now = get_time_us(wsio_instance);
+                                xio_statistics_add_send_latency(&wsio_instance->statistics, (now > pending_socket_io->send_time) ? (now - pending_socket_io->send_time) : 0);
+
                                 /* Codes_SRS_WSIO_01_060: [The argument on_send_complete shall be optional, if NULL is passed by the caller then no send complete callback shall be triggered.] */
                                 /* Codes_SRS_WSIO_01_078: [If the pending IO had an associated on_send_complete, then the on_send_complete function shall be called with the callback_context and IO_SEND_OK as arguments.] */
                                 if (pending_socket_io->on_send_complete != NULL)
@@ -349,6 +420,8 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                     }
                 }
             }
+
+            indicate_writable(wsio_instance);
         }
 
         break;
@@ -386,6 +459,8 @@ static int on_ws_callback(struct lws *wsi, enum lws_callback_reasons reason, voi
                 /* Codes_SRS_WSIO_01_084: [The bytes argument shall point to the received bytes as indicated by the LWS_CALLBACK_CLIENT_RECEIVE in argument.] */
                 /* Codes_SRS_WSIO_01_085: [The length argument shall be set to the number of received bytes as indicated by the LWS_CALLBACK_CLIENT_RECEIVE len argument.] */
                 /* Codes_SRS_WSIO_01_086: [The callback_context shall be set to the callback_context that was passed in wsio_open.] */
+                wsio_instance->statistics.messages_received++;
+                wsio_instance->statistics.bytes_received += len;
                 wsio_instance->on_bytes_received(wsio_instance->on_bytes_received_context, in, len);
             }
         }
@@ -536,6 +611,12 @@ CONCRETE_IO_HANDLE wsio_create(void* io_create_parameters)
             result->ws_context = NULL;
             result->proxy_address = NULL;
             result->proxy_port = 0;
+            (void)memset(&result->statistics, 0, sizeof(result->statistics));
+            result->send_high_watermark = 0;
+            result->send_low_watermark = 0;
+            result->on_writable.on_writable = NULL;
+            result->on_writable.context = NULL;
+            result->is_send_blocked = false;
 
             /* Codes_SRS_WSIO_01_098: [wsio_create shall create a pending IO list that is to be used when sending buffers over the libwebsockets IO by calling list_create.] */
             result->pending_io_list = list_create();
@@ -645,6 +726,24 @@ CONCRETE_IO_HANDLE wsio_create(void* io_create_parameters)
                                         (void)strcpy(result->trusted_ca, ws_io_config->trusted_ca);
                                     }
                                 }
+
+                                if (result != NULL)
+                                {
+                                    /* times queued sends for the send latency histogram */
+                                    result->tick_counter = tickcounter_create();
+                                    if (result->tick_counter == NULL)
+                                    {
+                                        LogError("Failure: tickcounter_create failed.");
+                                        free(result->trusted_ca);
+                                        free(result->protocols);
+                                        free(result->protocol_name);
+                                        free(result->relative_path);
+                                        free(result->host);
+                                        list_destroy(result->pending_io_list);
+                                        free(result);
+                                        result = NULL;
+                                    }
+                                }
                             }
                         }
                     }
@@ -681,6 +780,7 @@ int wsio_open(CONCRETE_IO_HANDLE ws_io, ON_IO_OPEN_COMPLETE on_io_open_complete,
             wsio_instance->on_io_open_complete_context = on_io_open_complete_context;
             wsio_instance->on_io_error = on_io_error;
             wsio_instance->on_io_error_context = on_io_error_context;
+            wsio_instance->is_send_blocked = false;
 
             int ietf_version = -1; /* latest */
             struct lws_context_creation_info info;
@@ -811,6 +911,8 @@ int wsio_close(CONCRETE_IO_HANDLE ws_io, ON_IO_CLOSE_COMPLETE on_io_close_comple
 
                         if (pending_socket_io != NULL)
                         {
+                            wsio_instance->statistics.pending_send_count--;
+                            wsio_instance->statistics.pending_send_bytes -= pending_socket_io->size;
                             free(pending_socket_io->bytes);
                             free(pending_socket_io);
                         }
@@ -862,6 +964,7 @@ void wsio_destroy(CONCRETE_IO_HANDLE ws_io)
             free(wsio_instance->proxy_address);
         }
 
+        tickcounter_destroy(wsio_instance->tick_counter);
         list_destroy(wsio_instance->pending_io_list);
 
         free(ws_io);
@@ -890,11 +993,17 @@ int wsio_send(CONCRETE_IO_HANDLE ws_io, const void* buffer, size_t size, ON_SEND
         {
             result = __LINE__;
         }
+        else if (is_send_queue_full(wsio_instance))
+        {
+            /* not an error, the producer waits for on_writable */
+            result = XIO_SEND_WOULD_BLOCK;
+        }
         else
         {
             /* Codes_SRS_WSIO_01_054: [wsio_send shall queue the buffer and size until the libwebsockets callback is invoked with the event LWS_CALLBACK_CLIENT_WRITEABLE.] */
             if (add_pending_io(wsio_instance, buffer, size, on_send_complete, callback_context) != 0)
             {
+                wsio_instance->statistics.send_error_count++;
                 result = __LINE__;
             }
             else
@@ -908,6 +1017,8 @@ int wsio_send(CONCRETE_IO_HANDLE ws_io, const void* buffer, size_t size, ON_SEND
                 else
                 {
                     /* Codes_SRS_WSIO_01_107: [On success, wsio_send shall return 0.] */
+                    wsio_instance->statistics.messages_sent++;
+                    wsio_instance->statistics.bytes_sent += size;
                     result = 0;
                 }
             }
@@ -963,6 +1074,40 @@ int wsio_setoption(CONCRETE_IO_HANDLE ws_io, const char* optionName, const void*
         {
             result = *(int*)value;
         }
+        else if (strcmp(OPTION_SEND_HIGH_WATERMARK, optionName) == 0)
+        {
+            /* the queue drains to the low watermark, it cannot be above the high watermark whichever is set first */
+            size_t send_high_watermark = *(const size_t*)value;
+            if ((send_high_watermark != 0) && (wsio_instance->send_low_watermark > send_high_watermark))
+            {
+                LogError("Failure: the send high watermark is below the send low watermark.");
+                result = __LINE__;
+            }
+            else
+            {
+                wsio_instance->send_high_watermark = send_high_watermark;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_SEND_LOW_WATERMARK, optionName) == 0)
+        {
+            size_t send_low_watermark = *(const size_t*)value;
+            if ((wsio_instance->send_high_watermark != 0) && (send_low_watermark > wsio_instance->send_high_watermark))
+            {
+                LogError("Failure: the send low watermark is above the send high watermark.");
+                result = __LINE__;
+            }
+            else
+            {
+                wsio_instance->send_low_watermark = send_low_watermark;
+                result = 0;
+            }
+        }
+        else if (strcmp(OPTION_ON_WRITABLE, optionName) == 0)
+        {
+            wsio_instance->on_writable = *(const XIO_WRITABLE_CALLBACK*)value;
+            result = 0;
+        }
         else if (strcmp(OPTION_HTTP_PROXY, optionName) == 0)
         {
             HTTP_PROXY_OPTIONS* proxy_data = (HTTP_PROXY_OPTIONS*)value;
@@ -1150,9 +1295,32 @@ static const IO_INTERFACE_DESCRIPTION ws_io_interface_description =
     wsio_close,
     wsio_send,
     wsio_dowork,
-    wsio_setoption
+    wsio_setoption,
+    NULL,
+    wsio_get_statistics,
+    NULL
 };
 
+int wsio_get_statistics(CONCRETE_IO_HANDLE ws_io, XIO_STATISTICS* statistics)
+{
+    int result;
+
+    if ((ws_io == NULL) ||
+        (statistics == NULL))
+    {
+        result = __LINE__;
+        LogError("Invalid arguments: ws_io = %p, statistics = %p.", ws_io, statistics);
+    }
+    else
+    {
+        WSIO_INSTANCE* wsio_instance = (WSIO_INSTANCE*)ws_io;
+        *statistics = wsio_instance->statistics;
+        result = 0;
+    }
+
+    return result;
+}
+
 /* Codes_SRS_WSIO_01_064: [wsio_get_interface_description shall return a pointer to an IO_INTERFACE_DESCRIPTION structure that contains pointers to the functions: wsio_create, wsio_destroy, wsio_open, wsio_close, wsio_send and wsio_dowork.] */
 const IO_INTERFACE_DESCRIPTION* wsio_get_interface_description(void)
 {
@@ -6,6 +6,7 @@
 #include <crtdbg.h>
 #endif
 #include <stddef.h>
+#include <string.h>
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xio.h"
 
@@ -149,12 +150,77 @@ int xio_send(XIO_HANDLE xio, const void* buffer, size_t size, ON_SEND_COMPLETE o
         /* Codes_SRS_XIO_01_009: [On success, xio_send shall return 0.] */
         /* Codes_SRS_XIO_01_015: [If the underlying concrete_io_send fails, xio_send shall return a non-zero value.] */
         /* Codes_SRS_XIO_01_027: [xio_send shall pass to the concrete_io_send function the on_send_complete and callback_context arguments.] */
+        /* Codes_SRS_XIO_01_040: [If the underlying concrete_io_send returns XIO_SEND_WOULD_BLOCK, xio_send shall return XIO_SEND_WOULD_BLOCK.] */
         result = xio_instance->io_interface_description->concrete_io_send(xio_instance->concrete_xio_handle, buffer, size, on_send_complete, callback_context);
     }
 
     return result;
 }
 
+int xio_send_vectored(XIO_HANDLE xio, const XIO_BUFFER* buffers, size_t buffer_count, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+
+    /* Codes_SRS_XIO_01_029: [If xio or buffers is NULL or buffer_count is 0, xio_send_vectored shall return a non-zero value.] */
+    if ((xio == NULL) ||
+        (buffers == NULL) ||
+        (buffer_count == 0))
+    {
+        LogError("Invalid arguments: xio=%p, buffers=%p, buffer_count=%zu", xio, buffers, buffer_count);
+        result = __LINE__;
+    }
+    else
+    {
+        XIO_INSTANCE* xio_instance = (XIO_INSTANCE*)xio;
+
+        if (xio_instance->io_interface_description->concrete_io_send_vectored != NULL)
+        {
+            /* Codes_SRS_XIO_01_030: [If the concrete IO implementation provides concrete_io_send_vectored, xio_send_vectored shall call it, passing down all its arguments.] */
+            /* Codes_SRS_XIO_01_031: [If the underlying concrete_io_send_vectored fails, xio_send_vectored shall return a non-zero value.] */
+            result = xio_instance->io_interface_description->concrete_io_send_vectored(xio_instance->concrete_xio_handle, buffers, buffer_count, on_send_complete, callback_context);
+        }
+        else
+        {
+            size_t total_size = 0;
+            size_t i;
+            unsigned char* message;
+
+            for (i = 0; i < buffer_count; i++)
+            {
+                total_size += buffers[i].size;
+            }
+
+            /* Codes_SRS_XIO_01_032: [Otherwise xio_send_vectored shall allocate a buffer large enough to hold all the segments and copy them into it, in order.] */
+            if ((total_size == 0) ||
+                ((message = (unsigned char*)malloc(total_size)) == NULL))
+            {
+                /* Codes_SRS_XIO_01_033: [If the segments are empty or allocating the buffer fails, xio_send_vectored shall return a non-zero value.] */
+                LogError("Cannot allocate %zu bytes for the concatenated message", total_size);
+                result = __LINE__;
+            }
+            else
+            {
+                size_t position = 0;
+
+                for (i = 0; i < buffer_count; i++)
+                {
+                    if (buffers[i].size > 0)
+                    {
+                        (void)memcpy(message + position, buffers[i].buffer, buffers[i].size);
+                        position += buffers[i].size;
+                    }
+                }
+
+                /* Codes_SRS_XIO_01_034: [xio_send_vectored shall send the buffer by calling concrete_io_send, return its result and free the buffer.] */
+                result = xio_instance->io_interface_description->concrete_io_send(xio_instance->concrete_xio_handle, message, total_size, on_send_complete, callback_context);
+                free(message);
+            }
+        }
+    }
+
+    return result;
+}
+
 void xio_dowork(XIO_HANDLE xio)
 {
     /* Codes_SRS_XIO_01_018: [When the handle argument is NULL, xio_dowork shall do nothing.] */
@@ -302,3 +368,82 @@ OPTIONHANDLER_HANDLE xio_retrieveoptions(XIO_HANDLE xio)
     return result;
 }
 
+
+int xio_get_statistics(XIO_HANDLE xio, XIO_STATISTICS* statistics)
+{
+    int result;
+
+    /* Codes_SRS_XIO_01_035: [If xio or statistics is NULL, xio_get_statistics shall return a non-zero value.] */
+    if ((xio == NULL) ||
+        (statistics == NULL))
+    {
+        LogError("Invalid arguments: xio=%p, statistics=%p", xio, statistics);
+        result = __LINE__;
+    }
+    else
+    {
+        XIO_INSTANCE* xio_instance = (XIO_INSTANCE*)xio;
+
+        /* Codes_SRS_XIO_01_036: [If the concrete IO implementation does not provide concrete_io_get_statistics, xio_get_statistics shall return a non-zero value.] */
+        if (xio_instance->io_interface_description->concrete_io_get_statistics == NULL)
+        {
+            LogError("The concrete IO does not collect statistics");
+            result = __LINE__;
+        }
+        else
+        {
+            /* Codes_SRS_XIO_01_037: [Otherwise xio_get_statistics shall call concrete_io_get_statistics and return its result.] */
+            result = xio_instance->io_interface_description->concrete_io_get_statistics(xio_instance->concrete_xio_handle, statistics);
+        }
+    }
+
+    return result;
+}
+
+int xio_get_socket(XIO_HANDLE xio, intptr_t* socket_handle)
+{
+    int result;
+
+    /* Codes_SRS_XIO_01_041: [If xio or socket_handle is NULL, xio_get_socket shall return a non-zero value.] */
+    if ((xio == NULL) ||
+        (socket_handle == NULL))
+    {
+        LogError("Invalid arguments: xio=%p, socket_handle=%p", xio, socket_handle);
+        result = __LINE__;
+    }
+    else
+    {
+        XIO_INSTANCE* xio_instance = (XIO_INSTANCE*)xio;
+
+        /* Codes_SRS_XIO_01_042: [If the concrete IO implementation does not provide concrete_io_get_socket, xio_get_socket shall return a non-zero value.] */
+        if (xio_instance->io_interface_description->concrete_io_get_socket == NULL)
+        {
+            LogError("The concrete IO does not own a socket");
+            result = __LINE__;
+        }
+        else
+        {
+            /* Codes_SRS_XIO_01_043: [Otherwise xio_get_socket shall call concrete_io_get_socket and return its result.] */
+            result = xio_instance->io_interface_description->concrete_io_get_socket(xio_instance->concrete_xio_handle, socket_handle);
+        }
+    }
+
+    return result;
+}
+
+void xio_statistics_add_send_latency(XIO_STATISTICS* statistics, uint64_t latency_us)
+{
+    /* Codes_SRS_XIO_01_038: [If statistics is NULL, xio_statistics_add_send_latency shall do nothing.] */
+    if (statistics != NULL)
+    {
+        /* Codes_SRS_XIO_01_039: [xio_statistics_add_send_latency shall increment the bucket of the send latency histogram whose range holds latency_us.] */
+        size_t bucket = 0;
+        while ((bucket < XIO_SEND_LATENCY_BUCKET_COUNT - 1) &&
+            (latency_us >= ((uint64_t)1 << bucket)))
+        {
+            bucket++;
+        }
+
+        statistics->send_latency_histogram[bucket]++;
+    }
+}
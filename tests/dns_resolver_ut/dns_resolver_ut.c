@@ -0,0 +1,476 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static const DNS_RESOLVER_CACHE_OPTIONS g_default_cache_options =
+{
+    DNS_RESOLVER_DEFAULT_TTL_MS,
+    DNS_RESOLVER_DEFAULT_NEGATIVE_TTL_MS,
+    DNS_RESOLVER_DEFAULT_STALE_TTL_MS,
+    DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT
+};
+
+static volatile size_t g_lookup_count;
+static volatile int g_fail_lookups;
+static long g_lookup_delay_ms;
+
+/* polls the resolver the way socketio_dowork does, for at most 10 seconds */
+static bool wait_for_completion(DNS_RESOLVER_HANDLE dns_resolver)
+{
+    size_t i;
+    bool result = false;
+
+    for (i = 0; (i < 10000) && !result; i++)
+    {
+        result = dns_resolver_is_complete(dns_resolver);
+        if (!result)
+        {
+            struct timespec delay = { 0, 1000000 };
+            (void)nanosleep(&delay, NULL);
+        }
+    }
+
+    return result;
+}
+
+static void sleep_ms(long milliseconds)
+{
+    struct timespec delay;
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (milliseconds % 1000) * 1000000;
+    (void)nanosleep(&delay, NULL);
+}
+
+/* stands in for the system resolver, every host name resolves to the loopback address */
+static int stub_getaddrinfo(const char* node, const char* service, const struct addrinfo* hints, struct addrinfo** res)
+{
+    int result;
+
+    (void)node;
+    if (g_lookup_delay_ms > 0)
+    {
+        sleep_ms(g_lookup_delay_ms);
+    }
+
+    if (g_fail_lookups)
+    {
+        result = EAI_NONAME;
+    }
+    else
+    {
+        result = getaddrinfo("127.0.0.1", service, hints, res);
+    }
+
+    g_lookup_count++;
+    return result;
+}
+
+static void stub_freeaddrinfo(struct addrinfo* res)
+{
+    freeaddrinfo(res);
+}
+
+static bool wait_for_lookup_count(size_t lookup_count)
+{
+    size_t i;
+
+    for (i = 0; (i < 10000) && (g_lookup_count < lookup_count); i++)
+    {
+        sleep_ms(1);
+    }
+
+    return g_lookup_count == lookup_count;
+}
+
+/* creates a resolver and waits for it, returns whether it has addresses */
+static bool resolve(const char* hostname)
+{
+    bool result;
+    DNS_RESOLVER_HANDLE dns_resolver = dns_resolver_create(hostname, 4242);
+    ASSERT_IS_NOT_NULL(dns_resolver);
+    ASSERT_IS_TRUE(wait_for_completion(dns_resolver));
+    result = (dns_resolver_get_addrinfo(dns_resolver) != NULL);
+    dns_resolver_destroy(dns_resolver);
+    return result;
+}
+
+static void set_cache_options(uint32_t ttl_ms, uint32_t negative_ttl_ms, uint32_t stale_ttl_ms, size_t max_entry_count)
+{
+    DNS_RESOLVER_CACHE_OPTIONS options;
+    options.ttl_ms = ttl_ms;
+    options.negative_ttl_ms = negative_ttl_ms;
+    options.stale_ttl_ms = stale_ttl_ms;
+    options.max_entry_count = max_entry_count;
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_cache_options(&options));
+}
+
+BEGIN_TEST_SUITE(dns_resolver_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_lookup_count = 0;
+    g_fail_lookups = 0;
+    g_lookup_delay_ms = 0;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    (void)dns_resolver_set_cache_options(&g_default_cache_options);
+    (void)dns_resolver_set_lookup_functions(NULL, NULL);
+    dns_resolver_clear_cache();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* dns_resolver_create */
+
+/* Tests_SRS_DNS_RESOLVER_01_001: [ If hostname is NULL, dns_resolver_create shall fail and return NULL. ]*/
+TEST_FUNCTION(dns_resolver_create_with_NULL_hostname_fails)
+{
+    ///act
+    DNS_RESOLVER_HANDLE dns_resolver = dns_resolver_create(NULL, 443);
+
+    ///assert
+    ASSERT_IS_NULL(dns_resolver);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_002: [ dns_resolver_create shall allocate a new resolver and copy the host name. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_003: [ dns_resolver_create shall start a detached thread that performs the lookup. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_005: [ The lookup thread shall call getaddrinfo, or the function set with dns_resolver_set_lookup_functions, for the host name and port. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_010: [ dns_resolver_is_complete shall return true once the lookup completed, whether it succeeded or not. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_012: [ dns_resolver_get_addrinfo shall return the resolved addresses, or NULL if the lookup failed or is still running. ]*/
+TEST_FUNCTION(dns_resolver_resolves_a_numeric_address)
+{
+    ///arrange
+    const struct addrinfo* addr_info;
+    DNS_RESOLVER_HANDLE dns_resolver = dns_resolver_create("127.0.0.1", 4242);
+    ASSERT_IS_NOT_NULL(dns_resolver);
+
+    ///act
+    bool is_complete = wait_for_completion(dns_resolver);
+    addr_info = dns_resolver_get_addrinfo(dns_resolver);
+
+    ///assert
+    ASSERT_IS_TRUE(is_complete);
+    ASSERT_IS_NOT_NULL(addr_info);
+    ASSERT_ARE_EQUAL(int, AF_INET, addr_info->ai_family);
+    ASSERT_ARE_EQUAL(int, 4242, (int)ntohs(((const struct sockaddr_in*)addr_info->ai_addr)->sin_port));
+    ASSERT_ARE_EQUAL(int, (int)htonl(INADDR_LOOPBACK), (int)((const struct sockaddr_in*)addr_info->ai_addr)->sin_addr.s_addr);
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_006: [ If getaddrinfo fails, the lookup shall complete without addresses. ]*/
+TEST_FUNCTION(dns_resolver_completes_without_addresses_when_the_lookup_fails)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver = dns_resolver_create("", 4242);
+    ASSERT_IS_NOT_NULL(dns_resolver);
+
+    ///act
+    bool is_complete = wait_for_completion(dns_resolver);
+
+    ///assert
+    ASSERT_IS_TRUE(is_complete);
+    ASSERT_IS_NULL(dns_resolver_get_addrinfo(dns_resolver));
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* dns_resolver_destroy */
+
+/* Tests_SRS_DNS_RESOLVER_01_007: [ If dns_resolver is NULL, dns_resolver_destroy shall do nothing. ]*/
+TEST_FUNCTION(dns_resolver_destroy_with_NULL_does_nothing)
+{
+    ///act
+    dns_resolver_destroy(NULL);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_008: [ If the lookup is still running, dns_resolver_destroy shall return immediately and the resolver shall be freed when the lookup completes. ]*/
+TEST_FUNCTION(dns_resolver_destroy_while_the_lookup_runs_succeeds)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver = dns_resolver_create("localhost", 4242);
+    ASSERT_IS_NOT_NULL(dns_resolver);
+
+    ///act
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* dns_resolver_is_complete */
+
+/* Tests_SRS_DNS_RESOLVER_01_009: [ If dns_resolver is NULL, dns_resolver_is_complete shall return false. ]*/
+TEST_FUNCTION(dns_resolver_is_complete_with_NULL_returns_false)
+{
+    ///act
+    bool result = dns_resolver_is_complete(NULL);
+
+    ///assert
+    ASSERT_IS_FALSE(result);
+}
+
+/* dns_resolver_get_addrinfo */
+
+/* Tests_SRS_DNS_RESOLVER_01_011: [ If dns_resolver is NULL, dns_resolver_get_addrinfo shall return NULL. ]*/
+TEST_FUNCTION(dns_resolver_get_addrinfo_with_NULL_returns_NULL)
+{
+    ///act
+    const struct addrinfo* result = dns_resolver_get_addrinfo(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(result);
+}
+
+/* cache */
+
+/* Tests_SRS_DNS_RESOLVER_01_013: [ If the cache holds an unexpired result for hostname and port, dns_resolver_create shall return a resolver that is already complete with a copy of it. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_014: [ When a lookup succeeds, its addresses shall be cached for ttl_ms. ]*/
+/* Tests_SRS_DNS_RESOLVER_01_023: [ dns_resolver_set_lookup_functions shall make the lookups started afterwards call getaddrinfo_function and freeaddrinfo_function, or getaddrinfo and freeaddrinfo when both are NULL. ]*/
+TEST_FUNCTION(dns_resolver_create_returns_cached_addresses)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver;
+    const struct addrinfo* addr_info;
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("cached.example"));
+
+    ///act
+    dns_resolver = dns_resolver_create("cached.example", 4242);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver);
+    ASSERT_IS_TRUE(dns_resolver_is_complete(dns_resolver));
+    addr_info = dns_resolver_get_addrinfo(dns_resolver);
+    ASSERT_IS_NOT_NULL(addr_info);
+    ASSERT_ARE_EQUAL(int, 4242, (int)ntohs(((const struct sockaddr_in*)addr_info->ai_addr)->sin_port));
+    ASSERT_ARE_EQUAL(size_t, 1, g_lookup_count);
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_014: [ When a lookup succeeds, its addresses shall be cached for ttl_ms. ]*/
+TEST_FUNCTION(dns_resolver_create_looks_up_again_once_the_ttl_expired)
+{
+    ///arrange
+    set_cache_options(0, 0, 0, DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT);
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("expired.example"));
+
+    ///act
+    bool result = resolve("expired.example");
+
+    ///assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(size_t, 2, g_lookup_count);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_015: [ When a lookup fails, the failure shall be cached for negative_ttl_ms. ]*/
+TEST_FUNCTION(dns_resolver_create_returns_a_cached_failure)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver;
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    g_fail_lookups = 1;
+    ASSERT_IS_FALSE(resolve("missing.example"));
+
+    ///act
+    dns_resolver = dns_resolver_create("missing.example", 4242);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver);
+    ASSERT_IS_TRUE(dns_resolver_is_complete(dns_resolver));
+    ASSERT_IS_NULL(dns_resolver_get_addrinfo(dns_resolver));
+    ASSERT_ARE_EQUAL(size_t, 1, g_lookup_count);
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_016: [ If a lookup of the same hostname and port is running, dns_resolver_create shall return a handle to it instead of starting another one. ]*/
+TEST_FUNCTION(dns_resolver_create_shares_a_running_lookup)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver_1;
+    DNS_RESOLVER_HANDLE dns_resolver_2;
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    g_lookup_delay_ms = 100;
+    dns_resolver_1 = dns_resolver_create("shared.example", 4242);
+
+    ///act
+    dns_resolver_2 = dns_resolver_create("shared.example", 4242);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver_1);
+    ASSERT_IS_TRUE(dns_resolver_1 == dns_resolver_2);
+    ASSERT_IS_TRUE(wait_for_completion(dns_resolver_2));
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrinfo(dns_resolver_2));
+    ASSERT_ARE_EQUAL(size_t, 1, g_lookup_count);
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver_1);
+    dns_resolver_destroy(dns_resolver_2);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_017: [ If the cached addresses expired less than stale_ttl_ms ago, dns_resolver_create shall return them and start a background lookup that refreshes them, unless one is running. ]*/
+TEST_FUNCTION(dns_resolver_create_returns_stale_addresses_and_refreshes_them)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver;
+    set_cache_options(0, 0, 60000, DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT);
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("stale.example"));
+
+    ///act
+    dns_resolver = dns_resolver_create("stale.example", 4242);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver);
+    ASSERT_IS_TRUE(dns_resolver_is_complete(dns_resolver));
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrinfo(dns_resolver));
+    ASSERT_IS_TRUE(wait_for_lookup_count(2));
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_018: [ If the background lookup fails, the stale addresses shall be kept until stale_ttl_ms elapses. ]*/
+TEST_FUNCTION(dns_resolver_keeps_stale_addresses_when_the_refresh_fails)
+{
+    ///arrange
+    DNS_RESOLVER_HANDLE dns_resolver;
+    set_cache_options(0, 0, 60000, DNS_RESOLVER_DEFAULT_MAX_ENTRY_COUNT);
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("stale.example"));
+    g_fail_lookups = 1;
+    ASSERT_IS_TRUE(resolve("stale.example"));
+    ASSERT_IS_TRUE(wait_for_lookup_count(2));
+    sleep_ms(100);
+
+    ///act
+    dns_resolver = dns_resolver_create("stale.example", 4242);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(dns_resolver);
+    ASSERT_IS_TRUE(dns_resolver_is_complete(dns_resolver));
+    ASSERT_IS_NOT_NULL(dns_resolver_get_addrinfo(dns_resolver));
+
+    ///cleanup
+    dns_resolver_destroy(dns_resolver);
+    ASSERT_IS_TRUE(wait_for_lookup_count(3));
+}
+
+/* dns_resolver_set_cache_options */
+
+/* Tests_SRS_DNS_RESOLVER_01_019: [ If options is NULL, dns_resolver_set_cache_options shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(dns_resolver_set_cache_options_with_NULL_options_fails)
+{
+    ///act
+    int result = dns_resolver_set_cache_options(NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_020: [ dns_resolver_set_cache_options shall store the options and drop the least recently used entries that exceed max_entry_count. ]*/
+TEST_FUNCTION(dns_resolver_set_cache_options_with_no_entries_disables_the_cache)
+{
+    ///arrange
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("uncached.example"));
+
+    ///act
+    set_cache_options(DNS_RESOLVER_DEFAULT_TTL_MS, DNS_RESOLVER_DEFAULT_NEGATIVE_TTL_MS, 0, 0);
+    ASSERT_IS_TRUE(resolve("uncached.example"));
+    ASSERT_IS_TRUE(resolve("uncached.example"));
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_lookup_count);
+}
+
+/* Tests_SRS_DNS_RESOLVER_01_020: [ dns_resolver_set_cache_options shall store the options and drop the least recently used entries that exceed max_entry_count. ]*/
+TEST_FUNCTION(dns_resolver_drops_the_least_recently_used_entry)
+{
+    ///arrange
+    set_cache_options(DNS_RESOLVER_DEFAULT_TTL_MS, DNS_RESOLVER_DEFAULT_NEGATIVE_TTL_MS, 0, 2);
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("a.example"));
+    ASSERT_IS_TRUE(resolve("b.example"));
+    ASSERT_IS_TRUE(resolve("a.example"));
+
+    ///act
+    ASSERT_IS_TRUE(resolve("c.example"));
+
+    ///assert
+    ASSERT_IS_TRUE(resolve("a.example"));
+    ASSERT_ARE_EQUAL(size_t, 3, g_lookup_count);
+    ASSERT_IS_TRUE(resolve("b.example"));
+    ASSERT_ARE_EQUAL(size_t, 4, g_lookup_count);
+}
+
+/* dns_resolver_clear_cache */
+
+/* Tests_SRS_DNS_RESOLVER_01_021: [ dns_resolver_clear_cache shall drop all the cache entries. Running lookups shall complete normally. ]*/
+TEST_FUNCTION(dns_resolver_clear_cache_drops_the_cached_addresses)
+{
+    ///arrange
+    ASSERT_ARE_EQUAL(int, 0, dns_resolver_set_lookup_functions(stub_getaddrinfo, stub_freeaddrinfo));
+    ASSERT_IS_TRUE(resolve("cleared.example"));
+
+    ///act
+    dns_resolver_clear_cache();
+
+    ///assert
+    ASSERT_IS_TRUE(resolve("cleared.example"));
+    ASSERT_ARE_EQUAL(size_t, 2, g_lookup_count);
+}
+
+/* dns_resolver_set_lookup_functions */
+
+/* Tests_SRS_DNS_RESOLVER_01_022: [ If only one of getaddrinfo_function and freeaddrinfo_function is NULL, dns_resolver_set_lookup_functions shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(dns_resolver_set_lookup_functions_with_only_one_function_fails)
+{
+    ///act
+    int result = dns_resolver_set_lookup_functions(stub_getaddrinfo, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+END_TEST_SUITE(dns_resolver_unittests)
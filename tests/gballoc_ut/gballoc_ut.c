@@ -28,6 +28,8 @@ static void* TEST_REALLOC_PTR = (void*)0x4245;
 #define OVERHEAD_SIZE	4096
 static const LOCK_HANDLE TEST_LOCK_HANDLE = (LOCK_HANDLE)0x4244;
 
+#include "umocktypes_charptr.h"
+
 #define ENABLE_MOCKS
 
 #include "umock_c.h"
@@ -43,7 +45,7 @@ extern "C" {
     MOCKABLE_FUNCTION(, void*, mock_realloc, void*, ptr, size_t, size);
     MOCKABLE_FUNCTION(, void, mock_free, void*, ptr);
 
-    MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init);
+    MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init_Named, const char*, name);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, handle);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Lock, LOCK_HANDLE, handle);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Unlock, LOCK_HANDLE, handle);
@@ -78,12 +80,13 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 
     REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
     REGISTER_TYPE(LOCK_RESULT, LOCK_RESULT);
+    (void)umocktypes_charptr_register_types();
 
     REGISTER_GLOBAL_MOCK_RETURN(mock_malloc, TEST_ALLOC_PTR1);
     REGISTER_GLOBAL_MOCK_RETURN(mock_realloc, TEST_ALLOC_PTR1);
     REGISTER_GLOBAL_MOCK_RETURN(mock_calloc, TEST_ALLOC_PTR1);
 
-    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init_Named, TEST_LOCK_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
     REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
 }
@@ -144,7 +147,7 @@ TEST_FUNCTION(gballoc_init_resets_memory_used)
 TEST_FUNCTION(when_gballoc_init_calls_lock_init_and_it_succeeds_then_gballoc_init_succeeds)
 {
     // arrange
-    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Lock_Init_Named("gballoc"));
 
     // act
     int result = gballoc_init();
@@ -158,7 +161,7 @@ TEST_FUNCTION(when_gballoc_init_calls_lock_init_and_it_succeeds_then_gballoc_ini
 TEST_FUNCTION(when_lock_init_fails_gballoc_init_fails)
 {
     // arrange
-    STRICT_EXPECTED_CALL(Lock_Init())
+    STRICT_EXPECTED_CALL(Lock_Init_Named("gballoc"))
         .SetReturn((LOCK_HANDLE)NULL);
 
     // act
@@ -173,7 +176,7 @@ TEST_FUNCTION(when_lock_init_fails_gballoc_init_fails)
 TEST_FUNCTION(gballoc_init_after_gballoc_init_fails)
 {
     // arrange
-    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Lock_Init_Named("gballoc"));
     gballoc_init();
 
     //act
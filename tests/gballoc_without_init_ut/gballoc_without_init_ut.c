@@ -22,6 +22,8 @@ static TEST_MUTEX_HANDLE g_testByTest;
 static void* TEST_ALLOC_PTR1 = (void*)0x4242;
 static const LOCK_HANDLE TEST_LOCK_HANDLE = (LOCK_HANDLE)0x4244;
 
+#include "umocktypes_charptr.h"
+
 #define ENABLE_MOCKS
 
 #include "umock_c.h"
@@ -38,7 +40,7 @@ extern "C" {
     MOCKABLE_FUNCTION(, void*, mock_realloc, void*, ptr, size_t, size);
     MOCKABLE_FUNCTION(, void, mock_free, void*, ptr);
 
-    MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init);
+    MOCKABLE_FUNCTION(, LOCK_HANDLE, Lock_Init_Named, const char*, name);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, handle);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Lock, LOCK_HANDLE, handle);
     MOCKABLE_FUNCTION(, LOCK_RESULT, Unlock, LOCK_HANDLE, handle);
@@ -70,12 +72,13 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 
     REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
     REGISTER_TYPE(LOCK_RESULT, LOCK_RESULT);
+    (void)umocktypes_charptr_register_types();
 
     REGISTER_GLOBAL_MOCK_RETURN(mock_malloc, TEST_ALLOC_PTR1);
     REGISTER_GLOBAL_MOCK_RETURN(mock_realloc, TEST_ALLOC_PTR1);
     REGISTER_GLOBAL_MOCK_RETURN(mock_calloc, TEST_ALLOC_PTR1);
 
-    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init, TEST_LOCK_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock_Init_Named, TEST_LOCK_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
     REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
 }
@@ -0,0 +1,277 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/io_loop.h"
+#include "azure_c_shared_utility/timer_wheel.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static int g_pipe_fds[2];
+static size_t g_event_count;
+static unsigned int g_last_events;
+static size_t g_timer_expired_count;
+static IO_LOOP_REGISTRATION_HANDLE g_registrations[2];
+static int g_unregister_other;
+
+static void test_on_io_loop_event(void* context, unsigned int events)
+{
+    char byte;
+    size_t index = (size_t)context;
+    g_event_count++;
+    g_last_events = events;
+
+    if ((events & IO_LOOP_EVENT_READ) != 0)
+    {
+        (void)read(g_pipe_fds[0], &byte, 1);
+    }
+
+    if (g_unregister_other)
+    {
+        io_loop_unregister(g_registrations[1 - index]);
+        g_registrations[1 - index] = NULL;
+        g_unregister_other = 0;
+    }
+}
+
+static void test_on_timer_expired(void* context)
+{
+    (void)context;
+    g_timer_expired_count++;
+}
+
+BEGIN_TEST_SUITE(io_loop_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    ASSERT_ARE_EQUAL(int, 0, pipe(g_pipe_fds));
+    (void)fcntl(g_pipe_fds[0], F_SETFL, fcntl(g_pipe_fds[0], F_GETFL, 0) | O_NONBLOCK);
+    g_event_count = 0;
+    g_last_events = 0;
+    g_timer_expired_count = 0;
+    g_registrations[0] = NULL;
+    g_registrations[1] = NULL;
+    g_unregister_other = 0;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    (void)close(g_pipe_fds[0]);
+    (void)close(g_pipe_fds[1]);
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* io_loop_create */
+
+/* Tests_SRS_IO_LOOP_01_001: [ io_loop_create shall allocate a new io loop, create an epoll instance and a timer wheel. ]*/
+/* Tests_SRS_IO_LOOP_01_021: [ io_loop_get_timer_wheel shall return the timer wheel owned by the io loop. ]*/
+TEST_FUNCTION(io_loop_create_succeeds)
+{
+    ///act
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+
+    ///assert
+    ASSERT_IS_NOT_NULL(io_loop);
+    ASSERT_IS_NOT_NULL(io_loop_get_timer_wheel(io_loop));
+
+    ///cleanup
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_003: [ If io_loop is NULL, io_loop_destroy shall do nothing. ]*/
+TEST_FUNCTION(io_loop_destroy_with_NULL_does_nothing)
+{
+    ///act
+    io_loop_destroy(NULL);
+}
+
+/* io_loop_register */
+
+/* Tests_SRS_IO_LOOP_01_005: [ If io_loop or on_io_loop_event is NULL or fd is negative, io_loop_register shall fail and return NULL. ]*/
+TEST_FUNCTION(io_loop_register_with_NULL_callback_fails)
+{
+    ///arrange
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+
+    ///act
+    IO_LOOP_REGISTRATION_HANDLE registration = io_loop_register(io_loop, g_pipe_fds[0], IO_LOOP_EVENT_READ, NULL, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(registration);
+
+    ///cleanup
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_005: [ If io_loop or on_io_loop_event is NULL or fd is negative, io_loop_register shall fail and return NULL. ]*/
+TEST_FUNCTION(io_loop_register_with_negative_fd_fails)
+{
+    ///arrange
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+
+    ///act
+    IO_LOOP_REGISTRATION_HANDLE registration = io_loop_register(io_loop, -1, IO_LOOP_EVENT_READ, test_on_io_loop_event, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(registration);
+
+    ///cleanup
+    io_loop_destroy(io_loop);
+}
+
+/* io_loop_wait */
+
+/* Tests_SRS_IO_LOOP_01_014: [ If io_loop is NULL, io_loop_wait shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(io_loop_wait_with_NULL_io_loop_fails)
+{
+    ///act
+    int result = io_loop_wait(NULL, 0);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IO_LOOP_01_015: [ io_loop_wait shall block in epoll_wait for at most timeout_ms, or less if a timer of the timer wheel expires earlier. ]*/
+TEST_FUNCTION(io_loop_wait_without_ready_descriptors_times_out)
+{
+    ///arrange
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    IO_LOOP_REGISTRATION_HANDLE registration = io_loop_register(io_loop, g_pipe_fds[0], IO_LOOP_EVENT_READ, test_on_io_loop_event, NULL);
+
+    ///act
+    int result = io_loop_wait(io_loop, 10);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, g_event_count);
+
+    ///cleanup
+    io_loop_unregister(registration);
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_006: [ io_loop_register shall add fd to the epoll instance, watching for the requested events. ]*/
+/* Tests_SRS_IO_LOOP_01_017: [ io_loop_wait shall call on_io_loop_event for every ready descriptor that was not unregistered by a previous callback. ]*/
+TEST_FUNCTION(io_loop_wait_calls_the_callback_of_a_readable_descriptor)
+{
+    ///arrange
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    IO_LOOP_REGISTRATION_HANDLE registration = io_loop_register(io_loop, g_pipe_fds[0], IO_LOOP_EVENT_READ, test_on_io_loop_event, NULL);
+    ASSERT_ARE_EQUAL(int, 1, (int)write(g_pipe_fds[1], "x", 1));
+
+    ///act
+    int result = io_loop_wait(io_loop, 1000);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, g_event_count);
+    ASSERT_IS_TRUE((g_last_events & IO_LOOP_EVENT_READ) != 0);
+
+    ///cleanup
+    io_loop_unregister(registration);
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_009: [ io_loop_modify shall change the events watched for the descriptor. ]*/
+TEST_FUNCTION(io_loop_modify_starts_reporting_write_readiness)
+{
+    ///arrange
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    IO_LOOP_REGISTRATION_HANDLE registration = io_loop_register(io_loop, g_pipe_fds[1], 0, test_on_io_loop_event, NULL);
+    ASSERT_ARE_EQUAL(int, 0, io_loop_wait(io_loop, 0));
+    ASSERT_ARE_EQUAL(size_t, 0, g_event_count);
+
+    ///act
+    int result = io_loop_modify(registration, IO_LOOP_EVENT_WRITE);
+    ASSERT_ARE_EQUAL(int, 0, io_loop_wait(io_loop, 1000));
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, g_event_count);
+    ASSERT_IS_TRUE((g_last_events & IO_LOOP_EVENT_WRITE) != 0);
+
+    ///cleanup
+    io_loop_unregister(registration);
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_013: [ If events are being dispatched, io_loop_unregister shall defer freeing the registration until the dispatch completes, and no further events shall be reported for it. ]*/
+TEST_FUNCTION(io_loop_unregister_from_a_callback_suppresses_pending_events)
+{
+    ///arrange
+    size_t i;
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    g_registrations[0] = io_loop_register(io_loop, g_pipe_fds[0], IO_LOOP_EVENT_READ, test_on_io_loop_event, (void*)0);
+    g_registrations[1] = io_loop_register(io_loop, g_pipe_fds[1], IO_LOOP_EVENT_WRITE, test_on_io_loop_event, (void*)1);
+    ASSERT_ARE_EQUAL(int, 1, (int)write(g_pipe_fds[1], "x", 1));
+
+    ///act
+    /*both descriptors are ready, whichever callback runs first unregisters the other one*/
+    g_unregister_other = 1;
+    int result = io_loop_wait(io_loop, 1000);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, g_event_count);
+
+    ///cleanup
+    for (i = 0; i < 2; i++)
+    {
+        if (g_registrations[i] != NULL)
+        {
+            io_loop_unregister(g_registrations[i]);
+        }
+    }
+    io_loop_destroy(io_loop);
+}
+
+/* Tests_SRS_IO_LOOP_01_018: [ io_loop_wait shall then call timer_wheel_dowork to process the expired timers. ]*/
+TEST_FUNCTION(io_loop_wait_expires_timers)
+{
+    ///arrange
+    size_t i;
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    ASSERT_IS_NOT_NULL(timer_wheel_start_timer(io_loop_get_timer_wheel(io_loop), 20, test_on_timer_expired, NULL));
+
+    ///act
+    for (i = 0; (i < 100) && (g_timer_expired_count == 0); i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, io_loop_wait(io_loop, IO_LOOP_WAIT_INFINITE));
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_timer_expired_count);
+
+    ///cleanup
+    io_loop_destroy(io_loop);
+}
+
+END_TEST_SUITE(io_loop_unittests)
@@ -105,5 +105,74 @@ TEST_FUNCTION(Test_Lock_Init_DeInit_NULL)
     ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_ERROR, result);
 }
 
+/*Tests_SRS_LOCK_01_001: [ Lock_Init_Named shall create a lock handle the same way Lock_Init does ]*/
+TEST_FUNCTION(Test_Lock_Init_Named_Lock_Unlock)
+{
+    //arrange
+    LOCK_HANDLE handle = NULL;
+    LOCK_RESULT result;
+    //act
+    handle = Lock_Init_Named("test_lock");
+    LOCK_RESULT res = Lock_Handle_ToString(handle);
+    //assert
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, res);
+
+    result = Lock(handle);
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, result);
+    result = Unlock(handle);
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, result);
+    //free
+    result = Lock_Deinit(handle);
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, result);
+}
+
+/*Tests_SRS_LOCK_01_002: [ A NULL name shall be accepted and yield an unnamed lock ]*/
+TEST_FUNCTION(Test_Lock_Init_Named_NULL_name_succeeds)
+{
+    //arrange
+    LOCK_HANDLE handle = NULL;
+    //act
+    handle = Lock_Init_Named(NULL);
+    //assert
+    LOCK_RESULT res = Lock_Handle_ToString(handle);
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, res);
+    //free
+    LOCK_RESULT result = Lock_Deinit(handle);
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, result);
+}
+
+/*Tests_SRS_LOCK_01_004: [ Lock_GetStatistics on NULL handle passed returns LOCK_ERROR ]*/
+TEST_FUNCTION(Test_Lock_GetStatistics_NULL_handle_fails)
+{
+    //arrange
+    LOCK_STATISTICS statistics;
+    //act
+    LOCK_RESULT result = Lock_GetStatistics(NULL, &statistics);
+    //assert
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_ERROR, result);
+}
+
+#ifdef LOCK_COLLECT_STATISTICS
+/*Tests_SRS_LOCK_01_003: [ Lock_GetStatistics shall return the name, the number of acquisitions, the number of contended acquisitions and the cumulative wait time of the lock ]*/
+TEST_FUNCTION(Test_Lock_GetStatistics_counts_acquisitions)
+{
+    //arrange
+    LOCK_STATISTICS statistics;
+    LOCK_HANDLE handle = Lock_Init_Named("test_lock");
+    (void)Lock(handle);
+    (void)Unlock(handle);
+    (void)Lock(handle);
+    (void)Unlock(handle);
+    //act
+    LOCK_RESULT result = Lock_GetStatistics(handle, &statistics);
+    //assert
+    ASSERT_ARE_EQUAL(LOCK_RESULT, LOCK_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, "test_lock", statistics.name);
+    ASSERT_ARE_EQUAL(int, 2, (int)statistics.acquire_count);
+    ASSERT_ARE_EQUAL(int, 0, (int)statistics.contended_count);
+    //free
+    (void)Lock_Deinit(handle);
+}
+#endif
 
 END_TEST_SUITE(Lock_UnitTests);
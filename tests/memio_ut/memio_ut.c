@@ -0,0 +1,415 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/memio.h"
+
+#define TEST_MAX_RECEIVE_CALLS  16
+
+typedef struct TEST_ENDPOINT_TAG
+{
+    XIO_HANDLE xio;
+    IO_OPEN_RESULT open_result;
+    unsigned char received_bytes[64];
+    size_t received_count;
+    size_t receive_call_sizes[TEST_MAX_RECEIVE_CALLS];
+    size_t receive_call_count;
+    size_t error_count;
+    bool close_on_receive;
+} TEST_ENDPOINT;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static MEMIO_PIPE_HANDLE g_pipe;
+static TEST_ENDPOINT g_client;
+static TEST_ENDPOINT g_server;
+static size_t g_send_complete_count;
+static IO_SEND_RESULT g_send_result;
+
+static void test_on_io_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    ((TEST_ENDPOINT*)context)->open_result = open_result;
+}
+
+static void test_on_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    TEST_ENDPOINT* endpoint = (TEST_ENDPOINT*)context;
+
+    if (endpoint->received_count + size <= sizeof(endpoint->received_bytes))
+    {
+        (void)memcpy(endpoint->received_bytes + endpoint->received_count, buffer, size);
+        endpoint->received_count += size;
+    }
+
+    if (endpoint->receive_call_count < TEST_MAX_RECEIVE_CALLS)
+    {
+        endpoint->receive_call_sizes[endpoint->receive_call_count] = size;
+    }
+    endpoint->receive_call_count++;
+
+    if (endpoint->close_on_receive)
+    {
+        (void)xio_close(endpoint->xio, NULL, NULL);
+    }
+}
+
+static void test_on_io_error(void* context)
+{
+    ((TEST_ENDPOINT*)context)->error_count++;
+}
+
+static void test_on_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    (void)context;
+    g_send_complete_count++;
+    g_send_result = send_result;
+}
+
+static void create_pipe(uint32_t latency_us, uint64_t bandwidth, size_t chunk_size)
+{
+    MEMIO_PIPE_CONFIG pipe_config;
+    MEMIO_CONFIG client_config;
+    MEMIO_CONFIG server_config;
+
+    pipe_config.latency_us = latency_us;
+    pipe_config.bandwidth = bandwidth;
+    pipe_config.chunk_size = chunk_size;
+    pipe_config.manual_clock = true;
+    g_pipe = memio_pipe_create(&pipe_config);
+    ASSERT_IS_NOT_NULL(g_pipe);
+
+    client_config.pipe = g_pipe;
+    client_config.endpoint = MEMIO_ENDPOINT_CLIENT;
+    g_client.xio = xio_create(memio_get_interface_description(), &client_config);
+    ASSERT_IS_NOT_NULL(g_client.xio);
+
+    server_config.pipe = g_pipe;
+    server_config.endpoint = MEMIO_ENDPOINT_SERVER;
+    g_server.xio = xio_create(memio_get_interface_description(), &server_config);
+    ASSERT_IS_NOT_NULL(g_server.xio);
+}
+
+static void open_endpoint(TEST_ENDPOINT* endpoint)
+{
+    ASSERT_ARE_EQUAL(int, 0, xio_open(endpoint->xio, test_on_io_open_complete, endpoint, test_on_bytes_received, endpoint, test_on_io_error, endpoint));
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)endpoint->open_result);
+}
+
+static void open_pipe(uint32_t latency_us, uint64_t bandwidth, size_t chunk_size)
+{
+    create_pipe(latency_us, bandwidth, chunk_size);
+    open_endpoint(&g_client);
+    open_endpoint(&g_server);
+}
+
+BEGIN_TEST_SUITE(memio_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_pipe = NULL;
+    (void)memset(&g_client, 0, sizeof(g_client));
+    (void)memset(&g_server, 0, sizeof(g_server));
+    g_client.open_result = IO_OPEN_ERROR;
+    g_server.open_result = IO_OPEN_ERROR;
+    g_send_complete_count = 0;
+    g_send_result = IO_SEND_ERROR;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    xio_destroy(g_client.xio);
+    xio_destroy(g_server.xio);
+    memio_pipe_destroy(g_pipe);
+
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* memio_pipe_advance_time */
+
+/* Tests_SRS_MEMIO_01_006: [ If pipe is NULL or the pipe does not use a manual clock, memio_pipe_advance_time shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(memio_pipe_advance_time_without_a_manual_clock_fails)
+{
+    ///arrange
+    g_pipe = memio_pipe_create(NULL);
+    ASSERT_IS_NOT_NULL(g_pipe);
+
+    ///act
+    int result = memio_pipe_advance_time(g_pipe, 1);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* memio_create */
+
+/* Tests_SRS_MEMIO_01_008: [ If io_create_parameters is NULL, its pipe is NULL or its endpoint is not MEMIO_ENDPOINT_CLIENT or MEMIO_ENDPOINT_SERVER, memio_create shall fail and return NULL. ]*/
+TEST_FUNCTION(memio_create_with_NULL_parameters_fails)
+{
+    ///act
+    CONCRETE_IO_HANDLE memio = memio_create(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(memio);
+}
+
+/* Tests_SRS_MEMIO_01_009: [ If the endpoint is already used by another memio instance, memio_create shall fail and return NULL. ]*/
+TEST_FUNCTION(memio_create_for_an_endpoint_in_use_fails)
+{
+    ///arrange
+    MEMIO_CONFIG config;
+    create_pipe(0, 0, 0);
+    config.pipe = g_pipe;
+    config.endpoint = MEMIO_ENDPOINT_SERVER;
+
+    ///act
+    CONCRETE_IO_HANDLE memio = memio_create(&config);
+
+    ///assert
+    ASSERT_IS_NULL(memio);
+}
+
+/* Tests_SRS_MEMIO_01_005: [ memio_pipe_destroy shall release the reference of the creator, the pipe is freed when the memio instances of its endpoints are destroyed too. ]*/
+TEST_FUNCTION(memio_endpoints_keep_working_after_memio_pipe_destroy)
+{
+    ///arrange
+    open_pipe(0, 0, 0);
+    memio_pipe_destroy(g_pipe);
+    g_pipe = NULL;
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "ab", 2, NULL, NULL));
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_server.received_count);
+}
+
+/* memio_send */
+
+/* Tests_SRS_MEMIO_01_021: [ If the instance is not open or the peer endpoint was closed, memio_send shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(memio_send_when_not_open_fails)
+{
+    ///arrange
+    create_pipe(0, 0, 0);
+
+    ///act
+    int result = xio_send(g_client.xio, "a", 1, test_on_send_complete, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, g_send_complete_count);
+}
+
+/* Tests_SRS_MEMIO_01_024: [ When the bytes left the endpoint at once, memio_send shall call on_send_complete with IO_SEND_OK, otherwise memio_dowork shall call it once they left. ]*/
+/* Tests_SRS_MEMIO_01_029: [ memio_dowork shall pass the bytes that are due to on_bytes_received, in the order they were sent and at most chunk_size bytes per call when chunk_size is not 0. ]*/
+TEST_FUNCTION(memio_send_without_limits_is_received_by_the_next_dowork_of_the_peer)
+{
+    ///arrange
+    open_pipe(0, 0, 0);
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "abc", 3, test_on_send_complete, NULL));
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "de", 2, test_on_send_complete, NULL));
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_send_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_SEND_OK, (int)g_send_result);
+    ASSERT_ARE_EQUAL(size_t, 5, g_server.received_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(g_server.received_bytes, "abcde", 5));
+    ASSERT_ARE_EQUAL(size_t, 0, g_client.received_count);
+}
+
+/* Tests_SRS_MEMIO_01_023: [ memio_send shall copy the bytes and queue them for the peer, due latency_us after they left the endpoint. ]*/
+TEST_FUNCTION(memio_send_is_received_after_the_latency)
+{
+    ///arrange
+    open_pipe(1000, 0, 0);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_server.xio, "xy", 2, NULL, NULL));
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, memio_pipe_advance_time(g_pipe, 999));
+    xio_dowork(g_client.xio);
+    size_t received_before_latency = g_client.received_count;
+    ASSERT_ARE_EQUAL(int, 0, memio_pipe_advance_time(g_pipe, 1));
+    xio_dowork(g_client.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 0, received_before_latency);
+    ASSERT_ARE_EQUAL(size_t, 2, g_client.received_count);
+}
+
+/* Tests_SRS_MEMIO_01_022: [ When the pipe has a bandwidth, the bytes shall leave the endpoint at that rate once the bytes sent before them left. ]*/
+/* Tests_SRS_MEMIO_01_028: [ memio_dowork shall call on_send_complete with IO_SEND_OK for the sends whose bytes left the endpoint. ]*/
+TEST_FUNCTION(memio_send_is_paced_by_the_bandwidth)
+{
+    ///arrange
+    /* 1000 bytes per second, each byte takes 1 ms */
+    open_pipe(0, 1000, 0);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "0123456789", 10, test_on_send_complete, NULL));
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "abcde", 5, test_on_send_complete, NULL));
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, memio_pipe_advance_time(g_pipe, 10000));
+    xio_dowork(g_client.xio);
+    xio_dowork(g_server.xio);
+    size_t completed_after_first_send = g_send_complete_count;
+    size_t received_after_first_send = g_server.received_count;
+    ASSERT_ARE_EQUAL(int, 0, memio_pipe_advance_time(g_pipe, 5000));
+    xio_dowork(g_client.xio);
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, completed_after_first_send);
+    ASSERT_ARE_EQUAL(size_t, 10, received_after_first_send);
+    ASSERT_ARE_EQUAL(size_t, 2, g_send_complete_count);
+    ASSERT_ARE_EQUAL(size_t, 15, g_server.received_count);
+}
+
+/* Tests_SRS_MEMIO_01_029: [ memio_dowork shall pass the bytes that are due to on_bytes_received, in the order they were sent and at most chunk_size bytes per call when chunk_size is not 0. ]*/
+TEST_FUNCTION(memio_dowork_delivers_chunk_size_bytes_per_call)
+{
+    ///arrange
+    open_pipe(0, 0, 4);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "0123456789", 10, NULL, NULL));
+
+    ///act
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_server.receive_call_count);
+    ASSERT_ARE_EQUAL(size_t, 4, g_server.receive_call_sizes[0]);
+    ASSERT_ARE_EQUAL(size_t, 4, g_server.receive_call_sizes[1]);
+    ASSERT_ARE_EQUAL(size_t, 2, g_server.receive_call_sizes[2]);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(g_server.received_bytes, "0123456789", 10));
+}
+
+/* Tests_SRS_MEMIO_01_029: [ memio_dowork shall pass the bytes that are due to on_bytes_received, in the order they were sent and at most chunk_size bytes per call when chunk_size is not 0. ]*/
+TEST_FUNCTION(memio_bytes_sent_before_the_peer_opens_are_received_once_it_opens)
+{
+    ///arrange
+    create_pipe(0, 0, 0);
+    open_endpoint(&g_client);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "early", 5, NULL, NULL));
+    xio_dowork(g_server.xio);
+    size_t received_before_open = g_server.received_count;
+
+    ///act
+    open_endpoint(&g_server);
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 0, received_before_open);
+    ASSERT_ARE_EQUAL(size_t, 5, g_server.received_count);
+}
+
+/* memio_close */
+
+/* Tests_SRS_MEMIO_01_018: [ memio_close shall shut the endpoint down: the bytes not yet delivered to it are dropped, its pending sends complete with IO_SEND_CANCELLED and the peer gets an error once it received the bytes sent before the close. ]*/
+/* Tests_SRS_MEMIO_01_030: [ Once the peer endpoint was closed and all the bytes it sent were received, memio_dowork shall call on_io_error. ]*/
+TEST_FUNCTION(memio_close_makes_the_peer_report_an_error_after_the_last_bytes)
+{
+    ///arrange
+    open_pipe(0, 0, 0);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "bye", 3, NULL, NULL));
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, xio_close(g_client.xio, NULL, NULL));
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_server.received_count);
+    ASSERT_ARE_EQUAL(size_t, 1, g_server.error_count);
+    ASSERT_ARE_NOT_EQUAL(int, 0, xio_send(g_server.xio, "a", 1, NULL, NULL));
+}
+
+/* Tests_SRS_MEMIO_01_018: [ memio_close shall shut the endpoint down: the bytes not yet delivered to it are dropped, its pending sends complete with IO_SEND_CANCELLED and the peer gets an error once it received the bytes sent before the close. ]*/
+TEST_FUNCTION(memio_close_cancels_the_pending_sends)
+{
+    ///arrange
+    open_pipe(0, 1000, 0);
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "abc", 3, test_on_send_complete, NULL));
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, xio_close(g_client.xio, NULL, NULL));
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_send_complete_count);
+    ASSERT_ARE_EQUAL(int, (int)IO_SEND_CANCELLED, (int)g_send_result);
+}
+
+/* Tests_SRS_MEMIO_01_018: [ memio_close shall shut the endpoint down: the bytes not yet delivered to it are dropped, its pending sends complete with IO_SEND_CANCELLED and the peer gets an error once it received the bytes sent before the close. ]*/
+TEST_FUNCTION(memio_close_from_on_bytes_received_stops_the_delivery)
+{
+    ///arrange
+    open_pipe(0, 0, 2);
+    g_server.close_on_receive = true;
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "abcdef", 6, NULL, NULL));
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_client.xio, "gh", 2, NULL, NULL));
+
+    ///act
+    xio_dowork(g_server.xio);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_server.receive_call_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_server.error_count);
+}
+
+/* Tests_SRS_MEMIO_01_015: [ If the instance is not closed or its endpoint was already closed once, memio_open shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(memio_open_after_close_fails)
+{
+    ///arrange
+    open_pipe(0, 0, 0);
+    ASSERT_ARE_EQUAL(int, 0, xio_close(g_client.xio, NULL, NULL));
+
+    ///act
+    int result = xio_open(g_client.xio, test_on_io_open_complete, &g_client, test_on_bytes_received, &g_client, test_on_io_error, &g_client);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* memio_setoption */
+
+/* Tests_SRS_MEMIO_01_032: [ memio has no options, memio_setoption shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(memio_setoption_fails)
+{
+    ///arrange
+    int value = 1;
+    create_pipe(0, 0, 0);
+
+    ///act
+    int result = xio_setoption(g_client.xio, "tcp_nodelay", &value);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+END_TEST_SUITE(memio_unittests)
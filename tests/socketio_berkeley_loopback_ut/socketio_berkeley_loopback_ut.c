@@ -0,0 +1,505 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/socketio.h"
+#include "azure_c_shared_utility/optionhandler.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+
+/* the peer shrinks its receive window and socketio its send buffer so that this much cannot be absorbed by the kernel */
+#define TEST_PAYLOAD_SIZE           (4 * 1024 * 1024)
+#define TEST_SOCKET_BUFFER_SIZE     4096
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static unsigned char* g_payload;
+static size_t g_on_writable_count;
+static size_t g_pending_send_bytes_on_writable;
+
+typedef struct TEST_CONNECTION_TAG
+{
+    int client;
+    int accepted_socket;
+    CONCRETE_IO_HANDLE socket_io;
+} TEST_CONNECTION;
+
+static void test_on_io_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    *(IO_OPEN_RESULT*)context = open_result;
+}
+
+static void test_on_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    (void)buffer;
+    (void)size;
+}
+
+static void test_on_io_error(void* context)
+{
+    (void)context;
+}
+
+static void test_on_writable(void* context)
+{
+    XIO_STATISTICS statistics;
+    ASSERT_ARE_EQUAL(int, 0, socketio_get_statistics((CONCRETE_IO_HANDLE)context, &statistics));
+    g_pending_send_bytes_on_writable = (size_t)statistics.pending_send_bytes;
+    g_on_writable_count++;
+}
+
+static void sleep_ms(long milliseconds)
+{
+    struct timespec delay;
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (milliseconds % 1000) * 1000000;
+    (void)nanosleep(&delay, NULL);
+}
+
+static size_t get_pending_send_bytes(CONCRETE_IO_HANDLE socket_io)
+{
+    XIO_STATISTICS statistics;
+    ASSERT_ARE_EQUAL(int, 0, socketio_get_statistics(socket_io, &statistics));
+    return (size_t)statistics.pending_send_bytes;
+}
+
+/* connects a blocking client to a socketio wrapping the accepted end of the connection, the same way the listener does */
+static void create_connection(TEST_CONNECTION* connection)
+{
+    struct sockaddr_in address;
+    socklen_t address_length = sizeof(address);
+    int receive_buffer_size = TEST_SOCKET_BUFFER_SIZE;
+    int send_buffer_size = TEST_SOCKET_BUFFER_SIZE;
+    int listening_socket = socket(AF_INET, SOCK_STREAM, 0);
+    SOCKETIO_CONFIG config;
+    IO_OPEN_RESULT open_result = IO_OPEN_ERROR;
+    ASSERT_IS_TRUE(listening_socket >= 0);
+
+    (void)memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_ARE_EQUAL(int, 0, bind(listening_socket, (struct sockaddr*)&address, sizeof(address)));
+    ASSERT_ARE_EQUAL(int, 0, listen(listening_socket, 1));
+    ASSERT_ARE_EQUAL(int, 0, getsockname(listening_socket, (struct sockaddr*)&address, &address_length));
+
+    connection->client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_IS_TRUE(connection->client >= 0);
+    /* set before connect so that the advertised window is small */
+    ASSERT_ARE_EQUAL(int, 0, setsockopt(connection->client, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size)));
+    ASSERT_ARE_EQUAL(int, 0, connect(connection->client, (struct sockaddr*)&address, sizeof(address)));
+
+    connection->accepted_socket = accept(listening_socket, NULL, NULL);
+    ASSERT_IS_TRUE(connection->accepted_socket >= 0);
+    ASSERT_ARE_EQUAL(int, 0, fcntl(connection->accepted_socket, F_SETFL, fcntl(connection->accepted_socket, F_GETFL, 0) | O_NONBLOCK));
+    (void)close(listening_socket);
+
+    config.hostname = NULL;
+    config.port = 0;
+    config.accepted_socket = &connection->accepted_socket;
+    connection->socket_io = socketio_create(&config);
+    ASSERT_IS_NOT_NULL(connection->socket_io);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(connection->socket_io, OPTION_TCP_SEND_BUFFER_SIZE, &send_buffer_size));
+    ASSERT_ARE_EQUAL(int, 0, socketio_open(connection->socket_io, test_on_io_open_complete, &open_result, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+}
+
+static void destroy_connection(TEST_CONNECTION* connection)
+{
+    /* socketio owns the accepted socket and closes it */
+    socketio_destroy(connection->socket_io);
+    (void)close(connection->client);
+}
+
+static void set_watermarks(CONCRETE_IO_HANDLE socket_io, size_t high_watermark, size_t low_watermark)
+{
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(socket_io, OPTION_SEND_HIGH_WATERMARK, &high_watermark));
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(socket_io, OPTION_SEND_LOW_WATERMARK, &low_watermark));
+}
+
+static void set_on_writable(CONCRETE_IO_HANDLE socket_io)
+{
+    XIO_WRITABLE_CALLBACK on_writable;
+    on_writable.on_writable = test_on_writable;
+    on_writable.context = socket_io;
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(socket_io, OPTION_ON_WRITABLE, &on_writable));
+}
+
+/* reads what the client has received without blocking, returns the number of bytes read */
+static size_t drain_client(int client)
+{
+    static unsigned char buffer[64 * 1024];
+    size_t result = 0;
+    ssize_t received;
+
+    do
+    {
+        received = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0)
+        {
+            result += (size_t)received;
+        }
+    } while (received > 0);
+
+    return result;
+}
+
+BEGIN_TEST_SUITE(socketio_berkeley_loopback_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    g_payload = (unsigned char*)calloc(1, TEST_PAYLOAD_SIZE);
+    ASSERT_IS_NOT_NULL(g_payload);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    free(g_payload);
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_on_writable_count = 0;
+    g_pending_send_bytes_on_writable = 0;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* socketio_send */
+
+TEST_FUNCTION(socketio_send_without_a_high_watermark_queues_everything)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    create_connection(&connection);
+
+    ///act
+    int result_1 = socketio_send(connection.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL);
+    int result_2 = socketio_send(connection.socket_io, g_payload, 1, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result_1);
+    ASSERT_ARE_EQUAL(int, 0, result_2);
+    ASSERT_IS_TRUE(get_pending_send_bytes(connection.socket_io) > 0);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_send_below_the_high_watermark_succeeds)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    create_connection(&connection);
+    set_watermarks(connection.socket_io, 2 * TEST_PAYLOAD_SIZE, 0);
+
+    ///act
+    int result_1 = socketio_send(connection.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL);
+    int result_2 = socketio_send(connection.socket_io, g_payload, 1, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result_1);
+    ASSERT_ARE_EQUAL(int, 0, result_2);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_send_at_the_high_watermark_returns_XIO_SEND_WOULD_BLOCK)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    size_t pending_send_bytes;
+    create_connection(&connection);
+    set_watermarks(connection.socket_io, 1, 0);
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(connection.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL));
+    pending_send_bytes = get_pending_send_bytes(connection.socket_io);
+    ASSERT_IS_TRUE(pending_send_bytes > 0);
+
+    ///act
+    int result = socketio_send(connection.socket_io, g_payload, 1, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, result);
+    /* the refused bytes are not queued */
+    ASSERT_ARE_EQUAL(size_t, pending_send_bytes, get_pending_send_bytes(connection.socket_io));
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_send_vectored_at_the_high_watermark_returns_XIO_SEND_WOULD_BLOCK)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    XIO_BUFFER buffers[2];
+    create_connection(&connection);
+    set_watermarks(connection.socket_io, 1, 0);
+    buffers[0].buffer = g_payload;
+    buffers[0].size = TEST_PAYLOAD_SIZE / 2;
+    buffers[1].buffer = g_payload + (TEST_PAYLOAD_SIZE / 2);
+    buffers[1].size = TEST_PAYLOAD_SIZE / 2;
+    ASSERT_ARE_EQUAL(int, 0, socketio_send_vectored(connection.socket_io, buffers, 2, NULL, NULL));
+
+    ///act
+    int result = socketio_send_vectored(connection.socket_io, buffers, 1, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, result);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+/* OPTION_SEND_LOW_WATERMARK */
+
+TEST_FUNCTION(socketio_setoption_send_low_watermark_above_the_send_high_watermark_fails)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    size_t high_watermark = 1024;
+    size_t low_watermark = 1025;
+    create_connection(&connection);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(connection.socket_io, OPTION_SEND_HIGH_WATERMARK, &high_watermark));
+
+    ///act
+    int result = socketio_setoption(connection.socket_io, OPTION_SEND_LOW_WATERMARK, &low_watermark);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_setoption_send_high_watermark_below_the_send_low_watermark_fails)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    size_t high_watermark = 1024;
+    size_t low_watermark = 1025;
+    create_connection(&connection);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(connection.socket_io, OPTION_SEND_LOW_WATERMARK, &low_watermark));
+
+    ///act
+    int result = socketio_setoption(connection.socket_io, OPTION_SEND_HIGH_WATERMARK, &high_watermark);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_setoption_send_high_watermark_0_with_a_send_low_watermark_succeeds)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    size_t high_watermark = 0;
+    size_t low_watermark = 1025;
+    create_connection(&connection);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(connection.socket_io, OPTION_SEND_LOW_WATERMARK, &low_watermark));
+
+    ///act
+    int result = socketio_setoption(connection.socket_io, OPTION_SEND_HIGH_WATERMARK, &high_watermark);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_setoption_send_low_watermark_equal_to_the_send_high_watermark_succeeds)
+{
+    ///arrange
+    TEST_CONNECTION connection;
+    size_t watermark = 1024;
+    create_connection(&connection);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(connection.socket_io, OPTION_SEND_HIGH_WATERMARK, &watermark));
+
+    ///act
+    int result = socketio_setoption(connection.socket_io, OPTION_SEND_LOW_WATERMARK, &watermark);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+/* OPTION_ON_WRITABLE */
+
+TEST_FUNCTION(socketio_calls_on_writable_once_the_queue_drains_to_the_low_watermark)
+{
+    ///arrange
+    size_t i;
+    size_t low_watermark = TEST_PAYLOAD_SIZE / 4;
+    TEST_CONNECTION connection;
+    create_connection(&connection);
+    set_watermarks(connection.socket_io, TEST_PAYLOAD_SIZE / 2, low_watermark);
+    set_on_writable(connection.socket_io);
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(connection.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL));
+    ASSERT_IS_TRUE(get_pending_send_bytes(connection.socket_io) > low_watermark);
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, socketio_send(connection.socket_io, g_payload, 1, NULL, NULL));
+
+    ///act
+    for (i = 0; (i < 10000) && (g_on_writable_count == 0); i++)
+    {
+        (void)drain_client(connection.client);
+        socketio_dowork(connection.socket_io);
+        if (g_on_writable_count == 0)
+        {
+            /* not yet at the low watermark */
+            ASSERT_IS_TRUE(get_pending_send_bytes(connection.socket_io) > low_watermark);
+            sleep_ms(1);
+        }
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_on_writable_count);
+    ASSERT_IS_TRUE(g_pending_send_bytes_on_writable <= low_watermark);
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(connection.socket_io, g_payload, 1, NULL, NULL));
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+TEST_FUNCTION(socketio_does_not_call_on_writable_when_the_high_watermark_was_not_reached)
+{
+    ///arrange
+    size_t i;
+    size_t received = 0;
+    TEST_CONNECTION connection;
+    create_connection(&connection);
+    set_watermarks(connection.socket_io, 2 * TEST_PAYLOAD_SIZE, 0);
+    set_on_writable(connection.socket_io);
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(connection.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL));
+
+    ///act
+    for (i = 0; (i < 10000) && (received < TEST_PAYLOAD_SIZE); i++)
+    {
+        received += drain_client(connection.client);
+        socketio_dowork(connection.socket_io);
+        if (received < TEST_PAYLOAD_SIZE)
+        {
+            sleep_ms(1);
+        }
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, TEST_PAYLOAD_SIZE, received);
+    ASSERT_ARE_EQUAL(size_t, 0, get_pending_send_bytes(connection.socket_io));
+    ASSERT_ARE_EQUAL(size_t, 0, g_on_writable_count);
+
+    ///cleanup
+    destroy_connection(&connection);
+}
+
+/* socketio_retrieveoptions */
+
+TEST_FUNCTION(socketio_retrieveoptions_round_trips_the_socket_and_watermark_options)
+{
+    ///arrange
+    int no_delay = 1;
+    int socket_no_delay = 0;
+    socklen_t length = sizeof(socket_no_delay);
+    size_t receive_buffer_size = 2 * SOCKETIO_DEFAULT_RECEIVE_BUFFER_SIZE;
+    TEST_CONNECTION source;
+    TEST_CONNECTION destination;
+    OPTIONHANDLER_HANDLE options;
+    create_connection(&source);
+    create_connection(&destination);
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(source.socket_io, OPTION_TCP_NODELAY, &no_delay));
+    ASSERT_ARE_EQUAL(int, 0, socketio_setoption(source.socket_io, OPTION_RECEIVE_BUFFER_SIZE, &receive_buffer_size));
+    set_watermarks(source.socket_io, 1, 0);
+
+    ///act
+    options = socketio_get_interface_description()->concrete_io_retrieveoptions(source.socket_io);
+    ASSERT_IS_NOT_NULL(options);
+    /* the source is gone before the options are used, they have to be clones */
+    destroy_connection(&source);
+    OPTIONHANDLER_RESULT result = OptionHandler_FeedOptions(options, destination.socket_io);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)OPTIONHANDLER_OK, (int)result);
+    ASSERT_ARE_EQUAL(int, 0, getsockopt(destination.accepted_socket, IPPROTO_TCP, TCP_NODELAY, &socket_no_delay, &length));
+    ASSERT_ARE_NOT_EQUAL(int, 0, socket_no_delay);
+    /* the high watermark of 1 made it over */
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(destination.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL));
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, socketio_send(destination.socket_io, g_payload, 1, NULL, NULL));
+
+    ///cleanup
+    OptionHandler_Destroy(options);
+    destroy_connection(&destination);
+}
+
+TEST_FUNCTION(socketio_retrieveoptions_does_not_keep_on_writable)
+{
+    ///arrange
+    size_t i;
+    TEST_CONNECTION source;
+    TEST_CONNECTION destination;
+    OPTIONHANDLER_HANDLE options;
+    create_connection(&source);
+    create_connection(&destination);
+    set_watermarks(source.socket_io, 1, 0);
+    set_on_writable(source.socket_io);
+    options = socketio_get_interface_description()->concrete_io_retrieveoptions(source.socket_io);
+    ASSERT_IS_NOT_NULL(options);
+    ASSERT_ARE_EQUAL(int, (int)OPTIONHANDLER_OK, (int)OptionHandler_FeedOptions(options, destination.socket_io));
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(destination.socket_io, g_payload, TEST_PAYLOAD_SIZE, NULL, NULL));
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, socketio_send(destination.socket_io, g_payload, 1, NULL, NULL));
+
+    ///act
+    /* the callback context belongs to the source, the destination unblocks without calling it */
+    for (i = 0; (i < 10000) && (get_pending_send_bytes(destination.socket_io) > 0); i++)
+    {
+        (void)drain_client(destination.client);
+        socketio_dowork(destination.socket_io);
+        sleep_ms(1);
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 0, get_pending_send_bytes(destination.socket_io));
+    ASSERT_ARE_EQUAL(size_t, 0, g_on_writable_count);
+    ASSERT_ARE_EQUAL(int, 0, socketio_send(destination.socket_io, g_payload, 1, NULL, NULL));
+
+    ///cleanup
+    OptionHandler_Destroy(options);
+    destroy_connection(&source);
+    destroy_connection(&destination);
+}
+
+END_TEST_SUITE(socketio_berkeley_loopback_unittests)
@@ -9,6 +9,12 @@
 #include "azure_c_shared_utility/list.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/optionhandler.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/dns_resolver.h"
+#include "azure_c_shared_utility/timer_wheel.h"
+#ifdef __linux__
+#include "azure_c_shared_utility/io_loop.h"
+#endif
 
 #undef ENABLE_MOCKS
 
@@ -0,0 +1,521 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/socketio_listener.h"
+#include "azure_c_shared_utility/shared_util_options.h"
+#ifdef __linux__
+#include "azure_c_shared_utility/io_loop.h"
+#endif
+
+#define TEST_CONNECTION_COUNT   3
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static XIO_HANDLE g_accepted_ios[TEST_CONNECTION_COUNT];
+static size_t g_accepted_count;
+static unsigned char g_received_bytes[16];
+static size_t g_received_count;
+
+static void test_on_accept(void* context, XIO_HANDLE accepted_io)
+{
+    (void)context;
+    ASSERT_IS_TRUE(g_accepted_count < TEST_CONNECTION_COUNT);
+    g_accepted_ios[g_accepted_count++] = accepted_io;
+}
+
+static void test_on_io_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    *(IO_OPEN_RESULT*)context = open_result;
+}
+
+static void test_on_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    if (g_received_count + size <= sizeof(g_received_bytes))
+    {
+        (void)memcpy(g_received_bytes + g_received_count, buffer, size);
+        g_received_count += size;
+    }
+}
+
+static void test_on_io_error(void* context)
+{
+    (void)context;
+}
+
+static void sleep_ms(long milliseconds)
+{
+    struct timespec delay;
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (milliseconds % 1000) * 1000000;
+    (void)nanosleep(&delay, NULL);
+}
+
+static int connect_client(int port)
+{
+    struct sockaddr_in address;
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_IS_TRUE(client >= 0);
+
+    (void)memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_ARE_EQUAL(int, 0, connect(client, (struct sockaddr*)&address, sizeof(address)));
+
+    return client;
+}
+
+/* finds the accepted socket, it is the one whose peer is the client */
+static int find_accepted_socket(int client)
+{
+    int result = -1;
+    int fd;
+    struct sockaddr_in client_address;
+    socklen_t client_address_length = sizeof(client_address);
+    ASSERT_ARE_EQUAL(int, 0, getsockname(client, (struct sockaddr*)&client_address, &client_address_length));
+
+    for (fd = 0; (fd < 1024) && (result == -1); fd++)
+    {
+        struct sockaddr_in peer_address;
+        socklen_t peer_address_length = sizeof(peer_address);
+        if ((fd != client) &&
+            (getpeername(fd, (struct sockaddr*)&peer_address, &peer_address_length) == 0) &&
+            (peer_address.sin_family == AF_INET) &&
+            (peer_address.sin_port == client_address.sin_port))
+        {
+            result = fd;
+        }
+    }
+
+    return result;
+}
+
+static SOCKETIO_LISTENER_HANDLE create_loopback_listener(void)
+{
+    SOCKETIO_LISTENER_CONFIG config;
+    SOCKETIO_LISTENER_HANDLE listener;
+
+    config.address = "127.0.0.1";
+    config.port = 0;
+    config.backlog = 0;
+    listener = socketio_listener_create(&config);
+    ASSERT_IS_NOT_NULL(listener);
+
+    return listener;
+}
+
+BEGIN_TEST_SUITE(socketio_listener_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_accepted_count = 0;
+    g_received_count = 0;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    size_t i;
+
+    for (i = 0; i < g_accepted_count; i++)
+    {
+        xio_destroy(g_accepted_ios[i]);
+    }
+
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* socketio_listener_create */
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_001: [ If config is NULL or its port is not between 0 and 65535, socketio_listener_create shall fail and return NULL. ]*/
+TEST_FUNCTION(socketio_listener_create_with_NULL_config_fails)
+{
+    ///act
+    SOCKETIO_LISTENER_HANDLE listener = socketio_listener_create(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_001: [ If config is NULL or its port is not between 0 and 65535, socketio_listener_create shall fail and return NULL. ]*/
+TEST_FUNCTION(socketio_listener_create_with_an_invalid_port_fails)
+{
+    ///arrange
+    SOCKETIO_LISTENER_CONFIG config;
+    config.address = NULL;
+    config.port = 65536;
+    config.backlog = 0;
+
+    ///act
+    SOCKETIO_LISTENER_HANDLE listener = socketio_listener_create(&config);
+
+    ///assert
+    ASSERT_IS_NULL(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_004: [ If listener is NULL, socketio_listener_destroy shall do nothing. ]*/
+TEST_FUNCTION(socketio_listener_destroy_with_NULL_does_nothing)
+{
+    ///act
+    socketio_listener_destroy(NULL);
+}
+
+/* socketio_listener_start */
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_006: [ If listener or on_accept is NULL, socketio_listener_start shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_listener_start_with_NULL_on_accept_fails)
+{
+    ///arrange
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+
+    ///act
+    int result = socketio_listener_start(listener, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_010: [ If any error occurs, socketio_listener_start shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_listener_start_with_a_host_name_fails)
+{
+    ///arrange
+    SOCKETIO_LISTENER_CONFIG config;
+    SOCKETIO_LISTENER_HANDLE listener;
+    config.address = "not.a.numeric.address";
+    config.port = 0;
+    config.backlog = 0;
+    listener = socketio_listener_create(&config);
+    ASSERT_IS_NOT_NULL(listener);
+
+    ///act
+    int result = socketio_listener_start(listener, test_on_accept, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_007: [ If the listener is already started, socketio_listener_start shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_listener_start_twice_fails)
+{
+    ///arrange
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+
+    ///act
+    int result = socketio_listener_start(listener, test_on_accept, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_020: [ If listener or port is NULL, or the listener is not started, socketio_listener_get_port shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(socketio_listener_get_port_before_start_fails)
+{
+    ///arrange
+    int port;
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+
+    ///act
+    int result = socketio_listener_get_port(listener, &port);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* socketio_listener_dowork */
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_008: [ socketio_listener_start shall create a non-blocking socket bound to the configured address and port, with SO_REUSEADDR set, and listen on it with the configured backlog. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_013: [ socketio_listener_dowork shall accept at most SOCKETIO_LISTENER_ACCEPT_BATCH_SIZE connections, each as a non-blocking socket. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_014: [ socketio_listener_dowork shall stop accepting when there is no pending connection. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_015: [ Each accepted socket shall be wrapped in an XIO_HANDLE created with the socketio interface description. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_017: [ The XIO_HANDLE shall be passed to on_accept, which owns it from then on. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_021: [ socketio_listener_get_port shall return the port the listening socket is bound to. ]*/
+TEST_FUNCTION(socketio_listener_dowork_accepts_all_pending_connections)
+{
+    ///arrange
+    size_t i;
+    int port;
+    int clients[TEST_CONNECTION_COUNT];
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_get_port(listener, &port));
+    for (i = 0; i < TEST_CONNECTION_COUNT; i++)
+    {
+        clients[i] = connect_client(port);
+    }
+
+    ///act
+    for (i = 0; (i < 1000) && (g_accepted_count < TEST_CONNECTION_COUNT); i++)
+    {
+        socketio_listener_dowork(listener);
+        if (g_accepted_count < TEST_CONNECTION_COUNT)
+        {
+            sleep_ms(1);
+        }
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, TEST_CONNECTION_COUNT, g_accepted_count);
+
+    ///cleanup
+    for (i = 0; i < TEST_CONNECTION_COUNT; i++)
+    {
+        (void)close(clients[i]);
+    }
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_017: [ The XIO_HANDLE shall be passed to on_accept, which owns it from then on. ]*/
+TEST_FUNCTION(socketio_listener_accepted_io_receives_the_client_bytes)
+{
+    ///arrange
+    size_t i;
+    int port;
+    int client;
+    IO_OPEN_RESULT open_result = IO_OPEN_ERROR;
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_get_port(listener, &port));
+    client = connect_client(port);
+    for (i = 0; (i < 1000) && (g_accepted_count == 0); i++)
+    {
+        socketio_listener_dowork(listener);
+        sleep_ms(1);
+    }
+    ASSERT_ARE_EQUAL(size_t, 1, g_accepted_count);
+
+    ///act
+    ASSERT_ARE_EQUAL(int, 0, xio_open(g_accepted_ios[0], test_on_io_open_complete, &open_result, test_on_bytes_received, NULL, test_on_io_error, NULL));
+    ASSERT_ARE_EQUAL(int, 4, (int)send(client, "ping", 4, 0));
+    for (i = 0; (i < 1000) && (g_received_count < 4); i++)
+    {
+        xio_dowork(g_accepted_ios[0]);
+        sleep_ms(1);
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)IO_OPEN_OK, (int)open_result);
+    ASSERT_ARE_EQUAL(size_t, 4, g_received_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(g_received_bytes, "ping", 4));
+
+    ///cleanup
+    (void)close(client);
+    socketio_listener_destroy(listener);
+}
+
+/* socketio_listener_stop */
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_012: [ socketio_listener_stop shall close the listening socket. ]*/
+TEST_FUNCTION(socketio_listener_can_be_started_again_after_stop)
+{
+    ///arrange
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+
+    ///act
+    socketio_listener_stop(listener);
+    int result = socketio_listener_start(listener, test_on_accept, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* socketio_listener_setoption */
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_024: [ Any other option shall be validated with socketio_setoption and kept to be set on the accepted XIO_HANDLEs. ]*/
+TEST_FUNCTION(socketio_listener_setoption_with_an_unknown_option_fails)
+{
+    ///arrange
+    int value = 1;
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+
+    ///act
+    int result = socketio_listener_setoption(listener, "no_such_option", &value);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_016: [ The options set with socketio_listener_setoption shall be set on the XIO_HANDLE. ]*/
+TEST_FUNCTION(socketio_listener_sets_the_options_on_the_accepted_connections)
+{
+    ///arrange
+    size_t i;
+    int port;
+    int client;
+    int no_delay = 1;
+    int socket_no_delay = 0;
+    socklen_t length = sizeof(socket_no_delay);
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_setoption(listener, OPTION_TCP_NODELAY, &no_delay));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_get_port(listener, &port));
+    client = connect_client(port);
+
+    ///act
+    for (i = 0; (i < 1000) && (g_accepted_count == 0); i++)
+    {
+        socketio_listener_dowork(listener);
+        sleep_ms(1);
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_accepted_count);
+    ASSERT_ARE_EQUAL(int, 0, getsockopt(find_accepted_socket(client), IPPROTO_TCP, TCP_NODELAY, &socket_no_delay, &length));
+    ASSERT_ARE_NOT_EQUAL(int, 0, socket_no_delay);
+
+    ///cleanup
+    (void)close(client);
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_025: [ OPTION_ON_WRITABLE shall be refused, its callback context cannot be shared by all the accepted XIO_HANDLEs. ]*/
+TEST_FUNCTION(socketio_listener_setoption_with_OPTION_ON_WRITABLE_fails)
+{
+    ///arrange
+    XIO_WRITABLE_CALLBACK on_writable;
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    on_writable.on_writable = test_on_io_error;
+    on_writable.context = NULL;
+
+    ///act
+    int result = socketio_listener_setoption(listener, OPTION_ON_WRITABLE, &on_writable);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    socketio_listener_destroy(listener);
+}
+
+/* Tests_SRS_SOCKETIO_LISTENER_01_024: [ Any other option shall be validated with socketio_setoption and kept to be set on the accepted XIO_HANDLEs. The size_t options (OPTION_RECEIVE_BUFFER_SIZE, OPTION_SEND_HIGH_WATERMARK, OPTION_SEND_LOW_WATERMARK) shall be kept as size_t. ]*/
+TEST_FUNCTION(socketio_listener_sets_the_send_watermarks_on_the_accepted_connections)
+{
+    ///arrange
+    size_t i;
+    int port;
+    int client;
+    int receive_buffer_size = 4096;
+    size_t high_watermark = 1;
+    size_t low_watermark = 0;
+    size_t payload_size = 32 * 1024 * 1024;
+    unsigned char* payload = (unsigned char*)calloc(1, payload_size);
+    IO_OPEN_RESULT open_result = IO_OPEN_ERROR;
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_IS_NOT_NULL(payload);
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_setoption(listener, OPTION_SEND_HIGH_WATERMARK, &high_watermark));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_setoption(listener, OPTION_SEND_LOW_WATERMARK, &low_watermark));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_get_port(listener, &port));
+    client = connect_client(port);
+    ASSERT_ARE_EQUAL(int, 0, setsockopt(client, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size)));
+    for (i = 0; (i < 1000) && (g_accepted_count == 0); i++)
+    {
+        socketio_listener_dowork(listener);
+        sleep_ms(1);
+    }
+    ASSERT_ARE_EQUAL(size_t, 1, g_accepted_count);
+    ASSERT_ARE_EQUAL(int, 0, xio_open(g_accepted_ios[0], test_on_io_open_complete, &open_result, test_on_bytes_received, NULL, test_on_io_error, NULL));
+
+    ///act
+    /* the client does not read, what the socket does not take is queued and goes over the high watermark */
+    ASSERT_ARE_EQUAL(int, 0, xio_send(g_accepted_ios[0], payload, payload_size, NULL, NULL));
+    int result = xio_send(g_accepted_ios[0], payload, 1, NULL, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, result);
+
+    ///cleanup
+    (void)close(client);
+    socketio_listener_destroy(listener);
+    free(payload);
+}
+
+#ifdef __linux__
+/* Tests_SRS_SOCKETIO_LISTENER_01_009: [ If an io loop was set, socketio_listener_start shall register the listening socket with it. ]*/
+/* Tests_SRS_SOCKETIO_LISTENER_01_023: [ OPTION_IO_LOOP shall only be accepted before the listener is started and only once. ]*/
+TEST_FUNCTION(socketio_listener_accepts_connections_from_the_io_loop)
+{
+    ///arrange
+    size_t i;
+    int port;
+    int client;
+    IO_LOOP_HANDLE io_loop = io_loop_create();
+    SOCKETIO_LISTENER_HANDLE listener = create_loopback_listener();
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_setoption(listener, OPTION_IO_LOOP, io_loop));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_start(listener, test_on_accept, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, socketio_listener_setoption(listener, OPTION_IO_LOOP, io_loop));
+    ASSERT_ARE_EQUAL(int, 0, socketio_listener_get_port(listener, &port));
+    client = connect_client(port);
+
+    ///act
+    for (i = 0; (i < 100) && (g_accepted_count == 0); i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, io_loop_wait(io_loop, 10));
+    }
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_accepted_count);
+
+    ///cleanup
+    (void)close(client);
+    socketio_listener_destroy(listener);
+    xio_destroy(g_accepted_ios[0]);
+    g_accepted_count = 0;
+    io_loop_destroy(io_loop);
+}
+#endif
+
+END_TEST_SUITE(socketio_listener_unittests)
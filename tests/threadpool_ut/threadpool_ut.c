@@ -0,0 +1,309 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/threadpool.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/lock.h"
+
+#define TEST_WORK_ITEM_COUNT    1000
+#define TEST_WORK_RESULT        42
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static LOCK_HANDLE g_counters_lock;
+static size_t g_completed_count;
+static size_t g_cancelled_count;
+static size_t g_bad_result_count;
+static bool g_unblocking_work_item_ran;
+
+static int test_work_function(void* context)
+{
+    /*uneven work item sizes*/
+    volatile size_t spin = 0;
+    size_t i;
+    for (i = 0; i < (size_t)context * 100; i++)
+    {
+        spin += i;
+    }
+    return TEST_WORK_RESULT;
+}
+
+static int test_slow_work_function(void* context)
+{
+    (void)context;
+    ThreadAPI_Sleep(10);
+    return TEST_WORK_RESULT;
+}
+
+static bool has_unblocking_work_item_run(void)
+{
+    bool result;
+    (void)Lock(g_counters_lock);
+    result = g_unblocking_work_item_ran;
+    (void)Unlock(g_counters_lock);
+    return result;
+}
+
+/*keeps its worker busy until test_unblocking_work_function ran, gives up after 10 seconds and returns a bad result*/
+static int test_blocking_work_function(void* context)
+{
+    size_t i;
+    (void)context;
+    for (i = 0; (i < 1000) && (!has_unblocking_work_item_run()); i++)
+    {
+        ThreadAPI_Sleep(10);
+    }
+    return has_unblocking_work_item_run() ? TEST_WORK_RESULT : 0;
+}
+
+static int test_unblocking_work_function(void* context)
+{
+    (void)context;
+    (void)Lock(g_counters_lock);
+    g_unblocking_work_item_ran = true;
+    (void)Unlock(g_counters_lock);
+    return TEST_WORK_RESULT;
+}
+
+static void test_on_work_complete(void* context, THREADPOOL_WORK_RESULT work_result, int work_function_result)
+{
+    (void)context;
+    (void)Lock(g_counters_lock);
+    if (work_result == THREADPOOL_WORK_CANCELLED)
+    {
+        g_cancelled_count++;
+    }
+    else if (work_function_result == TEST_WORK_RESULT)
+    {
+        g_completed_count++;
+    }
+    else
+    {
+        g_bad_result_count++;
+    }
+    (void)Unlock(g_counters_lock);
+}
+
+BEGIN_TEST_SUITE(threadpool_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    g_counters_lock = Lock_Init();
+    ASSERT_IS_NOT_NULL(g_counters_lock);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    (void)Lock_Deinit(g_counters_lock);
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_completed_count = 0;
+    g_cancelled_count = 0;
+    g_bad_result_count = 0;
+    g_unblocking_work_item_ran = false;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* threadpool_create */
+
+/* Tests_SRS_THREADPOOL_01_001: [ If thread_count is 0 or mode is not a known THREADPOOL_MODE, threadpool_create shall fail and return NULL. ]*/
+TEST_FUNCTION(threadpool_create_with_0_threads_fails)
+{
+    ///act
+    THREADPOOL_HANDLE threadpool = threadpool_create(0, THREADPOOL_MODE_SHARED_QUEUE);
+
+    ///assert
+    ASSERT_IS_NULL(threadpool);
+}
+
+/* Tests_SRS_THREADPOOL_01_002: [ threadpool_create shall start thread_count worker threads by calling ThreadAPI_Create. ]*/
+TEST_FUNCTION(threadpool_create_and_destroy_succeeds)
+{
+    ///act
+    THREADPOOL_HANDLE threadpool = threadpool_create(4, THREADPOOL_MODE_SHARED_QUEUE);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(threadpool);
+
+    ///cleanup
+    threadpool_destroy(threadpool);
+}
+
+/* Tests_SRS_THREADPOOL_01_013: [ If threadpool is NULL, threadpool_destroy shall do nothing. ]*/
+TEST_FUNCTION(threadpool_destroy_with_NULL_does_nothing)
+{
+    ///act
+    threadpool_destroy(NULL);
+}
+
+/* threadpool_schedule_work */
+
+/* Tests_SRS_THREADPOOL_01_005: [ If threadpool or work_function is NULL, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(threadpool_schedule_work_with_NULL_threadpool_fails)
+{
+    ///act
+    int result = threadpool_schedule_work(NULL, test_work_function, NULL, test_on_work_complete, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_THREADPOOL_01_005: [ If threadpool or work_function is NULL, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(threadpool_schedule_work_with_NULL_work_function_fails)
+{
+    ///arrange
+    THREADPOOL_HANDLE threadpool = threadpool_create(1, THREADPOOL_MODE_SHARED_QUEUE);
+
+    ///act
+    int result = threadpool_schedule_work(threadpool, NULL, NULL, test_on_work_complete, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    threadpool_destroy(threadpool);
+}
+
+/* Tests_SRS_THREADPOOL_01_006: [ threadpool_schedule_work shall queue the work item, distributing work items round robin over the work queues, and wake up one idle worker. ]*/
+/* Tests_SRS_THREADPOOL_01_014: [ If the pool was not shut down, threadpool_destroy shall shut it down executing the queued work items, then free all resources. ]*/
+TEST_FUNCTION(threadpool_shared_queue_executes_all_work_items)
+{
+    ///arrange
+    size_t i;
+    THREADPOOL_HANDLE threadpool = threadpool_create(4, THREADPOOL_MODE_SHARED_QUEUE);
+
+    ///act
+    for (i = 0; i < TEST_WORK_ITEM_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_work_function, (void*)(i % 50), test_on_work_complete, NULL));
+    }
+    threadpool_destroy(threadpool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, TEST_WORK_ITEM_COUNT, g_completed_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_cancelled_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_bad_result_count);
+}
+
+/* Tests_SRS_THREADPOOL_01_004: [ In THREADPOOL_MODE_WORK_STEALING mode every worker shall own a work queue; in THREADPOOL_MODE_SHARED_QUEUE mode all workers shall share one queue. ]*/
+TEST_FUNCTION(threadpool_work_stealing_executes_all_work_items)
+{
+    ///arrange
+    size_t i;
+    THREADPOOL_HANDLE threadpool = threadpool_create(4, THREADPOOL_MODE_WORK_STEALING);
+
+    ///act
+    for (i = 0; i < TEST_WORK_ITEM_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_work_function, (void*)(i % 50), test_on_work_complete, NULL));
+    }
+    threadpool_destroy(threadpool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, TEST_WORK_ITEM_COUNT, g_completed_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_cancelled_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_bad_result_count);
+}
+
+/* Tests_SRS_THREADPOOL_01_004: [ In THREADPOOL_MODE_WORK_STEALING mode every worker shall own a work queue; in THREADPOOL_MODE_SHARED_QUEUE mode all workers shall share one queue. ]*/
+TEST_FUNCTION(threadpool_work_stealing_idle_worker_runs_the_items_queued_behind_a_busy_worker)
+{
+    ///arrange
+    THREADPOOL_HANDLE threadpool = threadpool_create(2, THREADPOOL_MODE_WORK_STEALING);
+
+    ///act
+    /*round robin puts the blocking and the unblocking items in the same queue; the worker running the blocking item
+    cannot get to the unblocking one, so it only runs if the other worker takes it from that queue*/
+    ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_blocking_work_function, NULL, test_on_work_complete, NULL));
+    ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_work_function, NULL, test_on_work_complete, NULL));
+    ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_unblocking_work_function, NULL, test_on_work_complete, NULL));
+    threadpool_destroy(threadpool);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_completed_count);
+    ASSERT_ARE_EQUAL(size_t, 0, g_bad_result_count);
+}
+
+/* threadpool_shutdown */
+
+/* Tests_SRS_THREADPOOL_01_009: [ If threadpool is NULL, threadpool_shutdown shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(threadpool_shutdown_with_NULL_fails)
+{
+    ///act
+    int result = threadpool_shutdown(NULL, false);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_THREADPOOL_01_012: [ If cancel_pending is true, the work items that have not started shall be removed and completed with THREADPOOL_WORK_CANCELLED after the workers are joined. ]*/
+TEST_FUNCTION(threadpool_shutdown_with_cancel_completes_every_work_item_once)
+{
+    ///arrange
+    size_t i;
+    THREADPOOL_HANDLE threadpool = threadpool_create(2, THREADPOOL_MODE_WORK_STEALING);
+    for (i = 0; i < 100; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, threadpool_schedule_work(threadpool, test_slow_work_function, NULL, test_on_work_complete, NULL));
+    }
+
+    ///act
+    int result = threadpool_shutdown(threadpool, true);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 100, g_completed_count + g_cancelled_count);
+    ASSERT_IS_TRUE(g_cancelled_count > 0);
+
+    ///cleanup
+    threadpool_destroy(threadpool);
+}
+
+/* Tests_SRS_THREADPOOL_01_007: [ If threadpool_shutdown has been called, threadpool_schedule_work shall fail and return a non-zero value. ]*/
+/* Tests_SRS_THREADPOOL_01_010: [ If the pool is already shut down, threadpool_shutdown shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(threadpool_after_shutdown_rejects_work_and_shutdown)
+{
+    ///arrange
+    THREADPOOL_HANDLE threadpool = threadpool_create(2, THREADPOOL_MODE_SHARED_QUEUE);
+    ASSERT_ARE_EQUAL(int, 0, threadpool_shutdown(threadpool, false));
+
+    ///act
+    int schedule_result = threadpool_schedule_work(threadpool, test_work_function, NULL, test_on_work_complete, NULL);
+    int shutdown_result = threadpool_shutdown(threadpool, false);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, schedule_result);
+    ASSERT_ARE_NOT_EQUAL(int, 0, shutdown_result);
+
+    ///cleanup
+    threadpool_destroy(threadpool);
+}
+
+END_TEST_SUITE(threadpool_unittests)
@@ -187,6 +187,92 @@ TEST_FUNCTION(tickcounter_get_current_ms_succeed)
     tickcounter_destroy(tickHandle);
 }
 
+TEST_FUNCTION(tickcounter_get_current_us_tick_counter_NULL_fail)
+{
+    ///arrange
+    uint64_t current_us = 0;
+
+    ///act
+    int result = tickcounter_get_current_us(NULL, &current_us);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+TEST_FUNCTION(tickcounter_get_current_us_current_us_NULL_fail)
+{
+    ///arrange
+    TICK_COUNTER_HANDLE tickHandle = tickcounter_create();
+    umock_c_reset_all_calls();
+
+    ///act
+    int result = tickcounter_get_current_us(tickHandle, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    tickcounter_destroy(tickHandle);
+}
+
+TEST_FUNCTION(tickcounter_get_current_us_succeed)
+{
+    ///arrange
+    TICK_COUNTER_HANDLE tickHandle = tickcounter_create();
+    umock_c_reset_all_calls();
+
+    uint64_t first_us = 0;
+    uint64_t next_us = 0;
+
+    ///act
+    int result = tickcounter_get_current_us(tickHandle, &first_us);
+    int resultAlso = tickcounter_get_current_us(tickHandle, &next_us);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, resultAlso);
+    ASSERT_IS_TRUE(next_us >= first_us);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    /// clean
+    tickcounter_destroy(tickHandle);
+}
+
+#ifdef __linux__
+TEST_FUNCTION(tickcounter_get_current_ms_has_sub_second_resolution)
+{
+    ///arrange
+    TICK_COUNTER_HANDLE tickHandle = tickcounter_create();
+    umock_c_reset_all_calls();
+
+    uint64_t start_us = 0;
+    uint64_t current_us = 0;
+    uint64_t start_ms = 0;
+    uint64_t current_ms = 0;
+    size_t i;
+
+    ASSERT_ARE_EQUAL(int, 0, tickcounter_get_current_ms(tickHandle, &start_ms));
+    ASSERT_ARE_EQUAL(int, 0, tickcounter_get_current_us(tickHandle, &start_us));
+
+    ///act
+    // busy loop for ~5 ms, far less than the 1 second resolution of time()
+    for (i = 0; i < BUSY_LOOP_TIME && current_us - start_us < 5000; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, tickcounter_get_current_us(tickHandle, &current_us));
+    }
+    ASSERT_ARE_EQUAL(int, 0, tickcounter_get_current_ms(tickHandle, &current_ms));
+
+    ///assert
+    ASSERT_IS_TRUE(current_us - start_us >= 5000);
+    ASSERT_IS_TRUE(current_ms - start_ms >= 4);
+    ASSERT_IS_TRUE(current_ms - start_ms < 1000);
+
+    /// clean
+    tickcounter_destroy(tickHandle);
+}
+#endif
+
 //TEST_FUNCTION(tickcounter_get_current_ms_validate_tick_succeed)
 //{
 //    ///arrange
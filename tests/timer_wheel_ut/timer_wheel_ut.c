@@ -0,0 +1,465 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_stdint.h"
+#include "azure_c_shared_utility/timer_wheel.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#undef ENABLE_MOCKS
+
+MOCKABLE_FUNCTION(, void, test_on_timer_expired, void*, context);
+
+#define TEST_TICK_COUNTER_HANDLE    (TICK_COUNTER_HANDLE)0x4242
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static uint64_t g_current_ms;
+static size_t g_expired_count;
+static uint64_t g_expired_at_ms;
+static TIMER_WHEEL_HANDLE g_timer_wheel_to_cancel_on;
+static TIMER_HANDLE g_timer_to_cancel;
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, uint64_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = g_current_ms;
+    return 0;
+}
+
+static void my_test_on_timer_expired(void* context)
+{
+    (void)context;
+    g_expired_count++;
+    g_expired_at_ms = g_current_ms;
+
+    if (g_timer_to_cancel != NULL)
+    {
+        (void)timer_wheel_cancel_timer(g_timer_wheel_to_cancel_on, g_timer_to_cancel);
+        g_timer_to_cancel = NULL;
+    }
+}
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static void advance_and_dowork(TIMER_WHEEL_HANDLE timer_wheel, uint64_t ms, uint64_t step_ms)
+{
+    uint64_t target_ms = g_current_ms + ms;
+    while (g_current_ms < target_ms)
+    {
+        g_current_ms += ((target_ms - g_current_ms) < step_ms) ? (target_ms - g_current_ms) : step_ms;
+        timer_wheel_dowork(timer_wheel);
+    }
+}
+
+BEGIN_TEST_SUITE(timer_wheel_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, TEST_TICK_COUNTER_HANDLE);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
+    REGISTER_GLOBAL_MOCK_HOOK(test_on_timer_expired, my_test_on_timer_expired);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_current_ms = 1000;
+    g_expired_count = 0;
+    g_expired_at_ms = 0;
+    g_timer_wheel_to_cancel_on = NULL;
+    g_timer_to_cancel = NULL;
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* timer_wheel_create */
+
+/* Tests_SRS_TIMER_WHEEL_01_001: [ timer_wheel_create shall allocate a new timer wheel and create its tick counter by calling tickcounter_create. ]*/
+TEST_FUNCTION(timer_wheel_create_succeeds)
+{
+    ///arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+
+    ///act
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+
+    ///assert
+    ASSERT_IS_NOT_NULL(timer_wheel);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_002: [ If any error occurs, timer_wheel_create shall fail and return NULL. ]*/
+TEST_FUNCTION(when_tickcounter_create_fails_timer_wheel_create_fails)
+{
+    ///arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_create())
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+
+    ///assert
+    ASSERT_IS_NULL(timer_wheel);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_002: [ If any error occurs, timer_wheel_create shall fail and return NULL. ]*/
+TEST_FUNCTION(when_malloc_fails_timer_wheel_create_fails)
+{
+    ///arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(NULL);
+
+    ///act
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+
+    ///assert
+    ASSERT_IS_NULL(timer_wheel);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_wheel_destroy */
+
+/* Tests_SRS_TIMER_WHEEL_01_003: [ If timer_wheel is NULL, timer_wheel_destroy shall do nothing. ]*/
+TEST_FUNCTION(timer_wheel_destroy_with_NULL_does_nothing)
+{
+    ///act
+    timer_wheel_destroy(NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_004: [ timer_wheel_destroy shall free all the running timers without calling their callbacks, destroy the tick counter and free the timer wheel. ]*/
+TEST_FUNCTION(timer_wheel_destroy_frees_running_timers)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    timer_wheel_destroy(timer_wheel);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_wheel_start_timer */
+
+/* Tests_SRS_TIMER_WHEEL_01_005: [ If timer_wheel or on_timer_expired is NULL, timer_wheel_start_timer shall fail and return NULL. ]*/
+TEST_FUNCTION(timer_wheel_start_timer_with_NULL_timer_wheel_fails)
+{
+    ///act
+    TIMER_HANDLE timer = timer_wheel_start_timer(NULL, 10, test_on_timer_expired, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(timer);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_005: [ If timer_wheel or on_timer_expired is NULL, timer_wheel_start_timer shall fail and return NULL. ]*/
+TEST_FUNCTION(timer_wheel_start_timer_with_NULL_callback_fails)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    umock_c_reset_all_calls();
+
+    ///act
+    TIMER_HANDLE timer = timer_wheel_start_timer(timer_wheel, 10, NULL, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(timer);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_007: [ If any error occurs, timer_wheel_start_timer shall fail and return NULL. ]*/
+TEST_FUNCTION(when_malloc_fails_timer_wheel_start_timer_fails)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(NULL);
+
+    ///act
+    TIMER_HANDLE timer = timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(timer);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* timer_wheel_dowork */
+
+/* Tests_SRS_TIMER_WHEEL_01_006: [ timer_wheel_start_timer shall insert a new timer expiring timeout_ms milliseconds from the current tick count in the slot matching its expiry tick. ]*/
+/* Tests_SRS_TIMER_WHEEL_01_014: [ timer_wheel_dowork shall call on_timer_expired for every timer that expired, and free the timer afterwards. ]*/
+TEST_FUNCTION(timer_wheel_dowork_expires_a_short_timer_on_time)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+
+    ///act
+    advance_and_dowork(timer_wheel, 9, 1);
+    ASSERT_ARE_EQUAL(size_t, 0, g_expired_count);
+    advance_and_dowork(timer_wheel, 1, 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_expired_count);
+    ASSERT_ARE_EQUAL(uint64_t, 1010, g_expired_at_ms);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_013: [ timer_wheel_dowork shall process every tick between the last processed tick and the current tick count, cascading the timers of the upper levels into the lower levels. ]*/
+TEST_FUNCTION(timer_wheel_dowork_cascades_long_timers)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 300000, test_on_timer_expired, NULL);
+
+    ///act
+    advance_and_dowork(timer_wheel, 299999, 7);
+    ASSERT_ARE_EQUAL(size_t, 0, g_expired_count);
+    advance_and_dowork(timer_wheel, 1, 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_expired_count);
+    ASSERT_ARE_EQUAL(uint64_t, 301000, g_expired_at_ms);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_013: [ timer_wheel_dowork shall process every tick between the last processed tick and the current tick count, cascading the timers of the upper levels into the lower levels. ]*/
+TEST_FUNCTION(timer_wheel_dowork_after_a_long_pause_expires_all_timers)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 1, test_on_timer_expired, NULL);
+    (void)timer_wheel_start_timer(timer_wheel, 100, test_on_timer_expired, NULL);
+    (void)timer_wheel_start_timer(timer_wheel, 5000, test_on_timer_expired, NULL);
+
+    ///act
+    advance_and_dowork(timer_wheel, 6000, 6000);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_expired_count);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* timer_wheel_cancel_timer */
+
+/* Tests_SRS_TIMER_WHEEL_01_008: [ If timer_wheel or timer is NULL, timer_wheel_cancel_timer shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(timer_wheel_cancel_timer_with_NULL_timer_fails)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    umock_c_reset_all_calls();
+
+    ///act
+    int result = timer_wheel_cancel_timer(timer_wheel, NULL);
+
+    ///assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_009: [ timer_wheel_cancel_timer shall unlink the timer from its slot and free it. ]*/
+TEST_FUNCTION(timer_wheel_cancel_timer_prevents_expiry)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    TIMER_HANDLE timer = timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(timer));
+
+    ///act
+    int result = timer_wheel_cancel_timer(timer_wheel, timer);
+    advance_and_dowork(timer_wheel, 100, 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, g_expired_count);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_009: [ timer_wheel_cancel_timer shall unlink the timer from its slot and free it. ]*/
+TEST_FUNCTION(timer_wheel_cancel_timer_from_a_callback_cancels_a_timer_expiring_on_the_same_tick)
+{
+    ///arrange
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+    g_timer_wheel_to_cancel_on = timer_wheel;
+    g_timer_to_cancel = timer_wheel_start_timer(timer_wheel, 10, test_on_timer_expired, NULL);
+
+    ///act
+    advance_and_dowork(timer_wheel, 10, 1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_expired_count);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* timer_wheel_get_next_timeout */
+
+/* Tests_SRS_TIMER_WHEEL_01_016: [ If no timer is running, timer_wheel_get_next_timeout shall set timeout_ms to TIMER_WHEEL_NO_TIMEOUT and return 0. ]*/
+TEST_FUNCTION(timer_wheel_get_next_timeout_without_timers_returns_no_timeout)
+{
+    ///arrange
+    uint32_t timeout_ms = 0;
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+
+    ///act
+    int result = timer_wheel_get_next_timeout(timer_wheel, &timeout_ms);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(uint32_t, TIMER_WHEEL_NO_TIMEOUT, timeout_ms);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_017: [ Otherwise timer_wheel_get_next_timeout shall set timeout_ms to the time until the earliest tick at which a timer expires or is cascaded to a lower level. ]*/
+TEST_FUNCTION(timer_wheel_get_next_timeout_returns_time_until_the_next_expiry)
+{
+    ///arrange
+    uint32_t timeout_ms = 0;
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 30, test_on_timer_expired, NULL);
+    (void)timer_wheel_start_timer(timer_wheel, 20, test_on_timer_expired, NULL);
+    g_current_ms += 5;
+
+    ///act
+    int result = timer_wheel_get_next_timeout(timer_wheel, &timeout_ms);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(uint32_t, 15, timeout_ms);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+/* Tests_SRS_TIMER_WHEEL_01_017: [ Otherwise timer_wheel_get_next_timeout shall set timeout_ms to the time until the earliest tick at which a timer expires or is cascaded to a lower level. ]*/
+TEST_FUNCTION(timer_wheel_get_next_timeout_never_exceeds_the_expiry_of_a_long_timer)
+{
+    ///arrange
+    uint32_t timeout_ms = 0;
+    TIMER_WHEEL_HANDLE timer_wheel = timer_wheel_create();
+    (void)timer_wheel_start_timer(timer_wheel, 100000, test_on_timer_expired, NULL);
+
+    ///act
+    int result = timer_wheel_get_next_timeout(timer_wheel, &timeout_ms);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(timeout_ms > 0);
+    ASSERT_IS_TRUE(timeout_ms <= 100000);
+
+    ///cleanup
+    timer_wheel_destroy(timer_wheel);
+}
+
+END_TEST_SUITE(timer_wheel_unittests)
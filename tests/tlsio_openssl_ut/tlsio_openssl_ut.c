@@ -0,0 +1,492 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "openssl/ssl.h"
+#include "openssl/evp.h"
+#include "openssl/x509.h"
+#include "openssl/pem.h"
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/xio.h"
+#include "azure_c_shared_utility/tlsio.h"
+#include "azure_c_shared_utility/tlsio_openssl.h"
+#include "azure_c_shared_utility/memio.h"
+
+/* enough for the handshake and the session tickets sent after it, memio delivers on the next dowork */
+#define TEST_DOWORK_COUNT   100
+
+/* a TLS server over memory BIOs on the server endpoint of a memio pipe, driven from the test thread */
+typedef struct TEST_SERVER_CONNECTION_TAG
+{
+    XIO_HANDLE io;
+    SSL* ssl;
+    BIO* in_bio;
+    BIO* out_bio;
+    bool is_error;
+} TEST_SERVER_CONNECTION;
+
+typedef struct TEST_CLIENT_TAG
+{
+    bool is_open;
+    bool is_error;
+    size_t sends_completed;
+} TEST_CLIENT;
+
+/* a client connected through a memio pipe to a TEST_SERVER_CONNECTION */
+typedef struct TEST_CONNECTION_TAG
+{
+    MEMIO_PIPE_HANDLE pipe;
+    TEST_SERVER_CONNECTION server;
+    TEST_CLIENT client;
+    XIO_HANDLE client_io;
+} TEST_CONNECTION;
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static SSL_CTX* g_server_context;
+static char* g_server_certificate;
+
+/* a self-signed certificate for the server, returned in PEM form for the TrustedCerts option */
+static char* create_server_credentials(SSL_CTX* ssl_context)
+{
+    char* result = NULL;
+    EVP_PKEY* key = NULL;
+    EVP_PKEY_CTX* key_context = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
+    X509* certificate = X509_new();
+    BIO* pem_bio = BIO_new(BIO_s_mem());
+
+    if ((key_context != NULL) &&
+        (certificate != NULL) &&
+        (pem_bio != NULL) &&
+        (EVP_PKEY_keygen_init(key_context) > 0) &&
+        (EVP_PKEY_CTX_set_rsa_keygen_bits(key_context, 2048) > 0) &&
+        (EVP_PKEY_keygen(key_context, &key) > 0))
+    {
+        X509_NAME* name = X509_get_subject_name(certificate);
+        char* pem_data;
+        long pem_size;
+
+        (void)X509_set_version(certificate, 2);
+        (void)ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        (void)X509_gmtime_adj(X509_get_notBefore(certificate), -3600);
+        (void)X509_gmtime_adj(X509_get_notAfter(certificate), 24 * 3600);
+        (void)X509_set_pubkey(certificate, key);
+        (void)X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+        (void)X509_set_issuer_name(certificate, name);
+
+        if ((X509_sign(certificate, key, EVP_sha256()) > 0) &&
+            (SSL_CTX_use_certificate(ssl_context, certificate) == 1) &&
+            (SSL_CTX_use_PrivateKey(ssl_context, key) == 1) &&
+            (PEM_write_bio_X509(pem_bio, certificate) == 1) &&
+            ((pem_size = BIO_get_mem_data(pem_bio, &pem_data)) > 0) &&
+            ((result = (char*)malloc((size_t)pem_size + 1)) != NULL))
+        {
+            (void)memcpy(result, pem_data, (size_t)pem_size);
+            result[pem_size] = '\0';
+        }
+    }
+
+    BIO_free(pem_bio);
+    EVP_PKEY_free(key);
+    X509_free(certificate);
+    EVP_PKEY_CTX_free(key_context);
+
+    return result;
+}
+
+static void flush_server_records(TEST_SERVER_CONNECTION* connection)
+{
+    unsigned char ciphertext[4096];
+    int size;
+
+    while ((!connection->is_error) &&
+        ((size = BIO_read(connection->out_bio, ciphertext, sizeof(ciphertext))) > 0))
+    {
+        if (xio_send(connection->io, ciphertext, (size_t)size, NULL, NULL) != 0)
+        {
+            connection->is_error = true;
+        }
+    }
+}
+
+static void on_server_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    TEST_SERVER_CONNECTION* connection = (TEST_SERVER_CONNECTION*)context;
+    unsigned char discarded[1024];
+
+    if (BIO_write(connection->in_bio, buffer, (int)size) != (int)size)
+    {
+        connection->is_error = true;
+    }
+    else if (!SSL_is_init_finished(connection->ssl))
+    {
+        int handshake_result = SSL_do_handshake(connection->ssl);
+        if ((handshake_result != 1) &&
+            (SSL_get_error(connection->ssl, handshake_result) != SSL_ERROR_WANT_READ))
+        {
+            connection->is_error = true;
+        }
+    }
+    else
+    {
+        while (SSL_read(connection->ssl, discarded, sizeof(discarded)) > 0)
+        {
+        }
+    }
+
+    flush_server_records(connection);
+}
+
+static void on_server_io_error(void* context)
+{
+    ((TEST_SERVER_CONNECTION*)context)->is_error = true;
+}
+
+static void on_client_open_complete(void* context, IO_OPEN_RESULT open_result)
+{
+    TEST_CLIENT* client = (TEST_CLIENT*)context;
+    if (open_result == IO_OPEN_OK)
+    {
+        client->is_open = true;
+    }
+    else
+    {
+        client->is_error = true;
+    }
+}
+
+static void on_client_bytes_received(void* context, const unsigned char* buffer, size_t size)
+{
+    (void)context;
+    (void)buffer;
+    (void)size;
+}
+
+static void on_client_io_error(void* context)
+{
+    ((TEST_CLIENT*)context)->is_error = true;
+}
+
+static void on_client_send_complete(void* context, IO_SEND_RESULT send_result)
+{
+    TEST_CLIENT* client = (TEST_CLIENT*)context;
+    if (send_result == IO_SEND_OK)
+    {
+        client->sends_completed++;
+    }
+    else
+    {
+        client->is_error = true;
+    }
+}
+
+static void sleep_ms(long milliseconds)
+{
+    struct timespec delay;
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (milliseconds % 1000) * 1000000;
+    (void)nanosleep(&delay, NULL);
+}
+
+static void run_dowork(TEST_CONNECTION* connection)
+{
+    size_t i;
+
+    for (i = 0; (i < TEST_DOWORK_COUNT) && (!connection->client.is_error) && (!connection->server.is_error); i++)
+    {
+        xio_dowork(connection->client_io);
+        xio_dowork(connection->server.io);
+    }
+}
+
+/* runs the handshake with a fresh server connection */
+static void open_connection(TEST_CONNECTION* connection, const char* hostname, int port)
+{
+    MEMIO_CONFIG server_config;
+    MEMIO_CONFIG client_config;
+    TLSIO_LAYERED_CONFIG tlsio_config;
+
+    (void)memset(connection, 0, sizeof(TEST_CONNECTION));
+    connection->pipe = memio_pipe_create(NULL);
+    ASSERT_IS_NOT_NULL(connection->pipe);
+    server_config.pipe = connection->pipe;
+    server_config.endpoint = MEMIO_ENDPOINT_SERVER;
+    client_config.pipe = connection->pipe;
+    client_config.endpoint = MEMIO_ENDPOINT_CLIENT;
+
+    connection->server.io = xio_create(memio_get_interface_description(), &server_config);
+    ASSERT_IS_NOT_NULL(connection->server.io);
+    connection->server.ssl = SSL_new(g_server_context);
+    ASSERT_IS_NOT_NULL(connection->server.ssl);
+    connection->server.in_bio = BIO_new(BIO_s_mem());
+    connection->server.out_bio = BIO_new(BIO_s_mem());
+    ASSERT_IS_NOT_NULL(connection->server.in_bio);
+    ASSERT_IS_NOT_NULL(connection->server.out_bio);
+    SSL_set_bio(connection->server.ssl, connection->server.in_bio, connection->server.out_bio);
+    SSL_set_accept_state(connection->server.ssl);
+    ASSERT_ARE_EQUAL(int, 0, xio_open(connection->server.io, NULL, NULL, on_server_bytes_received, &connection->server, on_server_io_error, &connection->server));
+
+    tlsio_config.tls_config.hostname = hostname;
+    tlsio_config.tls_config.port = port;
+    tlsio_config.underlying_io_interface = memio_get_interface_description();
+    tlsio_config.underlying_io_parameters = &client_config;
+    connection->client_io = xio_create(tlsio_openssl_get_layered_interface_description(), &tlsio_config);
+    ASSERT_IS_NOT_NULL(connection->client_io);
+    ASSERT_ARE_EQUAL(int, 0, xio_setoption(connection->client_io, "TrustedCerts", g_server_certificate));
+    ASSERT_ARE_EQUAL(int, 0, xio_open(connection->client_io, on_client_open_complete, &connection->client, on_client_bytes_received, &connection->client, on_client_io_error, &connection->client));
+
+    run_dowork(connection);
+
+    ASSERT_IS_TRUE(connection->client.is_open);
+    ASSERT_IS_FALSE(connection->client.is_error);
+    ASSERT_IS_FALSE(connection->server.is_error);
+}
+
+static void close_connection(TEST_CONNECTION* connection)
+{
+    (void)xio_close(connection->client_io, NULL, NULL);
+    xio_destroy(connection->client_io);
+    (void)xio_close(connection->server.io, NULL, NULL);
+    xio_destroy(connection->server.io);
+    SSL_free(connection->server.ssl);
+    memio_pipe_destroy(connection->pipe);
+}
+
+/* the session cache is keyed by hostname and port */
+static void connect_and_close(const char* hostname, int port)
+{
+    TEST_CONNECTION connection;
+
+    open_connection(&connection, hostname, port);
+    close_connection(&connection);
+}
+
+static TLSIO_OPENSSL_SESSION_CACHE_STATISTICS get_session_cache_statistics(void)
+{
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS result;
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_get_session_cache_statistics(&result));
+    return result;
+}
+
+/* connects again and tells whether the cached session of the endpoint was offered and accepted */
+static bool is_session_resumed(const char* hostname, int port)
+{
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before = get_session_cache_statistics();
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+
+    connect_and_close(hostname, port);
+    after = get_session_cache_statistics();
+    return (after.resumed_handshakes - before.resumed_handshakes) == 1;
+}
+
+BEGIN_TEST_SUITE(tlsio_openssl_unittests)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_init());
+    g_server_context = SSL_CTX_new(SSLv23_server_method());
+    ASSERT_IS_NOT_NULL(g_server_context);
+    g_server_certificate = create_server_credentials(g_server_context);
+    ASSERT_IS_NOT_NULL(g_server_certificate);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    free(g_server_certificate);
+    SSL_CTX_free(g_server_context);
+    tlsio_openssl_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    /* empties the cache */
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_set_session_cache_limits(TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_SIZE, TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_TTL_SECONDS));
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* session cache */
+
+TEST_FUNCTION(tlsio_openssl_first_handshake_to_an_endpoint_is_a_miss_and_stores_its_session)
+{
+    ///arrange
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before = get_session_cache_statistics();
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+
+    ///act
+    connect_and_close("host_a", 443);
+
+    ///assert
+    after = get_session_cache_statistics();
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.handshakes - before.handshakes);
+    ASSERT_ARE_EQUAL(uint64_t, 0, after.sessions_offered - before.sessions_offered);
+    ASSERT_ARE_EQUAL(uint64_t, 0, after.resumed_handshakes - before.resumed_handshakes);
+    ASSERT_IS_TRUE(after.sessions_stored > before.sessions_stored);
+    ASSERT_ARE_EQUAL(size_t, 1, after.session_count);
+}
+
+TEST_FUNCTION(tlsio_openssl_second_handshake_to_an_endpoint_resumes_its_session)
+{
+    ///arrange
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before;
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+    connect_and_close("host_a", 443);
+    before = get_session_cache_statistics();
+
+    ///act
+    connect_and_close("host_a", 443);
+
+    ///assert
+    after = get_session_cache_statistics();
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.handshakes - before.handshakes);
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.sessions_offered - before.sessions_offered);
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.resumed_handshakes - before.resumed_handshakes);
+    ASSERT_ARE_EQUAL(size_t, 1, after.session_count);
+}
+
+TEST_FUNCTION(tlsio_openssl_session_of_an_endpoint_is_not_offered_to_another_hostname_or_port)
+{
+    ///arrange
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before;
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+    connect_and_close("host_a", 443);
+    before = get_session_cache_statistics();
+
+    ///act
+    connect_and_close("host_b", 443);
+    connect_and_close("host_a", 8883);
+
+    ///assert
+    after = get_session_cache_statistics();
+    ASSERT_ARE_EQUAL(uint64_t, 0, after.sessions_offered - before.sessions_offered);
+    ASSERT_ARE_EQUAL(size_t, 3, after.session_count);
+}
+
+TEST_FUNCTION(tlsio_openssl_session_older_than_the_ttl_is_evicted)
+{
+    ///arrange
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before;
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_set_session_cache_limits(TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_SIZE, 1));
+    connect_and_close("host_a", 443);
+    sleep_ms(1100);
+    before = get_session_cache_statistics();
+
+    ///act
+    connect_and_close("host_a", 443);
+
+    ///assert
+    after = get_session_cache_statistics();
+    ASSERT_ARE_EQUAL(uint64_t, 0, after.sessions_offered - before.sessions_offered);
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.sessions_evicted - before.sessions_evicted);
+    /* the new session replaced the expired one */
+    ASSERT_ARE_EQUAL(size_t, 1, after.session_count);
+}
+
+TEST_FUNCTION(tlsio_openssl_session_younger_than_the_ttl_is_resumed)
+{
+    ///arrange
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_set_session_cache_limits(TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_SIZE, 60));
+    connect_and_close("host_a", 443);
+
+    ///act
+    bool resumed = is_session_resumed("host_a", 443);
+
+    ///assert
+    ASSERT_IS_TRUE(resumed);
+}
+
+TEST_FUNCTION(tlsio_openssl_full_session_cache_evicts_the_least_recently_used_session)
+{
+    ///arrange
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS before;
+    TLSIO_OPENSSL_SESSION_CACHE_STATISTICS after;
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_set_session_cache_limits(2, TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_TTL_SECONDS));
+    connect_and_close("host_a", 443);
+    connect_and_close("host_b", 443);
+    /* host_a is used again, host_b is now the least recently used */
+    connect_and_close("host_a", 443);
+    before = get_session_cache_statistics();
+
+    ///act
+    connect_and_close("host_c", 443);
+
+    ///assert
+    after = get_session_cache_statistics();
+    ASSERT_ARE_EQUAL(uint64_t, 1, after.sessions_evicted - before.sessions_evicted);
+    ASSERT_ARE_EQUAL(size_t, 2, after.session_count);
+    ASSERT_IS_TRUE(is_session_resumed("host_a", 443));
+    ASSERT_IS_FALSE(is_session_resumed("host_b", 443));
+}
+
+TEST_FUNCTION(tlsio_openssl_session_cache_with_0_sessions_stores_nothing)
+{
+    ///arrange
+    ASSERT_ARE_EQUAL(int, 0, tlsio_openssl_set_session_cache_limits(0, TLSIO_OPENSSL_DEFAULT_SESSION_CACHE_TTL_SECONDS));
+    connect_and_close("host_a", 443);
+
+    ///act
+    bool resumed = is_session_resumed("host_a", 443);
+
+    ///assert
+    ASSERT_IS_FALSE(resumed);
+    ASSERT_ARE_EQUAL(size_t, 0, get_session_cache_statistics().session_count);
+}
+
+/* statistics */
+
+TEST_FUNCTION(tlsio_openssl_completed_send_is_counted_in_the_send_latency_histogram)
+{
+    ///arrange
+    const unsigned char payload[] = { 'h', 'e', 'l', 'l', 'o' };
+    TEST_CONNECTION connection;
+    XIO_STATISTICS statistics;
+    uint64_t latency_count = 0;
+    size_t i;
+    open_connection(&connection, "host_a", 443);
+
+    ///act
+    int send_result = xio_send(connection.client_io, payload, sizeof(payload), on_client_send_complete, &connection.client);
+    run_dowork(&connection);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 0, send_result);
+    ASSERT_ARE_EQUAL(size_t, 1, connection.client.sends_completed);
+    ASSERT_ARE_EQUAL(int, 0, xio_get_statistics(connection.client_io, &statistics));
+    for (i = 0; i < XIO_SEND_LATENCY_BUCKET_COUNT; i++)
+    {
+        latency_count += statistics.send_latency_histogram[i];
+    }
+    ASSERT_ARE_EQUAL(uint64_t, 1, latency_count);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.pending_send_count);
+
+    ///cleanup
+    close_connection(&connection);
+}
+
+END_TEST_SUITE(tlsio_openssl_unittests)
@@ -7,6 +7,7 @@
 
 #include "umock_c.h"
 #include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
 
 #define ENABLE_MOCKS
 
@@ -15,6 +16,7 @@
 #include "azure_c_shared_utility/shared_util_options.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
 #include "azure_c_shared_utility/list.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 static const void** list_items = NULL;
 static size_t list_item_count = 0;
@@ -24,6 +26,7 @@ static const char* TEST_PASSWORD = "user_pwd";
 
 static const LIST_HANDLE TEST_LIST_HANDLE = (LIST_HANDLE)0x4242;
 static const LIST_ITEM_HANDLE TEST_LIST_ITEM_HANDLE = (LIST_ITEM_HANDLE)0x11;
+static const TICK_COUNTER_HANDLE TEST_TICK_COUNTER_HANDLE = (TICK_COUNTER_HANDLE)0x12;
 static struct lws_context* TEST_LIBWEBSOCKET_CONTEXT = (struct lws_context*)0x4243;
 static void* TEST_USER_CONTEXT = (void*)0x4244;
 static struct lws* TEST_LIBWEBSOCKET = (struct lws*)0x4245;
@@ -575,6 +578,8 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     result = umocktypes_charptr_register_types();
     ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
@@ -588,6 +593,8 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_HOOK(OptionHandler_Create, my_OptionHandler_Create);
     REGISTER_GLOBAL_MOCK_HOOK(OptionHandler_Destroy, my_OptionHandler_Destroy);
     REGISTER_GLOBAL_MOCK_RETURN(OptionHandler_AddOption, OPTIONHANDLER_OK);
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, TEST_TICK_COUNTER_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_get_current_us, 0);
     REGISTER_TYPE(IO_OPEN_RESULT, IO_OPEN_RESULT);
     REGISTER_TYPE(IO_SEND_RESULT, IO_SEND_RESULT);
     REGISTER_TYPE(my_lws_write_protocol_enum, my_lws_write_protocol_enum);
@@ -600,6 +607,8 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(pfSetOption, void*);
     REGISTER_UMOCK_ALIAS_TYPE(OPTIONHANDLER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(LIST_ITEM_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(XIO_STATISTICS*, void*);
     REGISTER_UMOCK_ALIAS_TYPE(enum lws_write_protocol, my_lws_write_protocol_enum);
     REGISTER_UMOCK_ALIAS_TYPE(lws_write_protocol, my_lws_write_protocol_enum);
 }
@@ -647,6 +656,7 @@ TEST_FUNCTION(wsio_create_with_valid_args_succeeds)
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_create());
 
 	// act
     CONCRETE_IO_HANDLE wsio = wsio_create(&default_wsio_config);
@@ -759,6 +769,7 @@ TEST_FUNCTION(wsio_create_with_NULL_trusted_ca_and_the_Rest_of_the_args_valid_su
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_create());
 
     // act
     CONCRETE_IO_HANDLE wsio = wsio_create(&test_wsio_config);
@@ -917,6 +928,34 @@ TEST_FUNCTION(when_allocating_memory_for_the_trusted_ca_fails_wsio_create_fails)
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
+TEST_FUNCTION(when_creating_the_tick_counter_fails_wsio_create_fails)
+{
+    // arrange
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(list_create());
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_create())
+        .SetReturn((TICK_COUNTER_HANDLE)NULL);
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(list_destroy(TEST_LIST_HANDLE));
+    EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    CONCRETE_IO_HANDLE wsio = wsio_create(&default_wsio_config);
+
+    // assert
+    ASSERT_IS_NULL(wsio);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* wsio_destroy */
 
 /* Tests_SRS_WSIO_01_007: [wsio_destroy shall free all resources associated with the wsio instance.] */
@@ -931,6 +970,7 @@ TEST_FUNCTION(when_wsio_destroy_is_called_all_resources_are_freed)
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // protocol_name
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // protocols
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // trusted_ca
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER_HANDLE));
     STRICT_EXPECTED_CALL(list_destroy(TEST_LIST_HANDLE));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // instance
 
@@ -969,6 +1009,7 @@ TEST_FUNCTION(wsio_destroy_closes_the_underlying_lws_before_destroying_all_resou
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // protocol_name
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // protocols
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // trusted_ca
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER_HANDLE));
     STRICT_EXPECTED_CALL(list_destroy(TEST_LIST_HANDLE));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); // instance
 
@@ -1656,6 +1697,7 @@ TEST_FUNCTION(wsio_send_adds_the_bytes_to_the_list_and_triggers_on_writable_when
 
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(list_add(TEST_LIST_HANDLE, IGNORED_PTR_ARG))
         .IgnoreArgument(2);
     STRICT_EXPECTED_CALL(lws_callback_on_writable(TEST_LIBWEBSOCKET));
@@ -1739,6 +1781,7 @@ TEST_FUNCTION(when_list_add_fails_wsio_send_fails)
 
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(list_add(TEST_LIST_HANDLE, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .SetReturn((LIST_ITEM_HANDLE)NULL);
@@ -1770,6 +1813,7 @@ TEST_FUNCTION(when_callback_on_writable_fails_then_wsio_send_fails)
 
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(list_add(TEST_LIST_HANDLE, IGNORED_PTR_ARG))
         .IgnoreArgument(2);
     STRICT_EXPECTED_CALL(lws_callback_on_writable(TEST_LIBWEBSOCKET))
@@ -1810,6 +1854,8 @@ TEST_FUNCTION(when_lws_wants_to_send_bytes_they_are_pushed_to_lws)
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, sizeof(test_buffer), LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer, sizeof(test_buffer))
         .SetReturn((int)sizeof(test_buffer));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4243, IO_SEND_OK));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -1849,6 +1895,8 @@ TEST_FUNCTION(when_lws_wants_to_send_bytes_they_are_pushed_to_lws_but_no_callbac
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, sizeof(test_buffer), LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer, sizeof(test_buffer))
         .SetReturn((int)sizeof(test_buffer));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(list_remove(TEST_LIST_HANDLE, IGNORED_PTR_ARG));
@@ -2358,6 +2406,8 @@ TEST_FUNCTION(CLIENT_WRITABLE_when_open_and_one_chunk_queued_sends_the_chunk)
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, sizeof(test_buffer), LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer, sizeof(test_buffer))
         .SetReturn((int)sizeof(test_buffer));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(list_remove(TEST_LIST_HANDLE, IGNORED_PTR_ARG));
@@ -2667,6 +2717,8 @@ TEST_FUNCTION(when_removing_the_pending_IO_after_a_succesfull_write_lws_write_fa
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, sizeof(test_buffer), LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer, sizeof(test_buffer))
         .SetReturn(2);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4243, IO_SEND_OK));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -2897,6 +2949,8 @@ TEST_FUNCTION(when_send_is_succesfull_and_there_is_another_pending_IO_in_CLIENT_
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, 1, LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer + 1, 1)
         .SetReturn(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4243, IO_SEND_OK));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -3046,6 +3100,8 @@ TEST_FUNCTION(sending_partial_content_leaves_the_bytes_for_the_next_writable_eve
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, 1, LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer + 1, 1)
         .SetReturn(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4243, IO_SEND_OK));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -3095,6 +3151,8 @@ TEST_FUNCTION(sending_partial_content_of_2_bytes_works_and_leaves_the_bytes_for_
     STRICT_EXPECTED_CALL(lws_write(TEST_LIBWEBSOCKET, IGNORED_PTR_ARG, 1, LWS_WRITE_BINARY))
         .ValidateArgumentBuffer(2, test_buffer + 2, 1)
         .SetReturn(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_us(TEST_TICK_COUNTER_HANDLE, IGNORED_PTR_ARG));
+    EXPECTED_CALL(xio_statistics_add_send_latency(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4243, IO_SEND_OK));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -3886,6 +3944,64 @@ TEST_FUNCTION(wsio_setoption_optionName_invalid_fails)
     wsio_destroy(wsio);
 }
 
+TEST_FUNCTION(wsio_setoption_send_low_watermark_above_the_send_high_watermark_fails)
+{
+    //arrange
+    CONCRETE_IO_HANDLE wsio = wsio_create(&default_wsio_config);
+    size_t high_watermark = 1024;
+    size_t low_watermark = 1025;
+    (void)wsio_setoption(wsio, OPTION_SEND_HIGH_WATERMARK, &high_watermark);
+    umock_c_reset_all_calls();
+
+    // act
+    int option_result = wsio_setoption(wsio, OPTION_SEND_LOW_WATERMARK, &low_watermark);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, option_result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    wsio_destroy(wsio);
+}
+
+TEST_FUNCTION(wsio_setoption_send_high_watermark_below_the_send_low_watermark_fails)
+{
+    //arrange
+    CONCRETE_IO_HANDLE wsio = wsio_create(&default_wsio_config);
+    size_t high_watermark = 1024;
+    size_t low_watermark = 1025;
+    (void)wsio_setoption(wsio, OPTION_SEND_LOW_WATERMARK, &low_watermark);
+    umock_c_reset_all_calls();
+
+    // act
+    int option_result = wsio_setoption(wsio, OPTION_SEND_HIGH_WATERMARK, &high_watermark);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, option_result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    wsio_destroy(wsio);
+}
+
+TEST_FUNCTION(wsio_setoption_send_low_watermark_without_a_send_high_watermark_succeeds)
+{
+    //arrange
+    CONCRETE_IO_HANDLE wsio = wsio_create(&default_wsio_config);
+    size_t low_watermark = 1025;
+    umock_c_reset_all_calls();
+
+    // act
+    int option_result = wsio_setoption(wsio, OPTION_SEND_LOW_WATERMARK, &low_watermark);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, option_result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    wsio_destroy(wsio);
+}
+
 TEST_FUNCTION(wsio_setoption_succeed)
 {
     //arrange
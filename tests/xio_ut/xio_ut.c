@@ -2,6 +2,7 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <string.h>
 #include "testrunnerswitcher.h"
 
 static unsigned int g_fail_alloc_calls;
@@ -48,6 +49,12 @@ MOCK_FUNCTION_WITH_CODE(, void, test_xio_dowork, CONCRETE_IO_HANDLE, handle)
 MOCK_FUNCTION_END()
 MOCK_FUNCTION_WITH_CODE(, int, test_xio_setoption, CONCRETE_IO_HANDLE, handle, const char*, optionName, const void*, value)
 MOCK_FUNCTION_END(0)
+MOCK_FUNCTION_WITH_CODE(, int, test_xio_send_vectored, CONCRETE_IO_HANDLE, handle, const XIO_BUFFER*, buffers, size_t, buffer_count, ON_SEND_COMPLETE, on_send_complete, void*, callback_context)
+MOCK_FUNCTION_END(0)
+MOCK_FUNCTION_WITH_CODE(, int, test_xio_get_statistics, CONCRETE_IO_HANDLE, handle, XIO_STATISTICS*, statistics)
+MOCK_FUNCTION_END(0)
+MOCK_FUNCTION_WITH_CODE(, int, test_xio_get_socket, CONCRETE_IO_HANDLE, handle, intptr_t*, socket_handle)
+MOCK_FUNCTION_END(0)
 
 #include "azure_c_shared_utility/umock_c_prod.h"
 /*this function will clone an option given by name and value*/
@@ -108,6 +115,48 @@ const IO_INTERFACE_DESCRIPTION test_io_description =
     test_xio_setoption
 };
 
+const IO_INTERFACE_DESCRIPTION test_io_description_with_send_vectored =
+{
+    test_xio_retrieveoptions,
+    test_xio_create,
+    test_xio_destroy,
+    test_xio_open,
+    test_xio_close,
+    test_xio_send,
+    test_xio_dowork,
+    test_xio_setoption,
+    test_xio_send_vectored
+};
+
+const IO_INTERFACE_DESCRIPTION test_io_description_with_get_statistics =
+{
+    test_xio_retrieveoptions,
+    test_xio_create,
+    test_xio_destroy,
+    test_xio_open,
+    test_xio_close,
+    test_xio_send,
+    test_xio_dowork,
+    test_xio_setoption,
+    NULL,
+    test_xio_get_statistics
+};
+
+const IO_INTERFACE_DESCRIPTION test_io_description_with_get_socket =
+{
+    test_xio_retrieveoptions,
+    test_xio_create,
+    test_xio_destroy,
+    test_xio_open,
+    test_xio_close,
+    test_xio_send,
+    test_xio_dowork,
+    test_xio_setoption,
+    NULL,
+    NULL,
+    test_xio_get_socket
+};
+
 static TEST_MUTEX_HANDLE g_testByTest;
 static TEST_MUTEX_HANDLE g_dllByDll;
 
@@ -169,6 +218,9 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(ON_IO_OPEN_COMPLETE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(ON_BYTES_RECEIVED, void*);
     REGISTER_UMOCK_ALIAS_TYPE(ON_IO_ERROR, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const XIO_BUFFER*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(XIO_STATISTICS*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(intptr_t*, void*);
 
     REGISTER_UMOCK_ALIAS_TYPE(pfCloneOption, void*);
     REGISTER_UMOCK_ALIAS_TYPE(pfDestroyOption, void*);
@@ -697,6 +749,28 @@ TEST_FUNCTION(when_the_concrete_xio_send_fails_then_xio_send_fails)
     xio_destroy(handle);
 }
 
+/* Tests_SRS_XIO_01_040: [If the underlying concrete_io_send returns XIO_SEND_WOULD_BLOCK, xio_send shall return XIO_SEND_WOULD_BLOCK.] */
+TEST_FUNCTION(when_the_concrete_xio_send_would_block_then_xio_send_returns_XIO_SEND_WOULD_BLOCK)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_send(TEST_CONCRETE_IO_HANDLE, send_data, sizeof(send_data), test_on_send_complete, (void*)0x4242))
+        .SetReturn(XIO_SEND_WOULD_BLOCK);
+
+    // act
+    int result = xio_send(handle, send_data, sizeof(send_data), test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, XIO_SEND_WOULD_BLOCK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
 /* Tests_SRS_XIO_01_011: [No error check shall be performed on buffer and size.] */
 TEST_FUNCTION(xio_send_with_NULL_buffer_and_nonzero_length_passes_the_args_down_and_succeeds)
 {
@@ -758,6 +832,387 @@ TEST_FUNCTION(xio_send_with_non_NULL_buffer_and_zero_length_passes_the_args_down
     xio_destroy(handle);
 }
 
+/* xio_send_vectored */
+
+/* Tests_SRS_XIO_01_029: [If xio or buffers is NULL or buffer_count is 0, xio_send_vectored shall return a non-zero value.] */
+TEST_FUNCTION(xio_send_vectored_with_NULL_handle_fails)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_BUFFER buffers[1];
+    buffers[0].buffer = send_data;
+    buffers[0].size = sizeof(send_data);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_send_vectored(NULL, buffers, 1, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_XIO_01_029: [If xio or buffers is NULL or buffer_count is 0, xio_send_vectored shall return a non-zero value.] */
+TEST_FUNCTION(xio_send_vectored_with_zero_buffer_count_fails)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_BUFFER buffers[1];
+    XIO_HANDLE handle = xio_create(&test_io_description_with_send_vectored, NULL);
+    buffers[0].buffer = send_data;
+    buffers[0].size = sizeof(send_data);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_send_vectored(handle, buffers, 0, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_030: [If the concrete IO implementation provides concrete_io_send_vectored, xio_send_vectored shall call it, passing down all its arguments.] */
+TEST_FUNCTION(xio_send_vectored_calls_the_underlying_concrete_io_send_vectored)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_BUFFER buffers[2];
+    XIO_HANDLE handle = xio_create(&test_io_description_with_send_vectored, NULL);
+    buffers[0].buffer = send_data;
+    buffers[0].size = 1;
+    buffers[1].buffer = send_data + 1;
+    buffers[1].size = 1;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_send_vectored(TEST_CONCRETE_IO_HANDLE, buffers, 2, test_on_send_complete, (void*)0x4242));
+
+    // act
+    int result = xio_send_vectored(handle, buffers, 2, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_031: [If the underlying concrete_io_send_vectored fails, xio_send_vectored shall return a non-zero value.] */
+TEST_FUNCTION(when_the_concrete_io_send_vectored_fails_then_xio_send_vectored_fails)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_BUFFER buffers[1];
+    XIO_HANDLE handle = xio_create(&test_io_description_with_send_vectored, NULL);
+    buffers[0].buffer = send_data;
+    buffers[0].size = sizeof(send_data);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_send_vectored(TEST_CONCRETE_IO_HANDLE, buffers, 1, test_on_send_complete, (void*)0x4242))
+        .SetReturn(42);
+
+    // act
+    int result = xio_send_vectored(handle, buffers, 1, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_032: [Otherwise xio_send_vectored shall allocate a buffer large enough to hold all the segments and copy them into it, in order.] */
+/* Tests_SRS_XIO_01_034: [xio_send_vectored shall send the buffer by calling concrete_io_send, return its result and free the buffer.] */
+TEST_FUNCTION(xio_send_vectored_without_concrete_send_vectored_concatenates_the_segments)
+{
+    // arrange
+    unsigned char first[] = { 0x01, 0x02 };
+    unsigned char second[] = { 0x03 };
+    unsigned char expected[] = { 0x01, 0x02, 0x03 };
+    XIO_BUFFER buffers[2];
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    buffers[0].buffer = first;
+    buffers[0].size = sizeof(first);
+    buffers[1].buffer = second;
+    buffers[1].size = sizeof(second);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(expected)));
+    STRICT_EXPECTED_CALL(test_xio_send(TEST_CONCRETE_IO_HANDLE, IGNORED_PTR_ARG, sizeof(expected), test_on_send_complete, (void*)0x4242))
+        .ValidateArgumentBuffer(2, expected, sizeof(expected));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    int result = xio_send_vectored(handle, buffers, 2, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_033: [If the segments are empty or allocating the buffer fails, xio_send_vectored shall return a non-zero value.] */
+TEST_FUNCTION(when_allocating_the_concatenated_buffer_fails_then_xio_send_vectored_fails)
+{
+    // arrange
+    unsigned char send_data[] = { 0x42, 43 };
+    XIO_BUFFER buffers[1];
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    buffers[0].buffer = send_data;
+    buffers[0].size = sizeof(send_data);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(send_data)))
+        .SetReturn(NULL);
+
+    // act
+    int result = xio_send_vectored(handle, buffers, 1, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* xio_get_statistics */
+
+/* Tests_SRS_XIO_01_035: [If xio or statistics is NULL, xio_get_statistics shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_statistics_with_NULL_handle_fails)
+{
+    // arrange
+    XIO_STATISTICS statistics;
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_statistics(NULL, &statistics);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_XIO_01_035: [If xio or statistics is NULL, xio_get_statistics shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_statistics_with_NULL_statistics_fails)
+{
+    // arrange
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_statistics, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_statistics(handle, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_036: [If the concrete IO implementation does not provide concrete_io_get_statistics, xio_get_statistics shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_statistics_without_concrete_get_statistics_fails)
+{
+    // arrange
+    XIO_STATISTICS statistics;
+    XIO_HANDLE handle = xio_create(&test_io_description, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_statistics(handle, &statistics);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_037: [Otherwise xio_get_statistics shall call concrete_io_get_statistics and return its result.] */
+TEST_FUNCTION(xio_get_statistics_calls_the_concrete_get_statistics)
+{
+    // arrange
+    XIO_STATISTICS statistics;
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_statistics, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_get_statistics(TEST_CONCRETE_IO_HANDLE, &statistics));
+
+    // act
+    int result = xio_get_statistics(handle, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_037: [Otherwise xio_get_statistics shall call concrete_io_get_statistics and return its result.] */
+TEST_FUNCTION(when_the_concrete_get_statistics_fails_then_xio_get_statistics_fails)
+{
+    // arrange
+    XIO_STATISTICS statistics;
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_statistics, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_get_statistics(TEST_CONCRETE_IO_HANDLE, &statistics))
+        .SetReturn(42);
+
+    // act
+    int result = xio_get_statistics(handle, &statistics);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* xio_get_socket */
+
+/* Tests_SRS_XIO_01_041: [If xio or socket_handle is NULL, xio_get_socket shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_socket_with_NULL_handle_fails)
+{
+    // arrange
+    intptr_t socket_handle;
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_socket(NULL, &socket_handle);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_XIO_01_041: [If xio or socket_handle is NULL, xio_get_socket shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_socket_with_NULL_socket_handle_fails)
+{
+    // arrange
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_socket, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_socket(handle, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_042: [If the concrete IO implementation does not provide concrete_io_get_socket, xio_get_socket shall return a non-zero value.] */
+TEST_FUNCTION(xio_get_socket_without_concrete_get_socket_fails)
+{
+    // arrange
+    intptr_t socket_handle;
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_statistics, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    int result = xio_get_socket(handle, &socket_handle);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_043: [Otherwise xio_get_socket shall call concrete_io_get_socket and return its result.] */
+TEST_FUNCTION(xio_get_socket_calls_the_concrete_get_socket)
+{
+    // arrange
+    intptr_t socket_handle;
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_socket, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_get_socket(TEST_CONCRETE_IO_HANDLE, &socket_handle));
+
+    // act
+    int result = xio_get_socket(handle, &socket_handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* Tests_SRS_XIO_01_043: [Otherwise xio_get_socket shall call concrete_io_get_socket and return its result.] */
+TEST_FUNCTION(when_the_concrete_get_socket_fails_then_xio_get_socket_fails)
+{
+    // arrange
+    intptr_t socket_handle;
+    XIO_HANDLE handle = xio_create(&test_io_description_with_get_socket, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(test_xio_get_socket(TEST_CONCRETE_IO_HANDLE, &socket_handle))
+        .SetReturn(42);
+
+    // act
+    int result = xio_get_socket(handle, &socket_handle);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    xio_destroy(handle);
+}
+
+/* xio_statistics_add_send_latency */
+
+/* Tests_SRS_XIO_01_039: [xio_statistics_add_send_latency shall increment the bucket of the send latency histogram whose range holds latency_us.] */
+TEST_FUNCTION(xio_statistics_add_send_latency_picks_the_power_of_two_bucket)
+{
+    // arrange
+    XIO_STATISTICS statistics;
+    (void)memset(&statistics, 0, sizeof(statistics));
+
+    // act
+    xio_statistics_add_send_latency(&statistics, 0);
+    xio_statistics_add_send_latency(&statistics, 1);
+    xio_statistics_add_send_latency(&statistics, 3);
+    xio_statistics_add_send_latency(&statistics, 4);
+    xio_statistics_add_send_latency(&statistics, UINT64_MAX);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 1, (int)statistics.send_latency_histogram[0]);
+    ASSERT_ARE_EQUAL(int, 1, (int)statistics.send_latency_histogram[1]);
+    ASSERT_ARE_EQUAL(int, 1, (int)statistics.send_latency_histogram[2]);
+    ASSERT_ARE_EQUAL(int, 1, (int)statistics.send_latency_histogram[3]);
+    ASSERT_ARE_EQUAL(int, 1, (int)statistics.send_latency_histogram[XIO_SEND_LATENCY_BUCKET_COUNT - 1]);
+}
+
+/* Tests_SRS_XIO_01_038: [If statistics is NULL, xio_statistics_add_send_latency shall do nothing.] */
+TEST_FUNCTION(xio_statistics_add_send_latency_with_NULL_statistics_does_nothing)
+{
+    // arrange
+    umock_c_reset_all_calls();
+
+    // act
+    xio_statistics_add_send_latency(NULL, 42);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* xio_dowork */
 
 /* Tests_SRS_XIO_01_012: [xio_dowork shall call the concrete IO implementation specified in xio_create, by calling the concrete_xio_dowork function.] */